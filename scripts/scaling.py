@@ -0,0 +1,243 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-3.0-or-later
+# Copyright (C) 2022 Niccolò Betto
+
+"""Scaling study over the InputDecks benchmark ladder.
+
+Runs every deck for each combination of thread count and tiles_per_chunk, as a single clover_leaf run with the threads
+keyword set, so the tiles of the chunk are shared by a team of that many threads. By default the deck is the same for
+every thread count, so the same work is shared by more threads (strong scaling). With --weak the mesh grows with the
+threads instead, T times the rows of the deck on T threads, so the work per thread stays the same (weak scaling). The
+team has at most tiles_per_chunk threads, so configurations with more threads than tiles are skipped. Each
+configuration is repeated and the repetition with the median wall clock is kept.
+
+Per configuration the results file records the wall clock, the grind time (the last "Average time per cell" of
+clover.out), the number of steps and the profiler breakdown. A summary table of the scaling efficiency is printed, and
+with --baseline the grind times are compared to a previous results file, exiting with status 1 if any configuration
+got slower than the noise threshold allows.
+
+usage: scripts/scaling.py [-t 1,2,4] [-p 4,16] [-r 3] [--weak] [-o scaling.csv] [--baseline old.csv] [deck.in ...]
+"""
+
+import argparse
+import csv
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Profiler rows of clover.out, in order, with the column they are saved as
+PROFILER_ROWS = [
+    ("Timestep", "timestep"),
+    ("Ideal Gas", "ideal_gas"),
+    ("Viscosity", "viscosity"),
+    ("PdV", "pdv"),
+    ("Acceleration", "acceleration"),
+    ("Lagrangian blocks", "lagrangian"),
+    ("Cell advection", "cell_advection"),
+    ("Momentum advection", "mom_advection"),
+    ("Reset", "reset"),
+    ("Summary", "summary"),
+    ("Visit", "visit"),
+    ("Tile halo exchange", "tile_halo_exchange"),
+    ("Self halo exchange", "self_halo_exchange"),
+    ("MPI halo exchange", "mpi_halo_exchange"),
+]
+
+KEY_COLUMNS = ["deck", "tiles", "threads", "cells"]
+COLUMNS = KEY_COLUMNS + ["steps", "wall_clock", "grind_time"] + [column for _, column in PROFILER_ROWS]
+
+
+def ladder_decks(max_cells):
+    """The clover_bm*_short decks, smallest first, skipping the ones above max_cells"""
+    decks = []
+    for name in os.listdir(os.path.join(ROOT, "InputDecks")):
+        if re.fullmatch(r"clover_bm\d*_short\.in", name):
+            path = os.path.join(ROOT, "InputDecks", name)
+            cells = deck_cells(read(path))
+            if cells <= max_cells:
+                decks.append((cells, path))
+    return [path for _, path in sorted(decks)]
+
+
+def read(path):
+    with open(path) as f:
+        return f.read()
+
+
+def keyword(deck, name):
+    """The value of the last occurrence of a keyword of the deck, the one that applies"""
+    values = re.findall(r"^\s*%s\s*=?\s*([0-9.eE+-]+)" % name, deck, re.M)
+    return values[-1] if values else None
+
+
+def deck_cells(deck):
+    x = keyword(deck, "x_cells")
+    y = keyword(deck, "y_cells")
+    return int(x) * int(y) if x and y else 0
+
+
+def override(deck, overrides):
+    """Appends keywords to the *clover section, where they override the earlier ones as in clover_batch grids"""
+    end = deck.lower().rfind("*endclover")
+    if end < 0:
+        end = len(deck)
+    return deck[:end] + "".join(" %s\n" % o for o in overrides) + deck[end:]
+
+
+def parse_output(path):
+    """Wall clock, grind time, steps and profiler times of one clover.out"""
+    text = read(path)
+    if "Calculation completed" not in text:
+        raise RuntimeError("run did not complete: " + path)
+
+    final = text[text.index("Calculation completed"):]
+    result = {
+        "wall_clock": float(re.search(r"Wall clock\s+(\S+)", final).group(1)),
+        "steps": int(re.findall(r"^ *Step\s+(\d+)", text, re.M)[-1]),
+        "grind_time": float((re.findall(r"Average time per cell\s+(\S+)", text) or ["nan"])[-1]),
+    }
+    for row, column in PROFILER_ROWS:
+        match = re.search(r"^%s\s*:\s*(\S+)" % re.escape(row), final, re.M)
+        result[column] = float(match.group(1)) if match else 0.0
+    return result
+
+
+def scaled_deck(args, deck_path, tiles, threads):
+    """The deck of a configuration, with its mesh grown by the number of threads for weak scaling"""
+    deck = read(deck_path)
+    overrides = ["tiles_per_chunk=%d" % tiles, "threads=%d" % threads, "profiler_on"]
+    if args.weak:
+        y_cells = int(keyword(deck, "y_cells"))
+        ymax = float(keyword(deck, "ymax") or 10.0)
+        # The cells keep their size, the domain grows upwards with the rows
+        overrides += ["y_cells=%d" % (y_cells * threads), "ymax=%r" % (ymax * threads)]
+    return override(deck, overrides)
+
+
+def run_config(args, deck):
+    """Runs one configuration in a directory of its own"""
+    work = tempfile.mkdtemp(prefix="clover_scaling_")
+    try:
+        with open(os.path.join(work, "clover.in"), "w") as f:
+            f.write(deck)
+        subprocess.run([args.leaf], cwd=work, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True)
+        return parse_output(os.path.join(work, "clover.out"))
+    finally:
+        shutil.rmtree(work, ignore_errors=True)
+
+
+def measure(args, deck_path, tiles, threads):
+    deck = scaled_deck(args, deck_path, tiles, threads)
+    samples = [run_config(args, deck) for _ in range(args.repeat)]
+    samples.sort(key=lambda s: s["wall_clock"])
+    result = samples[(len(samples) - 1) // 2]
+    result.update(deck=os.path.basename(deck_path), tiles=tiles, threads=threads, cells=deck_cells(deck))
+    return result
+
+
+def print_summary(results, weak):
+    kind = "Weak" if weak else "Strong"
+    print("\n%s scaling, %s" % (kind, "the rows of the deck times the threads" if weak else "the same deck"))
+    print("%-26s%6s%8s%14s%14s%12s" % ("Deck", "Tiles", "Threads", "Wall (s)", "Grind (s)", "Efficiency"))
+
+    for r in results:
+        # Reference: the smallest thread count of the same deck and tiles
+        reference = next(s for s in results if s["deck"] == r["deck"] and s["tiles"] == r["tiles"])
+        if weak:
+            # Ideal: the wall clock stays the same as the threads, and the work, grow
+            efficiency = reference["wall_clock"] / r["wall_clock"]
+        else:
+            # Ideal: the wall clock drops in proportion to the threads
+            efficiency = reference["wall_clock"] * reference["threads"] / (r["wall_clock"] * r["threads"])
+        print(
+            "%-26s%6d%8d%14.4f%14.4e%11.1f%%"
+            % (r["deck"], r["tiles"], r["threads"], r["wall_clock"], r["grind_time"], 100.0 * efficiency)
+        )
+
+
+def compare(results, baseline_path, threshold):
+    """Prints the grind time changes against a baseline, returning the number of regressions"""
+    with open(baseline_path) as f:
+        baseline = {tuple(row[k] for k in KEY_COLUMNS): row for row in csv.DictReader(f)}
+
+    print("\nComparison with %s, noise threshold %.1f%%" % (baseline_path, 100.0 * threshold))
+    print("%-26s%6s%8s%12s%14s%14s%10s" % ("Deck", "Tiles", "Threads", "Cells", "Base (s)", "Grind (s)", "Change"))
+
+    regressions = 0
+    for r in results:
+        row = baseline.get(tuple(str(r[k]) for k in KEY_COLUMNS))
+        if row is None:
+            continue
+
+        base = float(row["grind_time"])
+        change = r["grind_time"] / base - 1.0
+        flag = ""
+        if change > threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -threshold:
+            flag = "  improved"
+        print(
+            "%-26s%6d%8d%12d%14.4e%14.4e%+9.1f%%%s"
+            % (r["deck"], r["tiles"], r["threads"], r["cells"], base, r["grind_time"], 100.0 * change, flag)
+        )
+    return regressions
+
+
+def int_list(value):
+    return [int(v) for v in value.split(",")]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Scaling study over the InputDecks benchmark ladder")
+    parser.add_argument("decks", nargs="*", help="decks to run (default: the clover_bm*_short ladder)")
+    parser.add_argument("-t", "--threads", type=int_list, default=[1, 2, 4], help="thread counts (default: 1,2,4)")
+    parser.add_argument("-p", "--tiles", type=int_list, default=[4, 16], help="tiles_per_chunk values (default: 4,16)")
+    parser.add_argument("-r", "--repeat", type=int, default=3, help="repetitions of each configuration (default: 3)")
+    parser.add_argument("-o", "--output", default="scaling.csv", help="results file (default: scaling.csv)")
+    parser.add_argument("--weak", action="store_true", help="grow the rows of the mesh with the threads")
+    parser.add_argument("--max-cells", type=float, default=4.0e6, help="largest ladder deck (default: 4e6 cells)")
+    parser.add_argument("--baseline", help="results file of a previous study to compare against")
+    parser.add_argument("--threshold", type=float, default=0.05, help="noise threshold (default: 0.05, i.e. 5%%)")
+    parser.add_argument("--leaf", default=os.path.join(ROOT, "clover_leaf"), help="clover_leaf binary")
+    args = parser.parse_args()
+
+    args.threads.sort()
+    decks = args.decks or ladder_decks(args.max_cells)
+    if not decks:
+        parser.error("no decks to run")
+    if not os.access(args.leaf, os.X_OK):
+        parser.error("%s not found, build it with make clover_leaf" % args.leaf)
+
+    results = []
+    for deck in decks:
+        for tiles in args.tiles:
+            for threads in args.threads:
+                name = "%s, %d tiles, %d threads" % (os.path.basename(deck), tiles, threads)
+                if threads > tiles:
+                    print(name + ": skipped, more threads than tiles")
+                    continue
+                print(name)
+                sys.stdout.flush()
+                results.append(measure(args, deck, tiles, threads))
+
+    with open(args.output, "w", newline="") as f:
+        writer = csv.DictWriter(f, COLUMNS, extrasaction="ignore")
+        writer.writeheader()
+        writer.writerows(results)
+
+    print_summary(results, args.weak)
+    print("\nResults saved to %s" % args.output)
+
+    if args.baseline and compare(results, args.baseline, args.threshold) > 0:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "activity.h"
+
+#include <stdlib.h>
+
+#include "definitions.h"
+#include "kernels/kernels.h"
+#include "report.h"
+
+typedef struct tile_activity_t {
+  bool active;  // Seen out of rest, never skipped again
+  bool skip;    // Skipped by the current step
+  double density;
+  double energy;
+} tile_activity;
+
+static BATCH_LOCAL tile_activity *tiles = NULL;
+
+// The tiles within ACTIVITY_MARGIN cells of tile t are near[near_start[t]] to near[near_start[t + 1] - 1]
+static BATCH_LOCAL int *near_start = NULL;
+static BATCH_LOCAL int *near = NULL;
+
+static BATCH_LOCAL long skipped;
+
+/**
+ * @brief Whether tile b overlaps tile a grown by ACTIVITY_MARGIN cells on every side
+ */
+static bool within_margin(const tile_type *a, const tile_type *b) {
+  return b->t_left <= a->t_right + ACTIVITY_MARGIN && b->t_right >= a->t_left - ACTIVITY_MARGIN &&
+         b->t_bottom <= a->t_top + ACTIVITY_MARGIN && b->t_top >= a->t_bottom - ACTIVITY_MARGIN;
+}
+
+void activity_open() {
+  activity_close();
+
+  skipped = 0;
+
+  // Full sweeps only need the count, which stays at zero
+  if (full_sweep || tiles_per_chunk < 2)
+    return;
+
+  int num_near = 0;
+  for (int a = 0; a < tiles_per_chunk; a++)
+    for (int b = 0; b < tiles_per_chunk; b++)
+      if (a != b && within_margin(&chunk.tiles[a], &chunk.tiles[b]))
+        num_near++;
+
+  tiles = calloc(tiles_per_chunk, sizeof(tile_activity));
+  near_start = malloc((tiles_per_chunk + 1) * sizeof(int));
+  near = malloc((num_near > 0 ? num_near : 1) * sizeof(int));
+  if (tiles == NULL || near_start == NULL || near == NULL) {
+    activity_close();
+    report_error("activity_open", "Error allocating the tile activity.");
+  }
+
+  num_near = 0;
+  for (int a = 0; a < tiles_per_chunk; a++) {
+    near_start[a] = num_near;
+    for (int b = 0; b < tiles_per_chunk; b++)
+      if (a != b && within_margin(&chunk.tiles[a], &chunk.tiles[b]))
+        near[num_near++] = b;
+  }
+  near_start[tiles_per_chunk] = num_near;
+}
+
+void activity_update() {
+  if (tiles == NULL)
+    return;
+
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    tile_activity *cur = &tiles[tile];
+    tile_type *tile_ptr = &chunk.tiles[tile];
+
+    if (cur->active)
+      continue;
+
+    cur->active = !kernel_quiescent(
+        tile_ptr->t_xmin,
+        tile_ptr->t_xmax,
+        tile_ptr->t_ymin,
+        tile_ptr->t_ymax,
+        tile_ptr->field.density0,
+        tile_ptr->field.energy0,
+        tile_ptr->field.volume,
+        tile_ptr->field.viscosity,
+        tile_ptr->field.xvel0,
+        tile_ptr->field.yvel0,
+        tile_ptr->field.vol_flux_x,
+        tile_ptr->field.vol_flux_y,
+        tile_ptr->field.mass_flux_x,
+        tile_ptr->field.mass_flux_y,
+        &cur->density,
+        &cur->energy,
+        tile_ptr->field.uniform_volume
+    );
+  }
+
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    tile_activity *cur = &tiles[tile];
+
+    // The first step has no reset_field behind it, the time level 1 fields don't match the time level 0 ones yet
+    cur->skip = step > 1 && !cur->active;
+    for (int n = near_start[tile]; n < near_start[tile + 1] && cur->skip; n++) {
+      const tile_activity *other = &tiles[near[n]];
+      cur->skip = !other->active && other->density == cur->density && other->energy == cur->energy;
+    }
+
+    if (cur->skip)
+      skipped++;
+  }
+}
+
+bool activity_skip(int tile) {
+  return tiles != NULL && tiles[tile].skip;
+}
+
+long activity_skipped() {
+  return skipped;
+}
+
+void activity_close() {
+  free(tiles);
+  free(near_start);
+  free(near);
+
+  tiles = NULL;
+  near_start = NULL;
+  near = NULL;
+}
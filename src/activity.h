@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Tile activity tracking, skipping the tiles where nothing can happen during a step
+ * @details Ahead of a shock most of the mesh is at rest in a uniform state, and a step leaves it exactly as it is:
+ * viscosity, PdV, accelerate and the advection sweeps all reduce to identities there. At the start of every step each
+ * tile is scanned with kernel_quiescent(), and a tile is skipped by those kernels when it and every tile within
+ * ACTIVITY_MARGIN cells of it are at rest in the same state. The margin covers how far a disturbance can travel in one
+ * step: one cell each for viscosity, the two PdV calls, accelerate and the fluxes, two cells for each cell advection
+ * sweep and three for each momentum sweep, 15 cells in all. The skipped tiles end the step bitwise identical to a full
+ * sweep.
+ *
+ * A tile seen out of rest once stays active for the rest of the run and is no longer scanned, which keeps the scans to
+ * the part of the mesh the disturbance hasn't reached yet. The timestep, the halo exchanges and reset_field still run
+ * everywhere, and the equation of state wherever the time level 0 one isn't current already (see ideal_gas()). The unit
+ * of skipping is the tile, so it only pays off with tiles_per_chunk > 1. The full_sweep deck keyword turns it off.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+// Cells around a tile that must be at rest for it to be skipped, see above
+#define ACTIVITY_MARGIN 16
+
+/**
+ * @brief Sets up the tracking of the tiles, called once the fields are generated
+ */
+extern void activity_open();
+
+/**
+ * @brief Scans the tiles and decides which ones the coming step skips, called at the start of every step
+ */
+extern void activity_update();
+
+/**
+ * @brief Whether the current step skips a tile, false when the tracking isn't open
+ */
+extern bool activity_skip(int tile);
+
+/**
+ * @brief Number of tile steps skipped so far
+ */
+extern long activity_skipped();
+
+/**
+ * @brief Releases the tracking, safe to call when it isn't open
+ */
+extern void activity_close();
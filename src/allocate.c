@@ -1,17 +1,120 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2022 Niccolò Betto
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "activity.h"
 #include "definitions.h"
+#include "flow.h"
+#include "halo.h"
+#include "jit.h"
+#include "report.h"
+#include "shm_export.h"
+#include "team.h"
 #include "utils/array.h"
 
+/**
+ * @brief A released field array, kept around so that the next run of the same size can reuse it. The bookkeeping is
+ * stored inside the released memory itself.
+ */
+typedef struct cached_block_t {
+  struct cached_block_t *next;
+  size_t size;
+} cached_block;
+
+// Arrays released by destroy_field(), waiting to be picked up by the next build_field(). Kept in release order so that
+// each array gets back the same memory on the next run
+static BATCH_LOCAL cached_block *field_cache = NULL;
+static BATCH_LOCAL cached_block *field_cache_tail = NULL;
+
+// Memory the field arrays are carved from instead of the heap while set, see field_set_arena()
+static BATCH_LOCAL char *field_arena = NULL;
+static BATCH_LOCAL size_t field_arena_size = 0;
+static BATCH_LOCAL size_t field_arena_used = 0;
+
+/**
+ * @brief Places the field arrays allocated from now on one after the other in the given memory, each aligned to 64
+ * bytes, instead of allocating them separately. Arrays inside the arena are never released to the cache.
+ * @param arena The memory to use, or NULL to go back to the heap
+ */
+void field_set_arena(void *arena, size_t size) {
+  field_arena = arena;
+  field_arena_size = size;
+  field_arena_used = 0;
+}
+
+/**
+ * @brief Allocates a field array, reusing a previously released array of the same size if one is available
+ */
+static void *field_alloc(size_t size) {
+  cached_block *prev = NULL;
+
+  if (field_arena != NULL) {
+    void *ptr = field_arena + field_arena_used;
+    field_arena_used += (size + 63) & ~(size_t)63;
+    if (field_arena_used > field_arena_size)
+      report_error("field_alloc", "Field arena exhausted");
+    return ptr;
+  }
+
+  for (cached_block *block = field_cache; block != NULL; prev = block, block = block->next) {
+    if (block->size != size)
+      continue;
+
+    if (prev != NULL)
+      prev->next = block->next;
+    else
+      field_cache = block->next;
+
+    if (block == field_cache_tail)
+      field_cache_tail = prev;
+
+    return block;
+  }
+
+  return malloc(size);
+}
+
+/**
+ * @brief Releases a field array to the cache instead of returning it to the system
+ */
+static void field_free(void *ptr, size_t size) {
+  if (field_arena != NULL && (char *)ptr >= field_arena && (char *)ptr < field_arena + field_arena_size)
+    return;
+
+  // Every field array holds at least a halo of 5 elements, so the bookkeeping always fits
+  cached_block *block = ptr;
+  block->size = size;
+  block->next = NULL;
+
+  if (field_cache_tail != NULL)
+    field_cache_tail->next = block;
+  else
+    field_cache = block;
+  field_cache_tail = block;
+}
+
+/**
+ * @brief Returns all the arrays still held by the cache to the system
+ */
+void release_field_cache() {
+  while (field_cache != NULL) {
+    cached_block *next = field_cache->next;
+    free(field_cache);
+    field_cache = next;
+  }
+  field_cache_tail = NULL;
+}
+
 /** @brief Allocates a 1D array, and performs shifting of the array pointer to allow access to the array using the same
  * indexing as in Fortran
  * @param array A pointer to the array pointer
  */
 void allocate_array(double **array, size_t lower_bound, size_t upper_bound) {
-  *array = malloc((upper_bound - lower_bound + 1) * sizeof(double));
+  *array = field_alloc((upper_bound - lower_bound + 1) * sizeof(double));
 
 #ifdef ARRAY_SHIFT_INDEXING
   *array = array_shift_indexing_1D_double(*array, lower_bound);
@@ -25,7 +128,8 @@ void allocate_array(double **array, size_t lower_bound, size_t upper_bound) {
 void allocate_matrix(
     double **matrix, size_t lower_bound_x, size_t upper_bound_x, size_t lower_bound_y, size_t upper_bound_y
 ) {
-  *matrix = malloc((upper_bound_y - lower_bound_y + 1) * (upper_bound_x - lower_bound_x + 1) * sizeof(double));
+  *matrix =
+      field_alloc((upper_bound_y - lower_bound_y + 1) * (upper_bound_x - lower_bound_x + 1) * sizeof(double));
 
 #ifdef ARRAY_SHIFT_INDEXING
   *matrix = array_shift_indexing_2D_double(*matrix, lower_bound_y, lower_bound_x, upper_bound_x);
@@ -40,7 +144,7 @@ void deallocate_array(double **array, size_t lower_bound, size_t upper_bound) {
   *array = array_revert_indexing_1D_double(*array, lower_bound);
 #endif
 
-  free(*array);
+  field_free(*array, (upper_bound - lower_bound + 1) * sizeof(double));
 }
 
 /** @brief Dellocates a 2D array previously allocated with `allocate_matrix` by reverting the shifting first
@@ -53,277 +157,187 @@ void deallocate_matrix(
   *matrix = array_revert_indexing_2D_double(*matrix, lower_bound_y, lower_bound_x, upper_bound_x);
 #endif
 
-  free(*matrix);
+  field_free(*matrix, (upper_bound_y - lower_bound_y + 1) * (upper_bound_x - lower_bound_x + 1) * sizeof(double));
 }
 
 /**
- * @brief Allocates the data for each mesh chunk
- * @details The data fields for the mesh chunk are allocated based on the mesh size
+ * @brief The field_type member holding one of the field arrays
  */
-void build_field() {
-  int tile, j, k;
+static double **field_array_ptr(field_type *field, const field_array_type *array) {
+  return (double **)((char *)field + array->offset);
+}
 
-  for (tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *cur_tile = &chunk.tiles[tile];
-    field_type *cur_field = &cur_tile->field;
-
-    allocate_matrix(
-        &cur_field->density0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->density1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->energy0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->energy1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->pressure, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->viscosity, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->soundspeed, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-
-    allocate_matrix(
-        &cur_field->xvel0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->xvel1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->yvel0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->yvel1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    allocate_matrix(
-        &cur_field->vol_flux_x, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->mass_flux_x, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->vol_flux_y, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->mass_flux_y, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    allocate_matrix(
-        &cur_field->work_array1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->work_array2, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->work_array3, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->work_array4, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->work_array5, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->work_array6, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    allocate_matrix(
-        &cur_field->work_array7, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    allocate_array(&cur_field->cellx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2);
-    allocate_array(&cur_field->celly, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2);
-    allocate_array(&cur_field->vertexx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3);
-    allocate_array(&cur_field->vertexy, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3);
-    allocate_array(&cur_field->celldx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2);
-    allocate_array(&cur_field->celldy, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2);
-    allocate_array(&cur_field->vertexdx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3);
-    allocate_array(&cur_field->vertexdy, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3);
-
-    allocate_matrix(
-        &cur_field->volume, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->xarea, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    allocate_matrix(
-        &cur_field->yarea, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    // Zeroing isn't strictly neccessary but it ensures physical pages
-    // are allocated. This prevents first touch overheads in the main code
-    // cycle which can skew timings in the first step
-
-    int stride = (cur_tile->t_xmax + 3) - (cur_tile->t_xmin - 2) + 1;
-    for (k = 0; k <= (cur_tile->t_ymax + 3) - (cur_tile->t_ymin - 2); k++) {
-      for (j = 0; j <= (cur_tile->t_xmax + 3) - (cur_tile->t_xmin - 2); j++) {
-        cur_field->work_array1[k * stride + j] = 0.0;
-        cur_field->work_array2[k * stride + j] = 0.0;
-        cur_field->work_array3[k * stride + j] = 0.0;
-        cur_field->work_array4[k * stride + j] = 0.0;
-        cur_field->work_array5[k * stride + j] = 0.0;
-        cur_field->work_array6[k * stride + j] = 0.0;
-        cur_field->work_array7[k * stride + j] = 0.0;
-
-        cur_field->xvel0[k * stride + j] = 0.0;
-        cur_field->xvel1[k * stride + j] = 0.0;
-        cur_field->yvel0[k * stride + j] = 0.0;
-        cur_field->yvel1[k * stride + j] = 0.0;
-      }
-    }
+/**
+ * @brief Whether build_field() allocates one of the field arrays, all but the volume and area planes on a uniform grid
+ */
+static bool field_array_built(const field_array_type *array) {
+  if (!uniform_grid)
+    return true;
 
-    stride = (cur_tile->t_xmax + 2) - (cur_tile->t_xmin - 2) + 1;
-    for (k = 0; k <= (cur_tile->t_ymax + 2) - (cur_tile->t_ymin - 2); k++) {
-      for (j = 0; j <= (cur_tile->t_xmax + 2) - (cur_tile->t_xmin - 2); j++) {
-        cur_field->density0[k * stride + j] = 0.0;
-        cur_field->density1[k * stride + j] = 0.0;
-        cur_field->energy0[k * stride + j] = 0.0;
-        cur_field->energy1[k * stride + j] = 0.0;
-        cur_field->pressure[k * stride + j] = 0.0;
-        cur_field->viscosity[k * stride + j] = 0.0;
-        cur_field->soundspeed[k * stride + j] = 0.0;
-        cur_field->volume[k * stride + j] = 0.0;
-      }
-    }
+  return array->offset != offsetof(field_type, volume) && array->offset != offsetof(field_type, xarea) &&
+         array->offset != offsetof(field_type, yarea);
+}
 
-    stride = (cur_tile->t_xmax + 3) - (cur_tile->t_xmin - 2) + 1;
-    for (k = 0; k <= (cur_tile->t_ymax + 2) - (cur_tile->t_ymin - 2); k++) {
-      for (j = 0; j <= (cur_tile->t_xmax + 3) - (cur_tile->t_xmin - 2); j++) {
-        cur_field->vol_flux_x[k * stride + j] = 0.0;
-        cur_field->mass_flux_x[k * stride + j] = 0.0;
-        cur_field->xarea[k * stride + j] = 0.0;
-      }
-    }
+/**
+ * @brief Elements of one of the field arrays of a tile, halo included
+ */
+static size_t field_array_elements(const field_array_type *array, const tile_type *tile) {
+  size_t columns = array->x_extra != 0 ? tile->t_xmax - tile->t_xmin + 1 + array->x_extra : 1;
+  size_t rows = array->y_extra != 0 ? tile->t_ymax - tile->t_ymin + 1 + array->y_extra : 1;
+  return columns * rows;
+}
 
-    stride = (cur_tile->t_xmax + 2) - (cur_tile->t_xmin - 2) + 1;
-    for (k = 0; k <= (cur_tile->t_ymax + 3) - (cur_tile->t_ymin - 2); k++) {
-      for (j = 0; j <= (cur_tile->t_xmax + 2) - (cur_tile->t_xmin - 2); j++) {
-        cur_field->vol_flux_y[k * stride + j] = 0.0;
-        cur_field->mass_flux_y[k * stride + j] = 0.0;
-        cur_field->yarea[k * stride + j] = 0.0;
-      }
-    }
+/**
+ * @brief Elements of one of the field arrays of a tile covering its own cells, the rest is halo
+ */
+static size_t field_array_interior(const field_array_type *array, const tile_type *tile) {
+  size_t columns = array->x_extra != 0 ? tile->t_xmax - tile->t_xmin + 1 : 1;
+  size_t rows = array->y_extra != 0 ? tile->t_ymax - tile->t_ymin + 1 : 1;
+  return columns * rows;
+}
 
-    for (j = 0; j <= (cur_tile->t_xmax + 2) - (cur_tile->t_xmin - 2); j++) {
-      cur_field->cellx[j] = 0.0;
-      cur_field->celldx[j] = 0.0;
-    }
+/**
+ * @brief Zeroes the field arrays of the tiles of a team member
+ * @details Zeroing isn't strictly neccessary but it ensures physical pages are allocated. This prevents first touch
+ * overheads in the main code cycle which can skew timings in the first step. Each member of the team zeroes the tiles
+ * it runs, so that their pages are placed on its NUMA node, see team.h. The arrays reused from the cache keep the pages
+ * of the previous run.
+ */
+static void touch_field() {
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++) {
+    tile_type *cur_tile = &chunk.tiles[tile];
 
-    for (j = 0; j <= (cur_tile->t_ymax + 2) - (cur_tile->t_ymin - 2); j++) {
-      cur_field->celly[j] = 0.0;
-      cur_field->celldy[j] = 0.0;
+    for (int a = 0; a < NUM_FIELD_ARRAYS; a++) {
+      const field_array_type *array = &field_arrays[a];
+      if (field_array_built(array))
+        memset(*field_array_ptr(&cur_tile->field, array), 0, field_array_elements(array, cur_tile) * sizeof(double));
     }
+  }
+}
 
-    for (j = 0; j <= (cur_tile->t_xmax + 3) - (cur_tile->t_xmin - 2); j++) {
-      cur_field->vertexx[j] = 0.0;
-      cur_field->vertexdx[j] = 0.0;
-    }
+/**
+ * @brief Allocates the data for each mesh chunk
+ * @details The data fields for the mesh chunk are allocated based on the mesh size, with the layout of field_arrays.
+ * Arrays released by a previous destroy_field() call are reused when their size matches, any other cached array is
+ * released afterwards. On a uniform grid the volume and area planes are left NULL, see kernels/geometry.h.
+ */
+void build_field() {
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    tile_type *cur_tile = &chunk.tiles[tile];
 
-    for (j = 0; j <= (cur_tile->t_ymax + 3) - (cur_tile->t_ymin - 2); j++) {
-      cur_field->vertexy[j] = 0.0;
-      cur_field->vertexdy[j] = 0.0;
+    for (int a = 0; a < NUM_FIELD_ARRAYS; a++) {
+      const field_array_type *array = &field_arrays[a];
+      double **ptr = field_array_ptr(&cur_tile->field, array);
+
+      if (!field_array_built(array))
+        *ptr = NULL;
+      else if (array->x_extra == 0)
+        allocate_array(ptr, cur_tile->t_ymin - 2, cur_tile->t_ymax + array->y_extra - 2);
+      else if (array->y_extra == 0)
+        allocate_array(ptr, cur_tile->t_xmin - 2, cur_tile->t_xmax + array->x_extra - 2);
+      else
+        allocate_matrix(
+            ptr,
+            cur_tile->t_xmin - 2,
+            cur_tile->t_xmax + array->x_extra - 2,
+            cur_tile->t_ymin - 2,
+            cur_tile->t_ymax + array->y_extra - 2
+        );
     }
   }
+
+  team_run(touch_field);
+
+  // Whatever is left was sized for a different mesh
+  release_field_cache();
 }
 
+/**
+ * @brief Deallocates the data for each mesh chunk
+ * @details The arrays are kept in a cache so that a following build_field() call for a mesh of the same size doesn't
+ * need to allocate them again, see release_field_cache(). Tiles whose fields were never built, as in a dry run, are
+ * skipped.
+ */
 void destroy_field() {
   for (int tile = 0; tile < tiles_per_chunk; tile++) {
     tile_type *cur_tile = &chunk.tiles[tile];
-    field_type *cur_field = &cur_tile->field;
-
-    deallocate_matrix(
-        &cur_field->density0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->density1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->energy0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->energy1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->pressure, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->viscosity, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->soundspeed, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-
-    deallocate_matrix(
-        &cur_field->xvel0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->xvel1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->yvel0, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->yvel1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    deallocate_matrix(
-        &cur_field->vol_flux_x, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->mass_flux_x, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->vol_flux_y, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->mass_flux_y, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    deallocate_matrix(
-        &cur_field->work_array1, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->work_array2, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->work_array3, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->work_array4, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->work_array5, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->work_array6, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-    deallocate_matrix(
-        &cur_field->work_array7, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
-
-    deallocate_array(&cur_field->cellx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2);
-    deallocate_array(&cur_field->celly, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2);
-    deallocate_array(&cur_field->vertexx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3);
-    deallocate_array(&cur_field->vertexy, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3);
-    deallocate_array(&cur_field->celldx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2);
-    deallocate_array(&cur_field->celldy, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2);
-    deallocate_array(&cur_field->vertexdx, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3);
-    deallocate_array(&cur_field->vertexdy, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3);
-
-    deallocate_matrix(
-        &cur_field->volume, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->xarea, cur_tile->t_xmin - 2, cur_tile->t_xmax + 3, cur_tile->t_ymin - 2, cur_tile->t_ymax + 2
-    );
-    deallocate_matrix(
-        &cur_field->yarea, cur_tile->t_xmin - 2, cur_tile->t_xmax + 2, cur_tile->t_ymin - 2, cur_tile->t_ymax + 3
-    );
+
+    if (cur_tile->field.density0 == NULL)
+      continue;
+
+    for (int a = 0; a < NUM_FIELD_ARRAYS; a++) {
+      const field_array_type *array = &field_arrays[a];
+      double **ptr = field_array_ptr(&cur_tile->field, array);
+
+      if (*ptr == NULL)
+        continue;
+      if (array->x_extra == 0)
+        deallocate_array(ptr, cur_tile->t_ymin - 2, cur_tile->t_ymax + array->y_extra - 2);
+      else if (array->y_extra == 0)
+        deallocate_array(ptr, cur_tile->t_xmin - 2, cur_tile->t_xmax + array->x_extra - 2);
+      else
+        deallocate_matrix(
+            ptr,
+            cur_tile->t_xmin - 2,
+            cur_tile->t_xmax + array->x_extra - 2,
+            cur_tile->t_ymin - 2,
+            cur_tile->t_ymax + array->y_extra - 2
+        );
+      *ptr = NULL;
+    }
   }
 }
+
+/**
+ * @brief Adds up the memory taken by the field arrays of the tiles, as build_field() allocates them
+ */
+void field_footprint(field_footprint_type *footprint) {
+  memset(footprint, 0, sizeof(*footprint));
+  footprint->tile_min = SIZE_MAX;
+
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    const tile_type *cur_tile = &chunk.tiles[tile];
+    size_t tile_bytes = 0;
+
+    for (int a = 0; a < NUM_FIELD_ARRAYS; a++) {
+      if (!field_array_built(&field_arrays[a]))
+        continue;
+
+      size_t bytes = field_array_elements(&field_arrays[a], cur_tile) * sizeof(double);
+
+      footprint->array[a] += bytes;
+      footprint->interior += field_array_interior(&field_arrays[a], cur_tile) * sizeof(double);
+      tile_bytes += bytes;
+    }
+
+    footprint->total += tile_bytes;
+    footprint->tile_min = tile_bytes < footprint->tile_min ? tile_bytes : footprint->tile_min;
+    footprint->tile_max = tile_bytes > footprint->tile_max ? tile_bytes : footprint->tile_max;
+  }
+}
+
+/**
+ * @brief Deallocates the tiles, leaving the states read from the deck for another start() call
+ */
+void destroy_tiles() {
+  activity_close();
+  halo_close();
+  flow_close();
+  team_close();
+  jit_close();
+  destroy_field();
+  shm_export_destroy();
+
+  free(chunk.tiles);
+  chunk.tiles = NULL;
+}
+
+/**
+ * @brief Deallocates the tiles and the states, leaving the globals ready for another initialise() call
+ */
+void destroy_chunk() {
+  destroy_tiles();
+
+  free(states);
+  states = NULL;
+}
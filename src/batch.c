@@ -0,0 +1,501 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Batch driver, running many independent decks concurrently in one process
+ * @details Every run is executed on a worker thread of a shared pool. The simulation globals are thread-local in batch
+ * builds, so each worker owns a complete, independent copy of the program state, and reuses the field arrays of its
+ * previous run when the mesh size matches. Each run reads and writes its files in its own directory.
+ *
+ * The runs come either from a list of decks, or from a parameter grid: a base deck plus one or more scalar keywords
+ * with a list of values each, expanded to their cartesian product. Grid values are appended to the *clover section,
+ * overriding any previous definition of the same keyword.
+ *
+ * In ensemble mode consecutive runs are grouped by ENSEMBLE_WIDTH, and each group advances in SIMD lanes as a single
+ * task (see ensemble.h). Members run as a single tile, and a run whose mesh size differs from the first one of its
+ * group falls back to a normal run after the group is done.
+ */
+
+#include <errno.h>
+#include <setjmp.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "clover.h"
+#include "data.h"
+#include "definitions.h"
+#include "ensemble.h"
+#include "profiler.h"
+#include "report.h"
+#include "utils/thread_pool.h"
+#include "utils/timer.h"
+
+#define BATCH_MAX_PARAMS 16
+
+extern void clover_setup();
+
+extern void clover_main();
+
+/**
+ * @file allocate.c
+ */
+extern void destroy_chunk();
+
+typedef struct batch_run_t {
+  int id;
+  char name[G_LEN_MAX];  // Deck file or grid point the run was generated from
+  char dir[G_LEN_MAX];   // Directory holding the run's files
+  char *deck;            // Contents of the run's clover.in
+
+  bool failed;
+  int steps;
+  double time;
+  double wall_clock;
+} batch_run;
+
+typedef struct batch_ensemble_t {
+  batch_run *runs[ENSEMBLE_WIDTH];
+  int num_runs;
+} batch_ensemble;
+
+typedef struct batch_param_t {
+  char key[G_NAME_LEN_MAX];
+  char *values[G_NAME_LEN_MAX];
+  int num_values;
+} batch_param;
+
+static void usage(const char *argv0) {
+  printf(
+      "Usage: %s [-j threads] [-o output_dir] [-e] deck.in [deck.in ...]\n"
+      "       %s [-j threads] [-o output_dir] [-e] -g base.in -p key=v1,v2,... [-p key=v1,v2,...]\n"
+      "\n"
+      "  -j threads     Number of concurrent runs (default: number of online CPUs)\n"
+      "  -o output_dir  Directory receiving one sub-directory per run (default: batch)\n"
+      "  -e             Ensemble mode, advance groups of %d runs with the same mesh size in SIMD lanes\n"
+      "  -g base.in     Base deck of a parameter grid\n"
+      "  -p key=values  Scalar deck keyword and comma separated values to sweep, can be repeated\n",
+      argv0,
+      argv0,
+      ENSEMBLE_WIDTH
+  );
+  exit(1);
+}
+
+static char *read_file(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    report_error_arg("batch", "Error opening deck: ", path);
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  rewind(file);
+
+  char *contents = malloc(size + 1);
+  size = fread(contents, 1, size, file);
+  contents[size] = '\0';
+  fclose(file);
+
+  return contents;
+}
+
+/**
+ * @brief Creates a directory unless it exists
+ * @return Whether the directory is there
+ */
+static bool make_dir(const char *path) {
+  errno = 0;
+  return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+/**
+ * @brief Builds a deck from the base one, with the given keyword assignments added at the end of the *clover section
+ */
+static char *override_deck(const char *base, const char *overrides) {
+  const char *end = NULL;
+
+  // Find the last *endclover tag, the parser is case insensitive
+  for (const char *s = base; *s != '\0'; s++) {
+    if (strncasecmp(s, "*endclover", 10) == 0)
+      end = s;
+  }
+  if (end == NULL)
+    end = base + strlen(base);
+
+  size_t head = end - base;
+  char *deck = malloc(strlen(base) + strlen(overrides) + 2);
+  memcpy(deck, base, head);
+  strcpy(deck + head, overrides);
+  strcat(deck, end);
+
+  return deck;
+}
+
+static void parse_param(batch_param *param, char *arg) {
+  char *values = strchr(arg, '=');
+  if (values == NULL || values == arg)
+    report_error_arg("batch", "Grid parameters must be in the form key=v1,v2,...: ", arg);
+
+  *values++ = '\0';
+  snprintf(param->key, sizeof(param->key), "%s", arg);
+
+  param->num_values = 0;
+  for (char *value = strtok(values, ","); value != NULL; value = strtok(NULL, ",")) {
+    if (param->num_values == G_NAME_LEN_MAX)
+      report_error_arg("batch", "Too many values for grid parameter: ", param->key);
+    param->values[param->num_values++] = value;
+  }
+
+  if (param->num_values == 0)
+    report_error_arg("batch", "No values given for grid parameter: ", param->key);
+}
+
+/**
+ * @brief Writes the run's deck to its directory and redirects the console output to the run's log
+ */
+static bool begin_run(batch_run *run, const char *contents) {
+  char path[G_LEN_MAX + 16];
+
+  // Before the abort handler is set, so a failure here is the run's alone
+  if (!make_dir(run->dir)) {
+    fprintf(stderr, "Error creating directory: %s\n", run->dir);
+    return false;
+  }
+
+  snprintf(path, sizeof(path), "%s/clover.in", run->dir);
+  FILE *deck = fopen(path, "w");
+  if (deck == NULL)
+    return false;
+  fputs(contents, deck);
+  fclose(deck);
+
+  // Console output of the run goes to its own log
+  snprintf(path, sizeof(path), "%s/clover.log", run->dir);
+  g_stdout = fopen(path, "w");
+  if (g_stdout == NULL)
+    return false;
+
+  g_run_dir = run->dir;
+  return true;
+}
+
+static void end_run() {
+  g_run_dir = NULL;
+
+  if (g_stdout != NULL)
+    fclose(g_stdout);
+  g_stdout = NULL;
+}
+
+static void run_deck(void *arg) {
+  batch_run *run = arg;
+  jmp_buf abort_env;
+
+  double start = timer();
+
+  if (!begin_run(run, run->deck)) {
+    run->failed = true;
+    return;
+  }
+
+  clover_set_abort_handler(&abort_env);
+
+  if (setjmp(abort_env) == 0) {
+    clover_main();
+
+    run->steps = step;
+    run->time = time_val;
+
+    destroy_chunk();
+  } else {
+    // The run aborted at an arbitrary point, its allocations can't be safely released
+    run->failed = true;
+    chunk.tiles = NULL;
+    states = NULL;
+    profiler_close();
+  }
+
+  clover_set_abort_handler(NULL);
+  end_run();
+
+  run->wall_clock = timer() - start;
+}
+
+static void run_ensemble(void *arg) {
+  batch_ensemble *group = arg;
+  jmp_buf abort_env;
+  ensemble_type ens;
+
+  FILE *logs[ENSEMBLE_WIDTH] = {NULL};
+  batch_run *standalone[ENSEMBLE_WIDTH];
+
+  // Modified between setjmp() and a possible longjmp()
+  volatile bool built = false;
+  volatile int num_standalone = 0;
+
+  double start = timer();
+
+  // Set up every member with the normal initialisation path, then move it to its lane
+  for (int i = 0; i < group->num_runs; i++) {
+    batch_run *run = group->runs[i];
+
+    char *deck = override_deck(run->deck, " tiles_per_chunk=1\n");
+    bool started = begin_run(run, deck);
+    free(deck);
+
+    if (!started) {
+      run->failed = true;
+      end_run();
+      continue;
+    }
+
+    clover_set_abort_handler(&abort_env);
+
+    if (setjmp(abort_env) == 0) {
+      clover_setup();
+
+      if (!dry_run && !built) {
+        ensemble_build(&ens, chunk.x_max, chunk.y_max);
+        built = true;
+      }
+
+      if (dry_run) {
+        // Nothing to run, the footprint is in the log already
+        clover_finalize();
+      } else if (ensemble_add_member(&ens, i)) {
+        // The lane keeps writing to the log
+        logs[i] = g_stdout;
+        g_stdout = NULL;
+      } else {
+        standalone[num_standalone++] = run;
+        clover_finalize();
+      }
+
+      destroy_chunk();
+    } else {
+      run->failed = true;
+      chunk.tiles = NULL;
+      states = NULL;
+    }
+
+    clover_set_abort_handler(NULL);
+    end_run();
+  }
+
+  if (built) {
+    ensemble_hydro(&ens);
+
+    for (int i = 0; i < group->num_runs; i++) {
+      if (!ens.lanes[i].used)
+        continue;
+
+      group->runs[i]->steps = ens.lanes[i].step;
+      group->runs[i]->time = ens.lanes[i].time;
+      group->runs[i]->failed = ens.lanes[i].failed;
+      fclose(logs[i]);
+    }
+
+    ensemble_destroy(&ens);
+  }
+
+  double wall_clock = timer() - start;
+  for (int i = 0; i < group->num_runs; i++)
+    group->runs[i]->wall_clock = wall_clock;
+
+  for (int i = 0; i < num_standalone; i++)
+    run_deck(standalone[i]);
+}
+
+static void report(FILE *out, batch_run *runs, int num_runs, int num_threads, double wall_clock) {
+  int failed = 0;
+  double run_total = 0.0;
+
+  fprintf(out, "Batch of %d runs on %d threads\n\n", num_runs, num_threads);
+  fprintf(out, "%6s%8s%9s%20s%20s  %s\n", "Run", "Status", "Steps", "Time", "Wall clock", "Deck");
+
+  for (int i = 0; i < num_runs; i++) {
+    batch_run *run = &runs[i];
+
+    fprintf(
+        out,
+        "%6d%8s%9d%20.10f%20.10f  %s\n",
+        run->id,
+        run->failed ? "FAILED" : "done",
+        run->steps,
+        run->time,
+        run->wall_clock,
+        run->name
+    );
+
+    if (run->failed)
+      failed++;
+    run_total += run->wall_clock;
+  }
+
+  fprintf(out, "\n%-24s%20d\n", "Failed runs", failed);
+  fprintf(out, "%-24s%20.10f\n", "Wall clock", wall_clock);
+  fprintf(out, "%-24s%20.10f\n", "Average run wall clock", run_total / num_runs);
+  fprintf(out, "%-24s%20.4f\n", "Runs per hour", num_runs / wall_clock * 3600.0);
+}
+
+int main(int argc, char **argv) {
+  int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  const char *output_dir = "batch";
+  const char *grid_deck = NULL;
+  bool ensemble = false;
+
+  batch_param params[BATCH_MAX_PARAMS];
+  int num_params = 0;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "j:o:eg:p:h")) != -1) {
+    switch (opt) {
+      case 'j':
+        num_threads = atoi(optarg);
+        break;
+      case 'o':
+        output_dir = optarg;
+        break;
+      case 'e':
+        ensemble = true;
+        break;
+      case 'g':
+        grid_deck = optarg;
+        break;
+      case 'p':
+        if (num_params == BATCH_MAX_PARAMS)
+          report_error("batch", "Too many grid parameters");
+        parse_param(&params[num_params++], optarg);
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+
+  if (num_threads < 1)
+    num_threads = 1;
+
+  if ((grid_deck == NULL) == (optind == argc) || (grid_deck == NULL && num_params > 0))
+    usage(argv[0]);
+
+  int num_runs;
+  batch_run *runs;
+
+  if (grid_deck != NULL) {
+    char *base = read_file(grid_deck);
+
+    num_runs = 1;
+    for (int p = 0; p < num_params; p++)
+      num_runs *= params[p].num_values;
+
+    runs = calloc(num_runs, sizeof(batch_run));
+
+    for (int i = 0; i < num_runs; i++) {
+      char overrides[G_LEN_MAX * 2] = "";
+      char *name = runs[i].name;
+
+      // Mixed radix decomposition of the run index, the first parameter changes fastest
+      int index = i;
+      for (int p = 0; p < num_params; p++) {
+        const char *value = params[p].values[index % params[p].num_values];
+        index /= params[p].num_values;
+
+        snprintf(strchr(overrides, '\0'), sizeof(overrides) - strlen(overrides), " %s=%s\n", params[p].key, value);
+        snprintf(strchr(name, '\0'), G_LEN_MAX - strlen(name), "%s%s=%s", p > 0 ? " " : "", params[p].key, value);
+      }
+      if (num_params == 0)
+        snprintf(name, G_LEN_MAX, "%s", grid_deck);
+
+      runs[i].deck = override_deck(base, overrides);
+    }
+
+    free(base);
+  } else {
+    num_runs = argc - optind;
+    runs = calloc(num_runs, sizeof(batch_run));
+
+    for (int i = 0; i < num_runs; i++) {
+      snprintf(runs[i].name, G_LEN_MAX, "%s", argv[optind + i]);
+      runs[i].deck = read_file(argv[optind + i]);
+    }
+  }
+
+  if (!make_dir(output_dir))
+    report_error_arg("batch", "Error creating directory: ", output_dir);
+
+  for (int i = 0; i < num_runs; i++) {
+    runs[i].id = i;
+    snprintf(runs[i].dir, G_LEN_MAX, "%s/run_%04d", output_dir, i);
+  }
+
+  int num_groups = 0;
+  batch_ensemble *groups = NULL;
+
+  if (ensemble) {
+    num_groups = (int)(((unsigned)num_runs + ENSEMBLE_WIDTH - 1) / ENSEMBLE_WIDTH);
+    groups = calloc(num_groups, sizeof(batch_ensemble));
+
+    for (int i = 0; i < num_runs; i++) {
+      batch_ensemble *group = &groups[i / ENSEMBLE_WIDTH];
+      group->runs[group->num_runs++] = &runs[i];
+    }
+  }
+
+  int num_tasks = ensemble ? num_groups : num_runs;
+  if (num_threads > num_tasks)
+    num_threads = num_tasks;
+
+  if (ensemble)
+    printf(
+        "Running %d decks in %d ensembles of %d lanes on %d threads, output in %s\n",
+        num_runs,
+        num_groups,
+        ENSEMBLE_WIDTH,
+        num_threads,
+        output_dir
+    );
+  else
+    printf("Running %d decks on %d threads, output in %s\n", num_runs, num_threads, output_dir);
+
+  double start = timer();
+
+  thread_pool *pool = thread_pool_create(num_threads);
+  if (pool == NULL)
+    report_error("batch", "Error creating the thread pool");
+
+  for (int i = 0; i < num_tasks; i++) {
+    if (ensemble)
+      thread_pool_submit(pool, run_ensemble, &groups[i]);
+    else
+      thread_pool_submit(pool, run_deck, &runs[i]);
+  }
+
+  thread_pool_destroy(pool);
+  free(groups);
+
+  double wall_clock = timer() - start;
+
+  char path[G_LEN_MAX];
+  snprintf(path, sizeof(path), "%s/batch.txt", output_dir);
+  FILE *summary = fopen(path, "w");
+  if (summary != NULL) {
+    report(summary, runs, num_runs, num_threads, wall_clock);
+    fclose(summary);
+  }
+
+  putchar('\n');
+  report(stdout, runs, num_runs, num_threads, wall_clock);
+
+  int failed = 0;
+  for (int i = 0; i < num_runs; i++) {
+    failed += runs[i].failed;
+    free(runs[i].deck);
+  }
+  free(runs);
+
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,858 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Per-kernel microbenchmark, timing each kernel in isolation on a single tile
+ * @details For every mesh size the tile is allocated with build_field(), filled with a Sod-like problem carrying a
+ * smooth velocity field, and primed by running the kernels of one hydro step once, so that every array holds
+ * plausible values. Each kernel is then called repeatedly on it: calls are grouped into samples lasting at least
+ * BENCH_MIN_SAMPLE seconds, so that tiny meshes can be timed too, and the median and minimum time per call over the
+ * samples are reported. Kernels updating their own inputs get the primed fields back before every sample.
+ *
+ * The GFLOP/s and GB/s come from the roofline model of each kernel (see kernels/roofline.h), on the mesh being
+ * timed, and the STREAM triad bandwidth measured at start-up is printed as their ceiling. update_halo only touches
+ * the border of the mesh, so it has no model.
+ *
+ * PdV and the advection kernels are timed through their specialised variants, as the hydro loop calls them, and the
+ * _generic rows time the same sweeps through the kernels taking the sweep as an argument, for comparison. The hydro
+ * loop computes the volume fluxes in the PdV corrector, the flux_calc row times the standalone kernel they replace.
+ *
+ * The tile keeps its volume and area planes unless -u is given, which benchmarks the uniform grid of the hydro runs
+ * (see kernels/geometry.h) instead.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "data.h"
+#include "definitions.h"
+#include "kernels/kernels.h"
+#include "kernels/roofline.h"
+#include "utils/stream.h"
+
+#define BENCH_MAX_SIZES   32
+#define BENCH_MIN_SAMPLE  1.0e-3
+#define BENCH_LIST_SIZE   1024
+
+/**
+ * @file allocate.c
+ */
+extern void build_field();
+
+extern void destroy_field();
+
+extern void release_field_cache();
+
+typedef struct bench_kernel_t {
+  const char *name;
+  void (*run)(tile_type *tile);
+  roofline_kernel model;
+  int variant;    // Variant of the model
+  bool in_place;  // Updates its own inputs
+} bench_kernel;
+
+// Timestep of the primed fields, used by every kernel taking one
+static double bench_dt;
+
+// Primed copies of the arrays updated in place by the advection kernels
+static double *saved[4];
+
+// Sod-like problem, the denser state covering the left half of the mesh
+static double state_density[] = {0.2, 1.0};
+static double state_energy[] = {1.0, 2.5};
+static double state_xvel[] = {0.0, 0.0};
+static double state_yvel[] = {0.0, 0.0};
+static double state_xmin[] = {0.0, 0.0};
+static double state_xmax[] = {0.0, 5.0};
+static double state_ymin[] = {0.0, 0.0};
+static double state_ymax[] = {0.0, 10.0};
+static double state_radius[] = {0.0, 0.0};
+static int state_geometry[] = {G_RECT, G_RECT};
+
+static double now() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1.0e-9;
+}
+
+static void run_initialise_chunk(tile_type *t) {
+  double dx = (grid.xmax - grid.xmin) / grid.x_cells;
+  double dy = (grid.ymax - grid.ymin) / grid.y_cells;
+
+  t->field.uniform_volume = dx * dy;
+  t->field.uniform_xarea = dy;
+  t->field.uniform_yarea = dx;
+
+  kernel_initialise_chunk(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      grid.xmin,
+      grid.ymin,
+      dx,
+      dy,
+      t->field.vertexx,
+      t->field.vertexdx,
+      t->field.vertexy,
+      t->field.vertexdy,
+      t->field.cellx,
+      t->field.celldx,
+      t->field.celly,
+      t->field.celldy,
+      t->field.volume,
+      t->field.xarea,
+      t->field.yarea
+  );
+}
+
+static void run_generate_chunk(tile_type *t) {
+  kernel_generate_chunk(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      t->field.vertexx,
+      t->field.vertexy,
+      t->field.cellx,
+      t->field.celly,
+      t->field.density0,
+      t->field.energy0,
+      t->field.xvel0,
+      t->field.yvel0,
+      2,
+      state_density,
+      state_energy,
+      state_xvel,
+      state_yvel,
+      state_xmin,
+      state_xmax,
+      state_ymin,
+      state_ymax,
+      state_radius,
+      state_geometry
+  );
+}
+
+static void run_ideal_gas(tile_type *t) {
+  kernel_ideal_gas(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      t->field.density0,
+      t->field.energy0,
+      t->field.pressure,
+      t->field.soundspeed
+  );
+}
+
+static void run_update_halo(tile_type *t) {
+  int chunk_neighbours[4] = {EXTERNAL_FACE, EXTERNAL_FACE, EXTERNAL_FACE, EXTERNAL_FACE};
+  int fields[NUM_FIELDS];
+
+  for (int f = 0; f < NUM_FIELDS; f++)
+    fields[f] = 1;
+
+  kernel_update_halo(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      chunk_neighbours,
+      t->tile_neighbours,
+      t->field.density0,
+      t->field.energy0,
+      t->field.pressure,
+      t->field.viscosity,
+      t->field.soundspeed,
+      t->field.density1,
+      t->field.energy1,
+      t->field.xvel0,
+      t->field.yvel0,
+      t->field.xvel1,
+      t->field.yvel1,
+      t->field.vol_flux_x,
+      t->field.vol_flux_y,
+      t->field.mass_flux_x,
+      t->field.mass_flux_y,
+      fields,
+      2
+  );
+}
+
+static void run_viscosity(tile_type *t) {
+  kernel_viscosity(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      t->field.celldx,
+      t->field.celldy,
+      t->field.density0,
+      t->field.pressure,
+      t->field.viscosity,
+      t->field.xvel0,
+      t->field.yvel0
+  );
+}
+
+static void run_calc_dt(tile_type *t) {
+  double dt_min = G_BIG, xl_pos, yl_pos;
+  int control, jldt, kldt;
+
+  kernel_calc_dt(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      0.0000001,
+      0.7,
+      0.5,
+      0.5,
+      0.7,
+      t->field.xarea,
+      t->field.yarea,
+      t->field.cellx,
+      t->field.celly,
+      t->field.celldx,
+      t->field.celldy,
+      t->field.volume,
+      t->field.density0,
+      t->field.energy0,
+      t->field.pressure,
+      t->field.viscosity,
+      t->field.soundspeed,
+      t->field.xvel0,
+      t->field.yvel0,
+      t->field.work_array1,
+      &dt_min,
+      &control,
+      &xl_pos,
+      &yl_pos,
+      &jldt,
+      &kldt,
+      0,
+      t->field.uniform_volume,
+      t->field.uniform_xarea,
+      t->field.uniform_yarea
+  );
+
+  bench_dt = dt_min;
+}
+
+static void run_pdv(tile_type *t, bool predict, bool generic) {
+  // As in the hydro loop, the predictor writes its density and energy to work arrays
+  double *density1 = predict ? t->field.work_array2 : t->field.density1;
+  double *energy1 = predict ? t->field.work_array3 : t->field.energy1;
+
+  if (generic)
+    kernel_pdv(
+        predict,
+        t->t_xmin,
+        t->t_xmax,
+        t->t_ymin,
+        t->t_ymax,
+        bench_dt,
+        t->field.xarea,
+        t->field.yarea,
+        t->field.volume,
+        t->field.density0,
+        density1,
+        t->field.energy0,
+        energy1,
+        t->field.pressure,
+        t->field.viscosity,
+        t->field.xvel0,
+        t->field.xvel1,
+        t->field.yvel0,
+        t->field.yvel1,
+        t->field.work_array1,
+        t->field.vol_flux_x,
+        t->field.vol_flux_y,
+        t->field.uniform_volume,
+        t->field.uniform_xarea,
+        t->field.uniform_yarea
+    );
+  else
+    kernel_pdv_variants[predict](
+        t->t_xmin,
+        t->t_xmax,
+        t->t_ymin,
+        t->t_ymax,
+        bench_dt,
+        t->field.xarea,
+        t->field.yarea,
+        t->field.volume,
+        t->field.density0,
+        density1,
+        t->field.energy0,
+        energy1,
+        t->field.pressure,
+        t->field.viscosity,
+        t->field.xvel0,
+        t->field.xvel1,
+        t->field.yvel0,
+        t->field.yvel1,
+        t->field.work_array1,
+        t->field.vol_flux_x,
+        t->field.vol_flux_y,
+        t->field.uniform_volume,
+        t->field.uniform_xarea,
+        t->field.uniform_yarea
+    );
+}
+
+static void run_pdv_predict(tile_type *t) {
+  run_pdv(t, true, false);
+}
+
+static void run_pdv_correct(tile_type *t) {
+  run_pdv(t, false, false);
+}
+
+static void run_pdv_predict_generic(tile_type *t) {
+  run_pdv(t, true, true);
+}
+
+static void run_pdv_correct_generic(tile_type *t) {
+  run_pdv(t, false, true);
+}
+
+static void run_accelerate(tile_type *t) {
+  kernel_accelerate(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      bench_dt,
+      t->field.xarea,
+      t->field.yarea,
+      t->field.volume,
+      t->field.density0,
+      t->field.pressure,
+      t->field.viscosity,
+      t->field.xvel0,
+      t->field.yvel0,
+      t->field.xvel1,
+      t->field.yvel1,
+      t->field.uniform_volume,
+      t->field.uniform_xarea,
+      t->field.uniform_yarea
+  );
+}
+
+static void run_flux_calc(tile_type *t) {
+  kernel_flux_calc(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      bench_dt,
+      t->field.xarea,
+      t->field.yarea,
+      t->field.xvel0,
+      t->field.yvel0,
+      t->field.xvel1,
+      t->field.yvel1,
+      t->field.vol_flux_x,
+      t->field.vol_flux_y,
+      t->field.uniform_xarea,
+      t->field.uniform_yarea
+  );
+}
+
+static void run_advec_cell(tile_type *t, int direction, int sweep_number, bool generic) {
+  if (generic)
+    kernel_advec_cell(
+        t->t_xmin,
+        t->t_xmax,
+        t->t_ymin,
+        t->t_ymax,
+        direction,
+        sweep_number,
+        t->field.vertexdx,
+        t->field.vertexdy,
+        t->field.volume,
+        t->field.density1,
+        t->field.energy1,
+        t->field.mass_flux_x,
+        t->field.vol_flux_x,
+        t->field.mass_flux_y,
+        t->field.vol_flux_y,
+        t->field.work_array1,
+        t->field.work_array2,
+        t->field.work_array3,
+        t->field.work_array4,
+        t->field.work_array5,
+        t->field.work_array6,
+        t->field.work_array7,
+        t->field.uniform_volume
+    );
+  else
+    kernel_advec_cell_variants[direction - 1][sweep_number - 1](
+        t->t_xmin,
+        t->t_xmax,
+        t->t_ymin,
+        t->t_ymax,
+        t->field.vertexdx,
+        t->field.vertexdy,
+        t->field.volume,
+        t->field.density1,
+        t->field.energy1,
+        t->field.mass_flux_x,
+        t->field.vol_flux_x,
+        t->field.mass_flux_y,
+        t->field.vol_flux_y,
+        t->field.work_array1,
+        t->field.work_array2,
+        t->field.work_array3,
+        t->field.work_array4,
+        t->field.work_array5,
+        t->field.work_array6,
+        t->field.work_array7,
+        t->field.uniform_volume
+    );
+}
+
+static void run_advec_cell_x(tile_type *t) {
+  run_advec_cell(t, G_XDIR, 1, false);
+}
+
+static void run_advec_cell_y(tile_type *t) {
+  run_advec_cell(t, G_YDIR, 2, false);
+}
+
+static void run_advec_cell_x_generic(tile_type *t) {
+  run_advec_cell(t, G_XDIR, 1, true);
+}
+
+static void run_advec_cell_y_generic(tile_type *t) {
+  run_advec_cell(t, G_YDIR, 2, true);
+}
+
+static void run_advec_mom(tile_type *t, int which_vel, int direction, int sweep_number, bool generic) {
+  if (generic)
+    kernel_advec_mom(
+        t->t_xmin,
+        t->t_xmax,
+        t->t_ymin,
+        t->t_ymax,
+        which_vel == G_XDIR ? t->field.xvel1 : t->field.yvel1,
+        t->field.mass_flux_x,
+        t->field.vol_flux_x,
+        t->field.mass_flux_y,
+        t->field.vol_flux_y,
+        t->field.volume,
+        t->field.density1,
+        t->field.work_array1,
+        t->field.work_array2,
+        t->field.work_array3,
+        t->field.work_array4,
+        t->field.work_array5,
+        t->field.work_array6,
+        t->field.celldx,
+        t->field.celldy,
+        t->field.uniform_volume,
+        which_vel,
+        sweep_number,
+        direction
+    );
+  else
+    kernel_advec_mom_variants[direction - 1][sweep_number - 1](
+        t->t_xmin,
+        t->t_xmax,
+        t->t_ymin,
+        t->t_ymax,
+        which_vel == G_XDIR ? t->field.xvel1 : t->field.yvel1,
+        t->field.mass_flux_x,
+        t->field.vol_flux_x,
+        t->field.mass_flux_y,
+        t->field.vol_flux_y,
+        t->field.volume,
+        t->field.density1,
+        t->field.work_array1,
+        t->field.work_array2,
+        t->field.work_array3,
+        t->field.work_array4,
+        t->field.work_array5,
+        t->field.work_array6,
+        t->field.celldx,
+        t->field.celldy,
+        t->field.uniform_volume
+    );
+}
+
+static void run_advec_mom_x(tile_type *t) {
+  run_advec_mom(t, G_XDIR, G_XDIR, 1, false);
+}
+
+static void run_advec_mom_y(tile_type *t) {
+  run_advec_mom(t, G_YDIR, G_YDIR, 2, false);
+}
+
+static void run_advec_mom_x_generic(tile_type *t) {
+  run_advec_mom(t, G_XDIR, G_XDIR, 1, true);
+}
+
+static void run_advec_mom_y_generic(tile_type *t) {
+  run_advec_mom(t, G_YDIR, G_YDIR, 2, true);
+}
+
+static void run_reset_field(tile_type *t) {
+  kernel_reset_field(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      t->field.density0,
+      t->field.density1,
+      t->field.energy0,
+      t->field.energy1,
+      t->field.xvel0,
+      t->field.xvel1,
+      t->field.yvel0,
+      t->field.yvel1
+  );
+}
+
+static void run_field_summary(tile_type *t) {
+  double vol, mass, ie, ke, press;
+
+  kernel_field_summary(
+      t->t_xmin,
+      t->t_xmax,
+      t->t_ymin,
+      t->t_ymax,
+      t->field.volume,
+      t->field.density0,
+      t->field.energy0,
+      t->field.pressure,
+      t->field.xvel0,
+      t->field.yvel0,
+      &vol,
+      &mass,
+      &ie,
+      &ke,
+      &press,
+      t->field.uniform_volume
+  );
+}
+
+// In hydro order
+static const bench_kernel kernels[] = {
+    {"initialise_chunk", run_initialise_chunk, ROOFLINE_INITIALISE_CHUNK, 0, false},
+    {"generate_chunk", run_generate_chunk, ROOFLINE_GENERATE_CHUNK, 0, false},
+    {"ideal_gas", run_ideal_gas, ROOFLINE_IDEAL_GAS, 0, false},
+    {"update_halo", run_update_halo, ROOFLINE_UPDATE_HALO, 0, false},
+    {"viscosity", run_viscosity, ROOFLINE_VISCOSITY, 0, false},
+    {"calc_dt", run_calc_dt, ROOFLINE_CALC_DT, 0, false},
+    {"pdv_predict", run_pdv_predict, ROOFLINE_PDV, true, false},
+    {"pdv_correct", run_pdv_correct, ROOFLINE_PDV, false, false},
+    {"pdv_predict_generic", run_pdv_predict_generic, ROOFLINE_PDV, true, false},
+    {"pdv_correct_generic", run_pdv_correct_generic, ROOFLINE_PDV, false, false},
+    {"accelerate", run_accelerate, ROOFLINE_ACCELERATE, 0, false},
+    {"flux_calc", run_flux_calc, ROOFLINE_FLUX_CALC, 0, false},
+    {"advec_cell_x", run_advec_cell_x, ROOFLINE_ADVEC_CELL, ROOFLINE_SWEEP(G_XDIR, 1), true},
+    {"advec_cell_y", run_advec_cell_y, ROOFLINE_ADVEC_CELL, ROOFLINE_SWEEP(G_YDIR, 2), true},
+    {"advec_mom_x", run_advec_mom_x, ROOFLINE_ADVEC_MOM, ROOFLINE_SWEEP(G_XDIR, 1), true},
+    {"advec_mom_y", run_advec_mom_y, ROOFLINE_ADVEC_MOM, ROOFLINE_SWEEP(G_YDIR, 2), true},
+    {"advec_cell_x_generic", run_advec_cell_x_generic, ROOFLINE_ADVEC_CELL, ROOFLINE_SWEEP(G_XDIR, 1), true},
+    {"advec_cell_y_generic", run_advec_cell_y_generic, ROOFLINE_ADVEC_CELL, ROOFLINE_SWEEP(G_YDIR, 2), true},
+    {"advec_mom_x_generic", run_advec_mom_x_generic, ROOFLINE_ADVEC_MOM, ROOFLINE_SWEEP(G_XDIR, 1), true},
+    {"advec_mom_y_generic", run_advec_mom_y_generic, ROOFLINE_ADVEC_MOM, ROOFLINE_SWEEP(G_YDIR, 2), true},
+    {"reset_field", run_reset_field, ROOFLINE_RESET_FIELD, 0, false},
+    {"field_summary", run_field_summary, ROOFLINE_FIELD_SUMMARY, 0, false},
+};
+
+#define NUM_KERNELS (int)(sizeof(kernels) / sizeof(kernels[0]))
+
+static size_t cell_size(const tile_type *t) {
+  return (size_t)(t->t_xmax + 4) * (t->t_ymax + 4) * sizeof(double);
+}
+
+static size_t node_size(const tile_type *t) {
+  return (size_t)(t->t_xmax + 5) * (t->t_ymax + 5) * sizeof(double);
+}
+
+static void restore_fields(tile_type *t) {
+  memcpy(t->field.density1, saved[0], cell_size(t));
+  memcpy(t->field.energy1, saved[1], cell_size(t));
+  memcpy(t->field.xvel1, saved[2], node_size(t));
+  memcpy(t->field.yvel1, saved[3], node_size(t));
+}
+
+/**
+ * @brief Allocates a single tile of n x n cells and fills it with the primed state of a hydro step
+ */
+static void setup(int n) {
+  grid.xmin = 0.0;
+  grid.ymin = 0.0;
+  grid.xmax = 10.0;
+  grid.ymax = 10.0;
+  grid.x_cells = n;
+  grid.y_cells = n;
+
+  tiles_per_chunk = 1;
+  chunk.tiles = calloc(1, sizeof(tile_type));
+
+  tile_type *t = &chunk.tiles[0];
+  t->t_xmin = 1;
+  t->t_xmax = n;
+  t->t_ymin = 1;
+  t->t_ymax = n;
+  t->t_left = 1;
+  t->t_right = n;
+  t->t_bottom = 1;
+  t->t_top = n;
+  for (int i = 0; i < 4; i++) {
+    t->tile_neighbours[i] = EXTERNAL_TILE;
+    t->external_tile_mask[i] = 1;
+  }
+
+  build_field();
+
+  run_initialise_chunk(t);
+  run_generate_chunk(t);
+
+  // A smooth vortex, a few percent of the sound speed
+  for (int k = t->t_ymin - 2; k <= t->t_ymax + 3; k++) {
+    for (int j = t->t_xmin - 2; j <= t->t_xmax + 3; j++) {
+      double x = t->field.vertexx[j - (t->t_xmin - 2)] / grid.xmax;
+      double y = t->field.vertexy[k - (t->t_ymin - 2)] / grid.ymax;
+      size_t index = (size_t)(k - (t->t_ymin - 2)) * (t->t_xmax + 5) + (j - (t->t_xmin - 2));
+
+      t->field.xvel0[index] = 0.1 * sin(M_PI * x) * cos(M_PI * y);
+      t->field.yvel0[index] = -0.1 * cos(M_PI * x) * sin(M_PI * y);
+    }
+  }
+
+  // One hydro step, leaving every array with the values it holds during a run
+  run_ideal_gas(t);
+  run_update_halo(t);
+  run_viscosity(t);
+  run_calc_dt(t);
+  run_pdv_predict(t);
+  run_accelerate(t);
+  run_pdv_correct(t);
+  run_advec_cell_x(t);
+  run_advec_mom_x(t);
+  run_advec_cell_y(t);
+  run_advec_mom_y(t);
+  run_update_halo(t);
+
+  saved[0] = malloc(cell_size(t));
+  saved[1] = malloc(cell_size(t));
+  saved[2] = malloc(node_size(t));
+  saved[3] = malloc(node_size(t));
+  memcpy(saved[0], t->field.density1, cell_size(t));
+  memcpy(saved[1], t->field.energy1, cell_size(t));
+  memcpy(saved[2], t->field.xvel1, node_size(t));
+  memcpy(saved[3], t->field.yvel1, node_size(t));
+}
+
+static void teardown() {
+  for (int i = 0; i < 4; i++) {
+    free(saved[i]);
+    saved[i] = NULL;
+  }
+
+  destroy_field();
+  release_field_cache();
+  free(chunk.tiles);
+  chunk.tiles = NULL;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Times one kernel, returning the median and minimum seconds per call
+ */
+static void time_kernel(const bench_kernel *kernel, int warmup, int repetitions, double *median, double *min) {
+  tile_type *t = &chunk.tiles[0];
+  double samples[repetitions];
+
+  // Enough calls per sample to make it measurable, also warming up caches and branch predictors
+  int calls = 1;
+  for (;;) {
+    if (kernel->in_place)
+      restore_fields(t);
+
+    double start = now();
+    for (int c = 0; c < calls; c++)
+      kernel->run(t);
+    if (now() - start >= BENCH_MIN_SAMPLE || calls >= 1 << 20)
+      break;
+    calls *= 2;
+  }
+
+  for (int r = -warmup; r < repetitions; r++) {
+    if (kernel->in_place)
+      restore_fields(t);
+
+    double start = now();
+    for (int c = 0; c < calls; c++)
+      kernel->run(t);
+    double elapsed = now() - start;
+
+    if (r >= 0)
+      samples[r] = elapsed / calls;
+  }
+
+  qsort(samples, repetitions, sizeof(double), compare_doubles);
+  *median = repetitions % 2 ? samples[repetitions / 2]
+                            : 0.5 * (samples[repetitions / 2 - 1] + samples[repetitions / 2]);
+  *min = samples[0];
+
+  // Leave the fields as primed for the next kernel
+  restore_fields(t);
+}
+
+static bool selected(const char *name, const char *filter) {
+  if (filter == NULL)
+    return true;
+
+  size_t length = strlen(name);
+  for (const char *match = strstr(filter, name); match != NULL; match = strstr(match + 1, name)) {
+    if ((match == filter || match[-1] == ',') && (match[length] == ',' || match[length] == '\0'))
+      return true;
+  }
+  return false;
+}
+
+static void usage(const char *argv0) {
+  printf(
+      "Usage: %s [-s sizes] [-r repetitions] [-w warmup] [-k kernels] [-u] [-l]\n"
+      "\n"
+      "  -s sizes        Comma separated mesh sizes n, each benchmarked on n x n cells (default: 16,64,256,1024)\n"
+      "  -r repetitions  Timed samples per kernel (default: 20)\n"
+      "  -w warmup       Untimed samples per kernel (default: 3)\n"
+      "  -k kernels      Comma separated kernels to run (default: all)\n"
+      "  -u              Uniform grid, without the volume and area planes\n"
+      "  -l              List the kernels and their roofline models, per cell of a %dx%d mesh\n"
+      "\n"
+      "The fields take about %d x (n + 5)^2 doubles, some 18 GB for n = 8192.\n",
+      argv0,
+      BENCH_LIST_SIZE,
+      BENCH_LIST_SIZE,
+      NUM_FIELD_ARRAYS + 4
+  );
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  int sizes[BENCH_MAX_SIZES] = {16, 64, 256, 1024};
+  int num_sizes = 4;
+  int repetitions = 20;
+  int warmup = 3;
+  const char *filter = NULL;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:r:w:k:ulh")) != -1) {
+    switch (opt) {
+      case 's':
+        num_sizes = 0;
+        for (char *size = strtok(optarg, ","); size != NULL && num_sizes < BENCH_MAX_SIZES; size = strtok(NULL, ","))
+          sizes[num_sizes++] = atoi(size);
+        break;
+      case 'r':
+        repetitions = atoi(optarg);
+        break;
+      case 'w':
+        warmup = atoi(optarg);
+        break;
+      case 'k':
+        filter = optarg;
+        break;
+      case 'u':
+        uniform_grid = true;
+        break;
+      case 'l':
+        printf("%-22s%12s%14s%14s%12s\n", "Kernel", "Flop/cell", "Read B/cell", "Write B/cell", "Flop/byte");
+        for (int i = 0; i < NUM_KERNELS; i++) {
+          roofline_cost cost =
+              roofline_model(kernels[i].model, kernels[i].variant, 1, BENCH_LIST_SIZE, 1, BENCH_LIST_SIZE);
+          double cells = (double)BENCH_LIST_SIZE * BENCH_LIST_SIZE;
+          double bytes = cost.bytes_read + cost.bytes_written;
+
+          if (!roofline_has_model(kernels[i].model)) {
+            printf("%-22s%12s%14s%14s%12s\n", kernels[i].name, "-", "-", "-", "-");
+            continue;
+          }
+          printf(
+              "%-22s%12.2f%14.2f%14.2f%12.2f\n",
+              kernels[i].name,
+              cost.flops / cells,
+              cost.bytes_read / cells,
+              cost.bytes_written / cells,
+              cost.flops / bytes
+          );
+        }
+        return 0;
+      default:
+        usage(argv[0]);
+    }
+  }
+
+  if (num_sizes == 0 || repetitions < 1 || warmup < 0)
+    usage(argv[0]);
+
+  double stream = stream_bandwidth();
+  if (stream > 0.0)
+    printf("STREAM triad bandwidth %.2f GB/s\n", stream / 1.0e9);
+
+  for (int s = 0; s < num_sizes; s++) {
+    int n = sizes[s];
+    if (n < 2) {
+      fprintf(stderr, "Skipping mesh size %d, at least 2 cells per direction are needed\n", n);
+      continue;
+    }
+
+    double cells = (double)n * n;
+    double footprint = (NUM_FIELD_ARRAYS + 4.0 - (uniform_grid ? 3 : 0)) * (n + 5.0) * (n + 5.0) * sizeof(double);
+
+    setup(n);
+
+    printf(
+        "\nMesh %dx%d, %.0f cells, %.1f MB of fields, %d samples after %d warm-up\n",
+        n,
+        n,
+        cells,
+        footprint / 1.0e6,
+        repetitions,
+        warmup
+    );
+    printf(
+        "%-22s%14s%14s%14s%10s%10s%8s\n", "Kernel", "Median (s)", "Min (s)", "Mcells/s", "GFLOP/s", "GB/s", "B/cell"
+    );
+
+    for (int i = 0; i < NUM_KERNELS; i++) {
+      if (!selected(kernels[i].name, filter))
+        continue;
+
+      double median, min;
+      time_kernel(&kernels[i], warmup, repetitions, &median, &min);
+
+      roofline_cost cost = roofline_model(kernels[i].model, kernels[i].variant, 1, n, 1, n);
+      double bytes = cost.bytes_read + cost.bytes_written;
+
+      printf("%-22s%14.4e%14.4e%14.2f", kernels[i].name, median, min, cells / median / 1.0e6);
+      if (roofline_has_model(kernels[i].model))
+        printf("%10.2f%10.2f%8.1f\n", cost.flops / median / 1.0e9, bytes / median / 1.0e9, bytes / cells);
+      else
+        printf("%10s%10s%8s\n", "-", "-", "-");
+    }
+
+    teardown();
+  }
+
+  return 0;
+}
@@ -1,12 +1,22 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2022 Niccolò Betto
 
+#include <setjmp.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "data.h"
 #include "definitions.h"
+#include "report.h"
+#include "shm_export.h"
+
+// Where clover_abort() returns control to instead of exiting, if set
+static BATCH_LOCAL jmp_buf *abort_handler = NULL;
+
+// Whether g_out was provided by the caller, in which case it's left open
+static BATCH_LOCAL bool out_borrowed = false;
 
 void clover_init_comms() {
   const int rank = 0, size = 1;
@@ -19,22 +29,46 @@ void clover_init_comms() {
 
   parallel.boss_task = 0;
   parallel.max_task = size;
+
+  if (g_stdout == NULL)
+    g_stdout = stdout;
 }
 
 void clover_finalize() {
+  shm_export_unlink();
+
   if (g_in != NULL) {
     if (fclose(g_in) == 0)
       g_in = NULL;
   }
 
+  if (g_out != NULL && out_borrowed) {
+    fflush(g_out);
+    g_out = NULL;
+    out_borrowed = false;
+  }
+
   if (g_out != NULL) {
     if (fclose(g_out) == 0)
       g_out = NULL;
   }
 }
 
+void clover_set_output(FILE *out) {
+  g_out = out;
+  out_borrowed = out != NULL;
+}
+
+void clover_set_abort_handler(jmp_buf *env) {
+  abort_handler = env;
+}
+
 void clover_abort() {
   clover_finalize();
+
+  if (abort_handler != NULL)
+    longjmp(*abort_handler, 1);
+
   exit(1);
 }
 
@@ -145,37 +179,48 @@ void clover_decompose(int x_cells, int y_cells, int *left, int *right, int *bott
   }
 }
 
-void clover_tile_decompose(int chunk_x_cells, int chunk_y_cells) {
-  int chunk_mesh_ratio = (float)chunk_x_cells / (float)chunk_y_cells;
+void clover_tile_grid(int tiles, int chunk_x_cells, int chunk_y_cells, int *tile_x, int *tile_y) {
+  double chunk_mesh_ratio = (double)chunk_x_cells / (double)chunk_y_cells;
 
-  int tile_x = tiles_per_chunk;
-  int tile_y = 1;
+  *tile_x = tiles;
+  *tile_y = 1;
 
   bool split_found = false;  // Used to detect 1D decomposition
 
-  for (int t = 1; t <= tiles_per_chunk; t++) {
-    if (tiles_per_chunk % t == 0) {
-      int factor_x = tiles_per_chunk / (float)t;
-      int factor_y = t;
-      // Compare the factor ration with the mesh ratio
+  // The first split whose tiles are at least as wide as they are tall, the squarest of those
+  for (int t = 1; t <= tiles; t++) {
+    if (tiles % t == 0) {
+      double factor_x = tiles / (double)t;
+      double factor_y = t;
+      // Compare the factor ratio with the mesh ratio
       if (factor_x / factor_y <= chunk_mesh_ratio) {
-        tile_y = t;
-        tile_x = tiles_per_chunk / t;
+        *tile_y = t;
+        *tile_x = tiles / t;
         split_found = true;
+        break;
       }
     }
   }
 
-  if (!split_found || tile_y == tiles_per_chunk) {
+  if (!split_found || *tile_y == tiles) {
     // Prime number or 1D decomp detected
     if (chunk_mesh_ratio >= 1.0) {
-      tile_x = tiles_per_chunk;
-      tile_y = 1;
+      *tile_x = tiles;
+      *tile_y = 1;
     } else {
-      tile_x = 1;
-      tile_y = tiles_per_chunk;
+      *tile_x = 1;
+      *tile_y = tiles;
     }
   }
+}
+
+void clover_tile_decompose(int chunk_x_cells, int chunk_y_cells) {
+  int tile_x = tile_grid_x, tile_y = tile_grid_y;
+  if (tile_x * tile_y != tiles_per_chunk)
+    clover_tile_grid(tiles_per_chunk, chunk_x_cells, chunk_y_cells, &tile_x, &tile_y);
+
+  if (tile_x > chunk_x_cells || tile_y > chunk_y_cells)
+    report_error("clover_tile_decompose", "More tiles than cells across the chunk.");
 
   int chunk_delta_x = chunk_x_cells / tile_x;
   int chunk_delta_y = chunk_y_cells / tile_y;
@@ -201,10 +246,11 @@ void clover_tile_decompose(int chunk_x_cells, int chunk_y_cells) {
       int bottom = chunk.bottom + (ty - 1) * chunk_delta_y + add_y_prev;
       int top = bottom + chunk_delta_y - 1 + add_y;
 
-      chunk.tiles[tile].tile_neighbours[TILE_LEFT] = tile_x * (ty - 1) + tx - 1;
-      chunk.tiles[tile].tile_neighbours[TILE_RIGHT] = tile_x * (ty - 1) + tx + 1;
-      chunk.tiles[tile].tile_neighbours[TILE_BOTTOM] = tile_x * (ty - 2) + tx;
-      chunk.tiles[tile].tile_neighbours[TILE_TOP] = tile_x * ty + tx;
+      // Indices into chunk.tiles
+      chunk.tiles[tile].tile_neighbours[TILE_LEFT] = tile - 1;
+      chunk.tiles[tile].tile_neighbours[TILE_RIGHT] = tile + 1;
+      chunk.tiles[tile].tile_neighbours[TILE_BOTTOM] = tile - tile_x;
+      chunk.tiles[tile].tile_neighbours[TILE_TOP] = tile + tile_x;
 
       // Initial set the external tile mast to 0 for each tile
       memset(chunk.tiles[tile].external_tile_mask, 0, sizeof(chunk.tiles[tile].external_tile_mask));
@@ -249,4 +295,6 @@ void clover_tile_decompose(int chunk_x_cells, int chunk_y_cells) {
     if (ty <= chunk_mod_y)
       add_y_prev++;
   }
+  if (parallel.boss && tiles_per_chunk > 1)
+    fprintf(g_out, "Tiles %d across by %d up\n", tile_x, tile_y);
 }
@@ -3,16 +3,39 @@
 
 #pragma once
 
+#include <setjmp.h>
+#include <stdio.h>
+
 extern void clover_init_comms();
 
 extern void clover_finalize();
 
+/**
+ * @brief Makes clover_abort() jump to the given environment instead of terminating the process
+ * @param env The environment saved by setjmp(), or NULL to restore the default behaviour
+ */
+extern void clover_set_abort_handler(jmp_buf *env);
+
 extern void clover_abort();
 
+/**
+ * @brief Makes the run write its output to the given stream instead of opening clover.out
+ * @details Must be called before initialise(). The stream is left open by clover_finalize().
+ */
+extern void clover_set_output(FILE *out);
+
 extern int clover_get_num_chunks();
 
 extern void clover_decompose(int x_cells, int y_cells, int *left, int *right, int *bottom, int *top);
 
+/**
+ * @brief The tiles across and up a chunk for a number of tiles, the split whose tiles are closest to square
+ */
+extern void clover_tile_grid(int tiles, int chunk_x_cells, int chunk_y_cells, int *tile_x, int *tile_y);
+
+/**
+ * @brief Splits the chunk into tiles_per_chunk tiles, tile_grid_x by tile_grid_y when they make that number
+ */
 extern void clover_tile_decompose(int chunk_x_cells, int chunk_y_cells);
 
 extern void clover_allocate_buffers();
@@ -1,21 +1,230 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2022 Niccolò Betto
 
+#include "clover_leaf.h"
+
+#include <setjmp.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "clover.h"
 #include "data.h"
+#include "definitions.h"
+#include "jit.h"
+#include "profiler.h"
+#include "shm_export.h"
+#include "team.h"
 
 extern void initialise();
 
 extern void hydro();
 
-void clover_main() {
+extern void hydro_start();
+
+extern bool hydro_step();
+
+extern void destroy_chunk();
+
+extern void release_field_cache();
+
+_Static_assert(CLOVER_NUM_FIELDS == NUM_FIELD_ARRAYS, "clover_field must list every field_type array");
+
+/**
+ * @brief Reads the input deck and generates the initial state, without running the calculation
+ */
+void clover_setup() {
   clover_init_comms();
 
-  printf("Clover Version %f\nMPI Version\nTask Count %d\n", G_VERSION, parallel.max_task);
+  fprintf(g_stdout, "Clover Version %f\nMPI Version\nTask Count %d\n", G_VERSION, parallel.max_task);
 
   initialise();
+}
+
+void clover_main() {
+  clover_setup();
+
+  // A dry run stops once the footprint is printed
+  if (dry_run) {
+    clover_finalize();
+    return;
+  }
 
   hydro();
 }
+
+// State of the calculation driven through the embedding API
+static BATCH_LOCAL jmp_buf api_abort;
+static BATCH_LOCAL bool api_ready = false;   // Set up, its fields can be accessed
+static BATCH_LOCAL bool api_failed = false;  // Aborted, its allocations can't be safely released
+static BATCH_LOCAL FILE *api_discard = NULL;
+
+// Volume and area planes of the tiles built for clover_leaf_get_field() on a uniform grid, three per tile
+static BATCH_LOCAL double **api_planes = NULL;
+static BATCH_LOCAL int api_num_planes = 0;
+
+int clover_leaf_init(const char *deck, FILE *out, FILE *console) {
+  if (deck == NULL || deck[0] == '\0')
+    return -1;
+
+  if (out == NULL || console == NULL) {
+    api_discard = fopen("/dev/null", "w");
+    if (api_discard == NULL)
+      return -1;
+  }
+
+  g_stdout = console != NULL ? console : api_discard;
+  clover_set_output(out != NULL ? out : api_discard);
+  g_deck = deck;
+
+  clover_set_abort_handler(&api_abort);
+
+  if (setjmp(api_abort) == 0) {
+    clover_setup();
+    if (!dry_run)
+      hydro_start();
+    api_ready = true;
+  } else {
+    api_failed = true;
+  }
+
+  clover_set_abort_handler(NULL);
+  g_deck = NULL;
+
+  return api_ready ? 0 : -1;
+}
+
+int clover_leaf_step(int steps) {
+  // Modified between setjmp() and a possible longjmp()
+  volatile int taken = 0;
+
+  if (!api_ready)
+    return -1;
+
+  clover_set_abort_handler(&api_abort);
+
+  if (setjmp(api_abort) == 0) {
+    while (taken < steps && !complete) {
+      hydro_step();
+      taken++;
+    }
+  } else {
+    api_ready = false;
+    api_failed = true;
+    taken = -1;
+  }
+
+  clover_set_abort_handler(NULL);
+
+  return taken;
+}
+
+int clover_leaf_get_step() {
+  return step;
+}
+
+double clover_leaf_get_time() {
+  return time_val;
+}
+
+double clover_leaf_get_dt() {
+  return dt;
+}
+
+bool clover_leaf_is_complete() {
+  return complete;
+}
+
+int clover_leaf_get_num_tiles() {
+  return api_ready ? tiles_per_chunk : 0;
+}
+
+/**
+ * @brief The volume or area plane of a tile that isn't allocated on a uniform grid, built from its single value on the
+ * first request, see kernels/geometry.h
+ * @return The plane, or NULL if it can't be allocated
+ */
+static const double *uniform_plane(int tile, clover_field field, size_t elements) {
+  if (api_planes == NULL) {
+    api_planes = calloc(3 * (size_t)tiles_per_chunk, sizeof(double *));
+    if (api_planes == NULL)
+      return NULL;
+    api_num_planes = 3 * tiles_per_chunk;
+  }
+
+  int plane = field - CLOVER_FIELD_VOLUME;
+  double **data = &api_planes[3 * tile + plane];
+  if (*data == NULL) {
+    const field_type *cur_field = &chunk.tiles[tile].field;
+    double values[] = {cur_field->uniform_volume, cur_field->uniform_xarea, cur_field->uniform_yarea};
+
+    *data = malloc(elements * sizeof(double));
+    if (*data == NULL)
+      return NULL;
+    for (size_t i = 0; i < elements; i++)
+      (*data)[i] = values[plane];
+  }
+  return *data;
+}
+
+int clover_leaf_get_field(int tile, clover_field field, clover_field_view *view) {
+  if (!api_ready || dry_run || tile < 0 || tile >= tiles_per_chunk || field < 0 || field >= CLOVER_NUM_FIELDS)
+    return -1;
+
+  const tile_type *cur_tile = &chunk.tiles[tile];
+  const field_array_type *array = &field_arrays[field];
+
+  view->x_min = cur_tile->t_xmin;
+  view->x_max = cur_tile->t_xmax;
+  view->y_min = cur_tile->t_ymin;
+  view->y_max = cur_tile->t_ymax;
+  view->left = cur_tile->t_left;
+  view->bottom = cur_tile->t_bottom;
+
+  view->x_lo = array->x_extra != 0 ? cur_tile->t_xmin - 2 : 0;
+  view->x_hi = array->x_extra != 0 ? cur_tile->t_xmax + array->x_extra - 2 : 0;
+  view->y_lo = array->y_extra != 0 ? cur_tile->t_ymin - 2 : 0;
+  view->y_hi = array->y_extra != 0 ? cur_tile->t_ymax + array->y_extra - 2 : 0;
+  view->x_size = view->x_hi - view->x_lo + 1;
+
+  view->data = *(double *const *)((const char *)&cur_tile->field + array->offset);
+  if (view->data == NULL && uniform_grid && field >= CLOVER_FIELD_VOLUME && field <= CLOVER_FIELD_YAREA)
+    view->data = uniform_plane(tile, field, view->x_size * (view->y_hi - view->y_lo + 1));
+
+  return view->data != NULL ? 0 : -1;
+}
+
+void clover_leaf_finalize() {
+  if (!api_failed) {
+    // A completed calculation already closed its files
+    clover_finalize();
+
+    if (chunk.tiles != NULL)
+      destroy_chunk();
+    release_field_cache();
+  }
+
+  // After a failure the chunk is abandoned, as the abort may have happened in the middle of an allocation, but not what
+  // doesn't depend on it: the team, as every abort happens out of its regions, is joined and the calling thread
+  // unpinned, the JIT kernels unloaded and the shared memory segment unmapped
+  team_close();
+  jit_close();
+  shm_export_destroy();
+  chunk.tiles = NULL;
+  states = NULL;
+  profiler_close();
+
+  if (api_discard != NULL)
+    fclose(api_discard);
+  api_discard = NULL;
+  g_stdout = NULL;
+
+  for (int plane = 0; plane < api_num_planes; plane++)
+    free(api_planes[plane]);
+  free(api_planes);
+  api_planes = NULL;
+  api_num_planes = 0;
+
+  api_ready = false;
+  api_failed = false;
+}
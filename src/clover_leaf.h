@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Embedding API, driving a calculation step by step from another program linking clover_leaf.a
+ * @details A calculation is set up from an input deck held in memory, then advanced any number of steps at a time.
+ * Between steps the fields of every tile can be read in place, without copies or files. Only one calculation can be
+ * active at a time (per thread, in batch builds).
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * @brief Arrays held by every tile, in field_type order
+ */
+typedef enum clover_field_t {
+  CLOVER_FIELD_DENSITY0,
+  CLOVER_FIELD_DENSITY1,
+  CLOVER_FIELD_ENERGY0,
+  CLOVER_FIELD_ENERGY1,
+  CLOVER_FIELD_PRESSURE,
+  CLOVER_FIELD_VISCOSITY,
+  CLOVER_FIELD_SOUNDSPEED,
+  CLOVER_FIELD_XVEL0,
+  CLOVER_FIELD_XVEL1,
+  CLOVER_FIELD_YVEL0,
+  CLOVER_FIELD_YVEL1,
+  CLOVER_FIELD_VOL_FLUX_X,
+  CLOVER_FIELD_MASS_FLUX_X,
+  CLOVER_FIELD_VOL_FLUX_Y,
+  CLOVER_FIELD_MASS_FLUX_Y,
+  CLOVER_FIELD_WORK_ARRAY1,
+  CLOVER_FIELD_WORK_ARRAY2,
+  CLOVER_FIELD_WORK_ARRAY3,
+  CLOVER_FIELD_WORK_ARRAY4,
+  CLOVER_FIELD_WORK_ARRAY5,
+  CLOVER_FIELD_WORK_ARRAY6,
+  CLOVER_FIELD_WORK_ARRAY7,
+  CLOVER_FIELD_CELLX,
+  CLOVER_FIELD_CELLY,
+  CLOVER_FIELD_VERTEXX,
+  CLOVER_FIELD_VERTEXY,
+  CLOVER_FIELD_CELLDX,
+  CLOVER_FIELD_CELLDY,
+  CLOVER_FIELD_VERTEXDX,
+  CLOVER_FIELD_VERTEXDY,
+  CLOVER_FIELD_VOLUME,
+  CLOVER_FIELD_XAREA,
+  CLOVER_FIELD_YAREA,
+  CLOVER_NUM_FIELDS
+} clover_field;
+
+/**
+ * @brief Read-only view of one field array of one tile
+ * @details Element (j, k) is data[(k - y_lo) * x_size + (j - x_lo)], using the tile's own indexing in which its cells
+ * go from (x_min, y_min) to (x_max, y_max). The index range includes the halo, and the extra row and column of
+ * vertex and face data. Arrays along x only have a single row with y_lo = y_hi = 0, arrays along y only have a single
+ * column with x_lo = x_hi = 0. The view stays valid until clover_leaf_finalize().
+ */
+typedef struct clover_field_view_t {
+  const double *data;
+  int x_lo, x_hi;
+  int y_lo, y_hi;
+  ptrdiff_t x_size;  // Distance between rows, in elements, so that the offset of a row doesn't overflow an int
+
+  int x_min, x_max;
+  int y_min, y_max;
+  int left, bottom;  // Global index of the tile's first cell, counting from 1
+} clover_field_view;
+
+/**
+ * @brief Sets up a calculation from an input deck held in memory
+ * @param deck Contents of an input deck, in the same format as clover.in
+ * @param out Stream receiving what would be written to clover.out, or NULL to discard it. It is not closed.
+ * @param console Stream receiving the console output, or NULL to discard it. It is not closed.
+ * @return 0 on success, -1 if the deck couldn't be set up, in which case only clover_leaf_finalize() may be called
+ */
+extern int clover_leaf_init(const char *deck, FILE *out, FILE *console);
+
+/**
+ * @brief Advances the calculation, stopping early once it reaches the end time or step of the deck
+ * @return The number of steps taken, 0 once the calculation is complete, -1 on error
+ */
+extern int clover_leaf_step(int steps);
+
+/**
+ * @brief Number of steps taken so far
+ */
+extern int clover_leaf_get_step();
+
+/**
+ * @brief Simulation time reached so far
+ */
+extern double clover_leaf_get_time();
+
+/**
+ * @brief Timestep used by the last step
+ */
+extern double clover_leaf_get_dt();
+
+/**
+ * @brief Whether the calculation reached the end time or step of the deck
+ */
+extern bool clover_leaf_is_complete();
+
+extern int clover_leaf_get_num_tiles();
+
+/**
+ * @brief Gives direct access to one field array of one tile
+ * @return 0 on success, -1 if there is no such tile or field. On a uniform grid, whose volume and area planes aren't
+ * allocated, they are built from their single value on the first request and kept until clover_leaf_finalize().
+ */
+extern int clover_leaf_get_field(int tile, clover_field field, clover_field_view *view);
+
+/**
+ * @brief Releases everything held by the calculation, after which a new one can be set up
+ */
+extern void clover_leaf_finalize();
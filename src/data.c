@@ -2,10 +2,20 @@
 // Copyright (C) 2022 Niccolò Betto
 
 #include "types/data.h"
+#include "utils/thread_local.h"
 
 #include <stdio.h>
 
-FILE *g_in = NULL;
-FILE *g_out = NULL;
+BATCH_LOCAL FILE *g_in = NULL;
+BATCH_LOCAL FILE *g_out = NULL;
 
-parallel_type parallel;
+BATCH_LOCAL FILE *g_stdout = NULL;
+
+BATCH_LOCAL const char *g_run_dir = NULL;
+
+BATCH_LOCAL const char *g_deck = NULL;
+
+BATCH_LOCAL char shm_export_name[G_NAME_LEN_MAX] = "";
+BATCH_LOCAL bool shm_export_buffered = false;
+
+BATCH_LOCAL parallel_type parallel;
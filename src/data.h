@@ -4,8 +4,22 @@
 #pragma once
 
 #include "types/data.h"
+#include "utils/thread_local.h"
 #include <stdio.h>
 
-extern FILE *g_in, *g_out;
+extern BATCH_LOCAL FILE *g_in, *g_out;
 
-extern parallel_type parallel;
+// Console output stream, set to stdout by clover_init_comms() unless redirected beforehand
+extern BATCH_LOCAL FILE *g_stdout;
+
+// Directory holding the run's input and output files, NULL for the current working directory
+extern BATCH_LOCAL const char *g_run_dir;
+
+// Contents of the input deck, read instead of the clover.in file if set
+extern BATCH_LOCAL const char *g_deck;
+
+// Name of the shared memory segment the fields are exported to, empty if not exporting, see shm_export.h
+extern BATCH_LOCAL char shm_export_name[G_NAME_LEN_MAX];
+extern BATCH_LOCAL bool shm_export_buffered;
+
+extern BATCH_LOCAL parallel_type parallel;
@@ -2,55 +2,108 @@
 // Copyright (C) 2022 Niccolò Betto
 
 #include "types/definitions.h"
-
-state_type *states;
-int number_of_states;
-
-int step;
-bool advect_x;
-
-int tiles_per_chunk;
-
-int error_condition;
-
-int test_problem;
-bool complete;
-
-bool use_fortran_kernels;
-bool use_C_kernels;
-bool use_OA_kernels;
-
-bool profiler_on;
-
-profiler_type profiler;
-
-double end_time;
-
-int end_step;
-
-double dtold;
-double dt;
-double time_val;
-double dtinit;
-double dtmin;
-double dtmax;
-double dtrise;
-double dtu_safe;
-double dtv_safe;
-double dtc_safe;
-double dtdiv_safe;
-double dtc;
-double dtu;
-double dtv;
-double dtdiv;
-
-int visit_frequency;
-int summary_frequency;
-
-int jdt;
-int kdt;
-
-chunk_type chunk;
-int number_of_chunks;
-
-grid_type grid;
+#include "utils/thread_local.h"
+
+BATCH_LOCAL state_type *states;
+BATCH_LOCAL int number_of_states;
+
+BATCH_LOCAL int step;
+BATCH_LOCAL bool advect_x;
+
+BATCH_LOCAL int tiles_per_chunk;
+BATCH_LOCAL bool tiles_auto;
+BATCH_LOCAL int tile_grid_x, tile_grid_y;
+
+BATCH_LOCAL int error_condition;
+
+BATCH_LOCAL int test_problem;
+BATCH_LOCAL bool complete;
+
+BATCH_LOCAL bool use_fortran_kernels;
+BATCH_LOCAL bool use_C_kernels;
+BATCH_LOCAL bool use_OA_kernels;
+
+BATCH_LOCAL bool profiler_on;
+BATCH_LOCAL bool trace_on;
+BATCH_LOCAL bool dry_run;
+BATCH_LOCAL bool full_sweep;
+BATCH_LOCAL bool full_halo;
+BATCH_LOCAL bool temporal_blocking;
+BATCH_LOCAL int band_rows;
+BATCH_LOCAL bool jit;
+BATCH_LOCAL bool full_geometry;
+BATCH_LOCAL int threads;
+BATCH_LOCAL bool unpinned;
+BATCH_LOCAL bool bulk_synchronous;
+BATCH_LOCAL bool uniform_grid;
+
+BATCH_LOCAL profiler_type profiler;
+
+BATCH_LOCAL double end_time;
+
+BATCH_LOCAL int end_step;
+
+BATCH_LOCAL double dtold;
+BATCH_LOCAL double dt;
+BATCH_LOCAL double time_val;
+BATCH_LOCAL double dtinit;
+BATCH_LOCAL double dtmin;
+BATCH_LOCAL double dtmax;
+BATCH_LOCAL double dtrise;
+BATCH_LOCAL double dtu_safe;
+BATCH_LOCAL double dtv_safe;
+BATCH_LOCAL double dtc_safe;
+BATCH_LOCAL double dtdiv_safe;
+BATCH_LOCAL double dtc;
+BATCH_LOCAL double dtu;
+BATCH_LOCAL double dtv;
+BATCH_LOCAL double dtdiv;
+
+BATCH_LOCAL int visit_frequency;
+BATCH_LOCAL int summary_frequency;
+
+BATCH_LOCAL int jdt;
+BATCH_LOCAL int kdt;
+
+BATCH_LOCAL chunk_type chunk;
+BATCH_LOCAL int number_of_chunks;
+
+BATCH_LOCAL grid_type grid;
+
+// clang-format off
+const field_array_type field_arrays[NUM_FIELD_ARRAYS] = {
+    {"density0",    offsetof(field_type, density0),    4, 4},
+    {"density1",    offsetof(field_type, density1),    4, 4},
+    {"energy0",     offsetof(field_type, energy0),     4, 4},
+    {"energy1",     offsetof(field_type, energy1),     4, 4},
+    {"pressure",    offsetof(field_type, pressure),    4, 4},
+    {"viscosity",   offsetof(field_type, viscosity),   4, 4},
+    {"soundspeed",  offsetof(field_type, soundspeed),  4, 4},
+    {"xvel0",       offsetof(field_type, xvel0),       5, 5},
+    {"xvel1",       offsetof(field_type, xvel1),       5, 5},
+    {"yvel0",       offsetof(field_type, yvel0),       5, 5},
+    {"yvel1",       offsetof(field_type, yvel1),       5, 5},
+    {"vol_flux_x",  offsetof(field_type, vol_flux_x),  5, 4},
+    {"mass_flux_x", offsetof(field_type, mass_flux_x), 5, 4},
+    {"vol_flux_y",  offsetof(field_type, vol_flux_y),  4, 5},
+    {"mass_flux_y", offsetof(field_type, mass_flux_y), 4, 5},
+    {"work_array1", offsetof(field_type, work_array1), 5, 5},
+    {"work_array2", offsetof(field_type, work_array2), 5, 5},
+    {"work_array3", offsetof(field_type, work_array3), 5, 5},
+    {"work_array4", offsetof(field_type, work_array4), 5, 5},
+    {"work_array5", offsetof(field_type, work_array5), 5, 5},
+    {"work_array6", offsetof(field_type, work_array6), 5, 5},
+    {"work_array7", offsetof(field_type, work_array7), 5, 5},
+    {"cellx",       offsetof(field_type, cellx),       4, 0},
+    {"celly",       offsetof(field_type, celly),       0, 4},
+    {"vertexx",     offsetof(field_type, vertexx),     5, 0},
+    {"vertexy",     offsetof(field_type, vertexy),     0, 5},
+    {"celldx",      offsetof(field_type, celldx),      4, 0},
+    {"celldy",      offsetof(field_type, celldy),      0, 4},
+    {"vertexdx",    offsetof(field_type, vertexdx),    5, 0},
+    {"vertexdy",    offsetof(field_type, vertexdy),    0, 5},
+    {"volume",      offsetof(field_type, volume),      4, 4},
+    {"xarea",       offsetof(field_type, xarea),       5, 4},
+    {"yarea",       offsetof(field_type, yarea),       4, 5},
+};
+// clang-format on
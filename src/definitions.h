@@ -6,55 +6,74 @@
 #include <stdbool.h>
 
 #include "types/definitions.h"
-
-extern state_type *states;  // allocatable
-extern int number_of_states;
-
-extern int step;
-extern bool advect_x;
-
-extern int tiles_per_chunk;
-
-extern int error_condition;
-
-extern int test_problem;
-extern bool complete;
-
-extern bool use_fortran_kernels;
-extern bool use_C_kernels;
-extern bool use_OA_kernels;
-
-extern bool profiler_on;
-
-extern profiler_type profiler;
-
-extern double end_time;
-
-extern int end_step;
-
-extern double dtold;
-extern double dt;
-extern double time_val;
-extern double dtinit;
-extern double dtmin;
-extern double dtmax;
-extern double dtrise;
-extern double dtu_safe;
-extern double dtv_safe;
-extern double dtc_safe;
-extern double dtdiv_safe;
-extern double dtc;
-extern double dtu;
-extern double dtv;
-extern double dtdiv;
-
-extern int visit_frequency;
-extern int summary_frequency;
-
-extern int jdt;
-extern int kdt;
-
-extern chunk_type chunk;
-extern int number_of_chunks;
-
-extern grid_type grid;
+#include "utils/thread_local.h"
+
+extern BATCH_LOCAL state_type *states;  // allocatable
+extern BATCH_LOCAL int number_of_states;
+
+extern BATCH_LOCAL int step;
+extern BATCH_LOCAL bool advect_x;
+
+extern BATCH_LOCAL int tiles_per_chunk;
+extern BATCH_LOCAL bool tiles_auto;  // tiles_per_chunk auto, the tiles are tuned, see tune.h
+// The tiles are tile_grid_x by tile_grid_y when they make tiles_per_chunk, see clover_tile_decompose()
+extern BATCH_LOCAL int tile_grid_x, tile_grid_y;
+
+extern BATCH_LOCAL int error_condition;
+
+extern BATCH_LOCAL int test_problem;
+extern BATCH_LOCAL bool complete;
+
+extern BATCH_LOCAL bool use_fortran_kernels;
+extern BATCH_LOCAL bool use_C_kernels;
+extern BATCH_LOCAL bool use_OA_kernels;
+
+extern BATCH_LOCAL bool profiler_on;
+extern BATCH_LOCAL bool trace_on;
+extern BATCH_LOCAL bool dry_run;
+extern BATCH_LOCAL bool full_sweep;
+extern BATCH_LOCAL bool full_halo;
+extern BATCH_LOCAL bool temporal_blocking;
+extern BATCH_LOCAL int band_rows;
+extern BATCH_LOCAL bool jit;
+extern BATCH_LOCAL bool full_geometry;
+extern BATCH_LOCAL int threads;  // Members of the team running the tiles of a step, see team.h
+extern BATCH_LOCAL bool unpinned;
+extern BATCH_LOCAL bool bulk_synchronous;  // The team runs the kernels separated by barriers, see flow.h
+extern BATCH_LOCAL bool uniform_grid;      // The volume and area planes aren't allocated, see kernels/geometry.h
+
+extern BATCH_LOCAL profiler_type profiler;
+
+extern BATCH_LOCAL double end_time;
+
+extern BATCH_LOCAL int end_step;
+
+extern BATCH_LOCAL double dtold;
+extern BATCH_LOCAL double dt;
+extern BATCH_LOCAL double time_val;
+extern BATCH_LOCAL double dtinit;
+extern BATCH_LOCAL double dtmin;
+extern BATCH_LOCAL double dtmax;
+extern BATCH_LOCAL double dtrise;
+extern BATCH_LOCAL double dtu_safe;
+extern BATCH_LOCAL double dtv_safe;
+extern BATCH_LOCAL double dtc_safe;
+extern BATCH_LOCAL double dtdiv_safe;
+extern BATCH_LOCAL double dtc;
+extern BATCH_LOCAL double dtu;
+extern BATCH_LOCAL double dtv;
+extern BATCH_LOCAL double dtdiv;
+
+extern BATCH_LOCAL int visit_frequency;
+extern BATCH_LOCAL int summary_frequency;
+
+extern BATCH_LOCAL int jdt;
+extern BATCH_LOCAL int kdt;
+
+extern BATCH_LOCAL chunk_type chunk;
+extern BATCH_LOCAL int number_of_chunks;
+
+extern BATCH_LOCAL grid_type grid;
+
+// Layout of every field_type array, in declaration order
+extern const field_array_type field_arrays[NUM_FIELD_ARRAYS];
@@ -0,0 +1,643 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "ensemble.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data.h"
+#include "definitions.h"
+#include "kernels.h"
+#include "utils/math.h"
+#include "utils/timer.h"
+
+static double **array_ptr(field_type *field, const field_array_type *array) {
+  return (double **)((char *)field + array->offset);
+}
+
+static size_t array_elements(const field_array_type *array, int x_max, int y_max) {
+  size_t columns = array->x_extra != 0 ? x_max + array->x_extra : 1;
+  size_t rows = array->y_extra != 0 ? y_max + array->y_extra : 1;
+  return columns * rows;
+}
+
+void ensemble_build(ensemble_type *ens, int x_cells, int y_cells) {
+  memset(ens, 0, sizeof(*ens));
+
+  ens->x_min = 1;
+  ens->x_max = x_cells;
+  ens->y_min = 1;
+  ens->y_max = y_cells;
+
+  for (size_t a = 0; a < NUM_FIELD_ARRAYS; a++) {
+    size_t size = array_elements(&field_arrays[a], x_cells, y_cells) * ENSEMBLE_WIDTH * sizeof(double);
+
+    // Every lane group starts on a vector boundary, the sizes are multiples of 64 bytes already
+    double *lanes = aligned_alloc(64, size);
+    memset(lanes, 0, size);
+    *array_ptr(&ens->field, &field_arrays[a]) = lanes;
+  }
+}
+
+void ensemble_destroy(ensemble_type *ens) {
+  for (size_t a = 0; a < NUM_FIELD_ARRAYS; a++) {
+    free(*array_ptr(&ens->field, &field_arrays[a]));
+    *array_ptr(&ens->field, &field_arrays[a]) = NULL;
+  }
+
+  for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+    ensemble_lane *lane = &ens->lanes[e];
+
+    if (lane->out != NULL)
+      fclose(lane->out);
+    lane->out = NULL;
+  }
+}
+
+/**
+ * @brief The single value of a volume or area plane that isn't allocated on a uniform grid, see kernels/geometry.h
+ */
+static double uniform_value(const field_type *field, const field_array_type *array) {
+  if (array->offset == offsetof(field_type, volume))
+    return field->uniform_volume;
+  return array->offset == offsetof(field_type, xarea) ? field->uniform_xarea : field->uniform_yarea;
+}
+
+bool ensemble_add_member(ensemble_type *ens, int e) {
+  if (tiles_per_chunk != 1 || chunk.x_max != ens->x_max || chunk.y_max != ens->y_max)
+    return false;
+
+  field_type *field = &chunk.tiles[0].field;
+
+  for (size_t a = 0; a < NUM_FIELD_ARRAYS; a++) {
+    const double *src = *array_ptr(field, &field_arrays[a]);
+    double *dst = *array_ptr(&ens->field, &field_arrays[a]);
+    size_t elements = array_elements(&field_arrays[a], ens->x_max, ens->y_max);
+
+    // The lanes keep every plane, as each member may have a grid of its own
+    if (src == NULL) {
+      double value = uniform_value(field, &field_arrays[a]);
+      for (size_t i = 0; i < elements; i++)
+        dst[i * ENSEMBLE_WIDTH + e] = value;
+      continue;
+    }
+
+    for (size_t i = 0; i < elements; i++)
+      dst[i * ENSEMBLE_WIDTH + e] = src[i];
+  }
+  ens->eos_current = false;
+
+  ensemble_lane *lane = &ens->lanes[e];
+  memset(lane, 0, sizeof(*lane));
+
+  lane->used = true;
+  lane->active = true;
+  lane->out = g_out;
+  lane->console = g_stdout;
+  lane->test_problem = test_problem;
+  lane->end_step = end_step;
+  lane->summary_frequency = summary_frequency;
+  lane->end_time = end_time;
+  lane->dtmin = dtmin;
+  lane->dtmax = dtmax;
+  lane->dtrise = dtrise;
+  lane->dtold = dtold;
+  lane->time = time_val;
+
+  ens->dt[e] = dt;
+  ens->dtc_safe[e] = dtc_safe;
+  ens->dtu_safe[e] = dtu_safe;
+  ens->dtv_safe[e] = dtv_safe;
+  ens->dtdiv_safe[e] = dtdiv_safe;
+
+  // The lane owns the output file from now on
+  g_out = NULL;
+
+  return true;
+}
+
+/**
+ * @brief Fills an unused lane with a copy of lane 0, so that it only ever computes on valid data
+ */
+static void fill_unused_lane(ensemble_type *ens, int e) {
+  for (size_t a = 0; a < NUM_FIELD_ARRAYS; a++) {
+    double *lanes = *array_ptr(&ens->field, &field_arrays[a]);
+    size_t elements = array_elements(&field_arrays[a], ens->x_max, ens->y_max);
+
+    for (size_t i = 0; i < elements; i++)
+      lanes[i * ENSEMBLE_WIDTH + e] = lanes[i * ENSEMBLE_WIDTH];
+  }
+
+  ens->dtc_safe[e] = ens->dtc_safe[0];
+  ens->dtu_safe[e] = ens->dtu_safe[0];
+  ens->dtv_safe[e] = ens->dtv_safe[0];
+  ens->dtdiv_safe[e] = ens->dtdiv_safe[0];
+}
+
+/**
+ * @brief Lane-wise update_halo, applying the reflective boundary conditions to the requested fields
+ */
+static void ensemble_update_halo(ensemble_type *ens, int fields[static NUM_FIELDS], int depth) {
+  field_type *f = &ens->field;
+
+  // clang-format off
+  struct {
+    double *field;
+    int x_kind, y_kind;
+    double x_sign, y_sign;
+  } halos[NUM_FIELDS] = {
+      [FIELD_DENSITY0]    = {f->density0,    ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_DENSITY1]    = {f->density1,    ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_ENERGY0]     = {f->energy0,     ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_ENERGY1]     = {f->energy1,     ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_PRESSURE]    = {f->pressure,    ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_VISCOSITY]   = {f->viscosity,   ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_SOUNDSPEED]  = {f->soundspeed,  ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL,  1.0,  1.0},
+      [FIELD_XVEL0]       = {f->xvel0,       ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_NODE, -1.0,  1.0},
+      [FIELD_XVEL1]       = {f->xvel1,       ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_NODE, -1.0,  1.0},
+      [FIELD_YVEL0]       = {f->yvel0,       ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_NODE,  1.0, -1.0},
+      [FIELD_YVEL1]       = {f->yvel1,       ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_NODE,  1.0, -1.0},
+      [FIELD_VOL_FLUX_X]  = {f->vol_flux_x,  ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_FACE, -1.0,  1.0},
+      [FIELD_VOL_FLUX_Y]  = {f->vol_flux_y,  ENSEMBLE_HALO_FACE, ENSEMBLE_HALO_NODE,  1.0, -1.0},
+      [FIELD_MASS_FLUX_X] = {f->mass_flux_x, ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_FACE, -1.0,  1.0},
+      [FIELD_MASS_FLUX_Y] = {f->mass_flux_y, ENSEMBLE_HALO_FACE, ENSEMBLE_HALO_NODE,  1.0, -1.0},
+  };
+  // clang-format on
+
+  for (int i = 0; i < NUM_FIELDS; i++) {
+    if (fields[i] != 1)
+      continue;
+
+    kernel_ensemble_update_halo(
+        ens->x_min,
+        ens->x_max,
+        ens->y_min,
+        ens->y_max,
+        halos[i].field,
+        halos[i].x_kind,
+        halos[i].y_kind,
+        halos[i].x_sign,
+        halos[i].y_sign,
+        depth
+    );
+  }
+}
+
+static void ensemble_ideal_gas(ensemble_type *ens, bool predict) {
+  if (!predict && ens->eos_current)
+    return;
+
+  kernel_ensemble_ideal_gas(
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      predict ? ens->field.work_array2 : ens->field.density0,
+      predict ? ens->field.work_array3 : ens->field.energy0,
+      ens->field.pressure,
+      ens->field.soundspeed
+  );
+
+  ens->eos_current = !predict;
+}
+
+static void ensemble_field_summary(ensemble_type *ens, int step, bool selected[static ENSEMBLE_WIDTH]) {
+  double vol[ENSEMBLE_WIDTH], mass[ENSEMBLE_WIDTH], ie[ENSEMBLE_WIDTH], ke[ENSEMBLE_WIDTH], press[ENSEMBLE_WIDTH];
+
+  ensemble_ideal_gas(ens, false);
+
+  kernel_ensemble_field_summary(
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      ens->field.volume,
+      ens->field.density0,
+      ens->field.energy0,
+      ens->field.pressure,
+      ens->field.xvel0,
+      ens->field.yvel0,
+      vol,
+      mass,
+      ie,
+      ke,
+      press
+  );
+
+  for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+    ensemble_lane *lane = &ens->lanes[e];
+
+    if (!selected[e])
+      continue;
+
+    print_field_summary(
+        lane->out,
+        lane->console,
+        step,
+        lane->time,
+        vol[e],
+        mass[e],
+        ie[e],
+        ke[e],
+        press[e],
+        lane->active ? 0 : lane->test_problem
+    );
+  }
+}
+
+/**
+ * @brief Lane-wise timestep, every member gets its own dt. Lanes that are no longer active get a zero timestep, which
+ * leaves their state unchanged.
+ */
+static void ensemble_timestep(ensemble_type *ens, int step) {
+  double dtl[ENSEMBLE_WIDTH], x_pos[ENSEMBLE_WIDTH], y_pos[ENSEMBLE_WIDTH];
+  int jldt[ENSEMBLE_WIDTH], kldt[ENSEMBLE_WIDTH];
+  int fields[NUM_FIELDS];
+
+  ensemble_ideal_gas(ens, false);
+
+  memset(fields, 0, NUM_FIELDS * sizeof(int));
+  fields[FIELD_PRESSURE] = 1;
+  fields[FIELD_ENERGY0] = 1;
+  fields[FIELD_DENSITY0] = 1;
+  fields[FIELD_XVEL0] = 1;
+  fields[FIELD_YVEL0] = 1;
+  ensemble_update_halo(ens, fields, 1);
+
+  kernel_ensemble_viscosity(
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      ens->field.celldx,
+      ens->field.celldy,
+      ens->field.density0,
+      ens->field.pressure,
+      ens->field.viscosity,
+      ens->field.xvel0,
+      ens->field.yvel0
+  );
+
+  memset(fields, 0, NUM_FIELDS * sizeof(int));
+  fields[FIELD_VISCOSITY] = 1;
+  ensemble_update_halo(ens, fields, 1);
+
+  kernel_ensemble_calc_dt(
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      ens->dtc_safe,
+      ens->dtu_safe,
+      ens->dtv_safe,
+      ens->dtdiv_safe,
+      ens->field.xarea,
+      ens->field.yarea,
+      ens->field.cellx,
+      ens->field.celly,
+      ens->field.celldx,
+      ens->field.celldy,
+      ens->field.volume,
+      ens->field.density0,
+      ens->field.viscosity,
+      ens->field.soundspeed,
+      ens->field.xvel0,
+      ens->field.yvel0,
+      ens->field.work_array1,
+      dtl,
+      x_pos,
+      y_pos,
+      jldt,
+      kldt
+  );
+
+  for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+    ensemble_lane *lane = &ens->lanes[e];
+
+    if (!lane->active) {
+      ens->dt[e] = 0.0;
+      continue;
+    }
+
+    ens->dt[e] = min(dtl[e], min((lane->dtold * lane->dtrise), lane->dtmax));
+
+    const char *format = "Step %7d time %.7lf control %10s  timestep  %.2e%8d, %8d x  %.2e y  %.2e\n";
+    fprintf(lane->out, format, step, lane->time, "sound", ens->dt[e], jldt[e], kldt[e], x_pos[e], y_pos[e]);
+    fprintf(lane->console, format, step, lane->time, "sound", ens->dt[e], jldt[e], kldt[e], x_pos[e], y_pos[e]);
+
+    if (ens->dt[e] < lane->dtmin) {
+      // Same report as report_error(), but only this member stops
+      const char *error = "\nError in %s: %s%s\n\nCLOVER is terminating.\n";
+      fprintf(lane->out, error, "timestep", "small timestep", "");
+      fprintf(lane->console, error, "timestep", "small timestep", "");
+
+      lane->active = false;
+      lane->failed = true;
+      lane->step = step;
+      ens->dt[e] = 0.0;
+      continue;
+    }
+
+    lane->dtold = ens->dt[e];
+  }
+}
+
+/**
+ * @brief PdV of all the members, the predictor followed by its equation of state and pressure halo exchange
+ * @details As in kernels.c, the predictor writes its density and energy to work arrays, read only by the equation of
+ * state, so density1 and energy1 don't need reverting before the corrector.
+ */
+static void ensemble_pdv(ensemble_type *ens, bool predict) {
+  int fields[NUM_FIELDS];
+
+  kernel_ensemble_pdv(
+      predict,
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      ens->dt,
+      ens->field.xarea,
+      ens->field.yarea,
+      ens->field.volume,
+      ens->field.density0,
+      predict ? ens->field.work_array2 : ens->field.density1,
+      ens->field.energy0,
+      predict ? ens->field.work_array3 : ens->field.energy1,
+      ens->field.pressure,
+      ens->field.viscosity,
+      ens->field.xvel0,
+      ens->field.xvel1,
+      ens->field.yvel0,
+      ens->field.yvel1,
+      ens->field.work_array1
+  );
+
+  if (predict) {
+    ensemble_ideal_gas(ens, true);
+
+    memset(fields, 0, sizeof(fields));
+    fields[FIELD_PRESSURE] = 1;
+    ensemble_update_halo(ens, fields, 1);
+  }
+}
+
+static void ensemble_advec_cell(ensemble_type *ens, int sweep_number, int direction) {
+  kernel_ensemble_advec_cell(
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      direction,
+      sweep_number,
+      ens->field.vertexdx,
+      ens->field.vertexdy,
+      ens->field.volume,
+      ens->field.density1,
+      ens->field.energy1,
+      ens->field.mass_flux_x,
+      ens->field.vol_flux_x,
+      ens->field.mass_flux_y,
+      ens->field.vol_flux_y,
+      ens->field.work_array1,
+      ens->field.work_array2,
+      ens->field.work_array3,
+      ens->field.work_array4,
+      ens->field.work_array5,
+      ens->field.work_array6,
+      ens->field.work_array7
+  );
+}
+
+static void ensemble_advec_mom(ensemble_type *ens, int which_vel, int direction, int sweep_number) {
+  kernel_ensemble_advec_mom(
+      ens->x_min,
+      ens->x_max,
+      ens->y_min,
+      ens->y_max,
+      which_vel == G_XDIR ? ens->field.xvel1 : ens->field.yvel1,
+      ens->field.mass_flux_x,
+      ens->field.vol_flux_x,
+      ens->field.mass_flux_y,
+      ens->field.vol_flux_y,
+      ens->field.volume,
+      ens->field.density1,
+      ens->field.work_array1,
+      ens->field.work_array2,
+      ens->field.work_array3,
+      ens->field.work_array4,
+      ens->field.work_array5,
+      ens->field.work_array6,
+      ens->field.celldx,
+      ens->field.celldy,
+      which_vel,
+      sweep_number,
+      direction
+  );
+}
+
+/**
+ * @brief Lane-wise advection, with the same sweep order and halo exchanges as advection()
+ */
+static void ensemble_advection(ensemble_type *ens, bool x_first) {
+  int fields[NUM_FIELDS];
+
+  memset(fields, 0, sizeof(fields));
+  fields[FIELD_ENERGY1] = 1;
+  fields[FIELD_DENSITY1] = 1;
+  fields[FIELD_VOL_FLUX_X] = 1;
+  fields[FIELD_VOL_FLUX_Y] = 1;
+  ensemble_update_halo(ens, fields, 2);
+
+  for (int sweep_number = 1; sweep_number <= 2; sweep_number++) {
+    int direction = x_first == (sweep_number == 1) ? G_XDIR : G_YDIR;
+
+    ensemble_advec_cell(ens, sweep_number, direction);
+
+    memset(fields, 0, sizeof(fields));
+    fields[FIELD_DENSITY1] = 1;
+    fields[FIELD_ENERGY1] = 1;
+    fields[FIELD_XVEL1] = 1;
+    fields[FIELD_YVEL1] = 1;
+    fields[FIELD_MASS_FLUX_X] = 1;
+    fields[FIELD_MASS_FLUX_Y] = 1;
+    ensemble_update_halo(ens, fields, 2);
+
+    ensemble_advec_mom(ens, G_XDIR, direction, sweep_number);
+    ensemble_advec_mom(ens, G_YDIR, direction, sweep_number);
+  }
+}
+
+void ensemble_hydro(ensemble_type *ens) {
+  bool x_first = true;
+  bool summary[ENSEMBLE_WIDTH];
+  int step = 0;
+  int running = 0;
+
+  for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+    if (ens->lanes[e].used)
+      running++;
+    else
+      fill_unused_lane(ens, e);
+  }
+
+  double timerstart = timer();
+
+  while (running > 0) {
+    double step_time = timer();
+    step++;
+
+    ensemble_timestep(ens, step);
+
+    ensemble_pdv(ens, true);
+
+    kernel_ensemble_accelerate(
+        ens->x_min,
+        ens->x_max,
+        ens->y_min,
+        ens->y_max,
+        ens->dt,
+        ens->field.xarea,
+        ens->field.yarea,
+        ens->field.volume,
+        ens->field.density0,
+        ens->field.pressure,
+        ens->field.viscosity,
+        ens->field.xvel0,
+        ens->field.yvel0,
+        ens->field.xvel1,
+        ens->field.yvel1
+    );
+
+    ensemble_pdv(ens, false);
+
+    kernel_ensemble_flux_calc(
+        ens->x_min,
+        ens->x_max,
+        ens->y_min,
+        ens->y_max,
+        ens->dt,
+        ens->field.xarea,
+        ens->field.yarea,
+        ens->field.xvel0,
+        ens->field.yvel0,
+        ens->field.xvel1,
+        ens->field.yvel1,
+        ens->field.vol_flux_x,
+        ens->field.vol_flux_y
+    );
+
+    ensemble_advection(ens, x_first);
+
+    kernel_ensemble_reset_field(
+        ens->x_min,
+        ens->x_max,
+        ens->y_min,
+        ens->y_max,
+        ens->field.density0,
+        ens->field.density1,
+        ens->field.energy0,
+        ens->field.energy1,
+        ens->field.xvel0,
+        ens->field.xvel1,
+        ens->field.yvel0,
+        ens->field.yvel1
+    );
+    ens->eos_current = false;
+
+    x_first = !x_first;
+
+    // Periodic summaries, and the final one of every member completing at this step
+    bool any_summary = false;
+    bool completed[ENSEMBLE_WIDTH];
+
+    for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+      ensemble_lane *lane = &ens->lanes[e];
+
+      summary[e] = false;
+      completed[e] = false;
+
+      if (!lane->active) {
+        // Members failing in this step's timestep still count as running
+        if (lane->failed && lane->step == step)
+          running--;
+        continue;
+      }
+
+      lane->time += ens->dt[e];
+
+      if (lane->summary_frequency != 0 && step % lane->summary_frequency == 0)
+        summary[e] = true;
+
+      if (step == 1)
+        lane->first_step = timer() - step_time;
+      else if (step == 2)
+        lane->second_step = timer() - step_time;
+
+      if (lane->time + G_SMALL > lane->end_time || step >= lane->end_step)
+        completed[e] = true;
+
+      any_summary = any_summary || summary[e];
+    }
+
+    if (any_summary)
+      ensemble_field_summary(ens, step, summary);
+
+    bool any_completed = false;
+    for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+      if (completed[e]) {
+        ens->lanes[e].active = false;
+        ens->lanes[e].step = step;
+        any_completed = true;
+        running--;
+      }
+    }
+
+    double wall_clock = timer() - timerstart;
+
+    if (any_completed) {
+      ensemble_field_summary(ens, step, completed);
+
+      for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+        ensemble_lane *lane = &ens->lanes[e];
+
+        if (!completed[e])
+          continue;
+
+        fprintf(lane->out, "\nCalculation completed\n");
+        fprintf(lane->out, "Clover is finishing\n");
+        fprintf(lane->out, "Wall clock     %.16f\n", wall_clock);
+        fprintf(lane->out, "First step overhead   %.16f\n", lane->first_step - lane->second_step);
+
+        fprintf(lane->console, "Wall clock    %.16f\n", wall_clock);
+        fprintf(lane->console, "First step overhead   %.16f\n", lane->first_step - lane->second_step);
+
+        fclose(lane->out);
+        lane->out = NULL;
+      }
+    }
+
+    // Timings are per cell of the whole ensemble, as all lanes advance together
+    double step_clock = timer() - step_time;
+    double cells = (double)ens->x_max * ens->y_max * ENSEMBLE_WIDTH;
+    double grind_time = wall_clock / ((step + 1) * cells);
+    double step_grind = step_clock / cells;
+
+    for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+      ensemble_lane *lane = &ens->lanes[e];
+
+      if (!lane->active)
+        continue;
+
+      fprintf(lane->out, "Wall clock    %.16f\n", wall_clock);
+      fprintf(lane->console, "Wall clock    %.16f\n", wall_clock);
+
+      fprintf(lane->out, "Average time per cell    %.16e\n", grind_time);
+      fprintf(lane->out, "Step time per cell       %.16e\n", step_grind);
+      fprintf(lane->console, "Average time per cell    %.16e\n", grind_time);
+      fprintf(lane->console, "Step time per cell       %.16e\n", step_grind);
+    }
+  }
+}
@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Ensemble mode, running up to ENSEMBLE_WIDTH independent problems with the same mesh size in SIMD lanes
+ * @details Aimed at sweeps of many small problems, whose inner loops are too short to vectorise on their own. Every
+ * member is read and generated by the normal initialisation path as a single tile, then moved to its lane, after which
+ * all members advance in lockstep with the kernels in kernels/ensemble.c. Each member keeps its own timestep, end
+ * condition and output files, and produces the same results as a normal run of its deck.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "kernels/ensemble.h"
+#include "types/definitions.h"
+
+typedef struct ensemble_lane_t {
+  bool used;    // Unused lanes hold a copy of lane 0 that never advances
+  bool active;  // Still running, cleared when the member completes or fails
+  bool failed;
+
+  FILE *out;      // The member's clover.out
+  FILE *console;  // Where the member's console output goes
+
+  int test_problem;
+  int end_step;
+  int summary_frequency;
+  double end_time;
+  double dtmin;
+  double dtmax;
+  double dtrise;
+  double dtold;
+
+  int step;
+  double time;
+  double first_step;
+  double second_step;
+} ensemble_lane;
+
+typedef struct ensemble_type_t {
+  int x_min;
+  int x_max;
+  int y_min;
+  int y_max;
+
+  field_type field;  // Lane interleaved arrays, see kernels/ensemble.h
+  ensemble_lane lanes[ENSEMBLE_WIDTH];
+
+  // Per-lane kernel parameters
+  double dt[ENSEMBLE_WIDTH];
+  double dtc_safe[ENSEMBLE_WIDTH];
+  double dtu_safe[ENSEMBLE_WIDTH];
+  double dtv_safe[ENSEMBLE_WIDTH];
+  double dtdiv_safe[ENSEMBLE_WIDTH];
+
+  bool eos_current;  // Pressure and soundspeed are the equation of state of density0 and energy0, see ideal_gas()
+} ensemble_type;
+
+/**
+ * @brief Allocates the lane interleaved arrays for a mesh of the given size, with all lanes unused
+ */
+extern void ensemble_build(ensemble_type *ens, int x_cells, int y_cells);
+
+/**
+ * @brief Releases the arrays of the ensemble and the output files of its members
+ */
+extern void ensemble_destroy(ensemble_type *ens);
+
+/**
+ * @brief Moves the problem currently held by the globals into the given lane
+ * @details The problem must have been set up by initialise() as a single tile of the ensemble's mesh size. The lane
+ * takes over the problem's output files, leaving g_out NULL, the chunk itself is left to the caller to destroy.
+ * @return false if the problem doesn't fit the ensemble
+ */
+extern bool ensemble_add_member(ensemble_type *ens, int lane);
+
+/**
+ * @brief Advances all the members in lockstep until each one has reached its own end time or step
+ */
+extern void ensemble_hydro(ensemble_type *ens);
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "flow.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+#include "definitions.h"
+#include "halo.h"
+#include "profiler.h"
+#include "report.h"
+#include "team.h"
+#include "utils/timer.h"
+
+// Sweeps over its tiles finding no task ready before a member yields its CPU, each polling the tiles near every one
+// of them, about as long as a barrier spins (see team.c)
+#define FLOW_SPINS 64
+
+// The tasks done on a tile over every flow_run(), alone on its cache line as the members poll their neighbours'
+typedef struct progress_t {
+  long done;
+  char pad[64 - sizeof(long)];
+} progress;
+
+static BATCH_LOCAL progress *tiles = NULL;
+
+void flow_open() {
+  flow_close();
+
+  tiles = aligned_alloc(64, tiles_per_chunk * sizeof(progress));
+  if (tiles == NULL)
+    report_error("flow_open", "Error allocating the task counts.");
+  for (int tile = 0; tile < tiles_per_chunk; tile++)
+    tiles[tile].done = 0;
+}
+
+bool flow_on() {
+  return team_size() > 1 && !bulk_synchronous;
+}
+
+/**
+ * @brief Whether every tile near a tile has done its first done tasks, so that the next task of the tile may run
+ */
+static bool ready(int tile, long done) {
+  int num;
+  const int *near = halo_near(tile, &num);
+
+  for (int n = 0; n < num; n++)
+    if (__atomic_load_n(&tiles[near[n]].done, __ATOMIC_ACQUIRE) < done)
+      return false;
+  return true;
+}
+
+static void run(const flow_task *task, int tile) {
+  if (!profiler_on || task->slot == NULL) {
+    task->run(tile, task->arg);
+    return;
+  }
+
+  double start = timer();
+  task->run(tile, task->arg);
+  profiler_task(task->slot, start);
+}
+
+void flow_run(const flow_task *tasks, int num_tasks) {
+  int begin = team_tile_begin(), end = team_tile_end();
+
+  // Every tile has done the same tasks when a run starts, the previous one ending with a barrier
+  long base = tiles[begin].done;
+  int left = (end - begin) * num_tasks;
+
+  for (int spins = 0; left > 0;) {
+    bool ran = false;
+
+    for (int tile = begin; tile < end; tile++) {
+      // Only this member writes the count of its own tiles
+      long done = tiles[tile].done;
+
+      while (done - base < num_tasks && ready(tile, done)) {
+        run(&tasks[done - base], tile);
+        __atomic_store_n(&tiles[tile].done, ++done, __ATOMIC_RELEASE);
+        left--;
+        ran = true;
+      }
+    }
+
+    spins = ran ? 0 : spins + 1;
+    if (spins >= FLOW_SPINS)
+      sched_yield();
+  }
+
+  team_barrier();
+}
+
+void flow_close() {
+  free(tiles);
+  tiles = NULL;
+}
@@ -0,0 +1,57 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Dataflow execution of the kernels of a step on the team, the default with more than one thread
+ * @details The kernels between two points needing the whole mesh, the reduction of the timestep and the end of the
+ * step, are given to flow_run() as a list of tasks, each run on every tile: a kernel, or one of the three parts of a
+ * halo exchange, top and bottom, left and right, then the external faces. Task i of a tile is ready once task i - 1 is
+ * done on the tile and on every tile within HALO_MARGIN cells of it, those it copies halos from and those whose writes
+ * invalidate its halos (see halo.h). Every tile counts the tasks done on it, and each member runs the ready tasks of
+ * its own tiles, each tile as far as it can go, only spinning when none is ready.
+ *
+ * A tile and the tiles near it are then never more than one task apart, so a task sees the data the bulk-synchronous
+ * drivers separated by barriers would show it and the results are bitwise identical, but a tile runs on as soon as its
+ * neighbours allow instead of waiting for the whole team, and a kernel often finds the tile the previous one left in
+ * cache. The bulk_synchronous deck keyword keeps the barriers.
+ *
+ * With profiler_on the members account the time of each task to the row of its kernel, so the rows add up the time of
+ * every thread, and with trace_on trace it as a region on their own thread. The hardware counters aren't split by
+ * kernel.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief A task of flow_run()
+ */
+typedef struct flow_task_t {
+  // Runs the task on a tile
+  void (*run)(int tile, const void *arg);
+  const void *arg;
+  // The profiler row its time is accounted to, e.g. &profiler.PdV
+  double *slot;
+} flow_task;
+
+/**
+ * @brief Sets up the task counts of the tiles, called once halo_open() has found the tiles near each other
+ */
+extern void flow_open();
+
+/**
+ * @brief Whether the step runs as a dataflow, on a team of more than one without the bulk_synchronous keyword
+ */
+extern bool flow_on();
+
+/**
+ * @brief Runs every task on every tile of the calling member, called by every member of a team region
+ * @details Returns once every member is done, as the drivers ending with team_barrier() do
+ */
+extern void flow_run(const flow_task *tasks, int num_tasks);
+
+/**
+ * @brief Releases the task counts, safe to call when they aren't set up
+ */
+extern void flow_close();
@@ -0,0 +1,120 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "halo.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "report.h"
+
+// Depth to which each field of each tile has a valid halo, tiles_per_chunk rows of NUM_FIELDS
+static BATCH_LOCAL int (*valid)[NUM_FIELDS] = NULL;
+static BATCH_LOCAL int (*masks)[NUM_FIELDS] = NULL;
+
+// The tiles within HALO_MARGIN cells of tile t, itself included, are near[near_start[t]] to near[near_start[t + 1] - 1]
+static BATCH_LOCAL int *near_start = NULL;
+static BATCH_LOCAL int *near = NULL;
+
+static BATCH_LOCAL long elided, requested;
+
+/**
+ * @brief Whether tile b overlaps tile a grown by HALO_MARGIN cells on every side
+ */
+static bool within_margin(const tile_type *a, const tile_type *b) {
+  return b->t_left <= a->t_right + HALO_MARGIN && b->t_right >= a->t_left - HALO_MARGIN &&
+         b->t_bottom <= a->t_top + HALO_MARGIN && b->t_top >= a->t_bottom - HALO_MARGIN;
+}
+
+void halo_open() {
+  halo_close();
+
+  elided = 0;
+  requested = 0;
+
+  int num_near = 0;
+  for (int a = 0; a < tiles_per_chunk; a++)
+    for (int b = 0; b < tiles_per_chunk; b++)
+      if (within_margin(&chunk.tiles[a], &chunk.tiles[b]))
+        num_near++;
+
+  valid = calloc(tiles_per_chunk, sizeof(*valid));
+  masks = calloc(tiles_per_chunk, sizeof(*masks));
+  near_start = malloc((tiles_per_chunk + 1) * sizeof(int));
+  near = malloc(num_near * sizeof(int));
+  if (valid == NULL || masks == NULL || near_start == NULL || near == NULL) {
+    halo_close();
+    report_error("halo_open", "Error allocating the halo validity.");
+  }
+
+  num_near = 0;
+  for (int a = 0; a < tiles_per_chunk; a++) {
+    near_start[a] = num_near;
+    for (int b = 0; b < tiles_per_chunk; b++)
+      if (within_margin(&chunk.tiles[a], &chunk.tiles[b]))
+        near[num_near++] = b;
+  }
+  near_start[tiles_per_chunk] = num_near;
+}
+
+void halo_written(int tile, int field) {
+  if (valid == NULL)
+    return;
+
+  // The members of a team may clear the same tiles near the edges of their ranges
+  for (int n = near_start[tile]; n < near_start[tile + 1]; n++)
+    __atomic_store_n(&valid[near[n]][field], 0, __ATOMIC_RELAXED);
+}
+
+int *halo_needed(int tile, const int fields[static NUM_FIELDS], int depth) {
+  int *mask = masks[tile];
+  long asked = 0, skipped = 0;
+
+  for (int field = 0; field < NUM_FIELDS; field++) {
+    mask[field] = fields[field] && (full_halo || valid[tile][field] < depth);
+
+    if (!fields[field])
+      continue;
+
+    asked++;
+    if (!mask[field])
+      skipped++;
+    else if (valid[tile][field] < depth)
+      valid[tile][field] = depth;
+  }
+
+  // Counted by every member of a team
+  __atomic_add_fetch(&requested, asked, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&elided, skipped, __ATOMIC_RELAXED);
+  return mask;
+}
+
+int *halo_mask(int tile) {
+  return masks[tile];
+}
+
+const int *halo_near(int tile, int *num) {
+  *num = near_start[tile + 1] - near_start[tile];
+  return &near[near_start[tile]];
+}
+
+long halo_elided() {
+  return elided;
+}
+
+long halo_requested() {
+  return requested;
+}
+
+void halo_close() {
+  free(valid);
+  free(masks);
+  free(near_start);
+  free(near);
+
+  valid = NULL;
+  masks = NULL;
+  near_start = NULL;
+  near = NULL;
+}
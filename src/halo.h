@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Halo validity tracking, eliding the exchanges of the fields whose halos are still up to date
+ * @details Every tile keeps, for each field update_halo() exchanges, the depth to which its halo holds the values of
+ * the cells it mirrors. An exchange raises it to the depth exchanged. A kernel writing a field on a tile calls
+ * halo_written(), which clears it on the tile and on every tile within HALO_MARGIN cells, whose halos may copy the cells
+ * written, directly or through the corners of a neighbour's halo. update_halo() then only exchanges the fields and
+ * tiles whose halos aren't valid to the depth asked for.
+ *
+ * Most of a step's exchanges are needed, as the field was written by the kernel before them, but each advection sweep
+ * writes the mass flux of its own direction only, so the other one, exchanged after the previous sweep, is elided.
+ * On a tiled mesh the tiles at rest (see activity.h) aren't written, and the exchanges between them are elided too.
+ * The number of tile field exchanges elided is printed in clover.out when the calculation completes. The full_halo
+ * deck keyword turns the tracking off.
+ */
+
+#pragma once
+
+#include "types/data.h"
+
+// Cells around a tile whose writes invalidate its halos, the halo depth and one more for the extra node and face
+#define HALO_MARGIN 3
+
+/**
+ * @brief Sets up the tracking with every halo invalid, called once the tiles are decomposed
+ */
+extern void halo_open();
+
+/**
+ * @brief Records that a kernel wrote a field on a tile
+ * @param field One of the FIELD_ indices
+ */
+extern void halo_written(int tile, int field);
+
+/**
+ * @brief The fields a tile has to exchange for an update_halo() call, which are then taken as exchanged
+ * @details Called by the member owning the tile, before the exchange reads any other tile: the kernels writing the
+ * tiles near it, which clear its validity, are done by then (see team.h and flow.h)
+ * @return The field mask of the tile, valid until the next call for it, a copy of fields when the tracking is off
+ */
+extern int *halo_needed(int tile, const int fields[static NUM_FIELDS], int depth);
+
+/**
+ * @brief The field mask last chosen for a tile by halo_needed()
+ */
+extern int *halo_mask(int tile);
+
+/**
+ * @brief The tiles within HALO_MARGIN cells of a tile, itself included, whose writes invalidate its halos
+ * @param num Set to the number of tiles
+ */
+extern const int *halo_near(int tile, int *num);
+
+/**
+ * @brief Number of tile field exchanges elided so far
+ */
+extern long halo_elided();
+
+/**
+ * @brief Number of tile field exchanges asked for so far, elided or not
+ */
+extern long halo_requested();
+
+/**
+ * @brief Releases the tracking, safe to call when it isn't open
+ */
+extern void halo_close();
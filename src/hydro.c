@@ -5,226 +5,278 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "activity.h"
 #include "clover.h"
 #include "data.h"
 #include "definitions.h"
+#include "flow.h"
+#include "halo.h"
 #include "kernels.h"
+#include "profiler.h"
 #include "report.h"
+#include "shm_export.h"
+#include "team.h"
+#include "trace.h"
 #include "user_callbacks.h"
 #include "utils/math.h"
+#include "utils/rss.h"
 #include "utils/timer.h"
 
-void timestep();
+bool timestep();
 
-void hydro() {
-  int loc = 1;
-  double timerstart, wall_clock, step_clock;
-  double grind_time, cells, rstep;
-  double step_time, step_grind;
-  double first_step, second_step;
-  double kerner_total;
+/**
+ * @brief The kernels of a step, run by every member of the team (see team.h)
+ */
+static void step_kernels() {
+  if (!timestep())
+    return;
+
+  if (flow_on()) {
+    step_flow();
+    return;
+  }
 
+  if (temporal_blocking) {
+    lagrangian_blocked();
+  } else {
+    PdV(true);
+    accelerate();
+    PdV(false);
+  }
+  advection();
+  reset_field();
+}
+
+// Timings carried across the steps of the calculation
+static BATCH_LOCAL double timerstart;
+static BATCH_LOCAL double first_step, second_step;
+
+void hydro_start() {
   hydro_init();
 
+  if (profiler_on)
+    profiler_open();
+
   timerstart = timer();
+}
 
-  while (true) {
-    step_time = timer();
-    step++;
+bool hydro_step() {
+  double wall_clock, step_clock;
+  double grind_time, cells, rstep;
+  double step_time, step_grind;
 
-    hydro_foreach_step(step);
+  step_time = timer();
+  step++;
 
-    timestep();
-    PdV(true);
-    accelerate();
-    PdV(false);
-    flux_calc();
-    advection();
-    reset_field();
+  hydro_foreach_step(step);
+  activity_update();
 
-    advect_x = !advect_x;
+  shm_export_begin_step();
 
-    time_val += dt;
+  team_run(step_kernels);
+  if (dt < dtmin)
+    report_error("timestep", "small timestep");
+
+  advect_x = !advect_x;
+
+  time_val += dt;
+
+  if (summary_frequency != 0 && step % summary_frequency == 0)
+    team_run(field_summary);
+
+  if (visit_frequency != 0 && step % visit_frequency == 0)
+    visit();
 
-    if (summary_frequency != 0 && step % summary_frequency == 0)
-      field_summary();
+  // Sometimes there can be a significant start up cost that appears in the first step.
+  // Sometimes it is due to the number of MPI tasks, or OpenCL kernel compilation.
+  // On the short test runs, this can skew the results, so should be taken into account
+  // in recorded run times.
+  if (step == 1)
+    first_step = timer() - step_time;
+  else if (step == 2)
+    second_step = timer() - step_time;
 
-    if (visit_frequency != 0 && step % visit_frequency == 0)
+  trace_step(step, step_time);
+
+  if (time_val + G_SMALL > end_time || step >= end_step) {
+    // The field summary checks the test problems on completion
+    complete = true;
+    team_run(field_summary);
+    if (visit_frequency != 0)
       visit();
+  }
 
-    // Sometimes there can be a significant start up cost that appears in the first step.
-    // Sometimes it is due to the number of MPI tasks, or OpenCL kernel compilation.
-    // On the short test runs, this can skew the results, so should be taken into account
-    // in recorded run times.
-    if (step == 1)
-      first_step = timer() - step_time;
-    else if (step == 2)
-      second_step = timer() - step_time;
-
-    if (time_val + G_SMALL > end_time || step >= end_step) {
-      complete = true;
-      field_summary();
-      if (visit_frequency != 0)
-        visit();
-
-      wall_clock = timer() - timerstart;
-      if (parallel.boss) {
-        fprintf(g_out, "\nCalculation completed\n");
-        fprintf(g_out, "Clover is finishing\n");
-        fprintf(g_out, "Wall clock     %.16f\n", wall_clock);
-        fprintf(g_out, "First step overhead   %.16f\n", first_step - second_step);
-
-        printf("Wall clock    %.16f\n", wall_clock);
-        printf("First step overhead   %.16f\n", first_step - second_step);
-      }
-
-      if (profiler_on) {
-        kerner_total = profiler.timestep + profiler.ideal_gas + profiler.viscosity + profiler.PdV + profiler.revert +
-                       profiler.acceleration + profiler.flux + profiler.cell_advection + profiler.mom_advection +
-                       profiler.reset + profiler.summary + profiler.visit + profiler.tile_halo_exchange +
-                       profiler.self_halo_exchange + profiler.mpi_halo_exchange;
-
-        if (parallel.boss) {
-          const char *fmt = "\n%-22s:%16.4f%16.4f\n";
-
-          fprintf(g_out, "\n%-22s%16s%20s\n", "Profiler Output", "Time", "Percentage");
-          fprintf(g_out, fmt, "Timestep", profiler.timestep, profiler.timestep / wall_clock * 100);
-          fprintf(g_out, fmt, "Ideal Gas", profiler.ideal_gas, profiler.ideal_gas / wall_clock * 100);
-          fprintf(g_out, fmt, "Viscosity", profiler.viscosity, profiler.viscosity / wall_clock * 100);
-          fprintf(g_out, fmt, "PdV", profiler.PdV, profiler.PdV / wall_clock * 100);
-          fprintf(g_out, fmt, "Revert", profiler.revert, profiler.revert / wall_clock * 100);
-          fprintf(g_out, fmt, "Acceleration", profiler.acceleration, profiler.acceleration / wall_clock * 100);
-          fprintf(g_out, fmt, "Fluxes", profiler.flux, profiler.flux / wall_clock * 100);
-          fprintf(g_out, fmt, "Cell advection", profiler.cell_advection, profiler.cell_advection / wall_clock * 100);
-          fprintf(g_out, fmt, "Momentum advection", profiler.mom_advection, profiler.mom_advection / wall_clock * 100);
-          fprintf(g_out, fmt, "Reset", profiler.reset, profiler.reset / wall_clock * 100);
-          fprintf(g_out, fmt, "Summary", profiler.summary, profiler.summary / wall_clock * 100);
-          fprintf(g_out, fmt, "Visit", profiler.visit, profiler.visit / wall_clock * 100);
-          fprintf(
-              g_out,
-              fmt,
-              "Tile halo exchange",
-              profiler.tile_halo_exchange,
-              profiler.tile_halo_exchange / wall_clock * 100
-          );
-          fprintf(
-              g_out,
-              fmt,
-              "Self halo exchange",
-              profiler.self_halo_exchange,
-              profiler.self_halo_exchange / wall_clock * 100
-          );
-          fprintf(
-              g_out, fmt, "MPI halo exchange", profiler.mpi_halo_exchange, profiler.mpi_halo_exchange / wall_clock * 100
-          );
-          fprintf(g_out, fmt, "Total", kerner_total, kerner_total / wall_clock * 100);
-          fprintf(g_out, fmt, "The Rest", wall_clock - kerner_total, (wall_clock - kerner_total) / wall_clock * 100);
-        }
-      }
-
-      hydro_done();
-      clover_finalize();
-      break;
-    }
+  // Published once the summaries are done, as their equation of state rewrites the exported pressure and soundspeed
+  shm_export_end_step();
 
+  if (complete) {
+    wall_clock = timer() - timerstart;
     if (parallel.boss) {
-      wall_clock = timer() - timerstart;
-      step_clock = timer() - step_time;
+      fprintf(g_out, "\nCalculation completed\n");
+      fprintf(g_out, "Clover is finishing\n");
+      fprintf(g_out, "Wall clock     %.16f\n", wall_clock);
+      fprintf(g_out, "First step overhead   %.16f\n", first_step - second_step);
+      fprintf(g_out, "Peak RSS       %.3f MB\n", peak_rss() / 1.0e6);
+      if (tiles_per_chunk > 1)
+        fprintf(g_out, "Tiles skipped  %ld of %ld tile steps\n", activity_skipped(), (long)step * tiles_per_chunk);
+      fprintf(g_out, "Halo exchanges elided  %ld of %ld tile fields\n", halo_elided(), halo_requested());
+
+      fprintf(g_stdout, "Wall clock    %.16f\n", wall_clock);
+      fprintf(g_stdout, "First step overhead   %.16f\n", first_step - second_step);
+    }
 
-      fprintf(g_out, "Wall clock    %.16f\n", wall_clock);
-      printf("Wall clock    %.16f\n", wall_clock);
+    if (profiler_on) {
+      if (parallel.boss)
+        profiler_print(g_out, wall_clock);
+      profiler_close();
+    }
 
-      cells = grid.x_cells * grid.y_cells;
-      rstep = step + 1;
-      grind_time = wall_clock / (rstep * cells);
-      step_grind = step_clock / cells;
+    hydro_done();
+    clover_finalize();
+    return true;
+  }
 
-      fprintf(g_out, "Average time per cell    %.16e\n", grind_time);
-      fprintf(g_out, "Step time per cell       %.16e\n", step_grind);
-      printf("Average time per cell    %.16e\n", grind_time);
-      printf("Step time per cell       %.16e\n", step_grind);
-    }
+  if (parallel.boss) {
+    wall_clock = timer() - timerstart;
+    step_clock = timer() - step_time;
+
+    fprintf(g_out, "Wall clock    %.16f\n", wall_clock);
+    fprintf(g_stdout, "Wall clock    %.16f\n", wall_clock);
+
+    cells = (double)grid.x_cells * grid.y_cells;
+    rstep = step + 1;
+    grind_time = wall_clock / (rstep * cells);
+    step_grind = step_clock / cells;
+
+    fprintf(g_out, "Average time per cell    %.16e\n", grind_time);
+    fprintf(g_out, "Step time per cell       %.16e\n", step_grind);
+    fprintf(g_stdout, "Average time per cell    %.16e\n", grind_time);
+    fprintf(g_stdout, "Step time per cell       %.16e\n", step_grind);
   }
+
+  return false;
 }
 
-void timestep() {
-  int tile;
-  int jldt, kldt;
+/**
+ * @brief Runs the kernels of a number of steps without their output, the calibration runs of the tile tuner (see tune.h)
+ * @return The wall time of the steps after the first, whose page faults and cold caches aren't representative
+ */
+double hydro_calibrate(int steps) {
+  double elapsed = 0.0;
+
+  for (int s = 0; s < steps; s++) {
+    double step_time = timer();
+    step++;
 
-  double dtlp;
-  double x_pos, y_pos, xl_pos, yl_pos;
-  double kernel_time;
+    activity_update();
+    team_run(step_kernels);
+    if (dt < dtmin)
+      break;
 
-  char dt_control[8], dtl_control[8];
+    advect_x = !advect_x;
+    time_val += dt;
 
-  int small;
+    if (s > 0)
+      elapsed += timer() - step_time;
+  }
+
+  return elapsed;
+}
+
+void hydro() {
+  hydro_start();
+
+  while (!hydro_step())
+    ;
+}
+
+/**
+ * @brief Chooses the timestep of the step, reduced over a slot per tile in tile order, the choice a single thread
+ * makes going through the tiles
+ * @return Whether the timestep is above dtmin, hydro_step() reports the error otherwise, out of the team's region
+ */
+bool timestep() {
+  profiler_sample kernel_time;
   int fields[NUM_FIELDS];
 
-  dt = G_BIG;
-  small = 0;
+  tile_dt *dts = team_slots(tiles_per_chunk * sizeof(tile_dt));
 
-  if (profiler_on)
-    kernel_time = timer();
+  if (flow_on()) {
+    timestep_flow(dts);
+  } else {
+    if (profiler_on)
+      profiler_start(&kernel_time);
 
-  for (tile = 0; tile < tiles_per_chunk; tile++) {
-    ideal_gas(tile, false);
-  }
+    for (int tile = team_tile_begin(); tile < team_tile_end(); tile++) {
+      ideal_gas(tile, false);
+    }
 
-  if (profiler_on)
-    profiler.ideal_gas += timer() - kernel_time;
+    team_barrier();
 
-  memset(fields, 0, NUM_FIELDS * sizeof(int));
-  fields[FIELD_PRESSURE] = 1;
-  fields[FIELD_ENERGY0] = 1;
-  fields[FIELD_DENSITY0] = 1;
-  fields[FIELD_XVEL0] = 1;
-  fields[FIELD_YVEL0] = 1;
-  update_halo(fields, 1);
+    if (profiler_on)
+      profiler_stop(&kernel_time, &profiler.ideal_gas);
 
-  if (profiler_on)
-    kernel_time = timer();
+    memset(fields, 0, NUM_FIELDS * sizeof(int));
+    fields[FIELD_PRESSURE] = 1;
+    fields[FIELD_ENERGY0] = 1;
+    fields[FIELD_DENSITY0] = 1;
+    fields[FIELD_XVEL0] = 1;
+    fields[FIELD_YVEL0] = 1;
+    update_halo(fields, 1);
 
-  viscosity();
+    if (profiler_on)
+      profiler_start(&kernel_time);
 
-  if (profiler_on)
-    profiler.viscosity += timer() - kernel_time;
+    viscosity();
 
-  memset(fields, 0, NUM_FIELDS * sizeof(int));
-  fields[FIELD_VISCOSITY] = 1;
-  update_halo(fields, 1);
+    if (profiler_on)
+      profiler_stop(&kernel_time, &profiler.viscosity);
 
-  if (profiler_on)
-    kernel_time = timer();
-
-  for (tile = 0; tile < tiles_per_chunk; tile++) {
-    calc_dt(tile, &dtlp, dtl_control, &xl_pos, &yl_pos, &jldt, &kldt);
-
-    if (dtlp <= dt) {
-      dt = dtlp;
-      strcpy(dt_control, dtl_control);
-      x_pos = xl_pos;
-      y_pos = yl_pos;
-      jdt = jldt;
-      kdt = kldt;
-    }
+    memset(fields, 0, NUM_FIELDS * sizeof(int));
+    fields[FIELD_VISCOSITY] = 1;
+    update_halo(fields, 1);
+
+    if (profiler_on)
+      profiler_start(&kernel_time);
+
+    for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+      calc_dt(tile, &dts[tile]);
+
+    team_barrier();
   }
 
-  dt = min(dt, min((dtold * dtrise), dtmax));
+  if (team_master()) {
+    // The flow's tasks accounted calc_dt() already
+    if (profiler_on && flow_on())
+      profiler_start(&kernel_time);
 
-  if (profiler_on)
-    profiler.timestep += timer() - kernel_time;
+    const tile_dt *chosen = &dts[0];
+    for (int tile = 1; tile < tiles_per_chunk; tile++) {
+      if (dts[tile].dt <= chosen->dt)
+        chosen = &dts[tile];
+    }
 
-  if (dt < dtmin)
-    small = 1;
+    dt = min(chosen->dt, min((dtold * dtrise), dtmax));
+    jdt = chosen->jdt;
+    kdt = chosen->kdt;
 
-  if (parallel.boss) {
-    const char *format = "Step %7d time %.7lf control %10s  timestep  %.2e%8d, %8d x  %.2e y  %.2e\n";
-    fprintf(g_out, format, step, time_val, dt_control, dt, jdt, kdt, x_pos, y_pos);
-    printf(format, step, time_val, dt_control, dt, jdt, kdt, x_pos, y_pos);
+    if (profiler_on)
+      profiler_stop(&kernel_time, &profiler.timestep);
+
+    if (parallel.boss) {
+      const char *format = "Step %7d time %.7lf control %10s  timestep  %.2e%8d, %8d x  %.2e y  %.2e\n";
+      fprintf(g_out, format, step, time_val, chosen->control, dt, jdt, kdt, chosen->x_pos, chosen->y_pos);
+      fprintf(g_stdout, format, step, time_val, chosen->control, dt, jdt, kdt, chosen->x_pos, chosen->y_pos);
+    }
+
+    dtold = dt;
+  } else if (profiler_on && !flow_on()) {
+    // The workers' share of calc_dt(), the master's ends with the reduction
+    profiler_stop(&kernel_time, &profiler.timestep);
   }
 
-  if (small == 1)
-    report_error("timestep", "small timestep");
+  team_barrier();
 
-  dtold = dt;
+  // Tested as hydro_step() does, a NaN timestep carries on
+  return !(dt < dtmin);
 }
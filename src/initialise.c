@@ -6,14 +6,23 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "activity.h"
 #include "clover.h"
 #include "data.h"
 #include "definitions.h"
+#include "flow.h"
+#include "halo.h"
+#include "jit.h"
 #include "kernels.h"
 #include "parse.h"
 #include "report.h"
+#include "shm_export.h"
+#include "team.h"
+#include "tune.h"
 #include "utils/math.h"
+#include "utils/rss.h"
 #include "utils/string.h"
+#include "utils/topology.h"
 
 void read_input();
 
@@ -24,33 +33,60 @@ void start();
  */
 extern void build_field();
 
+extern void field_footprint(field_footprint_type *footprint);
+
+/**
+ * @brief Opens one of the run's input or output files, relative to the run directory if one was set
+ */
+FILE *open_run_file(const char *name, const char *mode) {
+  char path[G_LEN_MAX];
+
+  if (g_run_dir == NULL)
+    return fopen(name, mode);
+
+  snprintf(path, sizeof(path), "%s/%s", g_run_dir, name);
+  return fopen(path, mode);
+}
+
 /**
  * @brief Top level initialisation routine
  * @details Checks for the user input and either invokes the input reader or switches to the internal test problem. It
  * processes the input and strips comments before writing a final input file. It then calls the start routine.
+ * An input deck set in g_deck is processed in memory instead, without touching the file system, and the output goes to
+ * the stream already set in g_out if any.
  */
 void initialise() {
   FILE *uin = NULL, *out_unit = NULL;
+  char *processed = NULL;
+  size_t processed_size = 0;
 
   if (parallel.boss) {
-    errno = 0;
-    g_out = fopen("clover.out", "w");
-    if (errno != 0) {
-      g_out = NULL;
-      report_error("initialise", "Error opening clover.out file.");
+    if (g_out == NULL) {
+      errno = 0;
+      g_out = open_run_file("clover.out", "w");
+      if (errno != 0) {
+        g_out = NULL;
+        report_error("initialise", "Error opening clover.out file.");
+      }
+
+      fputs("Output file clover.out opened. All output will go there.\n", g_stdout);
     }
 
     fprintf(g_out, "Clover Version %f\nMPI Version\nTask Count %d\n", G_VERSION, parallel.max_task);
 
-    puts("Output file clover.out opened. All output will go there.");
-
     fputs("\nClover will run from the following input:-\n", g_out);
 
     errno = 0;
-    uin = fopen("clover.in", "r");
-    if (errno != 0) {
+    if (g_deck != NULL) {
+      uin = fmemopen((void *)g_deck, strlen(g_deck), "r");
+      if (uin == NULL)
+        report_error("initialise", "Error reading the input deck");
+    } else {
+      uin = open_run_file("clover.in", "r");
+    }
+    if (g_deck == NULL && errno != 0) {
       errno = 0;
-      out_unit = fopen("clover.in", "w");
+      out_unit = open_run_file("clover.in", "w");
       if (errno != 0)
         report_error("initialise", "Error opening clover.in file");
 
@@ -75,11 +111,14 @@ void initialise() {
       );
 
       fclose(out_unit);
-      uin = fopen("clover.in", "r");
+      uin = open_run_file("clover.in", "r");
     }
 
     errno = 0;
-    out_unit = fopen("clover.in.tmp", "w");
+    if (g_deck != NULL)
+      out_unit = open_memstream(&processed, &processed_size);
+    else
+      out_unit = open_run_file("clover.in.tmp", "w");
     if (errno != 0)
       report_error("initialise", "Error opening clover.in.tmp file");
 
@@ -95,7 +134,10 @@ void initialise() {
   }
 
   errno = 0;
-  g_in = fopen("clover.in.tmp", "r");
+  if (g_deck != NULL)
+    g_in = fmemopen(processed, processed_size, "r");
+  else
+    g_in = open_run_file("clover.in.tmp", "r");
   if (errno != 0)
     report_error("initialise", "Error opening clover.in.tmp file");
 
@@ -108,21 +150,27 @@ void initialise() {
         break;
       fputs(buf, g_out);
     }
+    fclose(uin);
 
     fputs("\nInitialising and generating\n\n", g_out);
   }
 
   read_input();
 
+  if (tiles_auto)
+    tune_tiles();
+
   step = 0;
 
   start();
 
-  if (parallel.boss)
+  if (parallel.boss && !dry_run)
     fputs("Starting the calculation\n", g_out);
 
   if (fclose(g_in) == 0)
     g_in = NULL;
+
+  free(processed);
 }
 
 /**
@@ -154,6 +202,9 @@ void read_input() {
   summary_frequency = 10;
 
   tiles_per_chunk = 1;
+  tiles_auto = false;
+  tile_grid_x = 0;
+  tile_grid_y = 0;
 
   dtinit = 0.1;
   dtmax = 1.0;
@@ -168,6 +219,17 @@ void read_input() {
   use_C_kernels = true;
   use_OA_kernels = false;
   profiler_on = false;
+  trace_on = false;
+  dry_run = false;
+  full_sweep = false;
+  full_halo = false;
+  temporal_blocking = false;
+  band_rows = 0;
+  jit = false;
+  full_geometry = false;
+  threads = 1;
+  unpinned = false;
+  bulk_synchronous = false;
   profiler.timestep = 0.0;
   profiler.acceleration = 0.0;
   profiler.PdV = 0.0;
@@ -178,12 +240,14 @@ void read_input() {
   profiler.visit = 0.0;
   profiler.summary = 0.0;
   profiler.reset = 0.0;
-  profiler.revert = 0.0;
-  profiler.flux = 0.0;
+  profiler.lagrangian = 0.0;
   profiler.tile_halo_exchange = 0.0;
   profiler.self_halo_exchange = 0.0;
   profiler.mpi_halo_exchange = 0.0;
 
+  shm_export_name[0] = '\0';
+  shm_export_buffered = false;
+
   if (parallel.boss)
     fputs("Reading input file\n\n", g_out);
 
@@ -292,8 +356,13 @@ void read_input() {
             fprintf(g_out, "summary_frequency %d\n", summary_frequency);
           break;
         scase("tiles_per_chunk")
-          tiles_per_chunk = parse_getival(parse_getword(true));
-          if (parallel.boss)
+          word = parse_getword(true);
+          // Calibration runs choose the tiles before the calculation starts (see tune.h)
+          tiles_auto = strcmp(word, "auto") == 0;
+          tiles_per_chunk = tiles_auto ? 1 : parse_getival(word);
+          if (parallel.boss && tiles_auto)
+            fputs("tiles_per_chunk auto\n", g_out);
+          else if (parallel.boss)
             fprintf(g_out, "tiles_per_chunk %d\n", tiles_per_chunk);
           break;
         scase("tiles_per_problem")
@@ -321,6 +390,81 @@ void read_input() {
           if (parallel.boss)
             fputs("Profiler_on\n", g_out);
           break;
+        scase("trace_on")
+          // The traced regions are the profiler's
+          trace_on = true;
+          profiler_on = true;
+          if (parallel.boss)
+            fputs("Trace_on\n", g_out);
+          break;
+        scase("dry_run")
+          dry_run = true;
+          if (parallel.boss)
+            fputs("Dry_run\n", g_out);
+          break;
+        scase("full_sweep")
+          // Every kernel runs on every tile, even the ones at rest (see activity.h)
+          full_sweep = true;
+          if (parallel.boss)
+            fputs("Full_sweep\n", g_out);
+          break;
+        scase("full_halo")
+          // Every halo exchange runs, even of the halos still up to date (see halo.h)
+          full_halo = true;
+          if (parallel.boss)
+            fputs("Full_halo\n", g_out);
+          break;
+        scase("temporal_blocking")
+          temporal_blocking = true;
+          if (parallel.boss)
+            fputs("Temporal_blocking\n", g_out);
+          break;
+        scase("band_rows")
+          // Rows of the bands of temporal blocking, chosen from the L2 cache size when not given
+          band_rows = parse_getival(parse_getword(true));
+          if (parallel.boss)
+            fprintf(g_out, "band_rows %d\n", band_rows);
+          break;
+        scase("jit")
+          // PdV and the advection kernels compiled at start-up for the tile extents (see jit.h)
+          jit = true;
+          if (parallel.boss)
+            fputs("JIT\n", g_out);
+          break;
+        scase("full_geometry")
+          // The volume and area planes are allocated and read even though the grid is uniform (see kernels/geometry.h)
+          full_geometry = true;
+          if (parallel.boss)
+            fputs("Full_geometry\n", g_out);
+          break;
+        scase("threads")
+          // Threads sharing the tiles of every step (see team.h)
+          threads = parse_getival(parse_getword(true));
+          if (parallel.boss)
+            fprintf(g_out, "threads %d\n", threads);
+          break;
+        scase("unpinned")
+          // The threads of the team run wherever the scheduler puts them (see team.h)
+          unpinned = true;
+          if (parallel.boss)
+            fputs("Unpinned\n", g_out);
+          break;
+        scase("bulk_synchronous")
+          // The kernels of a step are separated by barriers rather than run as a dataflow (see flow.h)
+          bulk_synchronous = true;
+          if (parallel.boss)
+            fputs("Bulk_synchronous\n", g_out);
+          break;
+        scase("shm_export")
+          snprintf(shm_export_name, G_NAME_LEN_MAX, "/%s", parse_getword(true));
+          if (parallel.boss)
+            fprintf(g_out, "shm_export %s\n", shm_export_name);
+          break;
+        scase("shm_double_buffer")
+          shm_export_buffered = true;
+          if (parallel.boss)
+            fputs("shm_double_buffer\n", g_out);
+          break;
         scase("test_problem")
           test_problem = parse_getival(parse_getword(true));
           if (parallel.boss)
@@ -451,6 +595,77 @@ void read_input() {
   }
 }
 
+/**
+ * @brief Prints the memory the field arrays of the tiles take, and how much of it is halo. A dry run also lists it by
+ * array.
+ */
+static void print_footprint() {
+  field_footprint_type footprint;
+  field_footprint(&footprint);
+
+  double total = footprint.total;
+  double cells = (double)grid.x_cells * grid.y_cells;
+
+  fputs("\nMemory footprint\n", g_out);
+  fprintf(
+      g_out,
+      "Field arrays %14.3f MB in %d tiles of %.3f to %.3f MB\n",
+      total / 1.0e6,
+      tiles_per_chunk,
+      footprint.tile_min / 1.0e6,
+      footprint.tile_max / 1.0e6
+  );
+  fprintf(g_out, "Halo overhead %13.2f %%\n", 100.0 * (total - footprint.interior) / total);
+  fprintf(g_out, "Bytes per cell %12.1f\n", total / cells);
+  if (uniform_grid)
+    fputs("Uniform grid, the volume and area planes aren't allocated\n", g_out);
+
+  if (dry_run) {
+    fprintf(g_out, "\n%-16s%14s%10s\n", "Array", "MB", "%");
+    for (int a = 0; a < NUM_FIELD_ARRAYS; a++)
+      fprintf(
+          g_out,
+          "%-16s%14.3f%10.2f\n",
+          field_arrays[a].name,
+          footprint.array[a] / 1.0e6,
+          100.0 * footprint.array[a] / total
+      );
+  }
+}
+
+/**
+ * @brief Rows of the bands of temporal blocking on the widest tile for the L2 cache size, unless the deck sets them
+ * @details The corrector touches 16 arrays. Half of the cache is left to the rows above and below the band that the
+ * stencils read, and to whatever else stays resident.
+ */
+static void choose_band_rows() {
+  if (band_rows > 0)
+    return;
+
+  // Read as the tile tuner reads it, so that both choose for the same cache
+  long cache = topology_cache(2);
+  if (cache == 0)
+    cache = 1024 * 1024;
+
+  int width = 0;
+  for (int tile = 0; tile < tiles_per_chunk; tile++)
+    width = max(width, chunk.tiles[tile].t_xmax - chunk.tiles[tile].t_xmin + 1);
+
+  size_t row_bytes = 16 * (size_t)(width + 5) * sizeof(double);
+  band_rows = max((int)(cache / 2 / row_bytes), 2);
+}
+
+/**
+ * @brief Sets up the mesh and paints the states on the tiles of a team member, the member that zeroed their fields (see
+ * build_field())
+ */
+static void generate_tiles() {
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++) {
+    initialise_chunk(tile);
+    generate_chunk(tile);
+  }
+}
+
 /**
  * @brief Main set up routine
  * @details Invokes the mesh decomposer and sets up chunk connectivity. It then allocates the communication buffers and
@@ -499,18 +714,44 @@ void start() {
   chunk.y_max = y_cells;
 
   // Create the tiles
-  chunk.tiles = malloc(tiles_per_chunk * sizeof(tile_type));
+  chunk.tiles = calloc(tiles_per_chunk, sizeof(tile_type));
   clover_tile_decompose(x_cells, y_cells);
 
+  // The grid is uniform by construction, the shared memory export publishes the geometry planes for its readers
+  uniform_grid = !full_geometry && shm_export_name[0] == '\0';
+
+  if (parallel.boss)
+    print_footprint();
+
+  // The footprint is all a dry run is after, the fields are never allocated
+  if (dry_run) {
+    if (parallel.boss) {
+      fprintf(g_out, "\nPeak RSS %18.3f MB\n", peak_rss() / 1.0e6);
+      fputs("\nDry run, the calculation is skipped\n", g_out);
+      fputs("Dry run, the calculation is skipped\n", g_stdout);
+    }
+    complete = true;
+    return;
+  }
+
+  if (temporal_blocking) {
+    choose_band_rows();
+    if (parallel.boss)
+      fprintf(g_out, "\nTemporal blocking in bands of %d rows\n", band_rows);
+  }
+
+  jit_open();
+  shm_export_create();
+  // Before the fields are allocated, whose pages each member touches first (see build_field())
+  team_open();
   build_field();
 
   if (parallel.boss)
     fputs("\nGenerating chunks\n", g_out);
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    initialise_chunk(tile);
-    generate_chunk(tile);
-  }
+  team_run(generate_tiles);
+  halo_open();
+  flow_open();
 
   advect_x = true;
 
@@ -544,5 +785,8 @@ void start() {
   if (visit_frequency != 0)
     visit();
 
+  shm_export_start();
+  activity_open();
+
   profiler_on = profiler_off;
 }
@@ -0,0 +1,330 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "jit.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "data.h"
+#include "definitions.h"
+#include "report.h"
+#include "utils/cache_dir.h"
+#include "utils/timer.h"
+#include "utils/topology.h"
+
+// The compiler, flags and kernel sources of the build, passed by the Makefile
+#ifndef JIT_CC
+#define JIT_CC "cc"
+#endif
+#ifndef JIT_CFLAGS
+#define JIT_CFLAGS "-O3"
+#endif
+#ifndef JIT_SOURCE_DIR
+#define JIT_SOURCE_DIR "src/kernels"
+#endif
+
+typedef struct jit_tile_t {
+  pdv_kernel pdv[2];
+  advec_cell_kernel advec_cell[2][2];
+  advec_mom_kernel advec_mom[2][2];
+} jit_tile;
+
+// Sources of the kernels, the first NUM_INCLUDED included by the generated file, the others by them
+static const char *const sources[] = {"PdV.c", "advec_cell.c", "advec_mom.c", "ftocmacros.h", "geometry.h", "data.h"};
+
+#define NUM_SOURCES  (int)(sizeof(sources) / sizeof(sources[0]))
+#define NUM_INCLUDED 3
+
+// Size of the paths of the cache, and of their temporary names, with the process and thread appended
+#define JIT_PATH_LEN (2 * G_LEN_MAX + 32)
+#define JIT_TEMP_LEN (JIT_PATH_LEN + 48)
+
+// The kernels generated for each tile shape: the parameters and the call of their body, and their slot in jit_tile
+static const struct {
+  const char *params;
+  const char *call;
+  size_t slot;
+} variants[] = {
+    {"PDV_PARAMS", "pdv(uniform, false, PDV_ARGS)", offsetof(jit_tile, pdv[0])},
+    {"PDV_PARAMS", "pdv(uniform, true, PDV_ARGS)", offsetof(jit_tile, pdv[1])},
+    {"ADVEC_CELL_PARAMS", "advec_cell(uniform, G_XDIR, 1, ADVEC_CELL_ARGS)", offsetof(jit_tile, advec_cell[0][0])},
+    {"ADVEC_CELL_PARAMS", "advec_cell(uniform, G_XDIR, 2, ADVEC_CELL_ARGS)", offsetof(jit_tile, advec_cell[0][1])},
+    {"ADVEC_CELL_PARAMS", "advec_cell(uniform, G_YDIR, 1, ADVEC_CELL_ARGS)", offsetof(jit_tile, advec_cell[1][0])},
+    {"ADVEC_CELL_PARAMS", "advec_cell(uniform, G_YDIR, 2, ADVEC_CELL_ARGS)", offsetof(jit_tile, advec_cell[1][1])},
+    {"ADVEC_MOM_PARAMS", "advec_mom(uniform, 1, G_XDIR, ADVEC_MOM_ARGS)", offsetof(jit_tile, advec_mom[0][0])},
+    {"ADVEC_MOM_PARAMS", "advec_mom(uniform, 2, G_XDIR, ADVEC_MOM_ARGS)", offsetof(jit_tile, advec_mom[0][1])},
+    {"ADVEC_MOM_PARAMS", "advec_mom(uniform, 1, G_YDIR, ADVEC_MOM_ARGS)", offsetof(jit_tile, advec_mom[1][0])},
+    {"ADVEC_MOM_PARAMS", "advec_mom(uniform, 2, G_YDIR, ADVEC_MOM_ARGS)", offsetof(jit_tile, advec_mom[1][1])},
+};
+
+#define NUM_VARIANTS (int)(sizeof(variants) / sizeof(variants[0]))
+
+static BATCH_LOCAL void *handle = NULL;
+static BATCH_LOCAL jit_tile *tiles = NULL;
+
+/**
+ * @brief FNV-1a hash of a buffer, continuing from hash
+ */
+static uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+  const unsigned char *bytes = data;
+
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+static uint64_t hash_file(uint64_t hash, const char *path) {
+  char buffer[4096];
+  size_t read;
+
+  FILE *file = fopen(path, "rb");
+  if (file == NULL)
+    report_error_arg("jit_open", "Error reading the kernel source ", path);
+
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    hash = hash_bytes(hash, buffer, read);
+  fclose(file);
+  return hash;
+}
+
+/**
+ * @brief Hashes the model and the instruction set extensions of the CPU, as the kernels may be built for it with
+ * -march=native and the cache shared with nodes of other CPUs
+ */
+static uint64_t hash_cpu(uint64_t hash) {
+  // The extensions are listed as flags on x86, as Features on Arm
+  const char *fields[] = {"model name", "flags", "Features", "CPU implementer", "CPU part"};
+  char value[8192];
+
+  for (int f = 0; f < (int)(sizeof(fields) / sizeof(fields[0])); f++) {
+    if (topology_cpu_info(fields[f], value, sizeof(value)))
+      hash = hash_bytes(hash_bytes(hash, fields[f], strlen(fields[f])), value, strlen(value));
+  }
+  return hash;
+}
+
+/**
+ * @brief Whether the kernel sources are still where the binary was built from
+ */
+static bool sources_found() {
+  char path[JIT_PATH_LEN];
+
+  for (int i = 0; i < NUM_SOURCES; i++) {
+    snprintf(path, sizeof(path), "%s/%s", JIT_SOURCE_DIR, sources[i]);
+    if (access(path, R_OK) != 0)
+      return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Writes the generated source, one function per variant and tile shape, with the extents shadowing the
+ * arguments of the same name and whether the grid is uniform (see kernels/geometry.h) as a constant
+ */
+static char *generate(const int (*shapes)[4], int num_shapes) {
+  char *text = NULL;
+  size_t size;
+  FILE *out = open_memstream(&text, &size);
+  if (out == NULL)
+    report_error("jit_open", "Error generating the JIT kernels.");
+
+  fprintf(out, "// Kernels of %d tile shapes generated by CloverLeaf, see jit.h\n\n", num_shapes);
+  for (int i = 0; i < NUM_INCLUDED; i++)
+    fprintf(out, "#include \"%s/%s\"\n", JIT_SOURCE_DIR, sources[i]);
+
+  for (int s = 0; s < num_shapes; s++) {
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+      fprintf(
+          out,
+          "\n__attribute__((visibility(\"default\"))) void jit_%d_%d(%s) {\n  {\n"
+          "    const int x_min = %d, x_max = %d, y_min = %d, y_max = %d;\n"
+          "    const bool uniform = %s;\n    %s;\n  }\n}\n",
+          s,
+          v,
+          variants[v].params,
+          shapes[s][0],
+          shapes[s][1],
+          shapes[s][2],
+          shapes[s][3],
+          uniform_grid ? "true" : "false",
+          variants[v].call
+      );
+    }
+  }
+
+  fclose(out);
+  return text;
+}
+
+/**
+ * @brief Writes a file under a temporary name, then renames it into place
+ */
+static void write_file(const char *path, const char *text) {
+  char temp[JIT_TEMP_LEN];
+  snprintf(temp, sizeof(temp), "%s.%ld.%lx.tmp", path, (long)getpid(), (unsigned long)pthread_self());
+
+  FILE *file = fopen(temp, "w");
+  if (file == NULL || fputs(text, file) < 0 || fclose(file) != 0 || rename(temp, path) != 0)
+    report_error_arg("jit_open", "Error writing the JIT source ", path);
+}
+
+static void compile(const char *source, const char *object) {
+  char temp[JIT_TEMP_LEN], command[6 * G_LEN_MAX];
+  snprintf(temp, sizeof(temp), "%s.%ld.%lx.tmp", object, (long)getpid(), (unsigned long)pthread_self());
+
+  // The flags of the build are unbounded, so a command that doesn't fit is an error rather than cut short
+  int length = snprintf(
+      command,
+      sizeof(command),
+      "%s %s -fPIC -shared -fvisibility=hidden -o '%s' '%s'",
+      JIT_CC,
+      JIT_CFLAGS,
+      temp,
+      source
+  );
+  if (length < 0 || length >= (int)sizeof(command))
+    report_error_arg("jit_open", "Compiler command too long for the JIT kernels ", source);
+  if (system(command) != 0) {
+    unlink(temp);
+    report_error_arg("jit_open", "Error compiling the JIT kernels ", source);
+  }
+  if (rename(temp, object) != 0)
+    report_error_arg("jit_open", "Error moving the JIT kernels into the cache ", object);
+}
+
+void jit_open() {
+  jit_close();
+
+  if (!jit)
+    return;
+
+  // Without them the built-in kernels run, as without the keyword
+  if (!sources_found()) {
+    if (parallel.boss)
+      fprintf(g_out, "\nJIT kernel sources not found in %s, running the built-in kernels\n", JIT_SOURCE_DIR);
+    return;
+  }
+
+  // The distinct extents of the tiles, and the shape of each tile
+  int(*shapes)[4] = malloc(tiles_per_chunk * sizeof(int[4]));
+  int *tile_shape = malloc(tiles_per_chunk * sizeof(int));
+  tiles = malloc(tiles_per_chunk * sizeof(jit_tile));
+  if (shapes == NULL || tile_shape == NULL || tiles == NULL)
+    report_error("jit_open", "Error allocating the JIT tiles.");
+
+  int num_shapes = 0;
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    const tile_type *t = &chunk.tiles[tile];
+    int extents[4] = {t->t_xmin, t->t_xmax, t->t_ymin, t->t_ymax};
+
+    int s = 0;
+    while (s < num_shapes && memcmp(shapes[s], extents, sizeof(extents)) != 0)
+      s++;
+    if (s == num_shapes)
+      memcpy(shapes[num_shapes++], extents, sizeof(extents));
+    tile_shape[tile] = s;
+  }
+
+  char *text = generate((const int(*)[4])shapes, num_shapes);
+
+  char dir[G_LEN_MAX], path[JIT_PATH_LEN];
+  uint64_t hash = hash_bytes(0xcbf29ce484222325ULL, text, strlen(text));
+  hash = hash_bytes(hash, JIT_CC " " JIT_CFLAGS, strlen(JIT_CC " " JIT_CFLAGS));
+  hash = hash_cpu(hash);
+  for (int i = 0; i < NUM_SOURCES; i++) {
+    snprintf(path, sizeof(path), "%s/%s", JIT_SOURCE_DIR, sources[i]);
+    hash = hash_file(hash, path);
+  }
+
+  // The object is only loaded from a directory no one else can write, else it is built in a new one, removed once loaded
+  cache_dir(dir, sizeof(dir));
+  bool caching = make_dirs(dir);
+  if (!caching) {
+    if (parallel.boss)
+      fprintf(g_out, "\nJIT cache directory %s can't be created or isn't private, compiling without a cache\n", dir);
+    snprintf(dir, sizeof(dir), "/tmp/clover_jit_XXXXXX");
+    if (mkdtemp(dir) == NULL)
+      report_error("jit_open", "Error creating a directory for the JIT kernels.");
+  }
+
+  char source[JIT_PATH_LEN], object[JIT_PATH_LEN];
+  snprintf(source, sizeof(source), "%s/clover_jit_%016llx.c", dir, (unsigned long long)hash);
+  snprintf(object, sizeof(object), "%s/clover_jit_%016llx.so", dir, (unsigned long long)hash);
+
+  double start = timer();
+  bool cached = access(object, R_OK) == 0;
+  if (!cached) {
+    write_file(source, text);
+    compile(source, object);
+  }
+  free(text);
+
+  handle = dlopen(object, RTLD_NOW | RTLD_LOCAL);
+  if (!caching) {
+    unlink(source);
+    unlink(object);
+    rmdir(dir);
+  }
+  if (handle == NULL)
+    report_error_arg("jit_open", "Error loading the JIT kernels ", dlerror());
+
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    for (int v = 0; v < NUM_VARIANTS; v++) {
+      char symbol[64];
+      snprintf(symbol, sizeof(symbol), "jit_%d_%d", tile_shape[tile], v);
+
+      void *kernel = dlsym(handle, symbol);
+      if (kernel == NULL)
+        report_error_arg("jit_open", "Missing JIT kernel ", symbol);
+      memcpy((char *)&tiles[tile] + variants[v].slot, &kernel, sizeof(kernel));
+    }
+  }
+
+  if (parallel.boss) {
+    fprintf(
+        g_out,
+        "\nJIT kernels of %d tile shapes %s %s in %.3f s\n",
+        num_shapes,
+        cached ? "loaded from" : "compiled into",
+        object,
+        timer() - start
+    );
+  }
+
+  free(shapes);
+  free(tile_shape);
+}
+
+pdv_kernel jit_pdv(int tile, bool predict) {
+  return tiles != NULL ? tiles[tile].pdv[predict] : kernel_pdv_variants[predict];
+}
+
+advec_cell_kernel jit_advec_cell(int tile, int dir, int sweep_number) {
+  if (tiles != NULL)
+    return tiles[tile].advec_cell[dir - 1][sweep_number - 1];
+  return kernel_advec_cell_variants[dir - 1][sweep_number - 1];
+}
+
+advec_mom_kernel jit_advec_mom(int tile, int direction, int sweep_number) {
+  if (tiles != NULL)
+    return tiles[tile].advec_mom[direction - 1][sweep_number - 1];
+  return kernel_advec_mom_variants[direction - 1][sweep_number - 1];
+}
+
+void jit_close() {
+  free(tiles);
+  tiles = NULL;
+
+  if (handle != NULL)
+    dlclose(handle);
+  handle = NULL;
+}
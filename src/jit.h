@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Kernels compiled at start-up with the tile extents as constants, enabled by the jit deck keyword
+ * @details The variants of PdV and of the advection kernels (see kernels/kernels.h) are generated once more for every
+ * tile shape of the run, in a C file that includes their sources and calls their bodies with x_min, x_max, y_min and
+ * y_max as literals, and with uniform as one too (see kernels/geometry.h). The strides and trip counts of every loop
+ * are then known to the compiler. The file is compiled by the compiler and flags the program was built with into a
+ * shared object, which is opened with dlopen(3).
+ *
+ * The objects are cached in the CLOVER_JIT_CACHE directory, or else in $XDG_CACHE_HOME/cloverleaf or
+ * ~/.cache/cloverleaf, or /tmp/cloverleaf-<uid>, named after a hash of the generated source, of the kernel sources it
+ * includes, of the compiler command and of the CPU model and extensions, so a run of a deck already run reuses its
+ * object, an edit of the kernels invalidates it and a node of another CPU sharing the cache doesn't load code built for
+ * -march=native. The object is written under a temporary name and renamed into place, so that runs sharing the cache
+ * can't see it half written. A cache directory someone else could write isn't used, the object is then built in a new
+ * directory removed once it is loaded.
+ *
+ * The bands of temporal blocking change y_min and y_max on every call, they keep the built-in variants.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "kernels/kernels.h"
+
+/**
+ * @brief Compiles the kernels of the tile shapes, or loads them from the cache, once the tiles are decomposed
+ */
+extern void jit_open();
+
+/**
+ * @brief PdV variant of a tile, the built-in one when the JIT is off
+ */
+extern pdv_kernel jit_pdv(int tile, bool predict);
+
+/**
+ * @brief advec_cell variant of a tile, the built-in one when the JIT is off
+ */
+extern advec_cell_kernel jit_advec_cell(int tile, int dir, int sweep_number);
+
+/**
+ * @brief advec_mom variant of a tile, the built-in one when the JIT is off
+ */
+extern advec_mom_kernel jit_advec_mom(int tile, int direction, int sweep_number);
+
+/**
+ * @brief Closes the shared object, safe to call when it isn't open
+ */
+extern void jit_close();
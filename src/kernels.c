@@ -8,9 +8,16 @@
 #include <string.h>
 #include <time.h>
 
+#include "activity.h"
 #include "data.h"
 #include "definitions.h"
-#include "utils/timer.h"
+#include "flow.h"
+#include "halo.h"
+#include "jit.h"
+#include "kernels.h"
+#include "profiler.h"
+#include "team.h"
+#include "utils/math.h"
 
 void initialise_chunk(int tile) {
   tile_type *tile_ptr = &chunk.tiles[tile];
@@ -21,6 +28,11 @@ void initialise_chunk(int tile) {
   double xmin = grid.xmin + dx * (double)(tile_ptr->t_left - 1);
   double ymin = grid.ymin + dy * (double)(tile_ptr->t_bottom - 1);
 
+  // The values kernel_initialise_chunk() fills the planes with
+  tile_ptr->field.uniform_volume = dx * dy;
+  tile_ptr->field.uniform_xarea = dy;
+  tile_ptr->field.uniform_yarea = dx;
+
   kernel_initialise_chunk(
       tile_ptr->t_xmin,
       tile_ptr->t_xmax,
@@ -96,372 +108,421 @@ void generate_chunk(int tile) {
       state_radius,
       state_geometry
   );
+
+  tile_ptr->state_version++;
+}
+
+/**
+ * @brief The planes the PdV predictor writes its density and energy to, read only by the equation of state after it
+ * @details The corrector starts again from density0 and energy0, so the predicted state goes to two work arrays, free
+ * until the advection, instead of density1 and energy1, which would then have to be reverted before the corrector.
+ */
+static double *predicted_density(field_type *field) {
+  return field->work_array2;
+}
+
+static double *predicted_energy(field_type *field) {
+  return field->work_array3;
+}
+
+/**
+ * @brief Whether the predicted state of a tile is in the scratch planes: a tile skipped at rest isn't predicted, as its
+ * predicted state is its time level 0 one, bitwise
+ */
+static bool predicted(int tile, bool predict) {
+  return predict && !activity_skip(tile);
+}
+
+/**
+ * @brief Whether the pressure and soundspeed of a tile are the equation of state of its time level 0 state
+ */
+static bool eos_current(const tile_type *tile_ptr) {
+  return tile_ptr->eos_version != 0 && tile_ptr->eos_version == tile_ptr->state_version;
+}
+
+/**
+ * @brief Records the state the equation of state of a tile was just evaluated from, the predicted one or time level 0
+ */
+static void eos_evaluated(tile_type *tile_ptr, bool predicted) {
+  tile_ptr->eos_version = predicted ? 0 : tile_ptr->state_version;
 }
 
 void ideal_gas(int tile, bool predict) {
   tile_type *tile_ptr = &chunk.tiles[tile];
+  field_type *f = &tile_ptr->field;
+  bool scratch = predicted(tile, predict);
+
+  // Nothing changed density0 and energy0 since the pressure was last evaluated from them
+  if (!scratch && eos_current(tile_ptr))
+    return;
+
+  double tile_time = profiler_tile_start();
 
   kernel_ideal_gas(
       tile_ptr->t_xmin,
       tile_ptr->t_xmax,
       tile_ptr->t_ymin,
       tile_ptr->t_ymax,
-      predict ? tile_ptr->field.density1 : tile_ptr->field.density0,
-      predict ? tile_ptr->field.energy1 : tile_ptr->field.energy0,
-      tile_ptr->field.pressure,
-      tile_ptr->field.soundspeed
+      scratch ? predicted_density(f) : f->density0,
+      scratch ? predicted_energy(f) : f->energy0,
+      f->pressure,
+      f->soundspeed
   );
+
+  profiler_tile_stop(ROOFLINE_IDEAL_GAS, 0, tile, tile_time);
+  eos_evaluated(tile_ptr, scratch);
+  halo_written(tile, FIELD_PRESSURE);
+  halo_written(tile, FIELD_SOUNDSPEED);
 }
 
-void update_tile_halo(int fields[static NUM_FIELDS], int depth) {
-  int t_left, t_right, t_up, t_down;
+/**
+ * @brief Whether a field mask has any field set
+ */
+static bool any_field(const int fields[static NUM_FIELDS]) {
+  for (int field = 0; field < NUM_FIELDS; field++)
+    if (fields[field])
+      return true;
+  return false;
+}
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
-
-    t_up = tile_ptr->tile_neighbours[TILE_TOP];
-    t_down = tile_ptr->tile_neighbours[TILE_BOTTOM];
-
-    // Update Top Bottom - Real to Real
-
-    if (t_up != EXTERNAL_TILE) {
-      tile_type *tile_top_ptr = &chunk.tiles[t_up];
-
-      kernel_update_tile_halo_t(
-          tile_ptr->t_xmin,
-          tile_ptr->t_xmax,
-          tile_ptr->t_ymin,
-          tile_ptr->t_ymax,
-          tile_ptr->field.density0,
-          tile_ptr->field.energy0,
-          tile_ptr->field.pressure,
-          tile_ptr->field.viscosity,
-          tile_ptr->field.soundspeed,
-          tile_ptr->field.density1,
-          tile_ptr->field.energy1,
-          tile_ptr->field.xvel0,
-          tile_ptr->field.yvel0,
-          tile_ptr->field.xvel1,
-          tile_ptr->field.yvel1,
-          tile_ptr->field.vol_flux_x,
-          tile_ptr->field.vol_flux_y,
-          tile_ptr->field.mass_flux_x,
-          tile_ptr->field.mass_flux_y,
-          tile_top_ptr->t_xmin,
-          tile_top_ptr->t_xmax,
-          tile_top_ptr->t_ymin,
-          tile_top_ptr->t_ymax,
-          tile_top_ptr->field.density0,
-          tile_top_ptr->field.energy0,
-          tile_top_ptr->field.pressure,
-          tile_top_ptr->field.viscosity,
-          tile_top_ptr->field.soundspeed,
-          tile_top_ptr->field.density1,
-          tile_top_ptr->field.energy1,
-          tile_top_ptr->field.xvel0,
-          tile_top_ptr->field.yvel0,
-          tile_top_ptr->field.xvel1,
-          tile_top_ptr->field.yvel1,
-          tile_top_ptr->field.vol_flux_x,
-          tile_top_ptr->field.vol_flux_y,
-          tile_top_ptr->field.mass_flux_x,
-          tile_top_ptr->field.mass_flux_y,
-          fields,
-          depth
-      );
-    }
+/**
+ * @brief Copies the top and bottom halos of a tile from its neighbours, the first part of a halo exchange
+ * @param mask The fields to exchange, see halo_needed()
+ */
+static void exchange_top_bottom(int tile, int mask[static NUM_FIELDS], int depth) {
+  if (!any_field(mask))
+    return;
 
-    if (t_down != EXTERNAL_TILE) {
-      tile_type *tile_bottom_ptr = &chunk.tiles[t_down];
-
-      kernel_update_tile_halo_b(
-          tile_ptr->t_xmin,
-          tile_ptr->t_xmax,
-          tile_ptr->t_ymin,
-          tile_ptr->t_ymax,
-          tile_ptr->field.density0,
-          tile_ptr->field.energy0,
-          tile_ptr->field.pressure,
-          tile_ptr->field.viscosity,
-          tile_ptr->field.soundspeed,
-          tile_ptr->field.density1,
-          tile_ptr->field.energy1,
-          tile_ptr->field.xvel0,
-          tile_ptr->field.yvel0,
-          tile_ptr->field.xvel1,
-          tile_ptr->field.yvel1,
-          tile_ptr->field.vol_flux_x,
-          tile_ptr->field.vol_flux_y,
-          tile_ptr->field.mass_flux_x,
-          tile_ptr->field.mass_flux_y,
-          tile_bottom_ptr->t_xmin,
-          tile_bottom_ptr->t_xmax,
-          tile_bottom_ptr->t_ymin,
-          tile_bottom_ptr->t_ymax,
-          tile_bottom_ptr->field.density0,
-          tile_bottom_ptr->field.energy0,
-          tile_bottom_ptr->field.pressure,
-          tile_bottom_ptr->field.viscosity,
-          tile_bottom_ptr->field.soundspeed,
-          tile_bottom_ptr->field.density1,
-          tile_bottom_ptr->field.energy1,
-          tile_bottom_ptr->field.xvel0,
-          tile_bottom_ptr->field.yvel0,
-          tile_bottom_ptr->field.xvel1,
-          tile_bottom_ptr->field.yvel1,
-          tile_bottom_ptr->field.vol_flux_x,
-          tile_bottom_ptr->field.vol_flux_y,
-          tile_bottom_ptr->field.mass_flux_x,
-          tile_bottom_ptr->field.mass_flux_y,
-          fields,
-          depth
-      );
-    }
-  }
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
 
-  // Update Left Right - Ghost, Real, Ghost - > Real
+  int t_up = tile_ptr->tile_neighbours[TILE_TOP];
+  int t_down = tile_ptr->tile_neighbours[TILE_BOTTOM];
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
-
-    int t_left = tile_ptr->tile_neighbours[TILE_LEFT];
-    int t_right = tile_ptr->tile_neighbours[TILE_RIGHT];
-
-    if (t_left != EXTERNAL_TILE) {
-      tile_type *tile_left_ptr = &chunk.tiles[t_left];
-
-      kernel_update_tile_halo_l(
-          tile_ptr->t_xmin,
-          tile_ptr->t_xmax,
-          tile_ptr->t_ymin,
-          tile_ptr->t_ymax,
-          tile_ptr->field.density0,
-          tile_ptr->field.energy0,
-          tile_ptr->field.pressure,
-          tile_ptr->field.viscosity,
-          tile_ptr->field.soundspeed,
-          tile_ptr->field.density1,
-          tile_ptr->field.energy1,
-          tile_ptr->field.xvel0,
-          tile_ptr->field.yvel0,
-          tile_ptr->field.xvel1,
-          tile_ptr->field.yvel1,
-          tile_ptr->field.vol_flux_x,
-          tile_ptr->field.vol_flux_y,
-          tile_ptr->field.mass_flux_x,
-          tile_ptr->field.mass_flux_y,
-          tile_left_ptr->t_xmin,
-          tile_left_ptr->t_xmax,
-          tile_left_ptr->t_ymin,
-          tile_left_ptr->t_ymax,
-          tile_left_ptr->field.density0,
-          tile_left_ptr->field.energy0,
-          tile_left_ptr->field.pressure,
-          tile_left_ptr->field.viscosity,
-          tile_left_ptr->field.soundspeed,
-          tile_left_ptr->field.density1,
-          tile_left_ptr->field.energy1,
-          tile_left_ptr->field.xvel0,
-          tile_left_ptr->field.yvel0,
-          tile_left_ptr->field.xvel1,
-          tile_left_ptr->field.yvel1,
-          tile_left_ptr->field.vol_flux_x,
-          tile_left_ptr->field.vol_flux_y,
-          tile_left_ptr->field.mass_flux_x,
-          tile_left_ptr->field.mass_flux_y,
-          fields,
-          depth
-      );
-    }
+  // Update Top Bottom - Real to Real
 
-    if (t_right != EXTERNAL_TILE) {
-      tile_type *tile_right_ptr = &chunk.tiles[t_right];
-
-      kernel_update_tile_halo_r(
-          tile_ptr->t_xmin,
-          tile_ptr->t_xmax,
-          tile_ptr->t_ymin,
-          tile_ptr->t_ymax,
-          tile_ptr->field.density0,
-          tile_ptr->field.energy0,
-          tile_ptr->field.pressure,
-          tile_ptr->field.viscosity,
-          tile_ptr->field.soundspeed,
-          tile_ptr->field.density1,
-          tile_ptr->field.energy1,
-          tile_ptr->field.xvel0,
-          tile_ptr->field.yvel0,
-          tile_ptr->field.xvel1,
-          tile_ptr->field.yvel1,
-          tile_ptr->field.vol_flux_x,
-          tile_ptr->field.vol_flux_y,
-          tile_ptr->field.mass_flux_x,
-          tile_ptr->field.mass_flux_y,
-          tile_right_ptr->t_xmin,
-          tile_right_ptr->t_xmax,
-          tile_right_ptr->t_ymin,
-          tile_right_ptr->t_ymax,
-          tile_right_ptr->field.density0,
-          tile_right_ptr->field.energy0,
-          tile_right_ptr->field.pressure,
-          tile_right_ptr->field.viscosity,
-          tile_right_ptr->field.soundspeed,
-          tile_right_ptr->field.density1,
-          tile_right_ptr->field.energy1,
-          tile_right_ptr->field.xvel0,
-          tile_right_ptr->field.yvel0,
-          tile_right_ptr->field.xvel1,
-          tile_right_ptr->field.yvel1,
-          tile_right_ptr->field.vol_flux_x,
-          tile_right_ptr->field.vol_flux_y,
-          tile_right_ptr->field.mass_flux_x,
-          tile_right_ptr->field.mass_flux_y,
-          fields,
-          depth
-      );
-    }
+  if (t_up != EXTERNAL_TILE) {
+    tile_type *tile_top_ptr = &chunk.tiles[t_up];
+
+    kernel_update_tile_halo_t(
+        tile_ptr->t_xmin,
+        tile_ptr->t_xmax,
+        tile_ptr->t_ymin,
+        tile_ptr->t_ymax,
+        tile_ptr->field.density0,
+        tile_ptr->field.energy0,
+        tile_ptr->field.pressure,
+        tile_ptr->field.viscosity,
+        tile_ptr->field.soundspeed,
+        tile_ptr->field.density1,
+        tile_ptr->field.energy1,
+        tile_ptr->field.xvel0,
+        tile_ptr->field.yvel0,
+        tile_ptr->field.xvel1,
+        tile_ptr->field.yvel1,
+        tile_ptr->field.vol_flux_x,
+        tile_ptr->field.vol_flux_y,
+        tile_ptr->field.mass_flux_x,
+        tile_ptr->field.mass_flux_y,
+        tile_top_ptr->t_xmin,
+        tile_top_ptr->t_xmax,
+        tile_top_ptr->t_ymin,
+        tile_top_ptr->t_ymax,
+        tile_top_ptr->field.density0,
+        tile_top_ptr->field.energy0,
+        tile_top_ptr->field.pressure,
+        tile_top_ptr->field.viscosity,
+        tile_top_ptr->field.soundspeed,
+        tile_top_ptr->field.density1,
+        tile_top_ptr->field.energy1,
+        tile_top_ptr->field.xvel0,
+        tile_top_ptr->field.yvel0,
+        tile_top_ptr->field.xvel1,
+        tile_top_ptr->field.yvel1,
+        tile_top_ptr->field.vol_flux_x,
+        tile_top_ptr->field.vol_flux_y,
+        tile_top_ptr->field.mass_flux_x,
+        tile_top_ptr->field.mass_flux_y,
+        mask,
+        depth
+    );
+  }
+
+  if (t_down != EXTERNAL_TILE) {
+    tile_type *tile_bottom_ptr = &chunk.tiles[t_down];
+
+    kernel_update_tile_halo_b(
+        tile_ptr->t_xmin,
+        tile_ptr->t_xmax,
+        tile_ptr->t_ymin,
+        tile_ptr->t_ymax,
+        tile_ptr->field.density0,
+        tile_ptr->field.energy0,
+        tile_ptr->field.pressure,
+        tile_ptr->field.viscosity,
+        tile_ptr->field.soundspeed,
+        tile_ptr->field.density1,
+        tile_ptr->field.energy1,
+        tile_ptr->field.xvel0,
+        tile_ptr->field.yvel0,
+        tile_ptr->field.xvel1,
+        tile_ptr->field.yvel1,
+        tile_ptr->field.vol_flux_x,
+        tile_ptr->field.vol_flux_y,
+        tile_ptr->field.mass_flux_x,
+        tile_ptr->field.mass_flux_y,
+        tile_bottom_ptr->t_xmin,
+        tile_bottom_ptr->t_xmax,
+        tile_bottom_ptr->t_ymin,
+        tile_bottom_ptr->t_ymax,
+        tile_bottom_ptr->field.density0,
+        tile_bottom_ptr->field.energy0,
+        tile_bottom_ptr->field.pressure,
+        tile_bottom_ptr->field.viscosity,
+        tile_bottom_ptr->field.soundspeed,
+        tile_bottom_ptr->field.density1,
+        tile_bottom_ptr->field.energy1,
+        tile_bottom_ptr->field.xvel0,
+        tile_bottom_ptr->field.yvel0,
+        tile_bottom_ptr->field.xvel1,
+        tile_bottom_ptr->field.yvel1,
+        tile_bottom_ptr->field.vol_flux_x,
+        tile_bottom_ptr->field.vol_flux_y,
+        tile_bottom_ptr->field.mass_flux_x,
+        tile_bottom_ptr->field.mass_flux_y,
+        mask,
+        depth
+    );
   }
+
+  profiler_tile_stop(ROOFLINE_UPDATE_TILE_HALO, 0, tile, tile_time);
 }
 
-void update_halo(int fields[static NUM_FIELDS], int depth) {
-  double kernel_time;
+/**
+ * @brief Copies the left and right halos of a tile from its neighbours, ghost rows included, once the neighbours have
+ * exchanged their top and bottom halos
+ */
+static void exchange_left_right(int tile, int mask[static NUM_FIELDS], int depth) {
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
 
-  if (profiler_on)
-    kernel_time = timer();
+  int t_left = tile_ptr->tile_neighbours[TILE_LEFT];
+  int t_right = tile_ptr->tile_neighbours[TILE_RIGHT];
 
-  update_tile_halo(fields, depth);
+  if (t_left != EXTERNAL_TILE) {
+    tile_type *tile_left_ptr = &chunk.tiles[t_left];
 
-  if (profiler_on) {
-    profiler.tile_halo_exchange += timer() - kernel_time;
-    kernel_time = timer();
+    kernel_update_tile_halo_l(
+        tile_ptr->t_xmin,
+        tile_ptr->t_xmax,
+        tile_ptr->t_ymin,
+        tile_ptr->t_ymax,
+        tile_ptr->field.density0,
+        tile_ptr->field.energy0,
+        tile_ptr->field.pressure,
+        tile_ptr->field.viscosity,
+        tile_ptr->field.soundspeed,
+        tile_ptr->field.density1,
+        tile_ptr->field.energy1,
+        tile_ptr->field.xvel0,
+        tile_ptr->field.yvel0,
+        tile_ptr->field.xvel1,
+        tile_ptr->field.yvel1,
+        tile_ptr->field.vol_flux_x,
+        tile_ptr->field.vol_flux_y,
+        tile_ptr->field.mass_flux_x,
+        tile_ptr->field.mass_flux_y,
+        tile_left_ptr->t_xmin,
+        tile_left_ptr->t_xmax,
+        tile_left_ptr->t_ymin,
+        tile_left_ptr->t_ymax,
+        tile_left_ptr->field.density0,
+        tile_left_ptr->field.energy0,
+        tile_left_ptr->field.pressure,
+        tile_left_ptr->field.viscosity,
+        tile_left_ptr->field.soundspeed,
+        tile_left_ptr->field.density1,
+        tile_left_ptr->field.energy1,
+        tile_left_ptr->field.xvel0,
+        tile_left_ptr->field.yvel0,
+        tile_left_ptr->field.xvel1,
+        tile_left_ptr->field.yvel1,
+        tile_left_ptr->field.vol_flux_x,
+        tile_left_ptr->field.vol_flux_y,
+        tile_left_ptr->field.mass_flux_x,
+        tile_left_ptr->field.mass_flux_y,
+        mask,
+        depth
+    );
   }
 
-  if (chunk.chunk_neighbours[CHUNK_LEFT] == EXTERNAL_FACE || chunk.chunk_neighbours[CHUNK_RIGHT] == EXTERNAL_FACE ||
-      chunk.chunk_neighbours[CHUNK_BOTTOM] == EXTERNAL_FACE || chunk.chunk_neighbours[CHUNK_TOP] == EXTERNAL_FACE) {
-    for (int tile = 0; tile < tiles_per_chunk; tile++) {
-      tile_type *cur_tile = &chunk.tiles[tile];
-
-      kernel_update_halo(
-          cur_tile->t_xmin,
-          cur_tile->t_xmax,
-          cur_tile->t_ymin,
-          cur_tile->t_ymax,
-          chunk.chunk_neighbours,
-          cur_tile->tile_neighbours,
-          cur_tile->field.density0,
-          cur_tile->field.energy0,
-          cur_tile->field.pressure,
-          cur_tile->field.viscosity,
-          cur_tile->field.soundspeed,
-          cur_tile->field.density1,
-          cur_tile->field.energy1,
-          cur_tile->field.xvel0,
-          cur_tile->field.yvel0,
-          cur_tile->field.xvel1,
-          cur_tile->field.yvel1,
-          cur_tile->field.vol_flux_x,
-          cur_tile->field.vol_flux_y,
-          cur_tile->field.mass_flux_x,
-          cur_tile->field.mass_flux_y,
-          fields,
-          depth
-      );
-    }
+  if (t_right != EXTERNAL_TILE) {
+    tile_type *tile_right_ptr = &chunk.tiles[t_right];
+
+    kernel_update_tile_halo_r(
+        tile_ptr->t_xmin,
+        tile_ptr->t_xmax,
+        tile_ptr->t_ymin,
+        tile_ptr->t_ymax,
+        tile_ptr->field.density0,
+        tile_ptr->field.energy0,
+        tile_ptr->field.pressure,
+        tile_ptr->field.viscosity,
+        tile_ptr->field.soundspeed,
+        tile_ptr->field.density1,
+        tile_ptr->field.energy1,
+        tile_ptr->field.xvel0,
+        tile_ptr->field.yvel0,
+        tile_ptr->field.xvel1,
+        tile_ptr->field.yvel1,
+        tile_ptr->field.vol_flux_x,
+        tile_ptr->field.vol_flux_y,
+        tile_ptr->field.mass_flux_x,
+        tile_ptr->field.mass_flux_y,
+        tile_right_ptr->t_xmin,
+        tile_right_ptr->t_xmax,
+        tile_right_ptr->t_ymin,
+        tile_right_ptr->t_ymax,
+        tile_right_ptr->field.density0,
+        tile_right_ptr->field.energy0,
+        tile_right_ptr->field.pressure,
+        tile_right_ptr->field.viscosity,
+        tile_right_ptr->field.soundspeed,
+        tile_right_ptr->field.density1,
+        tile_right_ptr->field.energy1,
+        tile_right_ptr->field.xvel0,
+        tile_right_ptr->field.yvel0,
+        tile_right_ptr->field.xvel1,
+        tile_right_ptr->field.yvel1,
+        tile_right_ptr->field.vol_flux_x,
+        tile_right_ptr->field.vol_flux_y,
+        tile_right_ptr->field.mass_flux_x,
+        tile_right_ptr->field.mass_flux_y,
+        mask,
+        depth
+    );
   }
 
-  if (profiler_on)
-    profiler.self_halo_exchange += timer() - kernel_time;
+  profiler_tile_stop(ROOFLINE_UPDATE_TILE_HALO, 0, tile, tile_time);
 }
 
-void field_summary() {
-  double vol, mass, ie, ke, press;
-  double t_vol, t_mass, t_ie, t_ke, t_press;
-  double qa_diff;
+/**
+ * @brief Reflects the halos of a tile on the external faces of the chunk, the last part of a halo exchange
+ */
+static void exchange_external(int tile, int mask[static NUM_FIELDS], int depth) {
+  if (!any_field(mask))
+    return;
+
+  if (chunk.chunk_neighbours[CHUNK_LEFT] != EXTERNAL_FACE && chunk.chunk_neighbours[CHUNK_RIGHT] != EXTERNAL_FACE &&
+      chunk.chunk_neighbours[CHUNK_BOTTOM] != EXTERNAL_FACE && chunk.chunk_neighbours[CHUNK_TOP] != EXTERNAL_FACE)
+    return;
+
+  tile_type *cur_tile = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
+
+  kernel_update_halo(
+      cur_tile->t_xmin,
+      cur_tile->t_xmax,
+      cur_tile->t_ymin,
+      cur_tile->t_ymax,
+      chunk.chunk_neighbours,
+      cur_tile->tile_neighbours,
+      cur_tile->field.density0,
+      cur_tile->field.energy0,
+      cur_tile->field.pressure,
+      cur_tile->field.viscosity,
+      cur_tile->field.soundspeed,
+      cur_tile->field.density1,
+      cur_tile->field.energy1,
+      cur_tile->field.xvel0,
+      cur_tile->field.yvel0,
+      cur_tile->field.xvel1,
+      cur_tile->field.yvel1,
+      cur_tile->field.vol_flux_x,
+      cur_tile->field.vol_flux_y,
+      cur_tile->field.mass_flux_x,
+      cur_tile->field.mass_flux_y,
+      mask,
+      depth
+  );
 
-  double kernel_time;
+  profiler_tile_stop(ROOFLINE_UPDATE_HALO, 0, tile, tile_time);
+}
 
-  if (parallel.boss) {
-    fprintf(g_out, "\nTime %4.16f\n", time_val);
-    // Print table header row with column width 16
-    fprintf(
-        g_out,
-        "            %16s%16s%16s%16s%16s%16s%16s\n",
-        "Volume",
-        "Mass",
-        "Density",
-        "Pressure",
-        "Internal Energy",
-        "Kinetic Energy",
-        "Total Energy"
-    );
-  }
+void update_halo(int fields[static NUM_FIELDS], int depth) {
+  profiler_sample kernel_time;
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++)
-    ideal_gas(tile, false);
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    exchange_top_bottom(tile, halo_needed(tile, fields, depth), depth);
 
-  if (profiler_on) {
-    profiler.ideal_gas += timer() - kernel_time;
-    kernel_time = timer();
-  }
-
-  t_vol = 0.0;
-  t_mass = 0.0;
-  t_ie = 0.0;
-  t_ke = 0.0;
-  t_press = 0.0;
+  // Update Left Right - Ghost, Real, Ghost - > Real, once the ghost rows of the neighbours are
+  team_barrier();
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *cur_tile = &chunk.tiles[tile];
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    exchange_left_right(tile, halo_mask(tile), depth);
 
-    kernel_field_summary(
-        cur_tile->t_xmin,
-        cur_tile->t_xmax,
-        cur_tile->t_ymin,
-        cur_tile->t_ymax,
-        cur_tile->field.volume,
-        cur_tile->field.density0,
-        cur_tile->field.energy0,
-        cur_tile->field.pressure,
-        cur_tile->field.xvel0,
-        cur_tile->field.yvel0,
-        &vol,
-        &mass,
-        &ie,
-        &ke,
-        &press
-    );
+  team_barrier();
 
-    t_vol += vol;
-    t_mass += mass;
-    t_ie += ie;
-    t_ke += ke;
-    t_press += press;
+  if (profiler_on) {
+    profiler_stop(&kernel_time, &profiler.tile_halo_exchange);
+    profiler_start(&kernel_time);
   }
 
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    exchange_external(tile, halo_mask(tile), depth);
+
+  team_barrier();
+
   if (profiler_on)
-    profiler.summary += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.self_halo_exchange);
+}
 
-  if (parallel.boss) {
-    fprintf(
-        g_out,
-        "step:%7d%16.4e%16.4e%16.4e%16.4e%16.4e%16.4e%16.4e\n\n",
-        step,
-        t_vol,
-        t_mass,
-        t_mass / t_vol,
-        t_press / t_vol,
-        t_ie,
-        t_ke,
-        t_ie + t_ke
-    );
-  }
+void print_field_summary(
+    FILE *out,
+    FILE *console,
+    int summary_step,
+    double summary_time,
+    double vol,
+    double mass,
+    double ie,
+    double ke,
+    double press,
+    int qa_problem
+) {
+  double qa_diff;
+
+  fprintf(out, "\nTime %4.16f\n", summary_time);
+  // Print table header row with column width 16
+  fprintf(
+      out,
+      "            %16s%16s%16s%16s%16s%16s%16s\n",
+      "Volume",
+      "Mass",
+      "Density",
+      "Pressure",
+      "Internal Energy",
+      "Kinetic Energy",
+      "Total Energy"
+  );
+  fprintf(
+      out,
+      "step:%7d%16.4e%16.4e%16.4e%16.4e%16.4e%16.4e%16.4e\n\n",
+      summary_step,
+      vol,
+      mass,
+      mass / vol,
+      press / vol,
+      ie,
+      ke,
+      ie + ke
+  );
 
-  if (complete && parallel.boss && test_problem >= 1) {
+  if (qa_problem >= 1) {
     double ke_constant;
-    switch (test_problem) {
+    switch (qa_problem) {
       case 1:
         ke_constant = 1.82280367310258;
         break;
@@ -488,54 +549,150 @@ void field_summary() {
         break;
     }
 
-    qa_diff = fabs((100.0 * (t_ke / ke_constant)) - 100.0);
+    qa_diff = fabs((100.0 * (ke / ke_constant)) - 100.0);
 
-    printf("\nTest problem %4d is within %16.7e%% of the expected solution\n", test_problem, qa_diff);
-    fprintf(g_out, "\nTest problem %4d is within %16.7e%% of the expected solution\n", test_problem, qa_diff);
+    fprintf(console, "\nTest problem %4d is within %16.7e%% of the expected solution\n", qa_problem, qa_diff);
+    fprintf(out, "\nTest problem %4d is within %16.7e%% of the expected solution\n", qa_problem, qa_diff);
 
     if (qa_diff < 0.001) {
-      puts("This test is considered PASSED\n");
-      fputs("This test is considered PASSED\n", g_out);
+      fputs("This test is considered PASSED\n\n", console);
+      fputs("This test is considered PASSED\n", out);
     } else {
-      puts("This test is considered NOT PASSED\n");
-      fputs("This test is considered NOT PASSED\n", g_out);
+      fputs("This test is considered NOT PASSED\n\n", console);
+      fputs("This test is considered NOT PASSED\n", out);
     }
   }
 }
 
-void visit() {
-  // In the original source, this kernel would have printed data to a .vtk file
-  // However, since max_task was always equal to 1, the code of this kernel was never actually executed
-  // For this reason, the implementation of it has been skipped
-}
+// The sums of a tile in field_summary(), reduced in tile order whichever member computed them
+enum { SUM_VOL, SUM_MASS, SUM_IE, SUM_KE, SUM_PRESS, NUM_SUMS };
 
-void viscosity() {
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+void field_summary() {
+  double t_vol, t_mass, t_ie, t_ke, t_press;
+
+  profiler_sample kernel_time;
+
+  if (profiler_on)
+    profiler_start(&kernel_time);
+
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    ideal_gas(tile, false);
+
+  team_barrier();
+
+  if (profiler_on) {
+    profiler_stop(&kernel_time, &profiler.ideal_gas);
+    profiler_start(&kernel_time);
+  }
+
+  double(*sums)[NUM_SUMS] = team_slots(tiles_per_chunk * sizeof(*sums));
+
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++) {
     tile_type *cur_tile = &chunk.tiles[tile];
+    double tile_time = profiler_tile_start();
 
-    kernel_viscosity(
+    kernel_field_summary(
         cur_tile->t_xmin,
         cur_tile->t_xmax,
         cur_tile->t_ymin,
         cur_tile->t_ymax,
-        cur_tile->field.celldx,
-        cur_tile->field.celldy,
+        cur_tile->field.volume,
         cur_tile->field.density0,
+        cur_tile->field.energy0,
         cur_tile->field.pressure,
-        cur_tile->field.viscosity,
         cur_tile->field.xvel0,
-        cur_tile->field.yvel0
+        cur_tile->field.yvel0,
+        &sums[tile][SUM_VOL],
+        &sums[tile][SUM_MASS],
+        &sums[tile][SUM_IE],
+        &sums[tile][SUM_KE],
+        &sums[tile][SUM_PRESS],
+        cur_tile->field.uniform_volume
+    );
+
+    profiler_tile_stop(ROOFLINE_FIELD_SUMMARY, 0, tile, tile_time);
+  }
+
+  team_barrier();
+
+  if (!team_master()) {
+    // The workers' share of the summary, the master's ends with the reduction
+    if (profiler_on)
+      profiler_stop(&kernel_time, &profiler.summary);
+    return;
+  }
+
+  t_vol = 0.0;
+  t_mass = 0.0;
+  t_ie = 0.0;
+  t_ke = 0.0;
+  t_press = 0.0;
+
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    t_vol += sums[tile][SUM_VOL];
+    t_mass += sums[tile][SUM_MASS];
+    t_ie += sums[tile][SUM_IE];
+    t_ke += sums[tile][SUM_KE];
+    t_press += sums[tile][SUM_PRESS];
+  }
+
+  if (profiler_on)
+    profiler_stop(&kernel_time, &profiler.summary);
+
+  if (parallel.boss) {
+    print_field_summary(
+        g_out, g_stdout, step, time_val, t_vol, t_mass, t_ie, t_ke, t_press, complete ? test_problem : 0
     );
   }
 }
 
-void calc_dt(
-    int tile, double *local_dt, char local_control[static 8], double *xl_pos, double *yl_pos, int *jldt, int *kldt
-) {
+void visit() {
+  // In the original source, this kernel would have printed data to a .vtk file
+  // However, since max_task was always equal to 1, the code of this kernel was never actually executed
+  // For this reason, the implementation of it has been skipped
+}
+
+/**
+ * @brief The viscosity of a tile
+ */
+static void viscosity_tile(int tile) {
+  if (activity_skip(tile))
+    return;
+
+  tile_type *cur_tile = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
+
+  kernel_viscosity(
+      cur_tile->t_xmin,
+      cur_tile->t_xmax,
+      cur_tile->t_ymin,
+      cur_tile->t_ymax,
+      cur_tile->field.celldx,
+      cur_tile->field.celldy,
+      cur_tile->field.density0,
+      cur_tile->field.pressure,
+      cur_tile->field.viscosity,
+      cur_tile->field.xvel0,
+      cur_tile->field.yvel0
+  );
+
+  profiler_tile_stop(ROOFLINE_VISCOSITY, 0, tile, tile_time);
+  halo_written(tile, FIELD_VISCOSITY);
+}
+
+void viscosity() {
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    viscosity_tile(tile);
+
+  team_barrier();
+}
+
+void calc_dt(int tile, tile_dt *result) {
+  double tile_time = profiler_tile_start();
   tile_type *tile_ptr = &chunk.tiles[tile];
   int l_control;
   int small = 0;
-  *local_dt = G_BIG;
+  result->dt = G_BIG;
 
   kernel_calc_dt(
       tile_ptr->t_xmin,
@@ -562,182 +719,376 @@ void calc_dt(
       tile_ptr->field.xvel0,
       tile_ptr->field.yvel0,
       tile_ptr->field.work_array1,
-      local_dt,
+      &result->dt,
       &l_control,
-      xl_pos,
-      yl_pos,
-      jldt,
-      kldt,
-      small
+      &result->x_pos,
+      &result->y_pos,
+      &result->jdt,
+      &result->kdt,
+      small,
+      tile_ptr->field.uniform_volume,
+      tile_ptr->field.uniform_xarea,
+      tile_ptr->field.uniform_yarea
   );
 
+  profiler_tile_stop(ROOFLINE_CALC_DT, 0, tile, tile_time);
+
   switch (l_control) {
     case 1:
-      strcpy(local_control, "sound");
+      strcpy(result->control, "sound");
       break;
     case 2:
-      strcpy(local_control, "xvel");
+      strcpy(result->control, "xvel");
       break;
     case 3:
-      strcpy(local_control, "yvel");
+      strcpy(result->control, "yvel");
       break;
     case 4:
-      strcpy(local_control, "div");
+      strcpy(result->control, "div");
       break;
   }
 }
 
-void revert() {
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
+/**
+ * @brief Records the fields the PdV corrector writes on a tile, see halo.h
+ */
+static void corrector_written(int tile) {
+  halo_written(tile, FIELD_DENSITY1);
+  halo_written(tile, FIELD_ENERGY1);
+  halo_written(tile, FIELD_VOL_FLUX_X);
+  halo_written(tile, FIELD_VOL_FLUX_Y);
+}
 
-    kernel_revert(
-        tile_ptr->t_xmin,
-        tile_ptr->t_xmax,
-        tile_ptr->t_ymin,
-        tile_ptr->t_ymax,
-        tile_ptr->field.density0,
-        tile_ptr->field.density1,
-        tile_ptr->field.energy0,
-        tile_ptr->field.energy1
-    );
-  }
+/**
+ * @brief The PdV predictor or corrector on a tile
+ */
+static void pdv_tile(int tile, bool predict) {
+  if (activity_skip(tile))
+    return;
+
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
+
+  jit_pdv(tile, predict)(
+      tile_ptr->t_xmin,
+      tile_ptr->t_xmax,
+      tile_ptr->t_ymin,
+      tile_ptr->t_ymax,
+      dt,
+      tile_ptr->field.xarea,
+      tile_ptr->field.yarea,
+      tile_ptr->field.volume,
+      tile_ptr->field.density0,
+      predict ? predicted_density(&tile_ptr->field) : tile_ptr->field.density1,
+      tile_ptr->field.energy0,
+      predict ? predicted_energy(&tile_ptr->field) : tile_ptr->field.energy1,
+      tile_ptr->field.pressure,
+      tile_ptr->field.viscosity,
+      tile_ptr->field.xvel0,
+      tile_ptr->field.xvel1,
+      tile_ptr->field.yvel0,
+      tile_ptr->field.yvel1,
+      tile_ptr->field.work_array1,
+      tile_ptr->field.vol_flux_x,
+      tile_ptr->field.vol_flux_y,
+      tile_ptr->field.uniform_volume,
+      tile_ptr->field.uniform_xarea,
+      tile_ptr->field.uniform_yarea
+  );
+
+  profiler_tile_stop(ROOFLINE_PDV, predict, tile, tile_time);
+  if (!predict)
+    corrector_written(tile);
 }
 
 void PdV(bool predict) {
-  double kernel_time;
+  profiler_sample kernel_time;
   int fields[NUM_FIELDS];
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    pdv_tile(tile, predict);
 
-    kernel_pdv(
-        predict,
-        tile_ptr->t_xmin,
-        tile_ptr->t_xmax,
-        tile_ptr->t_ymin,
-        tile_ptr->t_ymax,
-        dt,
-        tile_ptr->field.xarea,
-        tile_ptr->field.yarea,
-        tile_ptr->field.volume,
-        tile_ptr->field.density0,
-        tile_ptr->field.density1,
-        tile_ptr->field.energy0,
-        tile_ptr->field.energy1,
-        tile_ptr->field.pressure,
-        tile_ptr->field.viscosity,
-        tile_ptr->field.xvel0,
-        tile_ptr->field.xvel1,
-        tile_ptr->field.yvel0,
-        tile_ptr->field.yvel1,
-        tile_ptr->field.work_array1
-    );
-  }
+  team_barrier();
 
   if (profiler_on)
-    profiler.PdV += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.PdV);
 
   if (predict) {
     if (profiler_on)
-      kernel_time = timer();
+      profiler_start(&kernel_time);
 
-    for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    for (int tile = team_tile_begin(); tile < team_tile_end(); tile++) {
       ideal_gas(tile, true);
     }
 
+    team_barrier();
+
     if (profiler_on)
-      profiler.ideal_gas += timer() - kernel_time;
+      profiler_stop(&kernel_time, &profiler.ideal_gas);
 
     memset(fields, 0, sizeof(fields));
     fields[FIELD_PRESSURE] = 1;
     update_halo(fields, 1);
+  }
+}
 
-    if (profiler_on)
-      kernel_time = timer();
+/**
+ * @brief The acceleration of the nodes of a tile
+ */
+static void accelerate_tile(int tile) {
+  if (activity_skip(tile))
+    return;
+
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
 
-    revert();
+  kernel_accelerate(
+      tile_ptr->t_xmin,
+      tile_ptr->t_xmax,
+      tile_ptr->t_ymin,
+      tile_ptr->t_ymax,
+      dt,
+      tile_ptr->field.xarea,
+      tile_ptr->field.yarea,
+      tile_ptr->field.volume,
+      tile_ptr->field.density0,
+      tile_ptr->field.pressure,
+      tile_ptr->field.viscosity,
+      tile_ptr->field.xvel0,
+      tile_ptr->field.yvel0,
+      tile_ptr->field.xvel1,
+      tile_ptr->field.yvel1,
+      tile_ptr->field.uniform_volume,
+      tile_ptr->field.uniform_xarea,
+      tile_ptr->field.uniform_yarea
+  );
 
-    if (profiler_on)
-      profiler.revert += timer() - kernel_time;
-  }
+  profiler_tile_stop(ROOFLINE_ACCELERATE, 0, tile, tile_time);
+  halo_written(tile, FIELD_XVEL1);
+  halo_written(tile, FIELD_YVEL1);
 }
 
 void accelerate() {
-  double kernel_time;
+  profiler_sample kernel_time;
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    accelerate_tile(tile);
 
-    kernel_accelerate(
-        tile_ptr->t_xmin,
-        tile_ptr->t_xmax,
-        tile_ptr->t_ymin,
-        tile_ptr->t_ymax,
+  team_barrier();
+
+  if (profiler_on)
+    profiler_stop(&kernel_time, &profiler.acceleration);
+}
+
+/**
+ * @brief Shifts an array of a tile so that a kernel called with y_min = row indexes it as the whole tile
+ * @param x_extra Elements past t_xmax in a row of the array, 4 for cells and 5 for nodes
+ * @return NULL for an array that isn't allocated, as the geometry planes on a uniform grid
+ */
+static double *band(double *array, const tile_type *tile_ptr, int row, int x_extra) {
+  if (array == NULL)
+    return NULL;
+  return array + (size_t)(tile_ptr->t_xmax + x_extra) * (row - tile_ptr->t_ymin);
+}
+
+/**
+ * @brief The predictor on the rows k0 to k1 of a tile: PdV, then the equation of state of its result
+ */
+static void predictor_band(int tile, int k0, int k1) {
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  field_type *f = &tile_ptr->field;
+  int x_min = tile_ptr->t_xmin, x_max = tile_ptr->t_xmax;
+  double band_time;
+
+  if (!activity_skip(tile)) {
+    band_time = profiler_tile_start();
+    kernel_pdv_variants[true](
+        x_min,
+        x_max,
+        k0,
+        k1,
         dt,
-        tile_ptr->field.xarea,
-        tile_ptr->field.yarea,
-        tile_ptr->field.volume,
-        tile_ptr->field.density0,
-        tile_ptr->field.pressure,
-        tile_ptr->field.viscosity,
-        tile_ptr->field.xvel0,
-        tile_ptr->field.yvel0,
-        tile_ptr->field.xvel1,
-        tile_ptr->field.yvel1
+        band(f->xarea, tile_ptr, k0, 5),
+        band(f->yarea, tile_ptr, k0, 4),
+        band(f->volume, tile_ptr, k0, 4),
+        band(f->density0, tile_ptr, k0, 4),
+        band(predicted_density(f), tile_ptr, k0, 4),
+        band(f->energy0, tile_ptr, k0, 4),
+        band(predicted_energy(f), tile_ptr, k0, 4),
+        band(f->pressure, tile_ptr, k0, 4),
+        band(f->viscosity, tile_ptr, k0, 4),
+        band(f->xvel0, tile_ptr, k0, 5),
+        band(f->xvel1, tile_ptr, k0, 5),
+        band(f->yvel0, tile_ptr, k0, 5),
+        band(f->yvel1, tile_ptr, k0, 5),
+        band(f->work_array1, tile_ptr, k0, 5),
+        band(f->vol_flux_x, tile_ptr, k0, 5),
+        band(f->vol_flux_y, tile_ptr, k0, 4),
+        f->uniform_volume,
+        f->uniform_xarea,
+        f->uniform_yarea
     );
+    profiler_band_stop(ROOFLINE_PDV, true, tile, k0, k1, band_time);
   }
 
-  if (profiler_on)
-    profiler.acceleration += timer() - kernel_time;
+  // As ideal_gas(), lagrangian_blocked() doesn't call the tiles whose equation of state is current and records it
+  bool scratch = predicted(tile, true);
+
+  band_time = profiler_tile_start();
+  kernel_ideal_gas(
+      x_min,
+      x_max,
+      k0,
+      k1,
+      band(scratch ? predicted_density(f) : f->density0, tile_ptr, k0, 4),
+      band(scratch ? predicted_energy(f) : f->energy0, tile_ptr, k0, 4),
+      band(f->pressure, tile_ptr, k0, 4),
+      band(f->soundspeed, tile_ptr, k0, 4)
+  );
+  profiler_band_stop(ROOFLINE_IDEAL_GAS, 0, tile, k0, k1, band_time);
+}
+
+/**
+ * @brief The corrector on the rows k0 to k1 of a tile: accelerate, then PdV with the fluxes
+ * @details Accelerate computes the nodes k0 to k1 + 1, all the nodes the cells and faces of the band need, so the
+ * bands don't have to be skewed. The top row of nodes of a band is computed again as the bottom one of the next, to
+ * the same values, as accelerate only reads the time level 0 velocities.
+ */
+static void corrector_band(int tile, int k0, int k1) {
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  field_type *f = &tile_ptr->field;
+  int x_min = tile_ptr->t_xmin, x_max = tile_ptr->t_xmax;
+
+  double band_time = profiler_tile_start();
+  kernel_accelerate(
+      x_min,
+      x_max,
+      k0,
+      k1,
+      dt,
+      band(f->xarea, tile_ptr, k0, 5),
+      band(f->yarea, tile_ptr, k0, 4),
+      band(f->volume, tile_ptr, k0, 4),
+      band(f->density0, tile_ptr, k0, 4),
+      band(f->pressure, tile_ptr, k0, 4),
+      band(f->viscosity, tile_ptr, k0, 4),
+      band(f->xvel0, tile_ptr, k0, 5),
+      band(f->yvel0, tile_ptr, k0, 5),
+      band(f->xvel1, tile_ptr, k0, 5),
+      band(f->yvel1, tile_ptr, k0, 5),
+      f->uniform_volume,
+      f->uniform_xarea,
+      f->uniform_yarea
+  );
+  profiler_band_stop(ROOFLINE_ACCELERATE, 0, tile, k0, k1, band_time);
+
+  band_time = profiler_tile_start();
+  kernel_pdv_variants[false](
+      x_min,
+      x_max,
+      k0,
+      k1,
+      dt,
+      band(f->xarea, tile_ptr, k0, 5),
+      band(f->yarea, tile_ptr, k0, 4),
+      band(f->volume, tile_ptr, k0, 4),
+      band(f->density0, tile_ptr, k0, 4),
+      band(f->density1, tile_ptr, k0, 4),
+      band(f->energy0, tile_ptr, k0, 4),
+      band(f->energy1, tile_ptr, k0, 4),
+      band(f->pressure, tile_ptr, k0, 4),
+      band(f->viscosity, tile_ptr, k0, 4),
+      band(f->xvel0, tile_ptr, k0, 5),
+      band(f->xvel1, tile_ptr, k0, 5),
+      band(f->yvel0, tile_ptr, k0, 5),
+      band(f->yvel1, tile_ptr, k0, 5),
+      band(f->work_array1, tile_ptr, k0, 5),
+      band(f->vol_flux_x, tile_ptr, k0, 5),
+      band(f->vol_flux_y, tile_ptr, k0, 4),
+      f->uniform_volume,
+      f->uniform_xarea,
+      f->uniform_yarea
+  );
+  profiler_band_stop(ROOFLINE_PDV, false, tile, k0, k1, band_time);
+}
+
+/**
+ * @brief The first phase of lagrangian_blocked() on a tile, band by band
+ */
+static void predictor_blocked(int tile) {
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  if (!predicted(tile, true) && eos_current(tile_ptr))
+    return;
+
+  for (int k0 = tile_ptr->t_ymin; k0 <= tile_ptr->t_ymax; k0 += band_rows)
+    predictor_band(tile, k0, min(k0 + band_rows - 1, tile_ptr->t_ymax));
+  eos_evaluated(tile_ptr, predicted(tile, true));
+  halo_written(tile, FIELD_PRESSURE);
+  halo_written(tile, FIELD_SOUNDSPEED);
 }
 
-void flux_calc() {
-  double kernel_time;
+/**
+ * @brief The second phase of lagrangian_blocked() on a tile, band by band
+ */
+static void corrector_blocked(int tile) {
+  if (activity_skip(tile))
+    return;
+
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  for (int k0 = tile_ptr->t_ymin; k0 <= tile_ptr->t_ymax; k0 += band_rows)
+    corrector_band(tile, k0, min(k0 + band_rows - 1, tile_ptr->t_ymax));
+  halo_written(tile, FIELD_XVEL1);
+  halo_written(tile, FIELD_YVEL1);
+  corrector_written(tile);
+}
+
+void lagrangian_blocked() {
+  profiler_sample kernel_time;
+  int fields[NUM_FIELDS];
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    predictor_blocked(tile);
 
-    kernel_flux_calc(
-        tile_ptr->t_xmin,
-        tile_ptr->t_xmax,
-        tile_ptr->t_ymin,
-        tile_ptr->t_ymax,
-        dt,
-        tile_ptr->field.xarea,
-        tile_ptr->field.yarea,
-        tile_ptr->field.xvel0,
-        tile_ptr->field.yvel0,
-        tile_ptr->field.xvel1,
-        tile_ptr->field.yvel1,
-        tile_ptr->field.vol_flux_x,
-        tile_ptr->field.vol_flux_y
-    );
-  }
+  team_barrier();
+
+  if (profiler_on)
+    profiler_stop(&kernel_time, &profiler.lagrangian);
+
+  // The only dependency between the tiles, accelerate reads the predicted pressure of the neighbouring cells
+  memset(fields, 0, sizeof(fields));
+  fields[FIELD_PRESSURE] = 1;
+  update_halo(fields, 1);
+
+  if (profiler_on)
+    profiler_start(&kernel_time);
+
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    corrector_blocked(tile);
+
+  team_barrier();
 
   if (profiler_on)
-    profiler.flux += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.lagrangian);
 }
 
 void advec_cell(int tile, int sweep_number, int direction) {
+  double tile_time = profiler_tile_start();
   tile_type *tile_ptr = &chunk.tiles[tile];
 
-  kernel_advec_cell(
+  jit_advec_cell(tile, direction, sweep_number)(
       tile_ptr->t_xmin,
       tile_ptr->t_xmax,
       tile_ptr->t_ymin,
       tile_ptr->t_ymax,
-      direction,
-      sweep_number,
       tile_ptr->field.vertexdx,
       tile_ptr->field.vertexdy,
       tile_ptr->field.volume,
@@ -753,14 +1104,21 @@ void advec_cell(int tile, int sweep_number, int direction) {
       tile_ptr->field.work_array4,
       tile_ptr->field.work_array5,
       tile_ptr->field.work_array6,
-      tile_ptr->field.work_array7
+      tile_ptr->field.work_array7,
+      tile_ptr->field.uniform_volume
   );
+
+  profiler_tile_stop(ROOFLINE_ADVEC_CELL, ROOFLINE_SWEEP(direction, sweep_number), tile, tile_time);
+  halo_written(tile, FIELD_DENSITY1);
+  halo_written(tile, FIELD_ENERGY1);
+  halo_written(tile, direction == G_XDIR ? FIELD_MASS_FLUX_X : FIELD_MASS_FLUX_Y);
 }
 
 void advec_mom(int tile, int which_vel, int direction, int sweep_number) {
+  double tile_time = profiler_tile_start();
   tile_type *tile_ptr = &chunk.tiles[tile];
 
-  kernel_advec_mom(
+  jit_advec_mom(tile, direction, sweep_number)(
       tile_ptr->t_xmin,
       tile_ptr->t_xmax,
       tile_ptr->t_ymin,
@@ -780,17 +1138,18 @@ void advec_mom(int tile, int which_vel, int direction, int sweep_number) {
       tile_ptr->field.work_array6,
       tile_ptr->field.celldx,
       tile_ptr->field.celldy,
-      which_vel,
-      sweep_number,
-      direction
+      tile_ptr->field.uniform_volume
   );
+
+  profiler_tile_stop(ROOFLINE_ADVEC_MOM, ROOFLINE_SWEEP(direction, sweep_number), tile, tile_time);
+  halo_written(tile, which_vel == G_XDIR ? FIELD_XVEL1 : FIELD_YVEL1);
 }
 
 void advection() {
   int sweep_number, direction, tile;
   int xvel, yvel;
   int fields[NUM_FIELDS];
-  double kernel_time;
+  profiler_sample kernel_time;
 
   sweep_number = 1;
   direction = advect_x ? G_XDIR : G_YDIR;
@@ -805,13 +1164,16 @@ void advection() {
   update_halo(fields, 2);
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
+
+  for (tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    if (!activity_skip(tile))
+      advec_cell(tile, sweep_number, direction);
 
-  for (tile = 0; tile < tiles_per_chunk; tile++)
-    advec_cell(tile, sweep_number, direction);
+  team_barrier();
 
   if (profiler_on)
-    profiler.cell_advection += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.cell_advection);
 
   memset(fields, 0, sizeof(fields));
   fields[FIELD_DENSITY1] = 1;
@@ -823,27 +1185,35 @@ void advection() {
   update_halo(fields, 2);
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
+
+  for (tile = team_tile_begin(); tile < team_tile_end(); tile++) {
+    if (activity_skip(tile))
+      continue;
 
-  for (tile = 0; tile < tiles_per_chunk; tile++) {
     advec_mom(tile, xvel, direction, sweep_number);
     advec_mom(tile, yvel, direction, sweep_number);
   }
 
+  team_barrier();
+
   if (profiler_on)
-    profiler.mom_advection += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.mom_advection);
 
   sweep_number = 2;
   direction = advect_x ? G_YDIR : G_XDIR;
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
+
+  for (tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    if (!activity_skip(tile))
+      advec_cell(tile, sweep_number, direction);
 
-  for (tile = 0; tile < tiles_per_chunk; tile++)
-    advec_cell(tile, sweep_number, direction);
+  team_barrier();
 
   if (profiler_on)
-    profiler.cell_advection += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.cell_advection);
 
   memset(fields, 0, sizeof(fields));
   fields[FIELD_DENSITY1] = 1;
@@ -855,42 +1225,231 @@ void advection() {
   update_halo(fields, 2);
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
+
+  for (tile = team_tile_begin(); tile < team_tile_end(); tile++) {
+    if (activity_skip(tile))
+      continue;
 
-  for (tile = 0; tile < tiles_per_chunk; tile++) {
     advec_mom(tile, xvel, direction, sweep_number);
     advec_mom(tile, yvel, direction, sweep_number);
   }
 
+  team_barrier();
+
   if (profiler_on)
-    profiler.mom_advection += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.mom_advection);
+}
+
+/**
+ * @brief Copies the time level 1 state of a tile to time level 0
+ */
+static void reset_tile(int tile) {
+  tile_type *tile_ptr = &chunk.tiles[tile];
+  double tile_time = profiler_tile_start();
+
+  kernel_reset_field(
+      tile_ptr->t_xmin,
+      tile_ptr->t_xmax,
+      tile_ptr->t_ymin,
+      tile_ptr->t_ymax,
+      tile_ptr->field.density0,
+      tile_ptr->field.density1,
+      tile_ptr->field.energy0,
+      tile_ptr->field.energy1,
+      tile_ptr->field.xvel0,
+      tile_ptr->field.xvel1,
+      tile_ptr->field.yvel0,
+      tile_ptr->field.yvel1
+  );
+
+  // A skipped tile ends the step in the state it started it, see activity.h
+  if (!activity_skip(tile)) {
+    tile_ptr->state_version++;
+    halo_written(tile, FIELD_DENSITY0);
+    halo_written(tile, FIELD_ENERGY0);
+    halo_written(tile, FIELD_XVEL0);
+    halo_written(tile, FIELD_YVEL0);
+  }
+
+  profiler_tile_stop(ROOFLINE_RESET_FIELD, 0, tile, tile_time);
 }
 
 void reset_field() {
-  double kernel_time;
+  profiler_sample kernel_time;
 
   if (profiler_on)
-    kernel_time = timer();
+    profiler_start(&kernel_time);
 
-  for (int tile = 0; tile < tiles_per_chunk; tile++) {
-    tile_type *tile_ptr = &chunk.tiles[tile];
+  for (int tile = team_tile_begin(); tile < team_tile_end(); tile++)
+    reset_tile(tile);
 
-    kernel_reset_field(
-        tile_ptr->t_xmin,
-        tile_ptr->t_xmax,
-        tile_ptr->t_ymin,
-        tile_ptr->t_ymax,
-        tile_ptr->field.density0,
-        tile_ptr->field.density1,
-        tile_ptr->field.energy0,
-        tile_ptr->field.energy1,
-        tile_ptr->field.xvel0,
-        tile_ptr->field.xvel1,
-        tile_ptr->field.yvel0,
-        tile_ptr->field.yvel1
-    );
-  }
+  team_barrier();
 
   if (profiler_on)
-    profiler.reset += timer() - kernel_time;
+    profiler_stop(&kernel_time, &profiler.reset);
+}
+
+/**
+ * @brief An update_halo() call as the three tasks of a flow, see flow.h
+ */
+typedef struct exchange_t {
+  int fields[NUM_FIELDS];
+  int depth;
+} exchange;
+
+// The exchanges of a step, as update_halo() is called by timestep(), PdV(), lagrangian_blocked() and advection()
+static const exchange timestep_halo = {
+    {[FIELD_PRESSURE] = 1, [FIELD_ENERGY0] = 1, [FIELD_DENSITY0] = 1, [FIELD_XVEL0] = 1, [FIELD_YVEL0] = 1}, 1
+};
+static const exchange viscosity_halo = {{[FIELD_VISCOSITY] = 1}, 1};
+static const exchange pressure_halo = {{[FIELD_PRESSURE] = 1}, 1};
+static const exchange advection_halo = {
+    {[FIELD_ENERGY1] = 1, [FIELD_DENSITY1] = 1, [FIELD_VOL_FLUX_X] = 1, [FIELD_VOL_FLUX_Y] = 1}, 2
+};
+static const exchange sweep_halo = {
+    {[FIELD_DENSITY1] = 1,
+     [FIELD_ENERGY1] = 1,
+     [FIELD_XVEL1] = 1,
+     [FIELD_YVEL1] = 1,
+     [FIELD_MASS_FLUX_X] = 1,
+     [FIELD_MASS_FLUX_Y] = 1},
+    2
+};
+
+// A sweep of the advection, the argument of its tasks
+typedef struct sweep_t {
+  int number;
+  int direction;
+} sweep;
+
+static void top_bottom_task(int tile, const void *arg) {
+  const exchange *x = arg;
+  exchange_top_bottom(tile, halo_needed(tile, x->fields, x->depth), x->depth);
+}
+
+static void left_right_task(int tile, const void *arg) {
+  exchange_left_right(tile, halo_mask(tile), ((const exchange *)arg)->depth);
+}
+
+static void external_task(int tile, const void *arg) {
+  exchange_external(tile, halo_mask(tile), ((const exchange *)arg)->depth);
+}
+
+/**
+ * @brief Appends the tasks of an exchange to a flow
+ * @return The number of tasks of the flow
+ */
+static int exchange_tasks(flow_task *tasks, int num, const exchange *x) {
+  tasks[num++] = (flow_task){top_bottom_task, x, &profiler.tile_halo_exchange};
+  tasks[num++] = (flow_task){left_right_task, x, &profiler.tile_halo_exchange};
+  tasks[num++] = (flow_task){external_task, x, &profiler.self_halo_exchange};
+  return num;
+}
+
+static void ideal_gas_task(int tile, const void *arg) {
+  (void)arg;
+  ideal_gas(tile, false);
+}
+
+static void viscosity_task(int tile, const void *arg) {
+  (void)arg;
+  viscosity_tile(tile);
+}
+
+static void calc_dt_task(int tile, const void *arg) {
+  calc_dt(tile, (tile_dt *)arg + tile);
+}
+
+static void predictor_task(int tile, const void *arg) {
+  (void)arg;
+  pdv_tile(tile, true);
+}
+
+static void predicted_ideal_gas_task(int tile, const void *arg) {
+  (void)arg;
+  ideal_gas(tile, true);
+}
+
+static void accelerate_task(int tile, const void *arg) {
+  (void)arg;
+  accelerate_tile(tile);
+}
+
+static void corrector_task(int tile, const void *arg) {
+  (void)arg;
+  pdv_tile(tile, false);
+}
+
+static void predictor_blocked_task(int tile, const void *arg) {
+  (void)arg;
+  predictor_blocked(tile);
+}
+
+static void corrector_blocked_task(int tile, const void *arg) {
+  (void)arg;
+  corrector_blocked(tile);
+}
+
+static void advec_cell_task(int tile, const void *arg) {
+  const sweep *s = arg;
+  if (!activity_skip(tile))
+    advec_cell(tile, s->number, s->direction);
+}
+
+static void advec_mom_task(int tile, const void *arg) {
+  const sweep *s = arg;
+  if (activity_skip(tile))
+    return;
+
+  advec_mom(tile, G_XDIR, s->direction, s->number);
+  advec_mom(tile, G_YDIR, s->direction, s->number);
+}
+
+static void reset_task(int tile, const void *arg) {
+  (void)arg;
+  reset_tile(tile);
+}
+
+void timestep_flow(tile_dt *dts) {
+  flow_task tasks[9];
+  int num = 0;
+
+  tasks[num++] = (flow_task){ideal_gas_task, NULL, &profiler.ideal_gas};
+  num = exchange_tasks(tasks, num, &timestep_halo);
+  tasks[num++] = (flow_task){viscosity_task, NULL, &profiler.viscosity};
+  num = exchange_tasks(tasks, num, &viscosity_halo);
+  tasks[num++] = (flow_task){calc_dt_task, dts, &profiler.timestep};
+
+  flow_run(tasks, num);
+}
+
+void step_flow() {
+  flow_task tasks[24];
+  int num = 0;
+  sweep first = {1, advect_x ? G_XDIR : G_YDIR};
+  sweep second = {2, advect_x ? G_YDIR : G_XDIR};
+
+  if (temporal_blocking) {
+    tasks[num++] = (flow_task){predictor_blocked_task, NULL, &profiler.lagrangian};
+    num = exchange_tasks(tasks, num, &pressure_halo);
+    tasks[num++] = (flow_task){corrector_blocked_task, NULL, &profiler.lagrangian};
+  } else {
+    tasks[num++] = (flow_task){predictor_task, NULL, &profiler.PdV};
+    tasks[num++] = (flow_task){predicted_ideal_gas_task, NULL, &profiler.ideal_gas};
+    num = exchange_tasks(tasks, num, &pressure_halo);
+    tasks[num++] = (flow_task){accelerate_task, NULL, &profiler.acceleration};
+    tasks[num++] = (flow_task){corrector_task, NULL, &profiler.PdV};
+  }
+
+  num = exchange_tasks(tasks, num, &advection_halo);
+  tasks[num++] = (flow_task){advec_cell_task, &first, &profiler.cell_advection};
+  num = exchange_tasks(tasks, num, &sweep_halo);
+  tasks[num++] = (flow_task){advec_mom_task, &first, &profiler.mom_advection};
+  tasks[num++] = (flow_task){advec_cell_task, &second, &profiler.cell_advection};
+  num = exchange_tasks(tasks, num, &sweep_halo);
+  tasks[num++] = (flow_task){advec_mom_task, &second, &profiler.mom_advection};
+  tasks[num++] = (flow_task){reset_task, NULL, &profiler.reset};
+
+  flow_run(tasks, num);
 }
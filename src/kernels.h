@@ -9,6 +9,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stdio.h>
 
 #include "types/data.h"
 
@@ -16,26 +17,79 @@ extern void initialise_chunk(int tile);
 
 extern void generate_chunk(int tile);
 
+/**
+ * @brief The equation of state of a tile, of its time level 0 state or of the one the PdV predictor wrote
+ * @details The tiles keep a version of their density0 and energy0, bumped by generate_chunk() and reset_field(), and
+ * the version their pressure and soundspeed were evaluated from. The time level 0 evaluation is skipped when the two
+ * match, as it is at the start of a step following a field summary, which then costs no sweep of its own.
+ */
 extern void ideal_gas(int tile, bool predict);
 
 extern void update_halo(int fields[static NUM_FIELDS], int depth);
 
 extern void field_summary();
 
+/**
+ * @brief Writes a field summary table to the output file, followed by the QA check of the given test problem if any
+ * @param qa_problem Test problem to check the kinetic energy against, 0 to skip the check
+ */
+extern void print_field_summary(
+    FILE *out,
+    FILE *console,
+    int summary_step,
+    double summary_time,
+    double vol,
+    double mass,
+    double ie,
+    double ke,
+    double press,
+    int qa_problem
+);
+
 extern void visit();
 
 extern void viscosity();
 
-extern void calc_dt(
-    int tile, double *local_dt, char local_control[static 8], double *xl_pos, double *yl_pos, int *jldt, int *kldt
-);
+// The timestep a tile allows, and where it is controlled
+typedef struct tile_dt_t {
+  double dt;
+  char control[8];
+  double x_pos, y_pos;
+  int jdt, kdt;
+} tile_dt;
 
+extern void calc_dt(int tile, tile_dt *result);
+
+/**
+ * @brief The PdV predictor, with the equation of state of its result and the pressure halo exchange, or the corrector
+ * @details The predictor writes its density and energy to work arrays rather than density1 and energy1, so that they
+ * don't have to be reverted to the time level 0 state before the corrector.
+ */
 extern void PdV(bool predict);
 
 extern void accelerate();
 
-extern void flux_calc();
+/**
+ * @brief The Lagrangian phase of a step, PdV(true), accelerate() and PdV(false), temporally blocked
+ * @details Each tile is processed in bands of band_rows rows, running every kernel of a phase on a band while it is
+ * still in cache: the predictor with its equation of state, then, after the pressure halo exchange, accelerate
+ * and the corrector. The results are bitwise identical to the unblocked kernels.
+ */
+extern void lagrangian_blocked();
 
 extern void advection();
 
 extern void reset_field();
+
+/**
+ * @brief The kernels of timestep() before its reduction, the equation of state, the viscosity and calc_dt() with their
+ * halo exchanges, as a single dataflow (see flow.h)
+ * @param dts The timestep of each tile
+ */
+extern void timestep_flow(tile_dt *dts);
+
+/**
+ * @brief The kernels of a step after the timestep, the Lagrangian phase, temporally blocked or not, the advection and
+ * reset_field(), as a single dataflow (see flow.h)
+ */
+extern void step_flow();
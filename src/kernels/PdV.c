@@ -27,145 +27,138 @@
 #include <stdbool.h>
 
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_pdv(
-    bool predict,
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    double dt,
-    double *xarea,
-    double *yarea,
-    double *volume,
-    double *density0,
-    double *density1,
-    double *energy0,
-    double *energy1,
-    double *pressure,
-    double *viscosity,
-    double *xvel0,
-    double *xvel1,
-    double *yvel0,
-    double *yvel1,
-    double *volume_change
-) {
+// Parameters of kernel_pdv() but predict, shared by its variants
+#define PDV_PARAMS                                                                                               \
+  int x_min, int x_max, int y_min, int y_max, double dt, double *xarea, double *yarea, double *volume,           \
+      double *density0, double *density1, double *energy0, double *energy1, double *pressure, double *viscosity, \
+      double *xvel0, double *xvel1, double *yvel0, double *yvel1, double *volume_change, double *vol_flux_x,     \
+      double *vol_flux_y, double uniform_volume, double uniform_xarea, double uniform_yarea
+
+#define PDV_ARGS                                                                              \
+  x_min, x_max, y_min, y_max, dt, xarea, yarea, volume, density0, density1, energy0, energy1, \
+      pressure, viscosity, xvel0, xvel1, yvel0, yvel1, volume_change, vol_flux_x, vol_flux_y, \
+      uniform_volume, uniform_xarea, uniform_yarea
+
+/**
+ * @brief Body of both variants of the kernel. The predictor moves the cells by half a step with the time level 0
+ * velocities, the corrector by a whole step with the average of both time levels. Always called with a constant
+ * predict: the corrector's time weight of 1 then folds away and each variant compiles to the loop nest it was written
+ * as, while a weight only known at run time could be contracted into different fused multiply-adds. Each variant
+ * inlines it once more by uniform, see geometry.h.
+ *
+ * The corrector also writes the volume fluxes through the faces of the tile, vol_flux_x and vol_flux_y, that the
+ * advection sweeps use, reusing the sums of the face velocities it loads anyway. They are the values flux_calc
+ * computes, bitwise, the predictor leaves them alone.
+ */
+static inline __attribute__((always_inline)) void pdv(const bool uniform, const bool predict, PDV_PARAMS) {
   int j, k;
   double recip_volume, energy_change, min_cell_volume, right_flux, left_flux, top_flux, bottom_flux, total_flux;
+  double left_vel, bottom_vel;
 
-  if (predict) {
-    for (k = y_min; k <= y_max; k++) {
+  double *xvel_end = predict ? xvel0 : xvel1;
+  double *yvel_end = predict ? yvel0 : yvel1;
+  double time_weight = predict ? 0.5 : 1.0;
+
+  for (k = y_min; k <= y_max; k++) {
 #pragma ivdep
-      for (j = x_min; j <= x_max; j++) {
-        left_flux = (xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)]) *
-                    (xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                     xvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                     xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                     xvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-                    0.25 * dt * 0.5;
-        right_flux = (xarea[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)]) *
-                     (xvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
-                      xvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                      xvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
-                      xvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-                     0.25 * dt * 0.5;
-        bottom_flux = (yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]) *
-                      (yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                       yvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
-                       yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                       yvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)]) *
-                      0.25 * dt * 0.5;
-        top_flux = (yarea[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)]) *
-                   (yvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                    yvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                    yvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                    yvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-                   0.25 * dt * 0.5;
-
-        total_flux = right_flux - left_flux + top_flux - bottom_flux;
-
-        volume_change[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-            (volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + total_flux);
-
-        min_cell_volume = MIN(
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + right_flux - left_flux + top_flux - bottom_flux,
-            MIN(volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + right_flux - left_flux,
-                volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + top_flux - bottom_flux)
-        );
-
-        recip_volume = 1.0 / volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
-
-        energy_change = (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-                             density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-                         viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-                             density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]) *
-                        total_flux * recip_volume;
-
-        energy1[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] - energy_change;
-
-        density1[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
-            volume_change[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)];
+    for (j = x_min; j <= x_max; j++) {
+      left_vel = xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
+                 xvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
+                 xvel_end[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
+                 xvel_end[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)];
+      left_flux = (XAREA(j, k)) * left_vel * 0.25 * dt * time_weight;
+      right_flux = (XAREA(j + 1, k)) *
+                   (xvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
+                    xvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
+                    xvel_end[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
+                    xvel_end[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
+                   0.25 * dt * time_weight;
+      bottom_vel = yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
+                   yvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
+                   yvel_end[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
+                   yvel_end[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)];
+      bottom_flux = (YAREA(j, k)) * bottom_vel * 0.25 * dt * time_weight;
+      top_flux = (YAREA(j, k + 1)) *
+                 (yvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
+                  yvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
+                  yvel_end[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
+                  yvel_end[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
+                 0.25 * dt * time_weight;
+
+      total_flux = right_flux - left_flux + top_flux - bottom_flux;
+
+      volume_change[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = VOLUME(j, k) / (VOLUME(j, k) + total_flux);
+
+      min_cell_volume =
+          MIN(VOLUME(j, k) + right_flux - left_flux + top_flux - bottom_flux,
+              MIN(VOLUME(j, k) + right_flux - left_flux, VOLUME(j, k) + top_flux - bottom_flux));
+
+      recip_volume = 1.0 / VOLUME(j, k);
+
+      energy_change = (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
+                           density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
+                       viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
+                           density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]) *
+                      total_flux * recip_volume;
+
+      energy1[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
+          energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] - energy_change;
+
+      density1[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
+          density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
+          volume_change[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)];
+
+      // The corrector's velocities are those of the advection's volume fluxes, evaluated as flux_calc does
+      if (!predict) {
+        vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = 0.25 * dt * XAREA(j, k) * left_vel;
+        vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = 0.25 * dt * YAREA(j, k) * bottom_vel;
       }
     }
-  } else {
-    for (k = y_min; k <= y_max; k++) {
+  }
+
+  if (predict)
+    return;
+
+  // The faces past the last column and row of cells
+  for (k = y_min; k <= y_max; k++) {
+    vol_flux_x[FTNREF2D(x_max + 1, k, x_max + 5, x_min - 2, y_min - 2)] =
+        0.25 * dt * XAREA(x_max + 1, k) *
+        (xvel0[FTNREF2D(x_max + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
+         xvel0[FTNREF2D(x_max + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
+         xvel1[FTNREF2D(x_max + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
+         xvel1[FTNREF2D(x_max + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]);
+  }
+
 #pragma ivdep
-      for (j = x_min; j <= x_max; j++) {
-        left_flux = (xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)]) *
-                    (xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                     xvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                     xvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                     xvel1[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-                    0.25 * dt;
-        right_flux = (xarea[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)]) *
-                     (xvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
-                      xvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                      xvel1[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
-                      xvel1[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-                     0.25 * dt;
-        bottom_flux = (yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]) *
-                      (yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                       yvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
-                       yvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-                       yvel1[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)]) *
-                      0.25 * dt;
-        top_flux = (yarea[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)]) *
-                   (yvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                    yvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                    yvel1[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
-                    yvel1[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-                   0.25 * dt;
-
-        total_flux = right_flux - left_flux + top_flux - bottom_flux;
-
-        volume_change[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-            (volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + total_flux);
-
-        min_cell_volume = MIN(
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + right_flux - left_flux + top_flux - bottom_flux,
-            MIN(volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + right_flux - left_flux,
-                volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] + top_flux - bottom_flux)
-        );
-
-        recip_volume = 1.0 / volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
-
-        energy_change = (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-                             density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-                         viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-                             density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]) *
-                        total_flux * recip_volume;
-
-        energy1[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] - energy_change;
-
-        density1[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
-            volume_change[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
+  for (j = x_min; j <= x_max; j++) {
+    vol_flux_y[FTNREF2D(j, y_max + 1, x_max + 4, x_min - 2, y_min - 2)] =
+        0.25 * dt * YAREA(j, y_max + 1) *
+        (yvel0[FTNREF2D(j, y_max + 1, x_max + 5, x_min - 2, y_min - 2)] +
+         yvel0[FTNREF2D(j + 1, y_max + 1, x_max + 5, x_min - 2, y_min - 2)] +
+         yvel1[FTNREF2D(j, y_max + 1, x_max + 5, x_min - 2, y_min - 2)] +
+         yvel1[FTNREF2D(j + 1, y_max + 1, x_max + 5, x_min - 2, y_min - 2)]);
   }
 }
+
+#define PDV_VARIANT(name, predict)   \
+  static void name(PDV_PARAMS) {     \
+    if (volume == NULL)              \
+      pdv(true, predict, PDV_ARGS);  \
+    else                             \
+      pdv(false, predict, PDV_ARGS); \
+  }
+
+PDV_VARIANT(pdv_correct, false)
+PDV_VARIANT(pdv_predict, true)
+
+// A pdv_kernel table, see kernels.h
+void (*const kernel_pdv_variants[2])(PDV_PARAMS) = {pdv_correct, pdv_predict};
+
+void kernel_pdv(bool predict, PDV_PARAMS) {
+  if (predict)
+    pdv_predict(PDV_ARGS);
+  else
+    pdv_correct(PDV_ARGS);
+}
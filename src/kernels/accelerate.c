@@ -23,24 +23,22 @@
  */
 
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_accelerate(
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    double dt,
-    double *xarea,
-    double *yarea,
-    double *volume,
-    double *density0,
-    double *pressure,
-    double *viscosity,
-    double *xvel0,
-    double *yvel0,
-    double *xvel1,
-    double *yvel1
-) {
+// Parameters of kernel_accelerate()
+#define ACCELERATE_PARAMS                                                                                 \
+  int x_min, int x_max, int y_min, int y_max, double dt, double *xarea, double *yarea, double *volume,    \
+      double *density0, double *pressure, double *viscosity, double *xvel0, double *yvel0, double *xvel1, \
+      double *yvel1, double uniform_volume, double uniform_xarea, double uniform_yarea
+
+#define ACCELERATE_ARGS                                                                                            \
+  x_min, x_max, y_min, y_max, dt, xarea, yarea, volume, density0, pressure, viscosity, xvel0, yvel0, xvel1, yvel1, \
+      uniform_volume, uniform_xarea, uniform_yarea
+
+/**
+ * @brief Body of the kernel, inlined with a constant uniform, see geometry.h
+ */
+static inline __attribute__((always_inline)) void accelerate(const bool uniform, ACCELERATE_PARAMS) {
   int j, k, err;
   double nodal_mass;
   double stepby_mass_s;
@@ -48,51 +46,65 @@ void kernel_accelerate(
   for (k = y_min; k <= y_max + 1; k++) {
 #pragma ivdep
     for (j = x_min; j <= x_max + 1; j++) {
-      nodal_mass = (density0[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)] *
-                        volume[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)] +
-                    density0[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] *
-                        volume[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] +
-                    density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
-                        volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-                    density0[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] *
-                        volume[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)]) *
+      nodal_mass = (density0[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)] * VOLUME(j - 1, k - 1) +
+                    density0[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] * VOLUME(j, k - 1) +
+                    density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] * VOLUME(j, k) +
+                    density0[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] * VOLUME(j - 1, k)) *
                    0.25;
       stepby_mass_s = 0.5 * dt / nodal_mass;
       xvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
           xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] -
-          stepby_mass_s * (xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] *
-                               (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
-                                pressure[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)]) +
-                           xarea[FTNREF2D(j, k - 1, x_max + 5, x_min - 2, y_min - 2)] *
-                               (pressure[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] -
-                                pressure[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
+          stepby_mass_s * (XAREA(j, k) * (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
+                                          pressure[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)]) +
+                           XAREA(j, k - 1) * (pressure[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] -
+                                              pressure[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
 
       yvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
           yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] -
-          stepby_mass_s * (yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
-                               (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
-                                pressure[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)]) +
-                           yarea[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] *
-                               (pressure[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] -
-                                pressure[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
+          stepby_mass_s * (YAREA(j, k) * (pressure[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
+                                          pressure[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)]) +
+                           YAREA(j - 1, k) * (pressure[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] -
+                                              pressure[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
 
       xvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
           xvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] -
-          stepby_mass_s * (xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] *
-                               (viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
-                                viscosity[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)]) +
-                           xarea[FTNREF2D(j, k - 1, x_max + 5, x_min - 2, y_min - 2)] *
-                               (viscosity[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] -
-                                viscosity[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
+          stepby_mass_s * (XAREA(j, k) * (viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
+                                          viscosity[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)]) +
+                           XAREA(j, k - 1) * (viscosity[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)] -
+                                              viscosity[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
 
       yvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
           yvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] -
-          stepby_mass_s * (yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
-                               (viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
-                                viscosity[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)]) +
-                           yarea[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] *
-                               (viscosity[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] -
-                                viscosity[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
+          stepby_mass_s * (YAREA(j, k) * (viscosity[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] -
+                                          viscosity[FTNREF2D(j, k - 1, x_max + 4, x_min - 2, y_min - 2)]) +
+                           YAREA(j - 1, k) * (viscosity[FTNREF2D(j - 1, k, x_max + 4, x_min - 2, y_min - 2)] -
+                                              viscosity[FTNREF2D(j - 1, k - 1, x_max + 4, x_min - 2, y_min - 2)]));
     }
   }
 }
+
+void kernel_accelerate(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double dt,
+    double *xarea,
+    double *yarea,
+    double *volume,
+    double *density0,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *yvel0,
+    double *xvel1,
+    double *yvel1,
+    double uniform_volume,
+    double uniform_xarea,
+    double uniform_yarea
+) {
+  if (volume == NULL)
+    accelerate(true, ACCELERATE_ARGS);
+  else
+    accelerate(false, ACCELERATE_ARGS);
+}
@@ -26,30 +26,25 @@
 
 #include "data.h"
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_advec_cell(
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    int dir,
-    int sweep_number,
-    double *vertexdx,
-    double *vertexdy,
-    double *volume,
-    double *density1,
-    double *energy1,
-    double *mass_flux_x,
-    double *vol_flux_x,
-    double *mass_flux_y,
-    double *vol_flux_y,
-    double *pre_vol,
-    double *post_vol,
-    double *pre_mass,
-    double *post_mass,
-    double *advec_vol,
-    double *post_ener,
-    double *ener_flux
+// Parameters of kernel_advec_cell() but the sweep, shared by its variants
+#define ADVEC_CELL_PARAMS                                                                                           \
+  int x_min, int x_max, int y_min, int y_max, double *vertexdx, double *vertexdy, double *volume, double *density1, \
+      double *energy1, double *mass_flux_x, double *vol_flux_x, double *mass_flux_y, double *vol_flux_y,            \
+      double *pre_vol, double *post_vol, double *pre_mass, double *post_mass, double *advec_vol, double *post_ener, \
+      double *ener_flux, double uniform_volume
+
+#define ADVEC_CELL_ARGS                                                                                            \
+  x_min, x_max, y_min, y_max, vertexdx, vertexdy, volume, density1, energy1, mass_flux_x, vol_flux_x, mass_flux_y, \
+      vol_flux_y, pre_vol, post_vol, pre_mass, post_mass, advec_vol, post_ener, ener_flux, uniform_volume
+
+/**
+ * @brief Body of every variant of the kernel, inlined with a constant direction and sweep number so that each variant
+ * only keeps the loops of its own sweep
+ */
+static inline __attribute__((always_inline)) void advec_cell(
+    const bool uniform, const int dir, const int sweep_number, ADVEC_CELL_PARAMS
 ) {
   int j, k, upwind, donor, downwind, dif;
 
@@ -64,11 +59,10 @@ void kernel_advec_cell(
 #pragma ivdep
         for (j = x_min - 2; j <= x_max + 2; j++) {
           pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-              volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-              (vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
-               vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
-               vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
-               vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]);
+              VOLUME(j, k) + (vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
+                              vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
+                              vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
+                              vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]);
           post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
               pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] -
               (vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
@@ -81,11 +75,9 @@ void kernel_advec_cell(
 #pragma ivdep
         for (j = x_min - 2; j <= x_max + 2; j++) {
           pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-              volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-              vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
+              VOLUME(j, k) + vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
               vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)];
-          post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-              volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
+          post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = VOLUME(j, k);
         }
       }
     }
@@ -182,11 +174,10 @@ void kernel_advec_cell(
 #pragma ivdep
         for (j = x_min - 2; j <= x_max + 2; j++) {
           pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-              volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-              (vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
-               vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-               vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
-               vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)]);
+              VOLUME(j, k) + (vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
+                              vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
+                              vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
+                              vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)]);
           post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
               pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] -
               (vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
@@ -199,11 +190,9 @@ void kernel_advec_cell(
 #pragma ivdep
         for (j = x_min - 2; j <= x_max + 2; j++) {
           pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-              volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-              vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
+              VOLUME(j, k) + vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
               vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
-          post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-              volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
+          post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = VOLUME(j, k);
         }
       }
     }
@@ -296,3 +285,53 @@ void kernel_advec_cell(
     }
   }
 }
+
+#define ADVEC_CELL_VARIANT(name, dir, sweep_number)          \
+  static void name(ADVEC_CELL_PARAMS) {                      \
+    if (volume == NULL)                                      \
+      advec_cell(true, dir, sweep_number, ADVEC_CELL_ARGS);  \
+    else                                                     \
+      advec_cell(false, dir, sweep_number, ADVEC_CELL_ARGS); \
+  }
+
+ADVEC_CELL_VARIANT(advec_cell_x1, G_XDIR, 1)
+ADVEC_CELL_VARIANT(advec_cell_x2, G_XDIR, 2)
+ADVEC_CELL_VARIANT(advec_cell_y1, G_YDIR, 1)
+ADVEC_CELL_VARIANT(advec_cell_y2, G_YDIR, 2)
+
+// An advec_cell_kernel table, see kernels.h
+void (*const kernel_advec_cell_variants[2][2])(ADVEC_CELL_PARAMS) = {
+    {advec_cell_x1, advec_cell_x2},
+    {advec_cell_y1, advec_cell_y2},
+};
+
+void kernel_advec_cell(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    int dir,
+    int sweep_number,
+    double *vertexdx,
+    double *vertexdy,
+    double *volume,
+    double *density1,
+    double *energy1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *pre_vol,
+    double *post_vol,
+    double *pre_mass,
+    double *post_mass,
+    double *advec_vol,
+    double *post_ener,
+    double *ener_flux,
+    double uniform_volume
+) {
+  if (volume == NULL)
+    advec_cell(true, dir, sweep_number, ADVEC_CELL_ARGS);
+  else
+    advec_cell(false, dir, sweep_number, ADVEC_CELL_ARGS);
+}
@@ -27,30 +27,25 @@
 #include <math.h>
 
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_advec_mom(
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    double *vel1,
-    double *mass_flux_x,
-    double *vol_flux_x,
-    double *mass_flux_y,
-    double *vol_flux_y,
-    double *volume,
-    double *density1,
-    double *node_flux,
-    double *node_mass_post,
-    double *node_mass_pre,
-    double *mom_flux,
-    double *pre_vol,
-    double *post_vol,
-    double *celldx,
-    double *celldy,
-    int which_vel,
-    int sweep_number,
-    int direction
+// Parameters of kernel_advec_mom() but the sweep, shared by its variants
+#define ADVEC_MOM_PARAMS                                                                                  \
+  int x_min, int x_max, int y_min, int y_max, double *vel1, double *mass_flux_x, double *vol_flux_x,      \
+      double *mass_flux_y, double *vol_flux_y, double *volume, double *density1, double *node_flux,       \
+      double *node_mass_post, double *node_mass_pre, double *mom_flux, double *pre_vol, double *post_vol, \
+      double *celldx, double *celldy, double uniform_volume
+
+#define ADVEC_MOM_ARGS                                                                                             \
+  x_min, x_max, y_min, y_max, vel1, mass_flux_x, vol_flux_x, mass_flux_y, vol_flux_y, volume, density1, node_flux, \
+      node_mass_post, node_mass_pre, mom_flux, pre_vol, post_vol, celldx, celldy, uniform_volume
+
+/**
+ * @brief Body of every variant of the kernel, inlined with a constant direction and sweep number so that each variant
+ * only keeps the loops of its own sweep. which_vel is unused, both velocities are advected alike.
+ */
+static inline __attribute__((always_inline)) void advec_mom(
+    const bool uniform, const int sweep_number, const int direction, ADVEC_MOM_PARAMS
 ) {
   int j, k, mom_sweep;
   int upwind, donor, downwind, dif;
@@ -66,8 +61,7 @@ void kernel_advec_mom(
 #pragma ivdep
       for (j = x_min - 2; j <= x_max + 2; j++) {
         post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-            vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
+            VOLUME(j, k) + vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
             vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
         pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
             post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
@@ -80,8 +74,7 @@ void kernel_advec_mom(
 #pragma ivdep
       for (j = x_min - 2; j <= x_max + 2; j++) {
         post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] +
-            vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
+            VOLUME(j, k) + vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
             vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)];
         pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
             post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
@@ -93,8 +86,7 @@ void kernel_advec_mom(
     for (k = y_min - 2; k <= y_max + 2; k++) {
 #pragma ivdep
       for (j = x_min - 2; j <= x_max + 2; j++) {
-        post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
+        post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = VOLUME(j, k);
         pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
             post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
             vol_flux_y[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)] -
@@ -105,8 +97,7 @@ void kernel_advec_mom(
     for (k = y_min - 2; k <= y_max + 2; k++) {
 #pragma ivdep
       for (j = x_min - 2; j <= x_max + 2; j++) {
-        post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
+        post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = VOLUME(j, k);
         pre_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
             post_vol[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
             vol_flux_x[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] -
@@ -289,3 +280,53 @@ void kernel_advec_mom(
     }
   }
 }
+
+#define ADVEC_MOM_VARIANT(name, sweep_number, direction)         \
+  static void name(ADVEC_MOM_PARAMS) {                           \
+    if (volume == NULL)                                          \
+      advec_mom(true, sweep_number, direction, ADVEC_MOM_ARGS);  \
+    else                                                         \
+      advec_mom(false, sweep_number, direction, ADVEC_MOM_ARGS); \
+  }
+
+ADVEC_MOM_VARIANT(advec_mom_x1, 1, 1)
+ADVEC_MOM_VARIANT(advec_mom_x2, 2, 1)
+ADVEC_MOM_VARIANT(advec_mom_y1, 1, 2)
+ADVEC_MOM_VARIANT(advec_mom_y2, 2, 2)
+
+// An advec_mom_kernel table, see kernels.h
+void (*const kernel_advec_mom_variants[2][2])(ADVEC_MOM_PARAMS) = {
+    {advec_mom_x1, advec_mom_x2},
+    {advec_mom_y1, advec_mom_y2},
+};
+
+void kernel_advec_mom(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *vel1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *volume,
+    double *density1,
+    double *node_flux,
+    double *node_mass_post,
+    double *node_mass_pre,
+    double *mom_flux,
+    double *pre_vol,
+    double *post_vol,
+    double *celldx,
+    double *celldy,
+    double uniform_volume,
+    int which_vel,
+    int sweep_number,
+    int direction
+) {
+  if (volume == NULL)
+    advec_mom(true, sweep_number, direction, ADVEC_MOM_ARGS);
+  else
+    advec_mom(false, sweep_number, direction, ADVEC_MOM_ARGS);
+}
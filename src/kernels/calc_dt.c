@@ -28,40 +28,25 @@
 
 #include "data.h"
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_calc_dt(
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    double min_dt,
-    double dtc_safe,
-    double dtu_safe,
-    double dtv_safe,
-    double dtdiv_safe,
-    double *xarea,
-    double *yarea,
-    double *cellx,
-    double *celly,
-    double *celldx,
-    double *celldy,
-    double *volume,
-    double *density0,
-    double *energy0,
-    double *pressure,
-    double *viscosity,
-    double *soundspeed,
-    double *xvel0,
-    double *yvel0,
-    double *dt_min,
-    double *dtminval,
-    int *dtlcontrol,
-    double *xlpos,
-    double *ylpos,
-    int *jldt,
-    int *kldt,
-    int small
-) {
+// Parameters of kernel_calc_dt()
+#define CALC_DT_PARAMS                                                                                               \
+  int x_min, int x_max, int y_min, int y_max, double min_dt, double dtc_safe, double dtu_safe, double dtv_safe,      \
+      double dtdiv_safe, double *xarea, double *yarea, double *cellx, double *celly, double *celldx, double *celldy, \
+      double *volume, double *density0, double *energy0, double *pressure, double *viscosity, double *soundspeed,    \
+      double *xvel0, double *yvel0, double *dt_min, double *dtminval, int *dtlcontrol, double *xlpos, double *ylpos, \
+      int *jldt, int *kldt, int small, double uniform_volume, double uniform_xarea, double uniform_yarea
+
+#define CALC_DT_ARGS                                                                                                  \
+  x_min, x_max, y_min, y_max, min_dt, dtc_safe, dtu_safe, dtv_safe, dtdiv_safe, xarea, yarea, cellx, celly, celldx,   \
+      celldy, volume, density0, energy0, pressure, viscosity, soundspeed, xvel0, yvel0, dt_min, dtminval, dtlcontrol, \
+      xlpos, ylpos, jldt, kldt, small, uniform_volume, uniform_xarea, uniform_yarea
+
+/**
+ * @brief Body of the kernel, inlined with a constant uniform, see geometry.h
+ */
+static inline __attribute__((always_inline)) void calc_dt(const bool uniform, CALC_DT_PARAMS) {
   double dt_min_val = *dtminval;
   int dtl_control = *dtlcontrol;
   double xl_pos = *xlpos;
@@ -96,29 +81,27 @@ void kernel_calc_dt(
 
       dv1 = (xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
              xvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-            xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)];
+            XAREA(j, k);
       dv2 = (xvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
              xvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-            xarea[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)];
+            XAREA(j + 1, k);
 
       div = div + dv2 - dv1;
 
-      dtut = dtu_safe * 2.0 * volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-             MAX(fabs(dv1), MAX(fabs(dv2), G_SMALL * volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]));
+      dtut = dtu_safe * 2.0 * VOLUME(j, k) / MAX(fabs(dv1), MAX(fabs(dv2), G_SMALL * VOLUME(j, k)));
 
       dv1 = (yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
              yvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)]) *
-            yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
+            YAREA(j, k);
       dv2 = (yvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
              yvel0[FTNREF2D(j + 1, k + 1, x_max + 5, x_min - 2, y_min - 2)]) *
-            yarea[FTNREF2D(j, k + 1, x_max + 4, x_min - 2, y_min - 2)];
+            YAREA(j, k + 1);
 
       div = div + dv2 - dv1;
 
-      dtvt = dtv_safe * 2.0 * volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] /
-             MAX(fabs(dv1), MAX(fabs(dv2), G_SMALL * volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]));
+      dtvt = dtv_safe * 2.0 * VOLUME(j, k) / MAX(fabs(dv1), MAX(fabs(dv2), G_SMALL * VOLUME(j, k)));
 
-      div = div / (2.0 * volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]);
+      div = div / (2.0 * VOLUME(j, k));
 
       if (div < -G_SMALL) {
         dtdivt = dtdiv_safe * (-1.0 / div);
@@ -192,3 +175,45 @@ void kernel_calc_dt(
     );
   }
 }
+
+void kernel_calc_dt(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double min_dt,
+    double dtc_safe,
+    double dtu_safe,
+    double dtv_safe,
+    double dtdiv_safe,
+    double *xarea,
+    double *yarea,
+    double *cellx,
+    double *celly,
+    double *celldx,
+    double *celldy,
+    double *volume,
+    double *density0,
+    double *energy0,
+    double *pressure,
+    double *viscosity,
+    double *soundspeed,
+    double *xvel0,
+    double *yvel0,
+    double *dt_min,
+    double *dtminval,
+    int *dtlcontrol,
+    double *xlpos,
+    double *ylpos,
+    int *jldt,
+    int *kldt,
+    int small,
+    double uniform_volume,
+    double uniform_xarea,
+    double uniform_yarea
+) {
+  if (volume == NULL)
+    calc_dt(true, CALC_DT_ARGS);
+  else
+    calc_dt(false, CALC_DT_ARGS);
+}
@@ -0,0 +1,929 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief C ensemble kernels
+ * @details Lane-wise versions of the hydro kernels, see ensemble.h for the data layout. Each kernel performs exactly the
+ * same floating point operations as its single problem counterpart, so every lane reproduces the results of a normal
+ * run of its member. Data dependent branches, like the upwind selection in the advection kernels, are turned into
+ * per-lane selections between values loaded unconditionally, which keeps the lane loops vectorisable.
+ */
+
+#include "ensemble.h"
+
+#include <math.h>
+
+#include "data.h"
+#include "ftocmacros.h"
+
+// Shorthands for lane e of cell centred and vertex fields, and of the 1D geometry arrays
+#define CELL(a, j, k) a[ENSEMBLE_REF2D(e, j, k, x_max + 4, x_min - 2, y_min - 2)]
+#define NODE(a, j, k) a[ENSEMBLE_REF2D(e, j, k, x_max + 5, x_min - 2, y_min - 2)]
+#define XLINE(a, j) a[ENSEMBLE_REF1D(e, j, x_min - 2)]
+#define YLINE(a, k) a[ENSEMBLE_REF1D(e, k, y_min - 2)]
+
+void kernel_ensemble_ideal_gas(
+    int x_min, int x_max, int y_min, int y_max, double *density, double *energy, double *pressure, double *soundspeed
+) {
+  int j, k, e;
+  double sound_speed_squared, v, pressurebyenergy, pressurebyvolume;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        v = 1.0 / CELL(density, j, k);
+        CELL(pressure, j, k) = (1.4 - 1.0) * CELL(density, j, k) * CELL(energy, j, k);
+        pressurebyenergy = (1.4 - 1.0) * CELL(density, j, k);
+        pressurebyvolume = -CELL(density, j, k) * CELL(pressure, j, k);
+        sound_speed_squared = v * v * (CELL(pressure, j, k) * pressurebyenergy - pressurebyvolume);
+        CELL(soundspeed, j, k) = sqrt(sound_speed_squared);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Applies the reflective boundary conditions of kernel_update_halo to one field of a single tile chunk
+ * @details The kind of the field along each direction gives the halo indexing, the sign is applied to the mirrored
+ * values: velocities and fluxes change sign on the boundaries normal to them.
+ */
+void kernel_ensemble_update_halo(
+    int x_min, int x_max, int y_min, int y_max, double *field, int x_kind, int y_kind, double x_sign, double y_sign,
+    int depth
+) {
+  int j, k, e;
+
+  // Mirror offsets: the low halo copies from lo_src + i, the high halo writes max + hi_dst + i from max + hi_src - i
+  const int lo_src[] = {0, 1, 1};
+  const int hi_dst[] = {0, 1, 0};
+  const int hi_src[] = {1, 1, 0};
+
+  const int x_ext = x_kind == ENSEMBLE_HALO_NODE;
+  const int y_ext = y_kind == ENSEMBLE_HALO_NODE;
+  const int x_size = x_max + 4 + x_ext;
+
+#define HALO(j, k) field[ENSEMBLE_REF2D(e, j, k, x_size, x_min - 2, y_min - 2)]
+
+  for (j = x_min - depth; j <= x_max + x_ext + depth; j++) {
+    for (k = 1; k <= depth; k++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        HALO(j, 1 - k) = y_sign * HALO(j, lo_src[y_kind] + k);
+      }
+    }
+  }
+
+  for (j = x_min - depth; j <= x_max + x_ext + depth; j++) {
+    for (k = 1; k <= depth; k++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        HALO(j, y_max + hi_dst[y_kind] + k) = y_sign * HALO(j, y_max + hi_src[y_kind] - k);
+      }
+    }
+  }
+
+  for (k = y_min - depth; k <= y_max + y_ext + depth; k++) {
+    for (j = 1; j <= depth; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        HALO(1 - j, k) = x_sign * HALO(lo_src[x_kind] + j, k);
+      }
+    }
+  }
+
+  for (k = y_min - depth; k <= y_max + y_ext + depth; k++) {
+    for (j = 1; j <= depth; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        HALO(x_max + hi_dst[x_kind] + j, k) = x_sign * HALO(x_max + hi_src[x_kind] - j, k);
+      }
+    }
+  }
+
+#undef HALO
+}
+
+void kernel_ensemble_viscosity(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *celldx,
+    double *celldy,
+    double *density0,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *yvel0
+) {
+  int j, k, e;
+  double ugrad, vgrad, grad2, pgradx, pgrady, pgradx2, pgrady2, grad, ygrad, pgrad, xgrad, div, strain2, limiter;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        ugrad = (NODE(xvel0, j + 1, k) + NODE(xvel0, j + 1, k + 1)) - (NODE(xvel0, j, k) + NODE(xvel0, j, k + 1));
+
+        vgrad = (NODE(yvel0, j, k + 1) + NODE(yvel0, j + 1, k + 1)) - (NODE(yvel0, j, k) + NODE(yvel0, j + 1, k));
+
+        div = (XLINE(celldx, j) * (ugrad) + YLINE(celldy, k) * (vgrad));
+
+        strain2 = 0.5 * (NODE(xvel0, j, k + 1) + NODE(xvel0, j + 1, k + 1) - NODE(xvel0, j, k) - NODE(xvel0, j + 1, k)) /
+                      YLINE(celldy, k) +
+                  0.5 * (NODE(yvel0, j + 1, k) + NODE(yvel0, j + 1, k + 1) - NODE(yvel0, j, k) - NODE(yvel0, j, k + 1)) /
+                      XLINE(celldx, j);
+
+        pgradx = (CELL(pressure, j + 1, k) - CELL(pressure, j - 1, k)) / (XLINE(celldx, j) + XLINE(celldx, j + 1));
+        pgrady = (CELL(pressure, j, k + 1) - CELL(pressure, j, k - 1)) / (YLINE(celldy, k) + YLINE(celldy, k + 1));
+
+        pgradx2 = pgradx * pgradx;
+        pgrady2 = pgrady * pgrady;
+
+        limiter = ((0.5 * (ugrad) / XLINE(celldx, j)) * pgradx2 + (0.5 * (vgrad) / YLINE(celldy, k)) * pgrady2 +
+                   strain2 * pgradx * pgrady) /
+                  MAX(pgradx2 + pgrady2, 1.0e-16);
+
+        pgradx = SIGN(MAX(1.0e-16, fabs(pgradx)), pgradx);
+        pgrady = SIGN(MAX(1.0e-16, fabs(pgrady)), pgrady);
+        pgrad = sqrt(pgradx * pgradx + pgrady * pgrady);
+        xgrad = fabs(XLINE(celldx, j) * pgrad / pgradx);
+        ygrad = fabs(YLINE(celldy, k) * pgrad / pgrady);
+        grad = MIN(xgrad, ygrad);
+        grad2 = grad * grad;
+
+        CELL(viscosity, j, k) =
+            (limiter > 0.0 || div >= 0.0) ? 0.0 : 2.0 * CELL(density0, j, k) * grad2 * limiter * limiter;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Computes the minimum timestep of each lane
+ * @details The reported location is derived the same way as in kernel_calc_dt, so that the timestep lines of an
+ * ensemble member match the ones of a normal run.
+ */
+void kernel_ensemble_calc_dt(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dtc_safe,
+    double *dtu_safe,
+    double *dtv_safe,
+    double *dtdiv_safe,
+    double *xarea,
+    double *yarea,
+    double *cellx,
+    double *celly,
+    double *celldx,
+    double *celldy,
+    double *volume,
+    double *density0,
+    double *viscosity,
+    double *soundspeed,
+    double *xvel0,
+    double *yvel0,
+    double *dt_min,
+    double *dtminval,
+    double *xlpos,
+    double *ylpos,
+    int *jldt,
+    int *kldt
+) {
+  int j, k, e;
+  int j_ldt, k_ldt;
+
+  double div, dsx, dsy, dtut, dtvt, dtct, dtdivt, cc, dv1, dv2, jk_control;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        dsx = XLINE(celldx, j);
+        dsy = YLINE(celldy, k);
+
+        cc = CELL(soundspeed, j, k) * CELL(soundspeed, j, k);
+        cc = cc + 2.0 * CELL(viscosity, j, k) / CELL(density0, j, k);
+        cc = MAX(sqrt(cc), G_SMALL);
+
+        dtct = dtc_safe[e] * MIN(dsx, dsy) / cc;
+
+        div = 0.0;
+
+        dv1 = (NODE(xvel0, j, k) + NODE(xvel0, j, k + 1)) * NODE(xarea, j, k);
+        dv2 = (NODE(xvel0, j + 1, k) + NODE(xvel0, j + 1, k + 1)) * NODE(xarea, j + 1, k);
+
+        div = div + dv2 - dv1;
+
+        dtut = dtu_safe[e] * 2.0 * CELL(volume, j, k) /
+               MAX(fabs(dv1), MAX(fabs(dv2), G_SMALL * CELL(volume, j, k)));
+
+        dv1 = (NODE(yvel0, j, k) + NODE(yvel0, j + 1, k)) * CELL(yarea, j, k);
+        dv2 = (NODE(yvel0, j, k + 1) + NODE(yvel0, j + 1, k + 1)) * CELL(yarea, j, k + 1);
+
+        div = div + dv2 - dv1;
+
+        dtvt = dtv_safe[e] * 2.0 * CELL(volume, j, k) /
+               MAX(fabs(dv1), MAX(fabs(dv2), G_SMALL * CELL(volume, j, k)));
+
+        div = div / (2.0 * CELL(volume, j, k));
+
+        dtdivt = div < -G_SMALL ? dtdiv_safe[e] * (-1.0 / div) : G_BIG;
+
+        NODE(dt_min, j, k) = MIN(dtct, MIN(dtut, MIN(dtvt, dtdivt)));
+      }
+    }
+  }
+
+  for (e = 0; e < ENSEMBLE_WIDTH; e++)
+    dtminval[e] = G_BIG;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        dtminval[e] = MIN(dtminval[e], NODE(dt_min, j, k));
+      }
+    }
+  }
+
+  // Extract the mimimum timestep information
+  jk_control = 1.1;
+  jk_control = jk_control - (jk_control - (int)(jk_control));
+  j_ldt = (int)jk_control % x_max;
+  k_ldt = 1 + (jk_control / x_max);
+
+  for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+    xlpos[e] = XLINE(cellx, j_ldt);
+    ylpos[e] = YLINE(celly, j_ldt);
+    jldt[e] = j_ldt;
+    kldt[e] = k_ldt;
+  }
+}
+
+void kernel_ensemble_pdv(
+    bool predict,
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dt,
+    double *xarea,
+    double *yarea,
+    double *volume,
+    double *density0,
+    double *density1,
+    double *energy0,
+    double *energy1,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *xvel1,
+    double *yvel0,
+    double *yvel1,
+    double *volume_change
+) {
+  int j, k, e;
+  double recip_volume, energy_change, right_flux, left_flux, top_flux, bottom_flux, total_flux;
+
+  // The predictor uses the start of step velocities for both time levels, over half the timestep
+  double *xvel_end = predict ? xvel0 : xvel1;
+  double *yvel_end = predict ? yvel0 : yvel1;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        left_flux = (NODE(xarea, j, k)) *
+                    (NODE(xvel0, j, k) + NODE(xvel0, j, k + 1) + NODE(xvel_end, j, k) + NODE(xvel_end, j, k + 1)) *
+                    0.25 * dt[e];
+        right_flux = (NODE(xarea, j + 1, k)) *
+                     (NODE(xvel0, j + 1, k) + NODE(xvel0, j + 1, k + 1) + NODE(xvel_end, j + 1, k) +
+                      NODE(xvel_end, j + 1, k + 1)) *
+                     0.25 * dt[e];
+        bottom_flux = (CELL(yarea, j, k)) *
+                      (NODE(yvel0, j, k) + NODE(yvel0, j + 1, k) + NODE(yvel_end, j, k) + NODE(yvel_end, j + 1, k)) *
+                      0.25 * dt[e];
+        top_flux = (CELL(yarea, j, k + 1)) *
+                   (NODE(yvel0, j, k + 1) + NODE(yvel0, j + 1, k + 1) + NODE(yvel_end, j, k + 1) +
+                    NODE(yvel_end, j + 1, k + 1)) *
+                   0.25 * dt[e];
+
+        if (predict) {
+          left_flux = left_flux * 0.5;
+          right_flux = right_flux * 0.5;
+          bottom_flux = bottom_flux * 0.5;
+          top_flux = top_flux * 0.5;
+        }
+
+        total_flux = right_flux - left_flux + top_flux - bottom_flux;
+
+        NODE(volume_change, j, k) = CELL(volume, j, k) / (CELL(volume, j, k) + total_flux);
+
+        recip_volume = 1.0 / CELL(volume, j, k);
+
+        energy_change = (CELL(pressure, j, k) / CELL(density0, j, k) + CELL(viscosity, j, k) / CELL(density0, j, k)) *
+                        total_flux * recip_volume;
+
+        CELL(energy1, j, k) = CELL(energy0, j, k) - energy_change;
+
+        CELL(density1, j, k) = CELL(density0, j, k) * NODE(volume_change, j, k);
+      }
+    }
+  }
+}
+
+void kernel_ensemble_accelerate(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dt,
+    double *xarea,
+    double *yarea,
+    double *volume,
+    double *density0,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *yvel0,
+    double *xvel1,
+    double *yvel1
+) {
+  int j, k, e;
+  double nodal_mass;
+  double stepby_mass_s;
+
+  for (k = y_min; k <= y_max + 1; k++) {
+    for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        nodal_mass = (CELL(density0, j - 1, k - 1) * CELL(volume, j - 1, k - 1) +
+                      CELL(density0, j, k - 1) * CELL(volume, j, k - 1) + CELL(density0, j, k) * CELL(volume, j, k) +
+                      CELL(density0, j - 1, k) * CELL(volume, j - 1, k)) *
+                     0.25;
+        stepby_mass_s = 0.5 * dt[e] / nodal_mass;
+
+        NODE(xvel1, j, k) = NODE(xvel0, j, k) -
+                            stepby_mass_s * (NODE(xarea, j, k) * (CELL(pressure, j, k) - CELL(pressure, j - 1, k)) +
+                                             NODE(xarea, j, k - 1) *
+                                                 (CELL(pressure, j, k - 1) - CELL(pressure, j - 1, k - 1)));
+
+        NODE(yvel1, j, k) = NODE(yvel0, j, k) -
+                            stepby_mass_s * (CELL(yarea, j, k) * (CELL(pressure, j, k) - CELL(pressure, j, k - 1)) +
+                                             CELL(yarea, j - 1, k) *
+                                                 (CELL(pressure, j - 1, k) - CELL(pressure, j - 1, k - 1)));
+
+        NODE(xvel1, j, k) = NODE(xvel1, j, k) -
+                            stepby_mass_s * (NODE(xarea, j, k) * (CELL(viscosity, j, k) - CELL(viscosity, j - 1, k)) +
+                                             NODE(xarea, j, k - 1) *
+                                                 (CELL(viscosity, j, k - 1) - CELL(viscosity, j - 1, k - 1)));
+
+        NODE(yvel1, j, k) = NODE(yvel1, j, k) -
+                            stepby_mass_s * (CELL(yarea, j, k) * (CELL(viscosity, j, k) - CELL(viscosity, j, k - 1)) +
+                                             CELL(yarea, j - 1, k) *
+                                                 (CELL(viscosity, j - 1, k) - CELL(viscosity, j - 1, k - 1)));
+      }
+    }
+  }
+}
+
+void kernel_ensemble_flux_calc(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dt,
+    double *xarea,
+    double *yarea,
+    double *xvel0,
+    double *yvel0,
+    double *xvel1,
+    double *yvel1,
+    double *vol_flux_x,
+    double *vol_flux_y
+) {
+  int j, k, e;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        NODE(vol_flux_x, j, k) =
+            0.25 * dt[e] * NODE(xarea, j, k) *
+            (NODE(xvel0, j, k) + NODE(xvel0, j, k + 1) + NODE(xvel1, j, k) + NODE(xvel1, j, k + 1));
+      }
+    }
+  }
+
+  for (k = y_min; k <= y_max + 1; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        CELL(vol_flux_y, j, k) =
+            0.25 * dt[e] * CELL(yarea, j, k) *
+            (NODE(yvel0, j, k) + NODE(yvel0, j + 1, k) + NODE(yvel1, j, k) + NODE(yvel1, j + 1, k));
+      }
+    }
+  }
+}
+
+/**
+ * @brief Van Leer limited advection of density and energy, see kernel_advec_cell
+ * @details The donor, upwind and downwind cells depend on the sign of each lane's flux, so the candidate values for
+ * both signs are loaded and the lane picks its own.
+ */
+void kernel_ensemble_advec_cell(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    int dir,
+    int sweep_number,
+    double *vertexdx,
+    double *vertexdy,
+    double *volume,
+    double *density1,
+    double *energy1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *pre_vol,
+    double *post_vol,
+    double *pre_mass,
+    double *post_mass,
+    double *advec_vol,
+    double *post_ener,
+    double *ener_flux
+) {
+  int j, k, e;
+  bool positive;
+
+  double sigmat, sigmav, sigmam, sigma3, sigma4, diffuw, diffdw, limiter;
+  double flux, pre_vol_donor, width_dif, density_upwind, density_donor, density_downwind;
+  double energy_upwind, energy_donor, energy_downwind;
+  double one_by_six;
+
+  one_by_six = 1.0 / 6.0;
+
+  if (dir == G_XDIR) {
+    for (k = y_min - 2; k <= y_max + 2; k++) {
+      for (j = x_min - 2; j <= x_max + 2; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          if (sweep_number == 1) {
+            NODE(pre_vol, j, k) = CELL(volume, j, k) + (NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k) +
+                                                        CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k));
+            NODE(post_vol, j, k) = NODE(pre_vol, j, k) - (NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k));
+          } else {
+            NODE(pre_vol, j, k) = CELL(volume, j, k) + NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k);
+            NODE(post_vol, j, k) = CELL(volume, j, k);
+          }
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max; k++) {
+      for (j = x_min; j <= x_max + 2; j++) {
+        const int upwind_n = MIN(j + 1, x_max + 2);
+
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          flux = NODE(vol_flux_x, j, k);
+          positive = flux > 0.0;
+
+          pre_vol_donor = positive ? NODE(pre_vol, j - 1, k) : NODE(pre_vol, j, k);
+          width_dif = positive ? XLINE(vertexdx, j - 1) : XLINE(vertexdx, upwind_n);
+          density_upwind = positive ? CELL(density1, j - 2, k) : CELL(density1, upwind_n, k);
+          density_donor = positive ? CELL(density1, j - 1, k) : CELL(density1, j, k);
+          density_downwind = positive ? CELL(density1, j, k) : CELL(density1, j - 1, k);
+          energy_upwind = positive ? CELL(energy1, j - 2, k) : CELL(energy1, upwind_n, k);
+          energy_donor = positive ? CELL(energy1, j - 1, k) : CELL(energy1, j, k);
+          energy_downwind = positive ? CELL(energy1, j, k) : CELL(energy1, j - 1, k);
+
+          sigmat = fabs(flux / pre_vol_donor);
+          sigma3 = (1.0 + sigmat) * (XLINE(vertexdx, j) / width_dif);
+          sigma4 = 2.0 - sigmat;
+
+          sigmav = sigmat;
+
+          diffuw = density_donor - density_upwind;
+          diffdw = density_downwind - density_donor;
+          limiter = diffuw * diffdw > 0.0
+                        ? (1.0 - sigmav) * SIGN(1.0, diffdw) *
+                              MIN(fabs(diffuw),
+                                  MIN(fabs(diffdw), one_by_six * (sigma3 * fabs(diffuw) + sigma4 * fabs(diffdw))))
+                        : 0.0;
+          NODE(mass_flux_x, j, k) = flux * (density_donor + limiter);
+
+          sigmam = fabs(NODE(mass_flux_x, j, k)) / (density_donor * pre_vol_donor);
+          diffuw = energy_donor - energy_upwind;
+          diffdw = energy_downwind - energy_donor;
+          limiter = diffuw * diffdw > 0.0
+                        ? (1.0 - sigmam) * SIGN(1.0, diffdw) *
+                              MIN(fabs(diffuw),
+                                  MIN(fabs(diffdw), one_by_six * (sigma3 * fabs(diffuw) + sigma4 * fabs(diffdw))))
+                        : 0.0;
+          NODE(ener_flux, j, k) = NODE(mass_flux_x, j, k) * (energy_donor + limiter);
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max; k++) {
+      for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(pre_mass, j, k) = CELL(density1, j, k) * NODE(pre_vol, j, k);
+          NODE(post_mass, j, k) = NODE(pre_mass, j, k) + NODE(mass_flux_x, j, k) - NODE(mass_flux_x, j + 1, k);
+          NODE(post_ener, j, k) = (CELL(energy1, j, k) * NODE(pre_mass, j, k) + NODE(ener_flux, j, k) -
+                                   NODE(ener_flux, j + 1, k)) /
+                                  NODE(post_mass, j, k);
+          NODE(advec_vol, j, k) = NODE(pre_vol, j, k) + NODE(vol_flux_x, j, k) - NODE(vol_flux_x, j + 1, k);
+
+          CELL(density1, j, k) = NODE(post_mass, j, k) / NODE(advec_vol, j, k);
+          CELL(energy1, j, k) = NODE(post_ener, j, k);
+        }
+      }
+    }
+
+  } else if (dir == G_YDIR) {
+    for (k = y_min - 2; k <= y_max + 2; k++) {
+      for (j = x_min - 2; j <= x_max + 2; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          if (sweep_number == 1) {
+            NODE(pre_vol, j, k) = CELL(volume, j, k) + (CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k) +
+                                                        NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k));
+            NODE(post_vol, j, k) = NODE(pre_vol, j, k) - (CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k));
+          } else {
+            NODE(pre_vol, j, k) = CELL(volume, j, k) + CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k);
+            NODE(post_vol, j, k) = CELL(volume, j, k);
+          }
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max + 2; k++) {
+      const int upwind_n = MIN(k + 1, y_max + 2);
+
+      for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          flux = CELL(vol_flux_y, j, k);
+          positive = flux > 0.0;
+
+          pre_vol_donor = positive ? NODE(pre_vol, j, k - 1) : NODE(pre_vol, j, k);
+          width_dif = positive ? YLINE(vertexdy, k - 1) : YLINE(vertexdy, upwind_n);
+          density_upwind = positive ? CELL(density1, j, k - 2) : CELL(density1, j, upwind_n);
+          density_donor = positive ? CELL(density1, j, k - 1) : CELL(density1, j, k);
+          density_downwind = positive ? CELL(density1, j, k) : CELL(density1, j, k - 1);
+          energy_upwind = positive ? CELL(energy1, j, k - 2) : CELL(energy1, j, upwind_n);
+          energy_donor = positive ? CELL(energy1, j, k - 1) : CELL(energy1, j, k);
+          energy_downwind = positive ? CELL(energy1, j, k) : CELL(energy1, j, k - 1);
+
+          sigmat = fabs(flux / pre_vol_donor);
+          sigma3 = (1.0 + sigmat) * (YLINE(vertexdy, k) / width_dif);
+          sigma4 = 2.0 - sigmat;
+
+          sigmav = sigmat;
+
+          diffuw = density_donor - density_upwind;
+          diffdw = density_downwind - density_donor;
+          limiter = diffuw * diffdw > 0.0
+                        ? (1.0 - sigmav) * SIGN(1.0, diffdw) *
+                              MIN(fabs(diffuw),
+                                  MIN(fabs(diffdw), one_by_six * (sigma3 * fabs(diffuw) + sigma4 * fabs(diffdw))))
+                        : 0.0;
+          CELL(mass_flux_y, j, k) = flux * (density_donor + limiter);
+
+          sigmam = fabs(CELL(mass_flux_y, j, k)) / (density_donor * pre_vol_donor);
+          diffuw = energy_donor - energy_upwind;
+          diffdw = energy_downwind - energy_donor;
+          limiter = diffuw * diffdw > 0.0
+                        ? (1.0 - sigmam) * SIGN(1.0, diffdw) *
+                              MIN(fabs(diffuw),
+                                  MIN(fabs(diffdw), one_by_six * (sigma3 * fabs(diffuw) + sigma4 * fabs(diffdw))))
+                        : 0.0;
+          NODE(ener_flux, j, k) = CELL(mass_flux_y, j, k) * (energy_donor + limiter);
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max; k++) {
+      for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(pre_mass, j, k) = CELL(density1, j, k) * NODE(pre_vol, j, k);
+          NODE(post_mass, j, k) = NODE(pre_mass, j, k) + CELL(mass_flux_y, j, k) - CELL(mass_flux_y, j, k + 1);
+          NODE(post_ener, j, k) = (CELL(energy1, j, k) * NODE(pre_mass, j, k) + NODE(ener_flux, j, k) -
+                                   NODE(ener_flux, j, k + 1)) /
+                                  NODE(post_mass, j, k);
+          NODE(advec_vol, j, k) = NODE(pre_vol, j, k) + CELL(vol_flux_y, j, k) - CELL(vol_flux_y, j, k + 1);
+
+          CELL(density1, j, k) = NODE(post_mass, j, k) / NODE(advec_vol, j, k);
+          CELL(energy1, j, k) = NODE(post_ener, j, k);
+        }
+      }
+    }
+  }
+}
+
+/**
+ * @brief Momentum advection, see kernel_advec_mom
+ */
+void kernel_ensemble_advec_mom(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *vel1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *volume,
+    double *density1,
+    double *node_flux,
+    double *node_mass_post,
+    double *node_mass_pre,
+    double *mom_flux,
+    double *pre_vol,
+    double *post_vol,
+    double *celldx,
+    double *celldy,
+    int which_vel,
+    int sweep_number,
+    int direction
+) {
+  int j, k, e, mom_sweep;
+  bool negative;
+  double sigma, wind, width, width_dif;
+  double vdiffuw, vdiffdw, auw, adw, limiter;
+  double vel_upwind, vel_donor, vel_downwind;
+
+  double advec_vel_s;
+
+  mom_sweep = direction + 2 * (sweep_number - 1);
+
+  for (k = y_min - 2; k <= y_max + 2; k++) {
+    for (j = x_min - 2; j <= x_max + 2; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        if (mom_sweep == 1) {
+          NODE(post_vol, j, k) = CELL(volume, j, k) + CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k);
+          NODE(pre_vol, j, k) = NODE(post_vol, j, k) + NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k);
+        } else if (mom_sweep == 2) {
+          NODE(post_vol, j, k) = CELL(volume, j, k) + NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k);
+          NODE(pre_vol, j, k) = NODE(post_vol, j, k) + CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k);
+        } else if (mom_sweep == 3) {
+          NODE(post_vol, j, k) = CELL(volume, j, k);
+          NODE(pre_vol, j, k) = NODE(post_vol, j, k) + CELL(vol_flux_y, j, k + 1) - CELL(vol_flux_y, j, k);
+        } else {
+          NODE(post_vol, j, k) = CELL(volume, j, k);
+          NODE(pre_vol, j, k) = NODE(post_vol, j, k) + NODE(vol_flux_x, j + 1, k) - NODE(vol_flux_x, j, k);
+        }
+      }
+    }
+  }
+
+  if (direction == 1) {
+    for (k = y_min; k <= y_max + 1; k++) {
+      for (j = x_min - 2; j <= x_max + 2; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(node_flux, j, k) = 0.25 * (NODE(mass_flux_x, j, k - 1) + NODE(mass_flux_x, j, k) +
+                                          NODE(mass_flux_x, j + 1, k - 1) + NODE(mass_flux_x, j + 1, k));
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max + 1; k++) {
+      for (j = x_min - 1; j <= x_max + 2; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(node_mass_post, j, k) =
+              0.25 * (CELL(density1, j, k - 1) * NODE(post_vol, j, k - 1) + CELL(density1, j, k) * NODE(post_vol, j, k) +
+                      CELL(density1, j - 1, k - 1) * NODE(post_vol, j - 1, k - 1) +
+                      CELL(density1, j - 1, k) * NODE(post_vol, j - 1, k));
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max + 1; k++) {
+      for (j = x_min - 1; j <= x_max + 2; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(node_mass_pre, j, k) = NODE(node_mass_post, j, k) - NODE(node_flux, j - 1, k) + NODE(node_flux, j, k);
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max + 1; k++) {
+      for (j = x_min - 1; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          negative = NODE(node_flux, j, k) < 0.0;
+
+          vel_upwind = negative ? NODE(vel1, j + 2, k) : NODE(vel1, j - 1, k);
+          vel_donor = negative ? NODE(vel1, j + 1, k) : NODE(vel1, j, k);
+          vel_downwind = negative ? NODE(vel1, j, k) : NODE(vel1, j + 1, k);
+          width_dif = negative ? XLINE(celldx, j + 1) : XLINE(celldx, j - 1);
+
+          sigma = fabs(NODE(node_flux, j, k)) /
+                  (negative ? NODE(node_mass_pre, j + 1, k) : NODE(node_mass_pre, j, k));
+          width = XLINE(celldx, j);
+          vdiffuw = vel_donor - vel_upwind;
+          vdiffdw = vel_downwind - vel_donor;
+          auw = fabs(vdiffuw);
+          adw = fabs(vdiffdw);
+          wind = vdiffdw <= 0.0 ? -1.0 : 1.0;
+          limiter = vdiffuw * vdiffdw > 0.0
+                        ? wind * MIN(width * ((2.0 - sigma) * adw / width + (1.0 + sigma) * auw / width_dif) / 6.0,
+                                     MIN(auw, adw))
+                        : 0.0;
+          advec_vel_s = vel_donor + (1.0 - sigma) * limiter;
+          NODE(mom_flux, j, k) = advec_vel_s * NODE(node_flux, j, k);
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max + 1; k++) {
+      for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(vel1, j, k) = (NODE(vel1, j, k) * NODE(node_mass_pre, j, k) + NODE(mom_flux, j - 1, k) -
+                              NODE(mom_flux, j, k)) /
+                             NODE(node_mass_post, j, k);
+        }
+      }
+    }
+  } else if (direction == 2) {
+    for (k = y_min - 2; k <= y_max + 2; k++) {
+      for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(node_flux, j, k) = 0.25 * (CELL(mass_flux_y, j - 1, k) + CELL(mass_flux_y, j, k) +
+                                          CELL(mass_flux_y, j - 1, k + 1) + CELL(mass_flux_y, j, k + 1));
+        }
+      }
+    }
+
+    for (k = y_min - 1; k <= y_max + 2; k++) {
+      for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(node_mass_post, j, k) =
+              0.25 * (CELL(density1, j, k - 1) * NODE(post_vol, j, k - 1) + CELL(density1, j, k) * NODE(post_vol, j, k) +
+                      CELL(density1, j - 1, k - 1) * NODE(post_vol, j - 1, k - 1) +
+                      CELL(density1, j - 1, k) * NODE(post_vol, j - 1, k));
+        }
+      }
+    }
+
+    for (k = y_min - 1; k <= y_max + 2; k++) {
+      for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(node_mass_pre, j, k) = NODE(node_mass_post, j, k) - NODE(node_flux, j, k - 1) + NODE(node_flux, j, k);
+        }
+      }
+    }
+
+    for (k = y_min - 1; k <= y_max + 1; k++) {
+      for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          negative = NODE(node_flux, j, k) < 0.0;
+
+          vel_upwind = negative ? NODE(vel1, j, k + 2) : NODE(vel1, j, k - 1);
+          vel_donor = negative ? NODE(vel1, j, k + 1) : NODE(vel1, j, k);
+          vel_downwind = negative ? NODE(vel1, j, k) : NODE(vel1, j, k + 1);
+          width_dif = negative ? YLINE(celldy, k + 1) : YLINE(celldy, k - 1);
+
+          sigma = fabs(NODE(node_flux, j, k)) /
+                  (negative ? NODE(node_mass_pre, j, k + 1) : NODE(node_mass_pre, j, k));
+          width = YLINE(celldy, k);
+          vdiffuw = vel_donor - vel_upwind;
+          vdiffdw = vel_downwind - vel_donor;
+          auw = fabs(vdiffuw);
+          adw = fabs(vdiffdw);
+          wind = vdiffdw <= 0.0 ? -1.0 : 1.0;
+          limiter = vdiffuw * vdiffdw > 0.0
+                        ? wind * MIN(width * ((2.0 - sigma) * adw / width + (1.0 + sigma) * auw / width_dif) / 6.0,
+                                     MIN(auw, adw))
+                        : 0.0;
+          advec_vel_s = vel_donor + (1.0 - sigma) * limiter;
+          NODE(mom_flux, j, k) = advec_vel_s * NODE(node_flux, j, k);
+        }
+      }
+    }
+
+    for (k = y_min; k <= y_max + 1; k++) {
+      for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+        for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+          NODE(vel1, j, k) = (NODE(vel1, j, k) * NODE(node_mass_pre, j, k) + NODE(mom_flux, j, k - 1) -
+                              NODE(mom_flux, j, k)) /
+                             NODE(node_mass_post, j, k);
+        }
+      }
+    }
+  }
+}
+
+void kernel_ensemble_reset_field(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *density0,
+    double *density1,
+    double *energy0,
+    double *energy1,
+    double *xvel0,
+    double *xvel1,
+    double *yvel0,
+    double *yvel1
+) {
+  int j, k, e;
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        CELL(density0, j, k) = CELL(density1, j, k);
+        CELL(energy0, j, k) = CELL(energy1, j, k);
+      }
+    }
+  }
+
+  for (k = y_min; k <= y_max + 1; k++) {
+    for (j = x_min; j <= x_max + 1; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        NODE(xvel0, j, k) = NODE(xvel1, j, k);
+        NODE(yvel0, j, k) = NODE(yvel1, j, k);
+      }
+    }
+  }
+}
+
+/**
+ * @brief Computes the field summary of each lane, summing the cells in the same order as kernel_field_summary
+ */
+void kernel_ensemble_field_summary(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *volume,
+    double *density0,
+    double *energy0,
+    double *pressure,
+    double *xvel0,
+    double *yvel0,
+    double *vol,
+    double *mass,
+    double *ie,
+    double *ke,
+    double *press
+) {
+  int j, k, e, jv, kv;
+
+  double vsqrd;
+  double cell_vol;
+  double cell_mass;
+
+  for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+    vol[e] = 0.0;
+    mass[e] = 0.0;
+    ie[e] = 0.0;
+    ke[e] = 0.0;
+    press[e] = 0.0;
+  }
+
+  for (k = y_min; k <= y_max; k++) {
+    for (j = x_min; j <= x_max; j++) {
+#pragma ivdep
+      for (e = 0; e < ENSEMBLE_WIDTH; e++) {
+        vsqrd = 0.0;
+        for (kv = k; kv <= k + 1; kv++) {
+          for (jv = j; jv <= j + 1; jv++) {
+            vsqrd = vsqrd + 0.25 * (NODE(xvel0, jv, kv) * NODE(xvel0, jv, kv) + NODE(yvel0, jv, kv) * NODE(yvel0, jv, kv));
+          }
+        }
+        cell_vol = CELL(volume, j, k);
+        cell_mass = cell_vol * CELL(density0, j, k);
+        vol[e] = vol[e] + cell_vol;
+        mass[e] = mass[e] + cell_mass;
+        ie[e] = ie[e] + cell_mass * CELL(energy0, j, k);
+        ke[e] = ke[e] + cell_mass * 0.5 * vsqrd;
+        press[e] = press[e] + cell_vol * CELL(pressure, j, k);
+      }
+    }
+  }
+}
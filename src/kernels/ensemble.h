@@ -0,0 +1,221 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Ensemble kernels, advancing ENSEMBLE_WIDTH independent problems of the same mesh size in lockstep
+ * @details Every field holds one value per ensemble member (lane) for each mesh location, the lane being the fastest
+ * varying index. The innermost loop of every kernel runs over the lanes, so it always has the full SIMD width no matter
+ * how small the mesh is. Scalars that differ between members, like the timestep, are passed as one value per lane.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Number of lanes, 8 doubles fill a 512 bit vector register
+#ifndef ENSEMBLE_WIDTH
+#define ENSEMBLE_WIDTH 8
+#endif
+
+// Index of lane e at the given mesh location, with the same bounds convention as FTNREF1D/FTNREF2D
+#define ENSEMBLE_REF1D(e, i_index, i_lb) (ENSEMBLE_WIDTH * ((i_index) - (i_lb)) + (e))
+#define ENSEMBLE_REF2D(e, i_index, j_index, i_size, i_lb, j_lb) \
+  (ENSEMBLE_WIDTH * ((ptrdiff_t)(i_size) * ((j_index) - (j_lb)) + (i_index) - (i_lb)) + (e))
+
+// Kind of mesh location along one direction, selecting the reflective boundary rule of kernel_update_halo
+#define ENSEMBLE_HALO_CELL 0  // Cell centred data
+#define ENSEMBLE_HALO_NODE 1  // Vertex data
+#define ENSEMBLE_HALO_FACE 2  // Flux data in the direction normal to its face
+
+extern void kernel_ensemble_ideal_gas(
+    int x_min, int x_max, int y_min, int y_max, double *density, double *energy, double *pressure, double *soundspeed
+);
+
+extern void kernel_ensemble_update_halo(
+    int x_min, int x_max, int y_min, int y_max, double *field, int x_kind, int y_kind, double x_sign, double y_sign,
+    int depth
+);
+
+extern void kernel_ensemble_viscosity(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *celldx,
+    double *celldy,
+    double *density0,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *yvel0
+);
+
+extern void kernel_ensemble_calc_dt(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dtc_safe,
+    double *dtu_safe,
+    double *dtv_safe,
+    double *dtdiv_safe,
+    double *xarea,
+    double *yarea,
+    double *cellx,
+    double *celly,
+    double *celldx,
+    double *celldy,
+    double *volume,
+    double *density0,
+    double *viscosity,
+    double *soundspeed,
+    double *xvel0,
+    double *yvel0,
+    double *dt_min,
+    double *dtminval,
+    double *xlpos,
+    double *ylpos,
+    int *jldt,
+    int *kldt
+);
+
+extern void kernel_ensemble_pdv(
+    bool predict,
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dt,
+    double *xarea,
+    double *yarea,
+    double *volume,
+    double *density0,
+    double *density1,
+    double *energy0,
+    double *energy1,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *xvel1,
+    double *yvel0,
+    double *yvel1,
+    double *volume_change
+);
+
+extern void kernel_ensemble_accelerate(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dt,
+    double *xarea,
+    double *yarea,
+    double *volume,
+    double *density0,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *yvel0,
+    double *xvel1,
+    double *yvel1
+);
+
+extern void kernel_ensemble_flux_calc(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *dt,
+    double *xarea,
+    double *yarea,
+    double *xvel0,
+    double *yvel0,
+    double *xvel1,
+    double *yvel1,
+    double *vol_flux_x,
+    double *vol_flux_y
+);
+
+extern void kernel_ensemble_advec_cell(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    int dir,
+    int sweep_number,
+    double *vertexdx,
+    double *vertexdy,
+    double *volume,
+    double *density1,
+    double *energy1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *pre_vol,
+    double *post_vol,
+    double *pre_mass,
+    double *post_mass,
+    double *advec_vol,
+    double *post_ener,
+    double *ener_flux
+);
+
+extern void kernel_ensemble_advec_mom(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *vel1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *volume,
+    double *density1,
+    double *node_flux,
+    double *node_mass_post,
+    double *node_mass_pre,
+    double *mom_flux,
+    double *pre_vol,
+    double *post_vol,
+    double *celldx,
+    double *celldy,
+    int which_vel,
+    int sweep_number,
+    int direction
+);
+
+extern void kernel_ensemble_reset_field(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *density0,
+    double *density1,
+    double *energy0,
+    double *energy1,
+    double *xvel0,
+    double *xvel1,
+    double *yvel0,
+    double *yvel1
+);
+
+extern void kernel_ensemble_field_summary(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *volume,
+    double *density0,
+    double *energy0,
+    double *pressure,
+    double *xvel0,
+    double *yvel0,
+    double *vol,
+    double *mass,
+    double *ie,
+    double *ke,
+    double *press
+);
@@ -23,24 +23,22 @@
  */
 
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_field_summary(
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    double *volume,
-    double *density0,
-    double *energy0,
-    double *pressure,
-    double *xvel0,
-    double *yvel0,
-    double *p_vol,
-    double *p_mass,
-    double *p_ie,
-    double *p_ke,
-    double *p_press
-) {
+// Parameters of kernel_field_summary()
+#define FIELD_SUMMARY_PARAMS                                                                                       \
+  int x_min, int x_max, int y_min, int y_max, double *volume, double *density0, double *energy0, double *pressure, \
+      double *xvel0, double *yvel0, double *p_vol, double *p_mass, double *p_ie, double *p_ke, double *p_press,    \
+      double uniform_volume
+
+#define FIELD_SUMMARY_ARGS                                                                                           \
+  x_min, x_max, y_min, y_max, volume, density0, energy0, pressure, xvel0, yvel0, p_vol, p_mass, p_ie, p_ke, p_press, \
+      uniform_volume
+
+/**
+ * @brief Body of the kernel, inlined with a constant uniform, see geometry.h
+ */
+static inline __attribute__((always_inline)) void field_summary(const bool uniform, FIELD_SUMMARY_PARAMS) {
   int j, k, jv, kv;
 
   double vol = *p_vol;
@@ -71,7 +69,7 @@ void kernel_field_summary(
                                       yvel0[FTNREF2D(jv, kv, x_max + 5, x_min - 2, y_min - 2)]);
         }
       }
-      cell_vol = volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
+      cell_vol = VOLUME(j, k);
       cell_mass = cell_vol * density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)];
       vol = vol + cell_vol;
       mass = mass + cell_mass;
@@ -87,3 +85,27 @@ void kernel_field_summary(
   *p_ke = ke;
   *p_press = press;
 }
+
+void kernel_field_summary(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *volume,
+    double *density0,
+    double *energy0,
+    double *pressure,
+    double *xvel0,
+    double *yvel0,
+    double *p_vol,
+    double *p_mass,
+    double *p_ie,
+    double *p_ke,
+    double *p_press,
+    double uniform_volume
+) {
+  if (volume == NULL)
+    field_summary(true, FIELD_SUMMARY_ARGS);
+  else
+    field_summary(false, FIELD_SUMMARY_ARGS);
+}
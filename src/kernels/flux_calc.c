@@ -22,29 +22,28 @@
  */
 
 #include "ftocmacros.h"
+#include "geometry.h"
 
-void kernel_flux_calc(
-    int x_min,
-    int x_max,
-    int y_min,
-    int y_max,
-    double dt,
-    double *xarea,
-    double *yarea,
-    double *xvel0,
-    double *yvel0,
-    double *xvel1,
-    double *yvel1,
-    double *vol_flux_x,
-    double *vol_flux_y
-) {
+// Parameters of kernel_flux_calc()
+#define FLUX_CALC_PARAMS                                                                                             \
+  int x_min, int x_max, int y_min, int y_max, double dt, double *xarea, double *yarea, double *xvel0, double *yvel0, \
+      double *xvel1, double *yvel1, double *vol_flux_x, double *vol_flux_y, double uniform_xarea, double uniform_yarea
+
+#define FLUX_CALC_ARGS                                                                                             \
+  x_min, x_max, y_min, y_max, dt, xarea, yarea, xvel0, yvel0, xvel1, yvel1, vol_flux_x, vol_flux_y, uniform_xarea, \
+      uniform_yarea
+
+/**
+ * @brief Body of the kernel, inlined with a constant uniform, see geometry.h
+ */
+static inline __attribute__((always_inline)) void flux_calc(const bool uniform, FLUX_CALC_PARAMS) {
   int j, k;
 
   for (k = y_min; k <= y_max; k++) {
 #pragma ivdep
     for (j = x_min; j <= x_max + 1; j++) {
       vol_flux_x[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] =
-          0.25 * dt * xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] *
+          0.25 * dt * XAREA(j, k) *
           (xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
            xvel0[FTNREF2D(j, k + 1, x_max + 5, x_min - 2, y_min - 2)] +
            xvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
@@ -56,7 +55,7 @@ void kernel_flux_calc(
 #pragma ivdep
     for (j = x_min; j <= x_max; j++) {
       vol_flux_y[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] =
-          0.25 * dt * yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] *
+          0.25 * dt * YAREA(j, k) *
           (yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
            yvel0[FTNREF2D(j + 1, k, x_max + 5, x_min - 2, y_min - 2)] +
            yvel1[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] +
@@ -64,3 +63,26 @@ void kernel_flux_calc(
     }
   }
 }
+
+void kernel_flux_calc(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double dt,
+    double *xarea,
+    double *yarea,
+    double *xvel0,
+    double *yvel0,
+    double *xvel1,
+    double *yvel1,
+    double *vol_flux_x,
+    double *vol_flux_y,
+    double uniform_xarea,
+    double uniform_yarea
+) {
+  if (xarea == NULL)
+    flux_calc(true, FLUX_CALC_ARGS);
+  else
+    flux_calc(false, FLUX_CALC_ARGS);
+}
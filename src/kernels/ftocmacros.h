@@ -11,8 +11,13 @@
 #ifndef _FTOC_MACROS_
 #define _FTOC_MACROS_
 
+#include <stddef.h>
+
+// 2D offsets are computed in ptrdiff_t: a tile of 50000x50000 cells holds more than 2^31 elements per array, while
+// every index along one direction still fits an int
+
 #define FTNREF1D(i_index,i_lb) ((i_index)-(i_lb))
-#define FTNREF2D(i_index,j_index,i_size,i_lb,j_lb) ((i_size)*(j_index-(j_lb))+(i_index)-(i_lb))
+#define FTNREF2D(i_index,j_index,i_size,i_lb,j_lb) ((ptrdiff_t)(i_size)*((j_index)-(j_lb))+(i_index)-(i_lb))
 #define FTNREF3D(i_index,j_index,k_index,i_size,j_size,i_lb,j_lb,k_lb) (i_size)*(j_size)*(k_index-k_lb)+(i_size)*(j_index-j_lb)+i_index-i_lb
 #define FTNREF4D(i_index,j_index,k_index,l_index,i_size,j_size,k_size,i_lb,j_lb,k_lb,l_lb) (i_size)*(j_size)*(k_size)*(l_index-l_lb)+(i_size)*(j_size)*(k_index-k_lb)+(i_size)*(j_index-j_lb)+i_index-i_lb
 #define FTNREF5D(i_index,j_index,k_index,l_index,m_index,i_size,j_size,k_size,l_size,i_lb,j_lb,k_lb,l_lb,m_lb) (i_size)*(j_size)*(k_size)*(l_size)*(m_index-m_lb)+(i_size)*(j_size)*(k_size)*(l_index-l_lb)+(i_size)*(j_size)*(k_index-k_lb)+(i_size)*(j_index-j_lb)+i_index-i_lb
@@ -23,6 +23,12 @@
  *
  *  Note that state one is always used as the background state, which is then
  *  overwritten by further state definitions.
+ *
+ *  The mesh coordinates only grow with the index, so the cells covered by a
+ *  state are found by bisection on the vertex and cell coordinates rather than
+ *  by testing every cell: rectangles become a range of rows and columns clipped
+ *  to the tile, circles a span of columns in each row. The cost of a state is
+ *  the number of cells it covers, not the size of the mesh.
  */
 
 #include <math.h>
@@ -30,6 +36,68 @@
 #include "data.h"
 #include "ftocmacros.h"
 
+/**
+ * @brief First index in [lo, hi] whose coordinate is at least value, or hi + 1 if there is none
+ * @param coord Coordinates increasing with the index, the first one being index lb
+ */
+static int first_at_least(const double *coord, int lb, int lo, int hi, double value) {
+  while (lo <= hi) {
+    int mid = lo + (hi - lo) / 2;
+    if (coord[FTNREF1D(mid, lb)] >= value)
+      hi = mid - 1;
+    else
+      lo = mid + 1;
+  }
+  return lo;
+}
+
+static int in_circle(double x, double y, double x_cent, double y_cent, double radius) {
+  return sqrt((x - x_cent) * (x - x_cent) + (y - y_cent) * (y - y_cent)) <= radius;
+}
+
+/**
+ * @brief Sets the density and energy of cells [j_lo, j_hi] x [k_lo, k_hi] and the velocity of their vertices
+ */
+static void paint(
+    int j_lo,
+    int j_hi,
+    int k_lo,
+    int k_hi,
+    int x_min,
+    int x_max,
+    int y_min,
+    double *density0,
+    double *energy0,
+    double *xvel0,
+    double *yvel0,
+    double density,
+    double energy,
+    double xvel,
+    double yvel
+) {
+  int j, k;
+
+  for (k = k_lo; k <= k_hi; k++) {
+    double *density_row = &density0[FTNREF2D(0, k, x_max + 4, x_min - 2, y_min - 2)];
+    double *energy_row = &energy0[FTNREF2D(0, k, x_max + 4, x_min - 2, y_min - 2)];
+#pragma ivdep
+    for (j = j_lo; j <= j_hi; j++) {
+      density_row[j] = density;
+      energy_row[j] = energy;
+    }
+  }
+
+  for (k = k_lo; k <= k_hi + 1; k++) {
+    double *xvel_row = &xvel0[FTNREF2D(0, k, x_max + 5, x_min - 2, y_min - 2)];
+    double *yvel_row = &yvel0[FTNREF2D(0, k, x_max + 5, x_min - 2, y_min - 2)];
+#pragma ivdep
+    for (j = j_lo; j <= j_hi + 1; j++) {
+      xvel_row[j] = xvel;
+      yvel_row[j] = yvel;
+    }
+  }
+}
+
 void kernel_generate_chunk(
     int x_min,
     int x_max,
@@ -55,10 +123,10 @@ void kernel_generate_chunk(
     double *state_radius,
     int *state_geometry
 ) {
-  double radius, x_cent, y_cent;
+  double x_cent, y_cent, radius;
   int state;
 
-  int j, k, jt, kt;
+  int j, k, j_lo, j_hi, k_lo, k_hi, j_cent;
 
   /* State 1 is always the background state */
 
@@ -66,12 +134,6 @@ void kernel_generate_chunk(
 #pragma ivdep
     for (j = x_min - 2; j <= x_max + 2; j++) {
       energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_energy[FTNREF1D(1, 1)];
-    }
-  }
-
-  for (k = y_min - 2; k <= y_max + 2; k++) {
-#pragma ivdep
-    for (j = x_min - 2; j <= x_max + 2; j++) {
       density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_density[FTNREF1D(1, 1)];
     }
   }
@@ -80,67 +142,72 @@ void kernel_generate_chunk(
 #pragma ivdep
     for (j = x_min - 2; j <= x_max + 2; j++) {
       xvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = state_xvel[FTNREF1D(1, 1)];
-    }
-  }
-
-  for (k = y_min - 2; k <= y_max + 2; k++) {
-#pragma ivdep
-    for (j = x_min - 2; j <= x_max + 2; j++) {
       yvel0[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = state_yvel[FTNREF1D(1, 1)];
     }
   }
 
   for (state = 2; state <= number_of_states; state++) {
-    /* Could the velocity setting be thread unsafe? */
+    double density = state_density[FTNREF1D(state, 1)];
+    double energy = state_energy[FTNREF1D(state, 1)];
+    double xvel = state_xvel[FTNREF1D(state, 1)];
+    double yvel = state_yvel[FTNREF1D(state, 1)];
+
     x_cent = state_xmin[FTNREF1D(state, 1)];
     y_cent = state_ymin[FTNREF1D(state, 1)];
 
-    for (k = y_min - 2; k <= y_max + 2; k++) {
-#pragma ivdep
-      for (j = x_min - 2; j <= x_max + 2; j++) {
-        if (state_geometry[FTNREF1D(state, 1)] == G_RECT) {
-          if (vertexx[FTNREF1D(j + 1, x_min - 2)] >= state_xmin[FTNREF1D(state, 1)] &&
-              vertexx[FTNREF1D(j, x_min - 2)] < state_xmax[FTNREF1D(state, 1)]) {
-            if (vertexy[FTNREF1D(k + 1, y_min - 2)] >= state_ymin[FTNREF1D(state, 1)] &&
-                vertexy[FTNREF1D(k, y_min - 2)] < state_ymax[FTNREF1D(state, 1)]) {
-              density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_density[FTNREF1D(state, 1)];
-              energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_energy[FTNREF1D(state, 1)];
-              for (kt = k; kt <= k + 1; kt++) {
-                for (jt = j; jt <= j + 1; jt++) {
-                  xvel0[FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = state_xvel[FTNREF1D(state, 1)];
-                  yvel0[FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = state_yvel[FTNREF1D(state, 1)];
-                }
-              }
-            }
-          }
-        } else if (state_geometry[FTNREF1D(state, 1)] == G_CIRC) {
-          radius = sqrt(
-              (cellx[FTNREF1D(j, x_min - 2)] - x_cent) * (cellx[FTNREF1D(j, x_min - 2)] - x_cent) +
-              (celly[FTNREF1D(k, y_min - 2)] - y_cent) * (celly[FTNREF1D(k, y_min - 2)] - y_cent)
-          );
-          if (radius <= state_radius[FTNREF1D(state, 1)]) {
-            density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_density[FTNREF1D(state, 1)];
-            energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_density[FTNREF1D(state, 1)];
-            for (kt = k; kt <= k + 1; kt++) {
-              for (jt = j; jt <= j + 1; jt++) {
-                xvel0[FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = state_xvel[FTNREF1D(state, 1)];
-                yvel0[FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = state_yvel[FTNREF1D(state, 1)];
-              }
-            }
-          }
-        } else if (state_geometry[FTNREF1D(state, 1)] == G_POINT) {
-          if (vertexx[FTNREF1D(j, x_min - 2)] == x_cent && vertexy[FTNREF1D(j, x_min - 2)] == y_cent) {
-            density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_density[FTNREF1D(state, 1)];
-            energy0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = state_density[FTNREF1D(state, 1)];
-            for (kt = k; kt <= k + 1; kt++) {
-              for (jt = j; jt <= j + 1; jt++) {
-                xvel0[FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = state_xvel[FTNREF1D(state, 1)];
-                yvel0[FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = state_yvel[FTNREF1D(state, 1)];
-              }
-            }
-          }
+    if (state_geometry[FTNREF1D(state, 1)] == G_RECT) {
+      // Cells whose right vertex is past xmin and whose left vertex is before xmax
+      j_lo = first_at_least(vertexx, x_min - 2, x_min - 1, x_max + 3, state_xmin[FTNREF1D(state, 1)]) - 1;
+      j_hi = first_at_least(vertexx, x_min - 2, x_min - 2, x_max + 2, state_xmax[FTNREF1D(state, 1)]) - 1;
+      k_lo = first_at_least(vertexy, y_min - 2, y_min - 1, y_max + 3, state_ymin[FTNREF1D(state, 1)]) - 1;
+      k_hi = first_at_least(vertexy, y_min - 2, y_min - 2, y_max + 2, state_ymax[FTNREF1D(state, 1)]) - 1;
+
+      if (j_lo <= j_hi && k_lo <= k_hi)
+        paint(j_lo, j_hi, k_lo, k_hi, x_min, x_max, y_min, density0, energy0, xvel0, yvel0, density, energy, xvel, yvel);
+    } else if (state_geometry[FTNREF1D(state, 1)] == G_CIRC) {
+      radius = state_radius[FTNREF1D(state, 1)];
+
+      // Cells left of j_cent get closer to the centre as j grows, the others further away
+      j_cent = first_at_least(cellx, x_min - 2, x_min - 2, x_max + 2, x_cent);
+
+      for (k = y_min - 2; k <= y_max + 2; k++) {
+        double y = celly[FTNREF1D(k, y_min - 2)];
+        int lo, hi;
+
+        // First cell inside on the left side, j_cent if there is none
+        lo = x_min - 2;
+        hi = j_cent - 1;
+        while (lo <= hi) {
+          int mid = lo + (hi - lo) / 2;
+          if (in_circle(cellx[FTNREF1D(mid, x_min - 2)], y, x_cent, y_cent, radius))
+            hi = mid - 1;
+          else
+            lo = mid + 1;
+        }
+        j_lo = lo;
+
+        // Last cell inside on the right side, j_cent - 1 if there is none
+        lo = j_cent;
+        hi = x_max + 2;
+        while (lo <= hi) {
+          int mid = lo + (hi - lo) / 2;
+          if (in_circle(cellx[FTNREF1D(mid, x_min - 2)], y, x_cent, y_cent, radius))
+            lo = mid + 1;
+          else
+            hi = mid - 1;
         }
+        j_hi = hi;
+
+        if (j_lo <= j_hi)
+          paint(j_lo, j_hi, k, k, x_min, x_max, y_min, density0, energy0, xvel0, yvel0, density, energy, xvel, yvel);
       }
+    } else if (state_geometry[FTNREF1D(state, 1)] == G_POINT) {
+      j = first_at_least(vertexx, x_min - 2, x_min - 2, x_max + 2, x_cent);
+      k = first_at_least(vertexy, y_min - 2, y_min - 2, y_max + 2, y_cent);
+
+      if (j <= x_max + 2 && k <= y_max + 2 && vertexx[FTNREF1D(j, x_min - 2)] == x_cent &&
+          vertexy[FTNREF1D(k, y_min - 2)] == y_cent)
+        paint(j, j, k, k, x_min, x_max, y_min, density0, energy0, xvel0, yvel0, density, energy, xvel, yvel);
     }
   }
 }
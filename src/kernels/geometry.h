@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Reads of the cell volumes and face areas by the kernels
+ * @details On a uniform grid the volume, xarea and yarea planes aren't allocated (see uniform_grid in definitions.h),
+ * the kernels are passed their single values uniform_volume, uniform_xarea and uniform_yarea instead and the planes as
+ * NULL. VOLUME(j, k), XAREA(j, k) and YAREA(j, k) read one or the other by a bool uniform in scope.
+ *
+ * The kernels reading them in their loops inline their body twice, with uniform true and false, and pick one by whether
+ * a plane is NULL, so that neither copy tests it per cell. A value read from a scalar instead of a plane enters the
+ * same operations, the results are bitwise identical. A flag only known at run time would not just cost a test per
+ * cell, it can also change which operations the compiler contracts into fused multiply-adds.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "ftocmacros.h"
+
+#define VOLUME(j, k) (uniform ? uniform_volume : volume[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)])
+#define XAREA(j, k) (uniform ? uniform_xarea : xarea[FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)])
+#define YAREA(j, k) (uniform ? uniform_yarea : yarea[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)])
@@ -21,6 +21,8 @@
  *  @details Invokes the user specified chunk initialisation kernel.
  */
 
+#include <stddef.h>
+
 #include "ftocmacros.h"
 
 void kernel_initialise_chunk(
@@ -86,6 +88,10 @@ void kernel_initialise_chunk(
     celldy[FTNREF1D(k, y_min - 2)] = d_y;
   }
 
+  // Not allocated on a uniform grid, see geometry.h
+  if (volume == NULL)
+    return;
+
   for (k = y_min - 2; k <= y_max + 2; k++) {
 #pragma ivdep
     for (j = x_min - 2; j <= x_max + 2; j++) {
@@ -8,6 +8,10 @@
 // As this is a public header, we need to include the types used outside of the kernels
 #include "../types/data.h"
 
+/**
+ * @brief Fills the grid of a tile. The volume, xarea and yarea planes are NULL on a uniform grid, the kernels reading
+ * them are then passed their single values instead, see geometry.h
+ */
 extern void kernel_initialise_chunk(
     int x_min,
     int x_max,
@@ -101,7 +105,28 @@ extern void kernel_field_summary(
     double *mass,
     double *ie,
     double *ke,
-    double *press
+    double *press,
+    double uniform_volume
+);
+
+extern bool kernel_quiescent(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *density0,
+    double *energy0,
+    double *volume,
+    double *viscosity,
+    double *xvel0,
+    double *yvel0,
+    double *vol_flux_x,
+    double *vol_flux_y,
+    double *mass_flux_x,
+    double *mass_flux_y,
+    double *density,
+    double *energy,
+    double uniform_volume
 );
 
 extern void kernel_viscosity(
@@ -149,7 +174,10 @@ extern void kernel_calc_dt(
     double *ylpos,
     int *jldt,
     int *kldt,
-    int smll
+    int smll,
+    double uniform_volume,
+    double uniform_xarea,
+    double uniform_yarea
 );
 
 extern void kernel_pdv(
@@ -172,13 +200,47 @@ extern void kernel_pdv(
     double *xvel1,
     double *yvel0,
     double *yvel1,
-    double *volume_change
+    double *volume_change,
+    double *vol_flux_x,
+    double *vol_flux_y,
+    double uniform_volume,
+    double uniform_xarea,
+    double uniform_yarea
 );
 
-extern void kernel_revert(
-    int x_min, int x_max, int y_min, int y_max, double *density0, double *density1, double *energy0, double *energy1
+/**
+ * @brief PdV specialised for the predictor or the corrector, indexed by predict. The corrector also writes the volume
+ * fluxes vol_flux_x and vol_flux_y, as kernel_flux_calc() would.
+ */
+typedef void (*pdv_kernel)(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double dt,
+    double *xarea,
+    double *yarea,
+    double *volume,
+    double *density0,
+    double *density1,
+    double *energy0,
+    double *energy1,
+    double *pressure,
+    double *viscosity,
+    double *xvel0,
+    double *xvel1,
+    double *yvel0,
+    double *yvel1,
+    double *volume_change,
+    double *vol_flux_x,
+    double *vol_flux_y,
+    double uniform_volume,
+    double uniform_xarea,
+    double uniform_yarea
 );
 
+extern const pdv_kernel kernel_pdv_variants[2];
+
 extern void kernel_accelerate(
     int x_min,
     int x_max,
@@ -194,7 +256,10 @@ extern void kernel_accelerate(
     double *xvel0,
     double *yvel0,
     double *xvel1,
-    double *yvel1
+    double *yvel1,
+    double uniform_volume,
+    double uniform_xarea,
+    double uniform_yarea
 );
 
 extern void kernel_flux_calc(
@@ -210,7 +275,9 @@ extern void kernel_flux_calc(
     double *xvel1,
     double *yvel1,
     double *vol_flux_x,
-    double *vol_flux_y
+    double *vol_flux_y,
+    double uniform_xarea,
+    double uniform_yarea
 );
 
 extern void kernel_advec_cell(
@@ -235,9 +302,39 @@ extern void kernel_advec_cell(
     double *post_mass,
     double *advec_vol,
     double *post_ener,
-    double *ener_flux
+    double *ener_flux,
+    double uniform_volume
+);
+
+/**
+ * @brief advec_cell specialised for each sweep, indexed by [dir - 1][sweep_number - 1]
+ */
+typedef void (*advec_cell_kernel)(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *vertexdx,
+    double *vertexdy,
+    double *volume,
+    double *density1,
+    double *energy1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *pre_vol,
+    double *post_vol,
+    double *pre_mass,
+    double *post_mass,
+    double *advec_vol,
+    double *post_ener,
+    double *ener_flux,
+    double uniform_volume
 );
 
+extern const advec_cell_kernel kernel_advec_cell_variants[2][2];
+
 extern void kernel_advec_mom(
     int x_min,
     int x_max,
@@ -258,11 +355,41 @@ extern void kernel_advec_mom(
     double *post_vol,
     double *celldx,
     double *celldy,
+    double uniform_volume,
     int which_vel,
     int sweep_number,
     int direction
 );
 
+/**
+ * @brief advec_mom specialised for each sweep, indexed by [direction - 1][sweep_number - 1]. Both velocities are
+ * advected by the same variant, which_vel doesn't change the computation.
+ */
+typedef void (*advec_mom_kernel)(
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *vel1,
+    double *mass_flux_x,
+    double *vol_flux_x,
+    double *mass_flux_y,
+    double *vol_flux_y,
+    double *volume,
+    double *density1,
+    double *node_flux,
+    double *node_mass_post,
+    double *node_mass_pre,
+    double *mom_flux,
+    double *pre_vol,
+    double *post_vol,
+    double *celldx,
+    double *celldy,
+    double uniform_volume
+);
+
+extern const advec_mom_kernel kernel_advec_mom_variants[2][2];
+
 extern void kernel_reset_field(
     int x_min,
     int x_max,
@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "roofline.h"
+
+#include <stddef.h>
+
+#include "../definitions.h"
+
+#define DOUBLE_BYTES 8.0
+
+typedef void (*roofline_model_fn)(int variant, double nx, double ny, roofline_cost *cost);
+
+/**
+ * @brief Adds a loop of a kernel to its cost
+ * @param iterations Iterations of the loop
+ * @param flops Flops per iteration
+ * @param reads Mesh sized arrays read
+ * @param writes Mesh sized arrays written
+ */
+static void add_loop(roofline_cost *cost, double iterations, double flops, int reads, int writes) {
+  cost->flops += iterations * flops;
+  cost->bytes_read += iterations * reads * DOUBLE_BYTES;
+  cost->bytes_written += iterations * writes * DOUBLE_BYTES;
+}
+
+/**
+ * @brief The volume and area planes among the arrays a loop reads or writes, none on a uniform grid
+ */
+static int planes(int count) {
+  return uniform_grid ? 0 : count;
+}
+
+static void model_initialise_chunk(int variant, double nx, double ny, roofline_cost *cost) {
+  // volume, xarea and yarea, the cell volume is loop invariant
+  add_loop(cost, (nx + 4) * (ny + 4), 0, 0, planes(3));
+}
+
+static void model_generate_chunk(int variant, double nx, double ny, roofline_cost *cost) {
+  // The background state, the other states only cover part of the mesh
+  add_loop(cost, (nx + 4) * (ny + 4), 0, 0, 4);
+}
+
+static void model_ideal_gas(int variant, double nx, double ny, roofline_cost *cost) {
+  add_loop(cost, nx * ny, 10, 2, 2);
+}
+
+static void model_viscosity(int variant, double nx, double ny, roofline_cost *cost) {
+  add_loop(cost, nx * ny, 40, 4, 1);
+}
+
+static void model_calc_dt(int variant, double nx, double ny, roofline_cost *cost) {
+  // The second loop reads back the minimum of each cell written by the first
+  add_loop(cost, nx * ny, 31, 5 + planes(3), 1);
+  add_loop(cost, nx * ny, 0, 1, 0);
+}
+
+static void model_pdv(int variant, double nx, double ny, roofline_cost *cost) {
+  if (variant) {
+    add_loop(cost, nx * ny, 41, 6 + planes(3), 3);
+    return;
+  }
+
+  // The corrector also writes the volume fluxes, those of the faces past the last column and row in loops of their own
+  add_loop(cost, nx * ny, 41, 8 + planes(3), 5);
+  add_loop(cost, nx + ny, 5, 2 + planes(1), 1);
+}
+
+static void model_accelerate(int variant, double nx, double ny, roofline_cost *cost) {
+  add_loop(cost, (nx + 1) * (ny + 1), 38, 5 + planes(3), 2);
+}
+
+static void model_flux_calc(int variant, double nx, double ny, roofline_cost *cost) {
+  add_loop(cost, (nx + 1) * ny, 6, 2 + planes(1), 1);
+  add_loop(cost, nx * (ny + 1), 6, 2 + planes(1), 1);
+}
+
+static void model_advec_cell(int variant, double nx, double ny, roofline_cost *cost) {
+  bool x_sweep = variant % 2 == 1;
+  bool first_sweep = variant <= 2;
+
+  // Volumes before and after the sweep, over the halo too
+  if (first_sweep)
+    add_loop(cost, (nx + 4) * (ny + 4), 6, 2 + planes(1), 2);
+  else
+    add_loop(cost, (nx + 4) * (ny + 4), 2, 1 + planes(1), 2);
+
+  // Limited mass and energy fluxes through the faces
+  add_loop(cost, x_sweep ? (nx + 2) * ny : nx * (ny + 2), 31, 4, 2);
+
+  // Update of the cells
+  add_loop(cost, nx * ny, 10, 6, 6);
+}
+
+static void model_advec_mom(int variant, double nx, double ny, roofline_cost *cost) {
+  bool x_sweep = variant % 2 == 1;
+
+  // Volumes before and after the sweep, over the halo too
+  if (variant <= 2)
+    add_loop(cost, (nx + 4) * (ny + 4), 4, 2 + planes(1), 2);
+  else
+    add_loop(cost, (nx + 4) * (ny + 4), 2, 1 + planes(1), 2);
+
+  // The loops run along the sweep direction over the halo, and across it over the nodes
+  double along = x_sweep ? nx : ny;
+  double across = (x_sweep ? ny : nx) + 1;
+
+  add_loop(cost, (along + 4) * across, 4, 1, 1);   // Node fluxes
+  add_loop(cost, (along + 3) * across, 8, 2, 1);   // Node masses after the sweep
+  add_loop(cost, (along + 3) * across, 2, 2, 1);   // Node masses before the sweep
+  add_loop(cost, (along + 2) * across, 18, 3, 1);  // Limited momentum fluxes
+  add_loop(cost, (along + 1) * across, 4, 4, 1);   // Update of the velocities
+}
+
+static void model_reset_field(int variant, double nx, double ny, roofline_cost *cost) {
+  add_loop(cost, nx * ny, 0, 2, 2);
+  add_loop(cost, (nx + 1) * (ny + 1), 0, 2, 2);
+}
+
+static void model_field_summary(int variant, double nx, double ny, roofline_cost *cost) {
+  add_loop(cost, nx * ny, 30, 5 + planes(1), 0);
+}
+
+// The registered models, NULL for the kernels without one
+static const struct {
+  const char *name;
+  roofline_model_fn model;
+} roofline_kernels[ROOFLINE_NUM_KERNELS] = {
+    [ROOFLINE_INITIALISE_CHUNK] = {"initialise_chunk", model_initialise_chunk},
+    [ROOFLINE_GENERATE_CHUNK] = {"generate_chunk", model_generate_chunk},
+    [ROOFLINE_IDEAL_GAS] = {"ideal_gas", model_ideal_gas},
+    [ROOFLINE_UPDATE_TILE_HALO] = {"update_tile_halo", NULL},
+    [ROOFLINE_UPDATE_HALO] = {"update_halo", NULL},
+    [ROOFLINE_VISCOSITY] = {"viscosity", model_viscosity},
+    [ROOFLINE_CALC_DT] = {"calc_dt", model_calc_dt},
+    [ROOFLINE_PDV] = {"pdv", model_pdv},
+    [ROOFLINE_ACCELERATE] = {"accelerate", model_accelerate},
+    [ROOFLINE_FLUX_CALC] = {"flux_calc", model_flux_calc},
+    [ROOFLINE_ADVEC_CELL] = {"advec_cell", model_advec_cell},
+    [ROOFLINE_ADVEC_MOM] = {"advec_mom", model_advec_mom},
+    [ROOFLINE_RESET_FIELD] = {"reset_field", model_reset_field},
+    [ROOFLINE_FIELD_SUMMARY] = {"field_summary", model_field_summary},
+};
+
+const char *roofline_name(roofline_kernel kernel) {
+  return roofline_kernels[kernel].name;
+}
+
+bool roofline_has_model(roofline_kernel kernel) {
+  return roofline_kernels[kernel].model != NULL;
+}
+
+roofline_cost roofline_model(roofline_kernel kernel, int variant, int x_min, int x_max, int y_min, int y_max) {
+  roofline_cost cost = {0};
+
+  if (roofline_kernels[kernel].model != NULL)
+    roofline_kernels[kernel].model(variant, x_max - x_min + 1, y_max - y_min + 1, &cost);
+  return cost;
+}
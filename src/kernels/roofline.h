@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief Analytic roofline models of the kernels: the floating point operations and the bytes of one call on a tile
+ * @details Every kernel registers a model of its work as a function of the tile extents and of its variant. The
+ * conventions are those of the classic roofline model:
+ *  - Each addition, subtraction, multiplication, division and square root is a flop, while comparisons, MIN, MAX,
+ *    fabs and SIGN aren't. Loop invariant expressions and code that can't execute aren't counted either.
+ *  - Data dependent branches count their common path: the advection limiters are counted as taken, as they are
+ *    everywhere but at extrema, while the compression branch of the viscosity, only taken in shocks, is not.
+ *  - Each mesh sized array a loop reads or writes is streamed once per iteration, whatever its stencil: the traffic
+ *    of a kernel whose neighbours all hit in cache. The 1D coordinate arrays are ignored, and so is the write
+ *    allocate traffic of the stores.
+ *  - On a uniform grid the volume and area planes aren't there to stream, see geometry.h.
+ *
+ * The halo kernels only touch the border of the tile, they are registered without a model.
+ */
+
+typedef enum roofline_kernel_t {
+  ROOFLINE_INITIALISE_CHUNK,
+  ROOFLINE_GENERATE_CHUNK,
+  ROOFLINE_IDEAL_GAS,
+  ROOFLINE_UPDATE_TILE_HALO,
+  ROOFLINE_UPDATE_HALO,
+  ROOFLINE_VISCOSITY,
+  ROOFLINE_CALC_DT,
+  ROOFLINE_PDV,
+  ROOFLINE_ACCELERATE,
+  ROOFLINE_FLUX_CALC,
+  ROOFLINE_ADVEC_CELL,
+  ROOFLINE_ADVEC_MOM,
+  ROOFLINE_RESET_FIELD,
+  ROOFLINE_FIELD_SUMMARY,
+  ROOFLINE_NUM_KERNELS
+} roofline_kernel;
+
+/**
+ * @brief Variant of the advection kernels, numbered as advec_mom's mom_sweep: 1 and 2 for the x and y sweeps of the
+ * first pass, 3 and 4 for the second pass. The variant of PdV is its predict flag, the other kernels have one variant.
+ */
+#define ROOFLINE_SWEEP(direction, sweep_number) ((direction) + 2 * ((sweep_number) - 1))
+
+typedef struct roofline_cost_t {
+  double flops;
+  double bytes_read;
+  double bytes_written;
+} roofline_cost;
+
+/**
+ * @brief Name of a kernel, as used by the trace and the profiler
+ */
+extern const char *roofline_name(roofline_kernel kernel);
+
+/**
+ * @brief Whether a kernel registers a model, false for the halo kernels
+ */
+extern bool roofline_has_model(roofline_kernel kernel);
+
+/**
+ * @brief Cost of one call of a kernel on the cells x_min..x_max by y_min..y_max, zero when it has no model
+ */
+extern roofline_cost roofline_model(roofline_kernel kernel, int variant, int x_min, int x_max, int y_min, int y_max);
@@ -16,18 +16,82 @@
  * CloverLeaf. If not, see http://www.gnu.org/licenses/. */
 
 /**
- *  @brief C kernel to update the external halo cells in a chunk.
+ *  @brief C kernel to update the halo cells between the tiles of a chunk.
  *  @author Niccolò Betto, Wayne Gaudin
- *  @details Updates halo cells for the required fields at the required depth
- *  for any halo cells that lie on an external boundary. The location and type
- *  of data governs how this is carried out. External boundaries are always
- *  reflective.
+ *  @details Copies the outer cells of the neighbouring tile into the halo
+ *  cells of the current one, for the required fields at the required depth.
+ *  Neighbours along x have the same height, and neighbours along y the same
+ *  width, but each tile has its own row length. Vertex and face data have one
+ *  extra row or column, shared with the neighbour, which is not copied.
  */
 
 #include "data.h"
 #include "ftocmacros.h"
 
-// clang-format on
+/**
+ * @brief Copies the halo of one field along x from the tile on the left (side < 0) or on the right (side > 0)
+ * @param x_inc 1 for vertex and x face data, which have one more column than the cells
+ * @param y_inc 1 for vertex and y face data, which have one more row than the cells
+ */
+static void copy_halo_x(
+    int side,
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *field,
+    int from_xmin,
+    int from_xmax,
+    double *from_field,
+    int x_inc,
+    int y_inc,
+    int depth
+) {
+  int j, k;
+
+  for (k = y_min - depth; k <= y_max + y_inc + depth; k++) {
+    for (j = 1; j <= depth; j++) {
+      if (side < 0)
+        field[FTNREF2D(x_min - j, k, x_max + 4 + x_inc, x_min - 2, y_min - 2)] =
+            from_field[FTNREF2D(from_xmax + 1 - j, k, from_xmax + 4 + x_inc, from_xmin - 2, y_min - 2)];
+      else
+        field[FTNREF2D(x_max + x_inc + j, k, x_max + 4 + x_inc, x_min - 2, y_min - 2)] =
+            from_field[FTNREF2D(from_xmin + x_inc - 1 + j, k, from_xmax + 4 + x_inc, from_xmin - 2, y_min - 2)];
+    }
+  }
+}
+
+/**
+ * @brief Copies the halo of one field along y from the tile below (side < 0) or above (side > 0)
+ */
+static void copy_halo_y(
+    int side,
+    int x_min,
+    int x_max,
+    int y_min,
+    int y_max,
+    double *field,
+    int from_ymin,
+    int from_ymax,
+    double *from_field,
+    int x_inc,
+    int y_inc,
+    int depth
+) {
+  int j, k;
+
+  for (k = 1; k <= depth; k++) {
+#pragma ivdep
+    for (j = x_min - depth; j <= x_max + x_inc + depth; j++) {
+      if (side < 0)
+        field[FTNREF2D(j, y_min - k, x_max + 4 + x_inc, x_min - 2, y_min - 2)] =
+            from_field[FTNREF2D(j, from_ymax + 1 - k, x_max + 4 + x_inc, x_min - 2, from_ymin - 2)];
+      else
+        field[FTNREF2D(j, y_max + y_inc + k, x_max + 4 + x_inc, x_min - 2, y_min - 2)] =
+            from_field[FTNREF2D(j, from_ymin + y_inc - 1 + k, x_max + 4 + x_inc, x_min - 2, from_ymin - 2)];
+    }
+  }
+}
 
 void kernel_update_tile_halo_l(
     int x_min,
@@ -71,142 +135,50 @@ void kernel_update_tile_halo_l(
     int fields[static NUM_FIELDS],
     int depth
 ) {
-  int j, k;
+  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, density0, left_xmin, left_xmax, left_density0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FTNREF1D(FIELD_DENSITY0, 1), 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        density0[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_density0[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, energy0, left_xmin, left_xmax, left_energy0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        density1[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_density1[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, pressure, left_xmin, left_xmax, left_pressure, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        energy0[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_energy0[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, viscosity, left_xmin, left_xmax, left_viscosity, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        energy1[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_energy1[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
-
-  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        pressure[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_pressure[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, soundspeed, left_xmin, left_xmax, left_soundspeed, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        viscosity[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_viscosity[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, density1, left_xmin, left_xmax, left_density1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        soundspeed[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_soundspeed[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, energy1, left_xmin, left_xmax, left_energy1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        xvel0[FTNREF2D(j, x_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            left_xvel0[FTNREF2D(left_xmax + 1 - j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, xvel0, left_xmin, left_xmax, left_xvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        xvel1[FTNREF2D(j, x_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            left_xvel1[FTNREF2D(left_xmax + 1 - j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, yvel0, left_xmin, left_xmax, left_yvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        yvel0[FTNREF2D(j, x_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            left_yvel0[FTNREF2D(left_xmax + 1 - j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, xvel1, left_xmin, left_xmax, left_xvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        yvel1[FTNREF2D(j, x_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            left_yvel1[FTNREF2D(left_xmax + 1 - j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, yvel1, left_xmin, left_xmax, left_yvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        vol_flux_x[FTNREF2D(j, x_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            left_vol_flux_x[FTNREF2D(left_xmax + 1 - j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, vol_flux_x, left_xmin, left_xmax, left_vol_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        mass_flux_x[FTNREF2D(j, x_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            left_mass_flux_x[FTNREF2D(left_xmax + 1 - j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, vol_flux_y, left_xmin, left_xmax, left_vol_flux_y, 0, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        vol_flux_y[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_vol_flux_y[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, mass_flux_x, left_xmin, left_xmax, left_mass_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        mass_flux_y[FTNREF2D(j, x_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            left_mass_flux_y[FTNREF2D(left_xmax + 1 - j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1)
+    copy_halo_x(-1, x_min, x_max, y_min, y_max, mass_flux_y, left_xmin, left_xmax, left_mass_flux_y, 0, 1, depth);
 }
 
 void kernel_update_tile_halo_r(
@@ -251,142 +223,50 @@ void kernel_update_tile_halo_r(
     int fields[static NUM_FIELDS],
     int depth
 ) {
-  int j, k;
+  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, density0, right_xmin, right_xmax, right_density0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        density0[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_density0[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, energy0, right_xmin, right_xmax, right_energy0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        density1[FTNREF2D(k, x_max + j, x_max + 4, x_min - 2, y_min - 2)] =
-            right_density1[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, pressure, right_xmin, right_xmax, right_pressure, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        energy0[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_energy0[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, viscosity, right_xmin, right_xmax, right_viscosity, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        energy1[FTNREF2D(k, x_max + j, x_max + 4, x_min - 2, y_min - 2)] =
-            right_energy1[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, soundspeed, right_xmin, right_xmax, right_soundspeed, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        pressure[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_pressure[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, density1, right_xmin, right_xmax, right_density1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        viscosity[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_viscosity[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, energy1, right_xmin, right_xmax, right_energy1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        soundspeed[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_soundspeed[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, xvel0, right_xmin, right_xmax, right_xvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        xvel0[FTNREF2D(x_max + 1 + j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            right_xvel0[FTNREF2D(right_xmin + 1 - 1 + j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, yvel0, right_xmin, right_xmax, right_yvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        xvel1[FTNREF2D(x_max + 1 + j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            right_xvel1[FTNREF2D(right_xmin + 1 - 1 + j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, xvel1, right_xmin, right_xmax, right_xvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        yvel0[FTNREF2D(x_max + 1 + j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            right_yvel0[FTNREF2D(right_xmin + 1 - 1 + j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
-
-  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        yvel1[FTNREF2D(x_max + 1 + j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            right_yvel1[FTNREF2D(right_xmin + 1 - 1 + j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, yvel1, right_xmin, right_xmax, right_yvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        vol_flux_x[FTNREF2D(x_max + 1 + j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            right_vol_flux_x[FTNREF2D(right_xmin + 1 - 1 + j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, vol_flux_x, right_xmin, right_xmax, right_vol_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        mass_flux_x[FTNREF2D(x_max + 1 + j, k, x_max + 5, x_min - 2, y_min - 2)] =
-            right_mass_flux_x[FTNREF2D(right_xmin + 1 - 1 + j, k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, vol_flux_y, right_xmin, right_xmax, right_vol_flux_y, 0, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        vol_flux_y[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_vol_flux_y[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, mass_flux_x, right_xmin, right_xmax, right_mass_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1) {
-    for (k = y_min - depth; k <= y_max + 1 + depth; k++) {
-      for (j = 0; j <= depth; j++) {
-        mass_flux_y[FTNREF2D(x_max + j, k, x_max + 4, x_min - 2, y_min - 2)] =
-            right_mass_flux_y[FTNREF2D(right_xmin - 1 + j, k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1)
+    copy_halo_x(1, x_min, x_max, y_min, y_max, mass_flux_y, right_xmin, right_xmax, right_mass_flux_y, 0, 1, depth);
 }
 
 void kernel_update_tile_halo_t(
@@ -431,142 +311,50 @@ void kernel_update_tile_halo_t(
     int fields[static NUM_FIELDS],
     int depth
 ) {
-  int j, k;
+  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, density0, top_ymin, top_ymax, top_density0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        density0[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_density0[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, energy0, top_ymin, top_ymax, top_energy0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        density1[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_density1[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, pressure, top_ymin, top_ymax, top_pressure, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        energy0[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_energy0[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, viscosity, top_ymin, top_ymax, top_viscosity, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        energy1[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_energy1[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, soundspeed, top_ymin, top_ymax, top_soundspeed, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        pressure[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_pressure[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, density1, top_ymin, top_ymax, top_density1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        viscosity[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_viscosity[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, energy1, top_ymin, top_ymax, top_energy1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        soundspeed[FTNREF2D(j, y_max + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_soundspeed[FTNREF2D(j, top_ymin - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, xvel0, top_ymin, top_ymax, top_xvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        xvel0[FTNREF2D(j, y_max + 1 + k, x_max + 5, x_min - 2, y_min - 2)] =
-            top_xvel0[FTNREF2D(j, top_ymin + 1 - 1 + k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, yvel0, top_ymin, top_ymax, top_yvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        xvel1[FTNREF2D(j, y_max + 1 + k, x_max + 5, x_min - 2, y_min - 2)] =
-            top_xvel1[FTNREF2D(j, top_ymin + 1 - 1 + k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, xvel1, top_ymin, top_ymax, top_xvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        yvel0[FTNREF2D(j, y_max + 1 + k, x_max + 5, x_min - 2, y_min - 2)] =
-            top_yvel0[FTNREF2D(j, top_ymin + 1 - 1 + k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, yvel1, top_ymin, top_ymax, top_yvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        yvel1[FTNREF2D(j, y_max + 1 + k, x_max + 5, x_min - 2, y_min - 2)] =
-            top_yvel1[FTNREF2D(j, top_ymin + 1 - 1 + k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, vol_flux_x, top_ymin, top_ymax, top_vol_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        vol_flux_x[FTNREF2D(j, y_max + k, x_max + 5, x_min - 2, y_min - 2)] =
-            top_vol_flux_x[FTNREF2D(j, top_ymin - 1 + k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, vol_flux_y, top_ymin, top_ymax, top_vol_flux_y, 0, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        mass_flux_x[FTNREF2D(j, y_max + k, x_max + 5, x_min - 2, y_min - 2)] =
-            top_mass_flux_x[FTNREF2D(j, top_ymin - 1 + k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, mass_flux_x, top_ymin, top_ymax, top_mass_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        vol_flux_y[FTNREF2D(j, y_max + 1 + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_vol_flux_y[FTNREF2D(j, top_ymin + 1 - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
-
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        mass_flux_y[FTNREF2D(j, y_max + 1 + k, x_max + 4, x_min - 2, y_min - 2)] =
-            top_mass_flux_y[FTNREF2D(j, top_ymin + 1 - 1 + k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1)
+    copy_halo_y(1, x_min, x_max, y_min, y_max, mass_flux_y, top_ymin, top_ymax, top_mass_flux_y, 0, 1, depth);
 }
 
 void kernel_update_tile_halo_b(
@@ -611,140 +399,48 @@ void kernel_update_tile_halo_b(
     int fields[static NUM_FIELDS],
     int depth
 ) {
-  int j, k;
+  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, density0, bottom_ymin, bottom_ymax, bottom_density0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        density0[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_density0[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, energy0, bottom_ymin, bottom_ymax, bottom_energy0, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        density1[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_density1[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, pressure, bottom_ymin, bottom_ymax, bottom_pressure, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        energy0[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_energy0[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, viscosity, bottom_ymin, bottom_ymax, bottom_viscosity, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        energy1[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_energy1[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, soundspeed, bottom_ymin, bottom_ymax, bottom_soundspeed, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_PRESSURE, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        pressure[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_pressure[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
-
-  if (fields[FTNREF1D(FIELD_VISCOSITY, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        viscosity[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_viscosity[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_DENSITY1, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, density1, bottom_ymin, bottom_ymax, bottom_density1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_SOUNDSPEED, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        soundspeed[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_soundspeed[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_ENERGY1, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, energy1, bottom_ymin, bottom_ymax, bottom_energy1, 0, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        xvel0[FTNREF2D(j, y_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            bottom_xvel0[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL0, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, xvel0, bottom_ymin, bottom_ymax, bottom_xvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        xvel1[FTNREF2D(j, y_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            bottom_xvel1[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, yvel0, bottom_ymin, bottom_ymax, bottom_yvel0, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL0, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        yvel0[FTNREF2D(j, y_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            bottom_yvel0[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_XVEL1, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, xvel1, bottom_ymin, bottom_ymax, bottom_xvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        yvel1[FTNREF2D(j, y_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            bottom_yvel1[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_YVEL1, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, yvel1, bottom_ymin, bottom_ymax, bottom_yvel1, 1, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        vol_flux_x[FTNREF2D(j, y_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            bottom_vol_flux_x[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_X, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, vol_flux_x, bottom_ymin, bottom_ymax, bottom_vol_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + 1 + depth; j++) {
-        mass_flux_x[FTNREF2D(j, y_min - k, x_max + 5, x_min - 2, y_min - 2)] =
-            bottom_mass_flux_x[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 5, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, vol_flux_y, bottom_ymin, bottom_ymax, bottom_vol_flux_y, 0, 1, depth);
 
-  if (fields[FTNREF1D(FIELD_VOL_FLUX_Y, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        vol_flux_y[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_vol_flux_y[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_X, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, mass_flux_x, bottom_ymin, bottom_ymax, bottom_mass_flux_x, 1, 0, depth);
 
-  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1) {
-    for (k = 0; k <= depth; k++) {
-      for (j = x_min - depth; j <= x_max + depth; j++) {
-        mass_flux_y[FTNREF2D(j, y_min - k, x_max + 4, x_min - 2, y_min - 2)] =
-            bottom_mass_flux_y[FTNREF2D(j, bottom_ymax + 1 - k, x_max + 4, x_min - 2, y_min - 2)];
-      }
-    }
-  }
+  if (fields[FTNREF1D(FIELD_MASS_FLUX_Y, 1)] == 1)
+    copy_halo_y(-1, x_min, x_max, y_min, y_max, mass_flux_y, bottom_ymin, bottom_ymax, bottom_mass_flux_y, 0, 1, depth);
 }
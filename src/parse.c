@@ -10,16 +10,17 @@
 #include "data.h"
 #include "report.h"
 #include "utils/string.h"
+#include "utils/thread_local.h"
 
-static FILE *file;  // iu: current file
+static BATCH_LOCAL FILE *file;  // iu: current file
 
-char line_buf[100];  // Line buffer
+BATCH_LOCAL char line_buf[100];  // Line buffer
 
-char *line;
-char *mask;  // mask: section of the file the user is interested in
-char *rest;
-char cur_section[100];  // here: section the parser is currently in
-char active_sel[100];   // sel: active selector (*select: statement)
+BATCH_LOCAL char *line;
+BATCH_LOCAL char *mask;  // mask: section of the file the user is interested in
+BATCH_LOCAL char *rest;
+BATCH_LOCAL char cur_section[100];  // here: section the parser is currently in
+BATCH_LOCAL char active_sel[100];   // sel: active selector (*select: statement)
 
 int parse_init(FILE *p_file, char *cmask) {
   file = p_file;
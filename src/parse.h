@@ -6,7 +6,9 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-extern char *line;
+#include "utils/thread_local.h"
+
+extern BATCH_LOCAL char *line;
 
 extern int parse_init(FILE *file, const char *mask);
 
@@ -0,0 +1,295 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "profiler.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "report.h"
+#include "team.h"
+#include "trace.h"
+#include "utils/math.h"
+#include "utils/stream.h"
+#include "utils/timer.h"
+
+#define NUM_PROFILER_SLOTS (int)(sizeof(profiler_type) / sizeof(double))
+
+// Size of a last level cache line, the traffic of each miss
+#define CACHE_LINE_BYTES 64
+
+// Rows of the profiler table, in the order they are printed, with the name of their column of the trace CSV file
+static const struct {
+  const char *name;
+  const char *column;
+  size_t offset;
+} profiler_rows[NUM_PROFILER_SLOTS] = {
+    {"Timestep", "timestep", offsetof(profiler_type, timestep)},
+    {"Ideal Gas", "ideal_gas", offsetof(profiler_type, ideal_gas)},
+    {"Viscosity", "viscosity", offsetof(profiler_type, viscosity)},
+    {"PdV", "pdv", offsetof(profiler_type, PdV)},
+    {"Acceleration", "acceleration", offsetof(profiler_type, acceleration)},
+    {"Lagrangian blocks", "lagrangian", offsetof(profiler_type, lagrangian)},
+    {"Cell advection", "cell_advection", offsetof(profiler_type, cell_advection)},
+    {"Momentum advection", "mom_advection", offsetof(profiler_type, mom_advection)},
+    {"Reset", "reset", offsetof(profiler_type, reset)},
+    {"Summary", "summary", offsetof(profiler_type, summary)},
+    {"Visit", "visit", offsetof(profiler_type, visit)},
+    {"Tile halo exchange", "tile_halo_exchange", offsetof(profiler_type, tile_halo_exchange)},
+    {"Self halo exchange", "self_halo_exchange", offsetof(profiler_type, self_halo_exchange)},
+    {"MPI halo exchange", "mpi_halo_exchange", offsetof(profiler_type, mpi_halo_exchange)},
+};
+
+// Counter totals of a member of the team for each profiler slot, in the order of the profiler_type fields
+typedef struct member_counts_t {
+  _Alignas(64) perf_counts slot[NUM_PROFILER_SLOTS];
+} member_counts;
+
+// Time and modelled cost of the kernel calls on tiles, by kernel
+typedef struct roofline_totals_t {
+  double time;
+  roofline_cost cost;
+} roofline_totals;
+
+typedef struct member_totals_t {
+  _Alignas(64) roofline_totals kernel[ROOFLINE_NUM_KERNELS];
+} member_totals;
+
+// Every member accounts to its own totals, on cache lines of their own, which are added up when printing
+static BATCH_LOCAL member_counts *slot_counts = NULL;
+static BATCH_LOCAL member_totals *kernel_totals = NULL;
+static BATCH_LOCAL int num_members = 0;
+static BATCH_LOCAL bool counters_on = false;
+
+/**
+ * @brief Opens the hardware counters of the calling member
+ */
+static void open_counters() {
+  perf_counters_open(team_member());
+}
+
+void profiler_open() {
+  profiler_close();
+  memset(&profiler, 0, sizeof(profiler));
+
+  num_members = team_size();
+  slot_counts = aligned_alloc(64, num_members * sizeof(member_counts));
+  kernel_totals = aligned_alloc(64, num_members * sizeof(member_totals));
+  if (slot_counts == NULL || kernel_totals == NULL)
+    report_error("profiler_open", "Error allocating the profiler totals.");
+  memset(slot_counts, 0, num_members * sizeof(member_counts));
+  memset(kernel_totals, 0, num_members * sizeof(member_totals));
+
+  // Probe the roofline ceiling now, before the wall clock starts
+  stream_bandwidth();
+
+  perf_counters_init(num_members);
+  team_run(open_counters);
+  counters_on = perf_counters_available(PERF_CYCLES);
+
+  if (trace_on) {
+    const char *columns[NUM_PROFILER_SLOTS];
+    for (int row = 0; row < NUM_PROFILER_SLOTS; row++)
+      columns[row] = profiler_rows[row].column;
+    trace_open(NUM_PROFILER_SLOTS, columns);
+  }
+}
+
+void profiler_close() {
+  perf_counters_close();
+  counters_on = false;
+  trace_close();
+
+  free(slot_counts);
+  free(kernel_totals);
+  slot_counts = NULL;
+  kernel_totals = NULL;
+  num_members = 0;
+}
+
+/**
+ * @brief Traces a region of a profiler slot
+ */
+static void trace_slot(const double *slot, double start, double end) {
+  size_t offset = (const char *)slot - (const char *)&profiler;
+
+  for (int row = 0; row < NUM_PROFILER_SLOTS; row++) {
+    if (profiler_rows[row].offset == offset)
+      trace_region(row, profiler_rows[row].name, start, end);
+  }
+}
+
+void profiler_start(profiler_sample *sample) {
+  if (counters_on)
+    perf_counters_read(team_member(), &sample->counts);
+  sample->time = timer();
+}
+
+void profiler_stop(const profiler_sample *sample, double *slot) {
+  if (counters_on) {
+    perf_counts counts;
+    perf_counters_read(team_member(), &counts);
+
+    perf_counts *totals = &slot_counts[team_member()].slot[slot - (double *)&profiler];
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+      totals->value[c] += counts.value[c] - sample->counts.value[c];
+  }
+
+  if (!team_master())
+    return;
+
+  double now = timer();
+  *slot += now - sample->time;
+
+  if (trace_on)
+    trace_slot(slot, sample->time, now);
+}
+
+double profiler_tile_start() {
+  return profiler_on ? timer() : 0.0;
+}
+
+void profiler_tile_stop(roofline_kernel kernel, int variant, int tile, double start) {
+  if (profiler_on)
+    profiler_band_stop(kernel, variant, tile, chunk.tiles[tile].t_ymin, chunk.tiles[tile].t_ymax, start);
+}
+
+void profiler_band_stop(roofline_kernel kernel, int variant, int tile, int y_min, int y_max, double start) {
+  // The kernels run before the profiler is opened aren't accounted
+  if (!profiler_on || kernel_totals == NULL)
+    return;
+
+  double now = timer();
+  const tile_type *t = &chunk.tiles[tile];
+  roofline_cost cost = roofline_model(kernel, variant, t->t_xmin, t->t_xmax, y_min, y_max);
+
+  roofline_totals *totals = &kernel_totals[team_member()].kernel[kernel];
+  totals->time += now - start;
+  totals->cost.flops += cost.flops;
+  totals->cost.bytes_read += cost.bytes_read;
+  totals->cost.bytes_written += cost.bytes_written;
+
+  trace_tile(roofline_name(kernel), tile, start, now);
+}
+
+void profiler_task(double *slot, double start) {
+  double now = timer();
+
+  // The members may add to the same slot at once
+  atomic_add(slot, now - start);
+
+  if (trace_on)
+    trace_slot(slot, start, now);
+}
+
+/**
+ * @brief Prints a ratio, or n/a when a counter is missing or the denominator is zero
+ */
+static void print_ratio(FILE *out, int width, double numerator, double denominator, bool available) {
+  if (available && denominator > 0.0)
+    fprintf(out, "%*.2f", width, numerator / denominator);
+  else
+    fprintf(out, "%*s", width, "n/a");
+}
+
+/**
+ * @brief Prints the counter columns of a row of the profiler table
+ */
+static void print_counters(FILE *out, const perf_counts *counts, double time) {
+  const double *value = counts->value;
+  bool ipc = perf_counters_available(PERF_INSTRUCTIONS);
+  bool llc = perf_counters_available(PERF_LLC_MISSES);
+  bool fp = perf_counters_available(PERF_FP_PACKED);
+
+  print_ratio(out, 10, value[PERF_INSTRUCTIONS], value[PERF_CYCLES], ipc);
+  print_ratio(out, 12, 100.0 * value[PERF_LLC_MISSES], value[PERF_LLC_REFERENCES], llc);
+  print_ratio(out, 12, 1.0e-9 * CACHE_LINE_BYTES * value[PERF_LLC_MISSES], time, llc);
+  print_ratio(out, 12, 100.0 * value[PERF_FP_PACKED], value[PERF_FP_SCALAR] + value[PERF_FP_PACKED], fp);
+}
+
+/**
+ * @brief Prints the achieved throughput of every kernel with a model, against the STREAM bandwidth
+ */
+static void print_roofline(FILE *out) {
+  double stream = stream_bandwidth();
+
+  fprintf(out, "\n%-22s%16s%12s%12s%12s%12s\n", "Roofline", "Time", "GFLOP/s", "GB/s", "Flop/byte", "% STREAM");
+
+  for (int kernel = 0; kernel < ROOFLINE_NUM_KERNELS; kernel++) {
+    roofline_totals totals = {0};
+    for (int m = 0; m < num_members; m++) {
+      const roofline_totals *member = &kernel_totals[m].kernel[kernel];
+      totals.time += member->time;
+      totals.cost.flops += member->cost.flops;
+      totals.cost.bytes_read += member->cost.bytes_read;
+      totals.cost.bytes_written += member->cost.bytes_written;
+    }
+    if (!roofline_has_model(kernel) || totals.time <= 0.0)
+      continue;
+
+    double bytes = totals.cost.bytes_read + totals.cost.bytes_written;
+    fprintf(
+        out,
+        "\n%-22s:%16.4f%12.2f%12.2f%12.2f",
+        roofline_name(kernel),
+        totals.time,
+        1.0e-9 * totals.cost.flops / totals.time,
+        1.0e-9 * bytes / totals.time,
+        totals.cost.flops / bytes
+    );
+    print_ratio(out, 12, 100.0 * bytes / totals.time, stream, true);
+    fputc('\n', out);
+  }
+
+  if (stream > 0.0)
+    fprintf(out, "\n%-22s:%16.2f GB/s\n", "STREAM triad", 1.0e-9 * stream);
+  else
+    fprintf(out, "\n%-22s:%16s\n", "STREAM triad", "n/a");
+}
+
+void profiler_print(FILE *out, double wall_clock) {
+  const double *slots = (const double *)&profiler;
+
+  fprintf(out, "\n%-22s%16s%20s", "Profiler Output", "Time", "Percentage");
+  if (counters_on)
+    fprintf(out, "%10s%12s%12s%12s", "IPC", "LLC miss %", "LLC GB/s", "FP vector %");
+  fputc('\n', out);
+
+  double kernel_total = 0.0;
+  perf_counts total_counts = {0};
+
+  for (int row = 0; row < NUM_PROFILER_SLOTS; row++) {
+    int slot = profiler_rows[row].offset / sizeof(double);
+
+    // The counts of every member, over the time of the region
+    perf_counts counts = {0};
+    for (int m = 0; m < num_members; m++)
+      for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+        counts.value[c] += slot_counts[m].slot[slot].value[c];
+
+    fprintf(out, "\n%-22s:%16.4f%16.4f", profiler_rows[row].name, slots[slot], slots[slot] / wall_clock * 100);
+    if (counters_on)
+      print_counters(out, &counts, slots[slot]);
+    fputc('\n', out);
+
+    kernel_total += slots[slot];
+    for (int c = 0; c < PERF_NUM_COUNTERS; c++)
+      total_counts.value[c] += counts.value[c];
+  }
+
+  fprintf(out, "\n%-22s:%16.4f%16.4f", "Total", kernel_total, kernel_total / wall_clock * 100);
+  if (counters_on)
+    print_counters(out, &total_counts, kernel_total);
+  fputc('\n', out);
+
+  double rest = wall_clock - kernel_total;
+  fprintf(out, "\n%-22s:%16.4f%16.4f\n", "The Rest", rest, rest / wall_clock * 100);
+
+  if (!counters_on)
+    fprintf(out, "\nHardware counters unavailable: %s\n", perf_counters_error());
+
+  print_roofline(out);
+  trace_print(out);
+}
@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Per kernel timings and hardware counters, enabled by the profiler_on deck keyword
+ * @details A profiled region is delimited by profiler_start() and profiler_stop(), which adds its wall time to one of
+ * the profiler_type slots and its counter deltas to the matching counter totals. Regions may nest, each keeps its own
+ * sample. With trace_on, the regions are also recorded by the trace (see trace.h). In a team region only the master
+ * times them, each driver ending its kernels with a barrier, so a region spans the whole team's work (see team.h).
+ * Every member counts its own hardware events over the region, the counters pausing while it waits at a barrier, and
+ * the table adds up the counts of the members. The tasks of a dataflow are accounted by profiler_task() instead (see
+ * flow.h).
+ *
+ * Each kernel call on a tile is delimited by profiler_tile_start() and profiler_tile_stop() instead, which account its
+ * time and the cost given by its roofline model (see kernels/roofline.h) to the kernel, for the roofline table. Every
+ * member of a team accounts its tiles to totals of its own, so the roofline times add up the time of every thread.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+#include "kernels/roofline.h"
+#include "utils/perf_counters.h"
+
+typedef struct profiler_sample_t {
+  double time;
+  perf_counts counts;
+} profiler_sample;
+
+/**
+ * @brief Clears the totals and opens the hardware counters and the trace, called before the first step when profiling
+ */
+extern void profiler_open();
+
+/**
+ * @brief Closes the hardware counters and the trace, safe to call when they aren't open
+ */
+extern void profiler_close();
+
+/**
+ * @brief Starts a profiled region, called by every member of a team region
+ */
+extern void profiler_start(profiler_sample *sample);
+
+/**
+ * @brief Ends a profiled region, accounting it to a slot of the profiler global
+ * @param slot A field of profiler, e.g. &profiler.PdV
+ */
+extern void profiler_stop(const profiler_sample *sample, double *slot);
+
+/**
+ * @brief Start time of a kernel call on one tile, 0 when not profiling
+ */
+extern double profiler_tile_start();
+
+/**
+ * @brief Ends a kernel call on one tile, accounting its time and modelled cost to the kernel and tracing it
+ * @param variant The variant of the kernel's model
+ * @param start The value returned by profiler_tile_start()
+ */
+extern void profiler_tile_stop(roofline_kernel kernel, int variant, int tile, double start);
+
+/**
+ * @brief Ends a kernel call on the rows y_min to y_max of a tile, as profiler_tile_stop() does for the whole tile
+ */
+extern void profiler_band_stop(roofline_kernel kernel, int variant, int tile, int y_min, int y_max, double start);
+
+/**
+ * @brief Accounts the time since start to a slot of the profiler global, from any member of a team, and traces it as a
+ * region of the member, for the tasks of flow_run() (see flow.h)
+ */
+extern void profiler_task(double *slot, double start);
+
+/**
+ * @brief Prints the profiler table: time, percentage of the wall clock and, when the counters are available, IPC,
+ * last level cache miss rate, bandwidth of the cache misses and fraction of packed floating point instructions.
+ * The roofline table follows, with the achieved GFLOP/s and GB/s of each kernel against the STREAM bandwidth, then the
+ * step latency percentiles when tracing.
+ */
+extern void profiler_print(FILE *out, double wall_clock);
@@ -9,7 +9,8 @@
 void report_error_arg(const char *location, const char *error, const char *arg) {
   const char *format = "\nError in %s: %s%s\n\nCLOVER is terminating.\n";
 
-  fprintf(stdout, format, location, error, arg);
+  // The console of the run, its clover.log in batch runs
+  fprintf(g_stdout != NULL ? g_stdout : stdout, format, location, error, arg);
   if (g_out != NULL)
     fprintf(g_out, format, location, error, arg);
 
@@ -0,0 +1,255 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "shm_export.h"
+
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "data.h"
+#include "definitions.h"
+#include "report.h"
+
+/**
+ * @file allocate.c
+ */
+extern void field_set_arena(void *arena, size_t size);
+
+static BATCH_LOCAL shm_header *header = NULL;
+static BATCH_LOCAL size_t segment_size = 0;
+
+// Where build_field() places the arrays: the only slot of the segment, or private memory when double buffered
+static BATCH_LOCAL char *arena = NULL;
+
+// Arrays holding the state at the end of a step, the others only hold intermediate values of the kernels
+static const size_t state_arrays[] = {
+    offsetof(field_type, density0),
+    offsetof(field_type, energy0),
+    offsetof(field_type, pressure),
+    offsetof(field_type, viscosity),
+    offsetof(field_type, soundspeed),
+    offsetof(field_type, xvel0),
+    offsetof(field_type, yvel0),
+    offsetof(field_type, vol_flux_x),
+    offsetof(field_type, mass_flux_x),
+    offsetof(field_type, vol_flux_y),
+    offsetof(field_type, mass_flux_y),
+};
+
+#define NUM_STATE_ARRAYS (sizeof(state_arrays) / sizeof(state_arrays[0]))
+
+// The mesh geometry, from cellx to yarea at the end of field_type, never changes after initialisation
+#define NUM_GEOMETRY_ARRAYS 11
+#define NUM_EXPORTED_ARRAYS (NUM_STATE_ARRAYS + NUM_GEOMETRY_ARRAYS)
+
+// Number of snapshots published so far, each double buffered slot gets a copy of the geometry the first time
+static BATCH_LOCAL int published = 0;
+
+/**
+ * @brief Layout of the i-th exported array, the state arrays first followed by the geometry
+ */
+static const field_array_type *exported_array(int i) {
+  if (i >= (int)NUM_STATE_ARRAYS)
+    return &field_arrays[NUM_FIELD_ARRAYS - NUM_GEOMETRY_ARRAYS + i - NUM_STATE_ARRAYS];
+
+  for (int a = 0;; a++) {
+    if (field_arrays[a].offset == state_arrays[i])
+      return &field_arrays[a];
+  }
+}
+
+static const double *array_data(const tile_type *tile, const field_array_type *array) {
+  return *(double *const *)((const char *)&tile->field + array->offset);
+}
+
+static size_t round_up(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * @brief Number of elements of one field array of the given tile
+ */
+static size_t array_elements(const field_array_type *array, const tile_type *tile) {
+  size_t columns = array->x_extra != 0 ? tile->t_xmax - tile->t_xmin + 1 + array->x_extra : 1;
+  size_t rows = array->y_extra != 0 ? tile->t_ymax - tile->t_ymin + 1 + array->y_extra : 1;
+  return columns * rows;
+}
+
+static void set_sequence(shm_slot *slot, uint64_t sequence) {
+  __atomic_store_n(&slot->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+void shm_export_create() {
+  if (shm_export_name[0] == '\0')
+    return;
+
+  // Same size and alignment as field_alloc() uses within the arena
+  size_t data_size = 0;
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    for (int a = 0; a < NUM_FIELD_ARRAYS; a++)
+      data_size += round_up(array_elements(&field_arrays[a], &chunk.tiles[tile]) * sizeof(double), 64);
+  }
+
+  int num_slots = shm_export_buffered ? 2 : 1;
+  size_t tiles_offset = round_up(sizeof(shm_header), 64);
+  size_t arrays_offset = round_up(tiles_offset + tiles_per_chunk * sizeof(shm_tile), 64);
+  size_t data_offset = round_up(arrays_offset + tiles_per_chunk * NUM_EXPORTED_ARRAYS * sizeof(shm_array), 4096);
+  size_t slot_size = round_up(data_size, 4096);
+  segment_size = data_offset + num_slots * slot_size;
+
+  int fd = shm_open(shm_export_name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+  if (fd < 0)
+    report_error_arg("shm_export_create", "Error creating shared memory segment ", shm_export_name);
+
+  if (ftruncate(fd, segment_size) != 0) {
+    close(fd);
+    report_error_arg("shm_export_create", "Error sizing shared memory segment ", shm_export_name);
+  }
+
+  void *segment = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (segment == MAP_FAILED)
+    report_error_arg("shm_export_create", "Error mapping shared memory segment ", shm_export_name);
+
+  // The segment starts zeroed, readers ignore it until the magic number is set by shm_export_start()
+  header = segment;
+  header->version = SHM_EXPORT_VERSION;
+  header->num_tiles = tiles_per_chunk;
+  header->num_arrays = NUM_EXPORTED_ARRAYS;
+  header->num_slots = num_slots;
+  header->tiles_offset = tiles_offset;
+  header->arrays_offset = arrays_offset;
+  header->data_size = data_size;
+  header->x_cells = grid.x_cells;
+  header->y_cells = grid.y_cells;
+  header->xmin = grid.xmin;
+  header->ymin = grid.ymin;
+  header->xmax = grid.xmax;
+  header->ymax = grid.ymax;
+  for (int slot = 0; slot < num_slots; slot++)
+    header->data_offset[slot] = data_offset + slot * slot_size;
+
+  if (shm_export_buffered) {
+    arena = aligned_alloc(4096, slot_size);
+    if (arena == NULL)
+      report_error("shm_export_create", "Error allocating the field arrays");
+  } else {
+    arena = (char *)segment + data_offset;
+  }
+
+  field_set_arena(arena, data_size);
+}
+
+void shm_export_start() {
+  if (header == NULL)
+    return;
+
+  shm_tile *tiles = (shm_tile *)((char *)header + header->tiles_offset);
+  shm_array *arrays = (shm_array *)((char *)header + header->arrays_offset);
+
+  for (int tile = 0; tile < tiles_per_chunk; tile++) {
+    const tile_type *cur_tile = &chunk.tiles[tile];
+
+    tiles[tile] = (shm_tile){
+        .x_min = cur_tile->t_xmin,
+        .x_max = cur_tile->t_xmax,
+        .y_min = cur_tile->t_ymin,
+        .y_max = cur_tile->t_ymax,
+        .left = cur_tile->t_left,
+        .bottom = cur_tile->t_bottom,
+    };
+
+    for (int a = 0; a < (int)NUM_EXPORTED_ARRAYS; a++) {
+      const field_array_type *array = exported_array(a);
+      shm_array *desc = &arrays[tile * NUM_EXPORTED_ARRAYS + a];
+
+      strncpy(desc->name, array->name, sizeof(desc->name) - 1);
+      desc->offset = (const char *)array_data(cur_tile, array) - arena;
+      desc->x_lo = array->x_extra != 0 ? cur_tile->t_xmin - 2 : 0;
+      desc->x_hi = array->x_extra != 0 ? cur_tile->t_xmax + array->x_extra - 2 : 0;
+      desc->y_lo = array->y_extra != 0 ? cur_tile->t_ymin - 2 : 0;
+      desc->y_hi = array->y_extra != 0 ? cur_tile->t_ymax + array->y_extra - 2 : 0;
+      desc->x_stagger = array->x_extra == 5;
+      desc->y_stagger = array->y_extra == 5;
+    }
+  }
+
+  shm_export_end_step();
+
+  __atomic_store_n(&header->magic, SHM_EXPORT_MAGIC, __ATOMIC_RELEASE);
+}
+
+void shm_export_begin_step() {
+  if (header == NULL || shm_export_buffered)
+    return;
+
+  // The arrays are updated in place from now on
+  set_sequence(&header->slots[0], header->slots[0].sequence + 1);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+void shm_export_end_step() {
+  if (header == NULL)
+    return;
+
+  int slot = shm_export_buffered ? 1 - header->latest : 0;
+  shm_slot *cur_slot = &header->slots[slot];
+
+  if (shm_export_buffered) {
+    set_sequence(cur_slot, cur_slot->sequence + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // The arrays sit at the same offsets in the slot as in the arena
+    int num_arrays = published < 2 ? NUM_EXPORTED_ARRAYS : NUM_STATE_ARRAYS;
+    for (int tile = 0; tile < tiles_per_chunk; tile++) {
+      for (int a = 0; a < num_arrays; a++) {
+        const field_array_type *array = exported_array(a);
+        const double *data = array_data(&chunk.tiles[tile], array);
+
+        memcpy(
+            (char *)header + header->data_offset[slot] + ((const char *)data - arena),
+            data,
+            array_elements(array, &chunk.tiles[tile]) * sizeof(double)
+        );
+      }
+    }
+  }
+
+  cur_slot->step = step;
+  cur_slot->time = time_val;
+  cur_slot->dt = dt;
+
+  // Back to even, the snapshot is complete
+  if (cur_slot->sequence % 2 == 1)
+    set_sequence(cur_slot, cur_slot->sequence + 1);
+  __atomic_store_n(&header->latest, slot, __ATOMIC_RELEASE);
+  published++;
+}
+
+void shm_export_unlink() {
+  if (header != NULL && shm_export_name[0] != '\0') {
+    shm_unlink(shm_export_name);
+    shm_export_name[0] = '\0';
+  }
+}
+
+void shm_export_destroy() {
+  if (header == NULL)
+    return;
+
+  shm_export_unlink();
+
+  field_set_arena(NULL, 0);
+  if (shm_export_buffered)
+    free(arena);
+  arena = NULL;
+
+  munmap(header, segment_size);
+  header = NULL;
+  segment_size = 0;
+  published = 0;
+}
@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Export of the field arrays to a POSIX shared memory segment, for live analysis by other processes
+ * @details Enabled by the shm_export=name deck keyword, the segment is created as /name. It starts with a shm_header,
+ * followed by the shm_tile and shm_array descriptors and by the data of one or two slots. The arrays exported are the
+ * ones holding the state at the end of a step, and the mesh geometry.
+ *
+ * By default the tiles' arrays live in the segment itself: there is a single slot, whose sequence is odd while a step
+ * is updating it, up to the field summary and visit output of the step, whose equation of state rewrites the pressure
+ * and soundspeed. With the shm_double_buffer keyword, the arrays stay private and the state is copied after each step
+ * to the slot not holding the latest snapshot, so that readers always find a complete one.
+ *
+ * A reader gets a consistent snapshot as with a seqlock:
+ *
+ *   do {
+ *     slot = header->latest;
+ *     seq = header->slots[slot].sequence;  // retry if odd
+ *     ...read from data_offset[slot]...
+ *   } while (header->slots[slot].sequence != seq);
+ *
+ * The segment is unlinked when the calculation finishes, existing mappings stay valid.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define SHM_EXPORT_MAGIC   0x52564c43  // "CLVR"
+#define SHM_EXPORT_VERSION 1
+
+typedef struct shm_slot_t {
+  uint64_t sequence;  // Odd while the slot is being written
+  int64_t step;
+  double time;
+  double dt;
+} shm_slot;  // 32 bytes
+
+typedef struct shm_tile_t {
+  int32_t x_min;
+  int32_t x_max;
+  int32_t y_min;
+  int32_t y_max;
+  int32_t left;    // Global index of the tile's first cell, counting from 1
+  int32_t bottom;
+} shm_tile;  // 24 bytes
+
+/**
+ * @brief One field array of one tile
+ * @details Element (j, k) is at offset + ((k - y_lo) * (x_hi - x_lo + 1) + (j - x_lo)) * sizeof(double) from the start of
+ * the slot's data. A direction the array doesn't extend in has a zero range.
+ */
+typedef struct shm_array_t {
+  char name[16];
+  uint64_t offset;
+  int32_t x_lo, x_hi;
+  int32_t y_lo, y_hi;
+  int32_t x_stagger;  // 1 for vertex or face data, with one element more than the cells, 0 for cell centred data
+  int32_t y_stagger;
+} shm_array;  // 48 bytes
+
+typedef struct shm_header_t {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t num_tiles;
+  uint32_t num_arrays;  // Per tile
+  uint32_t num_slots;
+  uint32_t latest;      // Slot holding the latest snapshot
+
+  uint64_t tiles_offset;   // shm_tile[num_tiles]
+  uint64_t arrays_offset;  // shm_array[num_tiles][num_arrays]
+  uint64_t data_offset[2];
+  uint64_t data_size;
+
+  int32_t x_cells;
+  int32_t y_cells;
+  double xmin;
+  double ymin;
+  double xmax;
+  double ymax;
+
+  shm_slot slots[2];
+} shm_header;
+
+/**
+ * @brief Creates the segment and makes build_field() place the arrays in it, or in private memory when double buffered
+ * @details Called once the tiles are decomposed, before build_field()
+ */
+extern void shm_export_create();
+
+/**
+ * @brief Fills in the array descriptors and publishes the initial state, called after the chunk has been generated
+ */
+extern void shm_export_start();
+
+/**
+ * @brief Marks the start of a step that will modify the fields
+ */
+extern void shm_export_begin_step();
+
+/**
+ * @brief Publishes the state at the end of a step
+ */
+extern void shm_export_end_step();
+
+/**
+ * @brief Removes the segment's name, readers already mapping it keep their view of the last snapshot
+ */
+extern void shm_export_unlink();
+
+/**
+ * @brief Unmaps the segment, called after destroy_field()
+ */
+extern void shm_export_destroy();
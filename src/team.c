@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#define _GNU_SOURCE
+
+#include "team.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "data.h"
+#include "definitions.h"
+#include "report.h"
+#include "utils/math.h"
+#include "utils/perf_counters.h"
+#include "utils/topology.h"
+
+// Polls of a barrier before the waiting member yields its CPU, for when there are more members than CPUs
+#define TEAM_SPINS 4096
+
+// Polls of the region counter before an idle worker blocks
+#define TEAM_IDLE_SPINS 65536
+
+static BATCH_LOCAL int size = 1;
+static BATCH_LOCAL pthread_t *workers = NULL;
+
+// The tiles of member m are first_tile[m] to first_tile[m + 1] - 1
+static BATCH_LOCAL int *first_tile = NULL;
+
+// The region being run, started by bumping generation
+static BATCH_LOCAL void (*region)() = NULL;
+static BATCH_LOCAL bool running = false;
+static BATCH_LOCAL bool stopping = false;
+static BATCH_LOCAL unsigned generation;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t started = PTHREAD_COND_INITIALIZER;
+
+// The barrier: members still to arrive, and the sense the last one flips
+static BATCH_LOCAL int arrived;
+static BATCH_LOCAL bool sense;
+
+static BATCH_LOCAL void *slots = NULL;
+static BATCH_LOCAL size_t slots_size = 0;
+
+// The CPU and NUMA node each member is pinned to, NULL when the team isn't pinned
+static BATCH_LOCAL int *member_cpu = NULL;
+static BATCH_LOCAL int *member_node = NULL;
+static BATCH_LOCAL cpu_set_t master_affinity;
+
+// Per member rather than per deck, so plain thread local storage whatever BATCH_LOCAL is
+static __thread int member = 0;
+static __thread bool local_sense = false;
+
+/**
+ * @brief The barrier of a region, pausing the hardware counters of a member while it waits so that the profiler only
+ * counts its work (see profiler.h). Not at the end of the region, after which the master may close the counters.
+ */
+static void barrier(bool pause_counters) {
+  if (!running)
+    return;
+
+  local_sense = !local_sense;
+  if (__atomic_sub_fetch(&arrived, 1, __ATOMIC_ACQ_REL) == 0) {
+    __atomic_store_n(&arrived, size, __ATOMIC_RELAXED);
+    __atomic_store_n(&sense, local_sense, __ATOMIC_RELEASE);
+    return;
+  }
+
+  if (pause_counters)
+    perf_counters_pause(member);
+
+  for (int spins = 0; __atomic_load_n(&sense, __ATOMIC_ACQUIRE) != local_sense; spins++) {
+    if (spins >= TEAM_SPINS)
+      sched_yield();
+  }
+
+  if (pause_counters)
+    perf_counters_resume(member);
+}
+
+static void *worker(void *arg) {
+  member = (int)(intptr_t)arg;
+  unsigned seen = 0;
+
+  while (true) {
+    int spins = 0;
+    while (__atomic_load_n(&generation, __ATOMIC_ACQUIRE) == seen && spins < TEAM_IDLE_SPINS)
+      spins++;
+
+    pthread_mutex_lock(&lock);
+    while (generation == seen)
+      pthread_cond_wait(&started, &lock);
+    seen = generation;
+    bool stop = stopping;
+    pthread_mutex_unlock(&lock);
+
+    if (stop)
+      break;
+
+    region();
+    barrier(false);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Starts the workers waiting on generation, or has them exit
+ */
+static void start_workers(bool stop) {
+  pthread_mutex_lock(&lock);
+  stopping = stop;
+  __atomic_store_n(&generation, generation + 1, __ATOMIC_RELEASE);
+  pthread_cond_broadcast(&started);
+  pthread_mutex_unlock(&lock);
+}
+
+/**
+ * @brief Chooses a CPU for every member: the members are split into consecutive groups over the NUMA nodes, in
+ * proportion to the CPUs of each node, so that consecutive tiles stay on one node, and each member of a group takes the
+ * next CPU of its node, a core of its own first (see utils/topology.h)
+ * @return Whether the CPUs could be read
+ */
+static bool place() {
+  int *cpus = malloc(CPU_SETSIZE * sizeof(int));
+  int *nodes = malloc(CPU_SETSIZE * sizeof(int));
+  member_cpu = malloc(size * sizeof(int));
+  member_node = malloc(size * sizeof(int));
+  if (cpus == NULL || nodes == NULL || member_cpu == NULL || member_node == NULL)
+    report_error("team_open", "Error allocating the team.");
+
+  int num = topology_cpus(cpus, nodes, CPU_SETSIZE);
+
+  // The CPUs of a node are cpus[start] to cpus[end - 1], its members from size * start / num
+  for (int start = 0, end; start < num; start = end) {
+    for (end = start; end < num && nodes[end] == nodes[start]; end++)
+      ;
+
+    int first = (int)((long)size * start / num);
+    int last = (int)((long)size * end / num);
+    for (int m = first; m < last; m++) {
+      member_cpu[m] = cpus[start + (m - first) % (end - start)];
+      member_node[m] = nodes[start];
+    }
+  }
+
+  free(cpus);
+  free(nodes);
+  return num > 0;
+}
+
+static pthread_t member_thread(int m) {
+  return m == 0 ? pthread_self() : workers[m - 1];
+}
+
+/**
+ * @brief Pins the members to their CPUs, the master included, whose affinity is restored by team_close()
+ * @return An error message, NULL once pinned
+ */
+static const char *pin() {
+  cpu_set_t set;
+
+  if (!place())
+    return "the CPUs available can't be read";
+
+  if (pthread_getaffinity_np(pthread_self(), sizeof(master_affinity), &master_affinity) != 0)
+    return "the affinity can't be read";
+
+  for (int m = 0; m < size; m++) {
+    CPU_ZERO(&set);
+    CPU_SET(member_cpu[m], &set);
+    if (pthread_setaffinity_np(member_thread(m), sizeof(set), &set) != 0) {
+      for (int pinned = 0; pinned < m; pinned++)
+        pthread_setaffinity_np(member_thread(pinned), sizeof(master_affinity), &master_affinity);
+      return "the affinity can't be set";
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Prints the tiles of every member, and the CPU and node it is pinned to
+ */
+static void print_placement(const char *error) {
+  if (member_cpu == NULL) {
+    fprintf(g_out, "Threads not pinned%s%s\n", error != NULL ? ", " : "", error != NULL ? error : "");
+    return;
+  }
+
+  fprintf(g_out, "%8s%16s%8s%8s\n", "Thread", "Tiles", "CPU", "Node");
+  for (int m = 0; m < size; m++)
+    fprintf(g_out, "%8d%9d - %4d%8d%8d\n", m, first_tile[m], first_tile[m + 1] - 1, member_cpu[m], member_node[m]);
+}
+
+void team_open() {
+  team_close();
+
+  size = max(min(threads, tiles_per_chunk), 1);
+#ifdef BATCH_ENABLED
+  size = 1;
+#endif
+
+  first_tile = malloc((size + 1) * sizeof(int));
+  if (first_tile == NULL)
+    report_error("team_open", "Error allocating the team.");
+  for (int m = 0; m <= size; m++)
+    first_tile[m] = (int)((long)tiles_per_chunk * m / size);
+
+  member = 0;
+  local_sense = false;
+  sense = false;
+  arrived = size;
+  generation = 0;
+  stopping = false;
+
+  if (parallel.boss && threads > 1) {
+    fprintf(
+        g_out,
+        "\nTeam of %d threads, %d to %d tiles each\n",
+        size,
+        tiles_per_chunk / size,
+        (tiles_per_chunk + size - 1) / size
+    );
+  }
+
+  if (size == 1)
+    return;
+
+  workers = malloc((size - 1) * sizeof(pthread_t));
+  if (workers == NULL)
+    report_error("team_open", "Error allocating the team.");
+
+  for (int m = 1; m < size; m++) {
+    if (pthread_create(&workers[m - 1], NULL, worker, (void *)(intptr_t)m) != 0) {
+      size = m;
+      team_close();
+      report_error("team_open", "Error starting the team's threads.");
+    }
+  }
+
+  const char *error = unpinned ? NULL : pin();
+  if (error != NULL || unpinned) {
+    free(member_cpu);
+    free(member_node);
+    member_cpu = NULL;
+    member_node = NULL;
+  }
+
+  if (parallel.boss)
+    print_placement(error);
+}
+
+void team_run(void (*body)()) {
+  if (size == 1) {
+    body();
+    return;
+  }
+
+  region = body;
+  running = true;
+  start_workers(false);
+
+  body();
+  barrier(false);
+  running = false;
+}
+
+void team_barrier() {
+  barrier(true);
+}
+
+int team_size() {
+  return size;
+}
+
+int team_member() {
+  return member;
+}
+
+int team_cpu(int m) {
+  return member_cpu != NULL ? member_cpu[m] : -1;
+}
+
+bool team_master() {
+  return member == 0;
+}
+
+int team_tile_begin() {
+  return running ? first_tile[member] : 0;
+}
+
+int team_tile_end() {
+  return running ? first_tile[member + 1] : tiles_per_chunk;
+}
+
+void *team_slots(size_t bytes) {
+  if (team_master() && bytes > slots_size) {
+    free(slots);
+    slots = malloc(bytes);
+    slots_size = slots == NULL ? 0 : bytes;
+    if (slots == NULL)
+      report_error("team_slots", "Error allocating the reduction slots.");
+  }
+  team_barrier();
+
+  return slots;
+}
+
+void team_close() {
+  if (member_cpu != NULL)
+    pthread_setaffinity_np(pthread_self(), sizeof(master_affinity), &master_affinity);
+
+  if (workers != NULL) {
+    start_workers(true);
+    for (int m = 1; m < size; m++)
+      pthread_join(workers[m - 1], NULL);
+  }
+
+  free(workers);
+  free(first_tile);
+  free(slots);
+  free(member_cpu);
+  free(member_node);
+
+  workers = NULL;
+  first_tile = NULL;
+  slots = NULL;
+  member_cpu = NULL;
+  member_node = NULL;
+  slots_size = 0;
+  size = 1;
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief A team of threads sharing the tiles of every step, enabled by the threads deck keyword
+ * @details The team is created once the tiles are decomposed, threads - 1 workers joining the thread running the
+ * calculation, its master, and lives until the chunk is destroyed. Each member owns a fixed range of consecutive tiles.
+ * hydro_step() runs the kernels of a step as a single team_run() region: every member runs the same drivers over its
+ * own tiles, and the kernels are separated by team_barrier(), a sense-reversing barrier the members spin on, unless
+ * they run as a dataflow (see flow.h). What isn't per tile, reducing and printing, runs on the master between two
+ * barriers. The workers only block between the regions.
+ *
+ * The timestep and the field summary are reduced through a slot per tile in tile order, so the results are bitwise
+ * identical whatever the number of threads. Outside a region the master owns every tile and
+ * the barriers do nothing, as they do with a team of one.
+ *
+ * Unless the unpinned deck keyword is given, a team of more than one is pinned, a member per CPU. The members are
+ * spread over the NUMA nodes the process may run on in consecutive groups, so that the consecutive tiles of a group,
+ * neighbours on the mesh, share a node. The members zero the field arrays of their own tiles, which places their pages
+ * on that node by first touch. The placement is printed in clover.out.
+ *
+ * In batch builds the globals are local to the thread running each deck (see utils/thread_local.h), where the workers
+ * couldn't see them, so the team is always of one: batches run their decks concurrently instead.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Starts the workers, called once the tiles are decomposed
+ */
+extern void team_open();
+
+/**
+ * @brief Runs body on every member, returning once they all have
+ */
+extern void team_run(void (*body)());
+
+/**
+ * @brief Waits for every member of a region to reach it, does nothing outside a region
+ */
+extern void team_barrier();
+
+/**
+ * @brief Number of members, 1 without a team
+ */
+extern int team_size();
+
+/**
+ * @brief Index of the calling member, 0 for the master
+ */
+extern int team_member();
+
+/**
+ * @brief The CPU a member is pinned to, -1 when the team isn't pinned
+ */
+extern int team_cpu(int member);
+
+/**
+ * @brief Whether the caller is the master, the thread running the calculation
+ */
+extern bool team_master();
+
+/**
+ * @brief The tiles of the calling member are team_tile_begin() to team_tile_end() - 1, all of them outside a region
+ */
+extern int team_tile_begin();
+
+extern int team_tile_end();
+
+/**
+ * @brief A buffer shared by the members of a region for their reductions, which every member calls with the same size
+ * @return The same buffer for every member, valid until the next call
+ */
+extern void *team_slots(size_t size);
+
+/**
+ * @brief Stops the workers, safe to call without a team
+ */
+extern void team_close();
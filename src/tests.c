@@ -1,17 +1,38 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 // Copyright (C) 2022 Niccolò Betto
 
+#define _GNU_SOURCE
+
 #include "tests.h"
 
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 
+#include "activity.h"
+#include "clover.h"
+#include "clover_leaf.h"
 #include "data.h"
 #include "definitions.h"
+#include "flow.h"
+#include "halo.h"
+#include "kernels/ensemble.h"
+#include "kernels/ftocmacros.h"
+#include "kernels/kernels.h"
 #include "parse.h"
+#include "profiler.h"
+#include "shm_export.h"
+#include "team.h"
 #include "utils/array.h"
 
 void test_parse_getword() {
@@ -224,6 +245,7 @@ void test_relative_array_indexing_2D() {
 
 extern void build_field();
 extern void destroy_field();
+extern void field_footprint(field_footprint_type *footprint);
 
 void test_build_field() {
   tiles_per_chunk = 1;
@@ -242,6 +264,30 @@ void test_build_field() {
   LOG_PRINT("Done deallocating\n");
 }
 
+void test_build_field_reuse() {
+  tiles_per_chunk = 1;
+  chunk.tiles = malloc(tiles_per_chunk * sizeof(tile_type));
+  chunk.tiles[0].t_xmin = 1;
+  chunk.tiles[0].t_xmax = 10;
+  chunk.tiles[0].t_ymin = 1;
+  chunk.tiles[0].t_ymax = 2;
+
+  build_field();
+  double *density0 = chunk.tiles[0].field.density0;
+  double *yarea = chunk.tiles[0].field.yarea;
+  destroy_field();
+
+  LOG_PRINT("Building a field of the same size again...\n");
+  build_field();
+  if (chunk.tiles[0].field.density0 != density0 || chunk.tiles[0].field.yarea != yarea) {
+    fail = true;
+    sprintf(fail_reason, "Field arrays were not reused\n");
+  }
+  destroy_field();
+
+  free(chunk.tiles);
+}
+
 void test_build_field_stress() {
   // Should take about 20 second to run on a reasonably fast machine
   // Ensures that the memory is freed properly
@@ -262,6 +308,1468 @@ void test_build_field_stress() {
   LOG_PRINT("Done.\nTook %.3f seconds\n", (double)(clock() - start) / CLOCKS_PER_SEC);
 }
 
+void test_generate_chunk() {
+  const int x_min = 1, x_max = 23, y_min = 1, y_max = 17;
+  const int cells = (x_max + 4) * (y_max + 4), nodes = (x_max + 5) * (y_max + 5);
+
+  // Background, then a rectangle overlapping the mesh edge, a circle, a point and a rectangle outside the tile
+  double density[] = {0.2, 1.0, 2.0, 3.0, 4.0};
+  double energy[] = {1.0, 2.5, 3.5, 4.5, 5.5};
+  double xvel[] = {0.0, 0.5, -0.5, 0.25, 1.0};
+  double yvel[] = {0.0, -0.5, 0.5, -0.25, 1.0};
+  double xmin[] = {0.0, -1.0, 3.05, 4.0, 30.0};
+  double xmax[] = {0.0, 2.5, 0.0, 0.0, 40.0};
+  double ymin[] = {0.0, 1.0, 2.1, 1.5, 30.0};
+  double ymax[] = {0.0, 1.3, 0.0, 0.0, 40.0};
+  double radius[] = {0.0, 0.0, 1.2, 0.0, 0.0};
+  int geometry[] = {G_RECT, G_RECT, G_CIRC, G_POINT, G_RECT};
+  const int num_states = 5;
+
+  double *geom[11], *fields[4], *expected[4];
+  int geom_sizes[11] = {x_max + 5, x_max + 5, y_max + 5, y_max + 5, x_max + 4, x_max + 4, y_max + 4, y_max + 4,
+                        cells,     nodes,     nodes};
+  for (int i = 0; i < 11; i++)
+    geom[i] = calloc(geom_sizes[i], sizeof(double));
+  for (int i = 0; i < 4; i++) {
+    fields[i] = calloc(nodes, sizeof(double));
+    expected[i] = calloc(nodes, sizeof(double));
+  }
+  double *vertexx = geom[0], *vertexy = geom[2], *cellx = geom[4], *celly = geom[6];
+
+  kernel_initialise_chunk(
+      x_min, x_max, y_min, y_max, 0.0, 0.0, 0.25, 0.125, vertexx, geom[1], vertexy, geom[3], cellx, geom[5], celly,
+      geom[7], geom[8], geom[9], geom[10]
+  );
+
+  kernel_generate_chunk(
+      x_min, x_max, y_min, y_max, vertexx, vertexy, cellx, celly, fields[0], fields[1], fields[2], fields[3],
+      num_states, density, energy, xvel, yvel, xmin, xmax, ymin, ymax, radius, geometry
+  );
+
+  // Reference, testing every cell against every state
+  for (int k = y_min - 2; k <= y_max + 2; k++) {
+    for (int j = x_min - 2; j <= x_max + 2; j++) {
+      expected[0][FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = density[0];
+      expected[1][FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = energy[0];
+      expected[2][FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = xvel[0];
+      expected[3][FTNREF2D(j, k, x_max + 5, x_min - 2, y_min - 2)] = yvel[0];
+    }
+  }
+  int painted = 0;
+  for (int s = 1; s < num_states; s++) {
+    for (int k = y_min - 2; k <= y_max + 2; k++) {
+      for (int j = x_min - 2; j <= x_max + 2; j++) {
+        double x = cellx[j - (x_min - 2)] - xmin[s], y = celly[k - (y_min - 2)] - ymin[s];
+        bool inside = false;
+        if (geometry[s] == G_RECT)
+          inside = vertexx[j + 1 - (x_min - 2)] >= xmin[s] && vertexx[j - (x_min - 2)] < xmax[s] &&
+                   vertexy[k + 1 - (y_min - 2)] >= ymin[s] && vertexy[k - (y_min - 2)] < ymax[s];
+        else if (geometry[s] == G_CIRC)
+          inside = sqrt(x * x + y * y) <= radius[s];
+        else if (geometry[s] == G_POINT)
+          inside = vertexx[j - (x_min - 2)] == xmin[s] && vertexy[k - (y_min - 2)] == ymin[s];
+        if (!inside)
+          continue;
+
+        painted++;
+        expected[0][FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = density[s];
+        expected[1][FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)] = energy[s];
+        for (int kt = k; kt <= k + 1; kt++) {
+          for (int jt = j; jt <= j + 1; jt++) {
+            expected[2][FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = xvel[s];
+            expected[3][FTNREF2D(jt, kt, x_max + 5, x_min - 2, y_min - 2)] = yvel[s];
+          }
+        }
+      }
+    }
+  }
+  LOG_PRINT("Painted %d cells over the background\n", painted);
+
+  for (int i = 0; i < 4; i++) {
+    if (memcmp(fields[i], expected[i], (i < 2 ? cells : nodes) * sizeof(double))) {
+      fail = true;
+      sprintf(fail_reason, "Field %d differs from the cell by cell reference\n", i);
+    }
+  }
+
+  for (int i = 0; i < 11; i++)
+    free(geom[i]);
+  for (int i = 0; i < 4; i++) {
+    free(fields[i]);
+    free(expected[i]);
+  }
+}
+
+void test_ensemble_update_halo() {
+  const int x_min = 1, x_max = 3, y_min = 1, y_max = 2, depth = 2;
+  int chunk_neighbours[4] = {EXTERNAL_FACE, EXTERNAL_FACE, EXTERNAL_FACE, EXTERNAL_FACE};
+  int tile_neighbours[4] = {EXTERNAL_TILE, EXTERNAL_TILE, EXTERNAL_TILE, EXTERNAL_TILE};
+
+  // One field of each halo rule, vol_flux_x and vol_flux_y are the ones mixing node and face rules
+  struct {
+    int field, x_extra, y_extra, x_kind, y_kind;
+    double x_sign, y_sign;
+  } cases[] = {
+      {FIELD_DENSITY0, 4, 4, ENSEMBLE_HALO_CELL, ENSEMBLE_HALO_CELL, 1.0, 1.0},
+      {FIELD_XVEL0, 5, 5, ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_NODE, -1.0, 1.0},
+      {FIELD_VOL_FLUX_X, 5, 4, ENSEMBLE_HALO_NODE, ENSEMBLE_HALO_FACE, -1.0, 1.0},
+      {FIELD_VOL_FLUX_Y, 4, 5, ENSEMBLE_HALO_FACE, ENSEMBLE_HALO_NODE, 1.0, -1.0},
+  };
+
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+    int size = (x_max + cases[c].x_extra) * (y_max + cases[c].y_extra);
+    double *lanes = malloc(size * ENSEMBLE_WIDTH * sizeof(double));
+    double *initial = malloc(size * ENSEMBLE_WIDTH * sizeof(double));
+    double *scalar = malloc(size * sizeof(double));
+
+    for (int i = 0; i < size * ENSEMBLE_WIDTH; i++)
+      lanes[i] = initial[i] = rand() / (double)RAND_MAX;
+
+    kernel_ensemble_update_halo(
+        x_min,
+        x_max,
+        y_min,
+        y_max,
+        lanes,
+        cases[c].x_kind,
+        cases[c].y_kind,
+        cases[c].x_sign,
+        cases[c].y_sign,
+        depth
+    );
+
+    for (int e = 0; e < ENSEMBLE_WIDTH; e++) {
+      for (int i = 0; i < size; i++)
+        scalar[i] = initial[i * ENSEMBLE_WIDTH + e];
+
+      double *arrays[NUM_FIELDS] = {NULL};
+      int fields[NUM_FIELDS] = {0};
+      arrays[cases[c].field] = scalar;
+      fields[cases[c].field] = 1;
+
+      kernel_update_halo(
+          x_min,
+          x_max,
+          y_min,
+          y_max,
+          chunk_neighbours,
+          tile_neighbours,
+          arrays[FIELD_DENSITY0],
+          arrays[FIELD_ENERGY0],
+          arrays[FIELD_PRESSURE],
+          arrays[FIELD_VISCOSITY],
+          arrays[FIELD_SOUNDSPEED],
+          arrays[FIELD_DENSITY1],
+          arrays[FIELD_ENERGY1],
+          arrays[FIELD_XVEL0],
+          arrays[FIELD_YVEL0],
+          arrays[FIELD_XVEL1],
+          arrays[FIELD_YVEL1],
+          arrays[FIELD_VOL_FLUX_X],
+          arrays[FIELD_VOL_FLUX_Y],
+          arrays[FIELD_MASS_FLUX_X],
+          arrays[FIELD_MASS_FLUX_Y],
+          fields,
+          depth
+      );
+
+      for (int i = 0; i < size; i++) {
+        if (scalar[i] != lanes[i * ENSEMBLE_WIDTH + e]) {
+          fail = true;
+          sprintf(fail_reason, "Field %d lane %d differs from kernel_update_halo at %d\n", cases[c].field, e, i);
+        }
+      }
+    }
+
+    free(lanes);
+    free(initial);
+    free(scalar);
+  }
+}
+
+void test_embedding_api() {
+  const char *deck =
+      "*clover\n"
+      " state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+      " x_cells=10\n"
+      " y_cells=4\n"
+      " xmin=0.0\n"
+      " ymin=0.0\n"
+      " xmax=10.0\n"
+      " ymax=2.0\n"
+      " initial_timestep=0.04\n"
+      " max_timestep=0.04\n"
+      " end_step=5\n"
+      " full_geometry\n"
+      "*endclover\n";
+
+  // Set up twice, to check that finalizing leaves everything ready for a new calculation
+  for (int run = 0; run < 2; run++) {
+    if (clover_leaf_init(deck, NULL, NULL) != 0) {
+      fail = true;
+      sprintf(fail_reason, "Set up failed\n");
+      return;
+    }
+
+    int taken = clover_leaf_step(3);
+    LOG_PRINT("Took %d steps, time %f, dt %e\n", taken, clover_leaf_get_time(), clover_leaf_get_dt());
+    if (taken != 3 || clover_leaf_get_step() != 3 || clover_leaf_get_time() <= 0.0 || clover_leaf_is_complete()) {
+      fail = true;
+      sprintf(fail_reason, "Unexpected state after 3 steps\n");
+    }
+
+    // Stops at end_step
+    if (clover_leaf_step(10) != 2 || !clover_leaf_is_complete() || clover_leaf_step(1) != 0) {
+      fail = true;
+      sprintf(fail_reason, "Calculation didn't stop at end_step\n");
+    }
+
+    clover_field_view density, volume;
+    if (clover_leaf_get_num_tiles() != 1 || clover_leaf_get_field(0, CLOVER_FIELD_DENSITY0, &density) != 0 ||
+        clover_leaf_get_field(0, CLOVER_FIELD_VOLUME, &volume) != 0 ||
+        clover_leaf_get_field(1, CLOVER_FIELD_DENSITY0, &density) == 0) {
+      fail = true;
+      sprintf(fail_reason, "Unexpected tiles\n");
+      clover_leaf_finalize();
+      return;
+    }
+
+    if (density.data != chunk.tiles[0].field.density0 || density.x_lo != -1 || density.x_hi != 12 ||
+        density.y_lo != -1 || density.y_hi != 6 || density.x_size != 14) {
+      fail = true;
+      sprintf(fail_reason, "Unexpected density0 view\n");
+    }
+
+    double mass = 0.0;
+    for (int k = density.y_min; k <= density.y_max; k++) {
+      for (int j = density.x_min; j <= density.x_max; j++) {
+        mass += density.data[(k - density.y_lo) * density.x_size + (j - density.x_lo)] *
+                volume.data[(k - volume.y_lo) * volume.x_size + (j - volume.x_lo)];
+      }
+    }
+    LOG_PRINT("Mass %f\n", mass);
+    if (fabs(mass - 12.0) > 1e-10) {
+      fail = true;
+      sprintf(fail_reason, "Mass not conserved: %f\n", mass);
+    }
+
+    clover_leaf_finalize();
+  }
+}
+
+void test_tile_halo() {
+  const char *decks[] = {
+      "*clover\n state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+      " x_cells=23\n y_cells=17\n xmax=10.0\n ymax=10.0\n end_step=20\n*endclover\n",
+      "*clover\n state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+      " x_cells=23\n y_cells=17\n xmax=10.0\n ymax=10.0\n end_step=20\n tiles_per_chunk=6\n*endclover\n",
+  };
+  const int x_cells = 23, y_cells = 17;
+  double *single = calloc(x_cells * y_cells, sizeof(double));
+
+  // The tiled run must reproduce the single tile one exactly, cell by cell
+  for (int d = 0; d < 2; d++) {
+    if (clover_leaf_init(decks[d], NULL, NULL) != 0 || clover_leaf_step(20) != 20) {
+      fail = true;
+      sprintf(fail_reason, "Run with deck %d failed\n", d);
+      break;
+    }
+
+    for (int tile = 0; tile < clover_leaf_get_num_tiles(); tile++) {
+      clover_field_view view;
+      clover_leaf_get_field(tile, CLOVER_FIELD_ENERGY0, &view);
+
+      for (int k = view.y_min; k <= view.y_max; k++) {
+        for (int j = view.x_min; j <= view.x_max; j++) {
+          double value = view.data[(k - view.y_lo) * view.x_size + (j - view.x_lo)];
+          double *cell = &single[(view.bottom + k - 2) * x_cells + (view.left + j - 2)];
+
+          if (d == 0) {
+            *cell = value;
+          } else if (*cell != value) {
+            fail = true;
+            sprintf(fail_reason, "Tile %d differs at (%d, %d): %e vs %e\n", tile, j, k, value, *cell);
+          }
+        }
+      }
+    }
+    LOG_PRINT("Run with %d tiles done\n", clover_leaf_get_num_tiles());
+
+    clover_leaf_finalize();
+  }
+
+  free(single);
+}
+
+void test_shm_export() {
+  const char *decks[] = {
+      "*clover\n state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+      " x_cells=10\n y_cells=2\n xmax=10.0\n ymax=2.0\n end_step=4\n shm_export=clover_test\n*endclover\n",
+      "*clover\n state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+      " x_cells=10\n y_cells=2\n xmax=10.0\n ymax=2.0\n end_step=4\n shm_export=clover_test\n"
+      " shm_double_buffer\n*endclover\n",
+  };
+
+  for (int d = 0; d < 2; d++) {
+    if (clover_leaf_init(decks[d], NULL, NULL) != 0) {
+      fail = true;
+      sprintf(fail_reason, "Set up failed\n");
+      return;
+    }
+
+    // Map the segment as a reader would
+    int fd = shm_open("/clover_test", O_RDONLY, 0);
+    struct stat st;
+    fstat(fd, &st);
+    const char *segment = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    const shm_header *header = (const shm_header *)segment;
+
+    if (header->magic != SHM_EXPORT_MAGIC || header->num_tiles != 1 || header->num_slots != (uint32_t)d + 1) {
+      fail = true;
+      sprintf(fail_reason, "Unexpected header\n");
+    }
+
+    const shm_array *density = (const shm_array *)(segment + header->arrays_offset);
+    while (strcmp(density->name, "density0"))
+      density++;
+
+    while (clover_leaf_step(1) == 1) {
+      const shm_slot *slot = &header->slots[header->latest];
+      const double *snapshot = (const double *)(segment + header->data_offset[header->latest] + density->offset);
+      clover_field_view live;
+      clover_leaf_get_field(0, CLOVER_FIELD_DENSITY0, &live);
+
+      LOG_PRINT("Slot %u sequence %lu step %ld\n", header->latest, slot->sequence, slot->step);
+      if (slot->sequence % 2 != 0 || slot->step != clover_leaf_get_step() || density->x_hi - density->x_lo + 1 != live.x_size ||
+          memcmp(snapshot, live.data, live.x_size * (live.y_hi - live.y_lo + 1) * sizeof(double))) {
+        fail = true;
+        sprintf(fail_reason, "Snapshot doesn't match step %d\n", clover_leaf_get_step());
+      }
+    }
+
+    // Readers keep their mapping, but the name is gone once the calculation is complete
+    if (shm_open("/clover_test", O_RDONLY, 0) >= 0) {
+      fail = true;
+      sprintf(fail_reason, "Segment not unlinked\n");
+    }
+
+    munmap((void *)segment, st.st_size);
+    clover_leaf_finalize();
+  }
+}
+
+/**
+ * @brief A profiled region is accounted to its own slot only, and the counters either count or explain why they can't
+ */
+void test_profiler() {
+  profiler_open();
+
+  profiler_sample sample;
+  volatile double sum = 0.0;
+  perf_counts before, after;
+
+  perf_counters_read(0, &before);
+  profiler_start(&sample);
+  for (int i = 0; i < 1000000; i++)
+    sum += i * 0.5;
+  profiler_stop(&sample, &profiler.PdV);
+  perf_counters_read(0, &after);
+
+  const double *slots = (const double *)&profiler;
+  for (int slot = 0; slot < (int)(sizeof(profiler) / sizeof(double)); slot++) {
+    if ((&slots[slot] == &profiler.PdV) != (slots[slot] > 0.0)) {
+      fail = true;
+      sprintf(fail_reason, "Region accounted to slot %d\n", slot);
+    }
+  }
+
+  if (perf_counters_available(PERF_INSTRUCTIONS)) {
+    LOG_PRINT(
+        "Cycles %.0f instructions %.0f\n", after.value[PERF_CYCLES] - before.value[PERF_CYCLES],
+        after.value[PERF_INSTRUCTIONS] - before.value[PERF_INSTRUCTIONS]
+    );
+    if (after.value[PERF_INSTRUCTIONS] - before.value[PERF_INSTRUCTIONS] < 1000000) {
+      fail = true;
+      sprintf(fail_reason, "Loop instructions not counted\n");
+    }
+  } else {
+    LOG_PRINT("Hardware counters unavailable: %s\n", perf_counters_error());
+    if (perf_counters_error()[0] == '\0' || after.value[PERF_CYCLES] != 0.0) {
+      fail = true;
+      sprintf(fail_reason, "Unavailable counters not reported\n");
+    }
+  }
+
+  profiler_close();
+}
+
+/**
+ * @brief A traced run writes one CSV row per step followed by the percentiles, and a complete JSON trace
+ */
+void test_trace() {
+  const char *deck =
+      "*clover\n"
+      " state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+      " x_cells=10\n y_cells=4\n xmax=10.0\n ymax=2.0\n end_step=7\n tiles_per_chunk=2\n trace_on\n"
+      "*endclover\n";
+
+  char dir[] = "/tmp/clover_trace_XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    fail = true;
+    sprintf(fail_reason, "Can't create the run directory\n");
+    return;
+  }
+  g_run_dir = dir;
+
+  if (clover_leaf_init(deck, NULL, NULL) != 0 || clover_leaf_step(100) != 7) {
+    fail = true;
+    sprintf(fail_reason, "Run failed\n");
+  }
+  clover_leaf_finalize();
+  g_run_dir = NULL;
+
+  char path[64], text[512];
+  int rows = 0, percentiles = 0, tiles = 0;
+
+  sprintf(path, "%s/clover_trace.csv", dir);
+  FILE *csv = fopen(path, "r");
+  while (csv != NULL && fgets(text, sizeof(text), csv) != NULL) {
+    if (text[0] >= '1' && text[0] <= '9')
+      rows++;
+    else if (text[0] == 'p')
+      percentiles++;
+  }
+
+  sprintf(path, "%s/clover_trace.json", dir);
+  FILE *json = fopen(path, "r");
+  while (json != NULL && fgets(text, sizeof(text), json) != NULL) {
+    if (strstr(text, "\"name\":\"pdv\"") != NULL && strstr(text, "\"tile\":1") != NULL)
+      tiles++;
+  }
+
+  LOG_PRINT("%d steps, %d percentile rows, %d PdV calls on tile 1, last line '%s'\n", rows, percentiles, tiles, text);
+  if (rows != 7 || percentiles != 3 || tiles != 14 || strcmp(text, "]}\n") != 0) {
+    fail = true;
+    sprintf(fail_reason, "Unexpected trace files\n");
+  }
+
+  if (csv != NULL)
+    fclose(csv);
+  if (json != NULL)
+    fclose(json);
+  remove(path);
+  sprintf(path, "%s/clover_trace.csv", dir);
+  remove(path);
+  rmdir(dir);
+}
+
+/**
+ * @brief The roofline models scale with the tile and are symmetric in the sweep direction, and the per tile calls are
+ * charged their modelled cost
+ */
+void test_roofline() {
+  roofline_cost gas = roofline_model(ROOFLINE_IDEAL_GAS, 0, 1, 10, 1, 4);
+  LOG_PRINT(
+      "ideal_gas on 10x4: %.0f flops, %.0f B read, %.0f B written\n", gas.flops, gas.bytes_read, gas.bytes_written
+  );
+  if (gas.flops != 400.0 || gas.bytes_read != 640.0 || gas.bytes_written != 640.0) {
+    fail = true;
+    sprintf(fail_reason, "Unexpected ideal_gas model\n");
+  }
+
+  for (int kernel = ROOFLINE_ADVEC_CELL; kernel <= ROOFLINE_ADVEC_MOM; kernel++) {
+    for (int sweep_number = 1; sweep_number <= 2; sweep_number++) {
+      roofline_cost x = roofline_model(kernel, ROOFLINE_SWEEP(G_XDIR, sweep_number), 1, 6, 1, 3);
+      roofline_cost y = roofline_model(kernel, ROOFLINE_SWEEP(G_YDIR, sweep_number), 1, 3, 1, 6);
+      if (x.flops != y.flops || x.bytes_read != y.bytes_read || x.bytes_written != y.bytes_written) {
+        fail = true;
+        sprintf(fail_reason, "%s sweep %d not symmetric\n", roofline_name(kernel), sweep_number);
+      }
+    }
+  }
+
+  roofline_cost halo = roofline_model(ROOFLINE_UPDATE_HALO, 0, 1, 10, 1, 4);
+  if (roofline_has_model(ROOFLINE_UPDATE_HALO) || halo.flops != 0.0 || halo.bytes_read != 0.0) {
+    fail = true;
+    sprintf(fail_reason, "update_halo has a model\n");
+  }
+
+  tile_type tile = {.t_xmin = 1, .t_xmax = 10, .t_ymin = 1, .t_ymax = 4};
+  tile_type *saved_tiles = chunk.tiles;
+  bool saved_profiler_on = profiler_on;
+  chunk.tiles = &tile;
+  profiler_on = true;
+  profiler_open();
+
+  for (int call = 0; call < 3; call++)
+    profiler_tile_stop(ROOFLINE_IDEAL_GAS, 0, 0, profiler_tile_start());
+
+  char *text = NULL;
+  size_t size;
+  FILE *out = open_memstream(&text, &size);
+  profiler_print(out, 1.0);
+  fclose(out);
+
+  char *row = strstr(text, "\nideal_gas");
+  LOG_PRINT("%.*s\n", row != NULL ? (int)strcspn(row + 1, "\n") : 0, row != NULL ? row + 1 : "");
+  if (row == NULL || strstr(text, "\nviscosity") != NULL || strstr(text, "STREAM triad") == NULL) {
+    fail = true;
+    sprintf(fail_reason, "Unexpected roofline table\n");
+  }
+
+  free(text);
+  profiler_close();
+  profiler_on = saved_profiler_on;
+  chunk.tiles = saved_tiles;
+}
+
+/**
+ * @brief The footprint adds up to the arrays build_field() allocates, and a dry run prints it without allocating them
+ */
+void test_footprint() {
+  const char *deck =
+      "*clover\n"
+      " state 1 density=0.2 energy=1.0\n"
+      " x_cells=10\n y_cells=4\n xmax=10.0\n ymax=2.0\n end_step=1\n tiles_per_chunk=2\n%s"
+      "*endclover\n";
+  char text[512];
+
+  sprintf(text, deck, "");
+  if (clover_leaf_init(text, NULL, NULL) != 0) {
+    fail = true;
+    sprintf(fail_reason, "Set up failed\n");
+    return;
+  }
+
+  size_t allocated = 0;
+  for (int tile = 0; tile < clover_leaf_get_num_tiles(); tile++) {
+    for (int f = 0; f < CLOVER_NUM_FIELDS; f++) {
+      // The volume and area planes of a uniform grid are only built for the view, they aren't field arrays
+      clover_field_view view;
+      bool built = uniform_grid && f >= CLOVER_FIELD_VOLUME && f <= CLOVER_FIELD_YAREA;
+      if (built || clover_leaf_get_field(tile, f, &view) != 0)
+        continue;
+      allocated += (size_t)(view.x_hi - view.x_lo + 1) * (view.y_hi - view.y_lo + 1) * sizeof(double);
+    }
+  }
+
+  field_footprint_type footprint;
+  field_footprint(&footprint);
+  clover_leaf_finalize();
+
+  LOG_PRINT(
+      "Footprint %zu bytes, %zu interior, tiles of %zu to %zu, allocated %zu\n",
+      footprint.total,
+      footprint.interior,
+      footprint.tile_min,
+      footprint.tile_max,
+      allocated
+  );
+  if (footprint.total != allocated || footprint.tile_min + footprint.tile_max != footprint.total ||
+      footprint.interior >= footprint.total) {
+    fail = true;
+    sprintf(fail_reason, "Footprint doesn't match the allocated arrays\n");
+  }
+
+  char *out_text = NULL;
+  size_t out_size;
+  FILE *out = open_memstream(&out_text, &out_size);
+
+  sprintf(text, deck, " dry_run\n");
+  clover_field_view view;
+  if (clover_leaf_init(text, out, NULL) != 0 || !clover_leaf_is_complete() || clover_leaf_step(1) != 0 ||
+      clover_leaf_get_field(0, CLOVER_FIELD_DENSITY0, &view) == 0) {
+    fail = true;
+    sprintf(fail_reason, "Dry run ran\n");
+  }
+  clover_leaf_finalize();
+  fclose(out);
+
+  if (strstr(out_text, "Field arrays") == NULL || strstr(out_text, "Dry run, the calculation is skipped") == NULL) {
+    fail = true;
+    sprintf(fail_reason, "Dry run didn't print the footprint\n");
+  }
+  free(out_text);
+}
+
+// Runs of a deck with different keywords, compared bitwise with a reference run
+typedef struct compared_runs_t {
+  const char *deck;            // With a %s for the keywords of each run
+  int steps;                   // Taken at once, or one at a time comparing the timesteps
+  bool every_dt;
+  const clover_field *fields;  // Compared on the cells, and from first_node on on the nodes
+  int num_fields, first_node;
+  int x_cells, y_cells;
+  double *fields_ref, *dts_ref;
+  FILE *out;  // The clover.out of the run, in out_text once it has ended
+  char *out_text;
+  size_t out_size;
+} compared_runs;
+
+/**
+ * @brief Ends a run of compared_runs, see run_compared()
+ */
+static void end_compared(compared_runs *runs) {
+  clover_leaf_finalize();
+  fclose(runs->out);
+  runs->out = NULL;
+}
+
+/**
+ * @brief Starts a run of the deck with some keywords and takes its steps, then records its timesteps and fields for a
+ * reference run, or compares them with those of the last reference run
+ * @details The run is left open for the checks of the test, and ended by end_compared()
+ * @return Whether the run started, it's ended and the test fails otherwise
+ */
+static bool run_compared(compared_runs *runs, const char *keywords, int run, bool reference) {
+  const int x_points = runs->x_cells + 1, y_points = runs->y_cells + 1;
+  char text[512];
+
+  if (runs->fields_ref == NULL) {
+    runs->fields_ref = calloc((size_t)runs->num_fields * x_points * y_points + 1, sizeof(double));
+    runs->dts_ref = calloc(runs->steps, sizeof(double));
+  }
+  free(runs->out_text);
+  runs->out_text = NULL;
+  runs->out = open_memstream(&runs->out_text, &runs->out_size);
+
+  sprintf(text, runs->deck, keywords);
+  if (clover_leaf_init(text, runs->out, NULL) != 0) {
+    fail = true;
+    sprintf(fail_reason, "Run %d failed\n", run);
+    end_compared(runs);
+    return false;
+  }
+
+  if (!runs->every_dt && clover_leaf_step(runs->steps) != runs->steps) {
+    fail = true;
+    sprintf(fail_reason, "Run %d failed\n", run);
+  }
+  for (int s = 0; s < runs->steps && runs->every_dt; s++) {
+    clover_leaf_step(1);
+    if (reference) {
+      runs->dts_ref[s] = clover_leaf_get_dt();
+    } else if (clover_leaf_get_dt() != runs->dts_ref[s]) {
+      fail = true;
+      sprintf(fail_reason, "Run %d, timestep %d differs\n", run, s + 1);
+    }
+  }
+
+  // The nodes on the tile edges are compared twice
+  for (int tile = 0; tile < clover_leaf_get_num_tiles(); tile++) {
+    for (int f = 0; f < runs->num_fields; f++) {
+      clover_field_view view;
+      clover_leaf_get_field(tile, runs->fields[f], &view);
+      int nodes = f >= runs->first_node;
+
+      for (int k = view.y_min; k <= view.y_max + nodes; k++) {
+        for (int j = view.x_min; j <= view.x_max + nodes; j++) {
+          double value = view.data[(k - view.y_lo) * view.x_size + (j - view.x_lo)];
+          size_t row = (size_t)f * y_points + view.bottom + k - 2;
+          double *point = &runs->fields_ref[row * x_points + view.left + j - 2];
+
+          if (reference) {
+            *point = value;
+          } else if (*point != value) {
+            fail = true;
+            sprintf(fail_reason, "Run %d, field %d of tile %d differs at (%d, %d): %e vs %e\n", run, f, tile, j, k,
+                    value, *point);
+          }
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+/**
+ * @brief Releases what compared_runs recorded
+ */
+static void free_compared(compared_runs *runs) {
+  free(runs->fields_ref);
+  free(runs->dts_ref);
+  free(runs->out_text);
+}
+
+/**
+ * @brief Skipping the tiles at rest reproduces a full sweep bitwise, while skipping some of them
+ */
+void test_activity() {
+  const clover_field fields[] = {CLOVER_FIELD_DENSITY0, CLOVER_FIELD_ENERGY0, CLOVER_FIELD_XVEL0, CLOVER_FIELD_YVEL0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+              " x_cells=96\n y_cells=96\n xmax=10.0\n ymax=10.0\n end_step=30\n tiles_per_chunk=36\n%s*endclover\n",
+      .steps = 30,
+      .fields = fields,
+      .num_fields = 4,
+      .first_node = 2,
+      .x_cells = 96,
+      .y_cells = 96
+  };
+
+  for (int d = 0; d < 2; d++) {
+    if (!run_compared(&runs, d == 0 ? " full_sweep\n" : "", d, d == 0))
+      break;
+
+    long skipped = activity_skipped();
+    LOG_PRINT("%s: %ld tile steps skipped\n", d == 0 ? "Full sweep" : "Skipping", skipped);
+    if ((d == 0) != (skipped == 0)) {
+      fail = true;
+      sprintf(fail_reason, "%ld tile steps skipped in run %d\n", skipped, d);
+    }
+
+    end_compared(&runs);
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief Temporal blocking passes the QA check of test problem 6 and reproduces the unblocked run bitwise
+ */
+void test_temporal_blocking() {
+  const clover_field fields[] = {CLOVER_FIELD_ENERGY0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+              " x_cells=20\n y_cells=20\n xmax=10.0\n ymax=10.0\n initial_timestep=0.04\n timestep_rise=1.5\n"
+              " max_timestep=0.04\n end_step=87\n test_problem 6\n tiles_per_chunk=4\n%s*endclover\n",
+      .steps = 87,
+      .fields = fields,
+      .num_fields = 1,
+      .first_node = 1,
+      .x_cells = 20,
+      .y_cells = 20
+  };
+
+  // Bands of 3 rows leave a band of 1 row at the top of the 10 row tiles
+  for (int d = 0; d < 2; d++) {
+    if (!run_compared(&runs, d == 0 ? "" : " temporal_blocking\n band_rows=3\n", d, d == 0))
+      break;
+    end_compared(&runs);
+
+    char *qa = strstr(runs.out_text, "Test problem");
+    if (qa != NULL)
+      LOG_PRINT("%s: %.*s\n", d == 0 ? "Unblocked" : "Blocked", (int)strcspn(qa, "\n"), qa);
+    if (qa == NULL || strstr(runs.out_text, "This test is considered PASSED") == NULL) {
+      fail = true;
+      sprintf(fail_reason, "QA check of run %d not passed\n", d);
+    }
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief The specialised variants of PdV and of the advection kernels match the generic kernels bitwise
+ */
+void test_kernel_variants() {
+  const int x_min = 1, x_max = 13, y_min = 1, y_max = 9, num_arrays = 22;
+  const int size = (x_max + 5) * (y_max + 5);
+  double *a[22], *b[22], *initial[22];
+
+  // Positive values, as the kernels divide by volumes and masses
+  for (int i = 0; i < num_arrays; i++) {
+    a[i] = malloc(size * sizeof(double));
+    b[i] = malloc(size * sizeof(double));
+    initial[i] = malloc(size * sizeof(double));
+    for (int n = 0; n < size; n++)
+      initial[i][n] = 0.5 + rand() / (double)RAND_MAX;
+  }
+
+  // PdV predictor and corrector, then advec_cell and advec_mom for each direction and sweep
+  for (int c = 0; c < 10; c++) {
+    for (int i = 0; i < num_arrays; i++) {
+      memcpy(a[i], initial[i], size * sizeof(double));
+      memcpy(b[i], initial[i], size * sizeof(double));
+    }
+
+    int direction = (c - 2) / 2 % 2 + 1, sweep_number = (c - 2) % 2 + 1;
+    if (c < 2) {
+      kernel_pdv_variants[c](
+          x_min, x_max, y_min, y_max, 0.01, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11],
+          a[12], a[13], a[14], a[15], 0.7, 0.6, 0.9
+      );
+      kernel_pdv(
+          c, x_min, x_max, y_min, y_max, 0.01, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8], b[9], b[10],
+          b[11], b[12], b[13], b[14], b[15], 0.7, 0.6, 0.9
+      );
+    } else if (c < 6) {
+      kernel_advec_cell_variants[direction - 1][sweep_number - 1](
+          x_min, x_max, y_min, y_max, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12],
+          a[13], a[14], a[15], 0.7
+      );
+      kernel_advec_cell(
+          x_min, x_max, y_min, y_max, direction, sweep_number, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8],
+          b[9], b[10], b[11], b[12], b[13], b[14], b[15], 0.7
+      );
+    } else {
+      kernel_advec_mom_variants[direction - 1][sweep_number - 1](
+          x_min, x_max, y_min, y_max, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9], a[10], a[11], a[12],
+          a[13], a[14], 0.7
+      );
+      kernel_advec_mom(
+          x_min, x_max, y_min, y_max, b[0], b[1], b[2], b[3], b[4], b[5], b[6], b[7], b[8], b[9], b[10], b[11], b[12],
+          b[13], b[14], 0.7, direction, sweep_number, direction
+      );
+    }
+
+    for (int i = 0; i < num_arrays; i++) {
+      if (memcmp(a[i], b[i], size * sizeof(double))) {
+        fail = true;
+        sprintf(fail_reason, "Case %d: array %d differs from the generic kernel\n", c, i);
+      }
+    }
+  }
+  LOG_PRINT("Compared 10 variants on a %dx%d tile\n", x_max, y_max);
+
+  for (int i = 0; i < num_arrays; i++) {
+    free(a[i]);
+    free(b[i]);
+    free(initial[i]);
+  }
+}
+
+/**
+ * @brief The volume fluxes written by the PdV corrector match kernel_flux_calc() bitwise, on a tile and on a band
+ */
+void test_pdv_fluxes() {
+  const int x_min = 1, x_max = 13, y_min = 1, y_max = 9, num_arrays = 16;
+  const int size = (x_max + 5) * (y_max + 5);
+  double *a[16], *flux_x, *flux_y;
+
+  for (int i = 0; i < num_arrays; i++) {
+    a[i] = malloc(size * sizeof(double));
+    for (int n = 0; n < size; n++)
+      a[i][n] = 0.5 + rand() / (double)RAND_MAX;
+  }
+  flux_x = calloc(size, sizeof(double));
+  flux_y = calloc(size, sizeof(double));
+
+  // The whole tile, then its rows 4 to 6 alone as a band of temporal blocking
+  for (int c = 0; c < 2; c++) {
+    int k0 = c == 0 ? y_min : 4, k1 = c == 0 ? y_max : 6;
+    size_t shift = (size_t)(x_max + 5) * (k0 - y_min);
+
+    memset(a[14], 0, size * sizeof(double));
+    memset(a[15], 0, size * sizeof(double));
+    kernel_pdv(
+        false, x_min, x_max, k0, k1, 0.01, a[0] + shift, a[1] + shift, a[2] + shift, a[3] + shift, a[4] + shift,
+        a[5] + shift, a[6] + shift, a[7] + shift, a[8] + shift, a[9] + shift, a[10] + shift, a[11] + shift,
+        a[12] + shift, a[13] + shift, a[14] + shift, a[15] + shift, 0.7, 0.6, 0.9
+    );
+    kernel_flux_calc(
+        x_min, x_max, k0, k1, 0.01, a[0] + shift, a[1] + shift, a[9] + shift, a[11] + shift, a[10] + shift,
+        a[12] + shift, flux_x + shift, flux_y + shift, 0.6, 0.9
+    );
+
+    if (memcmp(a[14], flux_x, size * sizeof(double)) || memcmp(a[15], flux_y, size * sizeof(double))) {
+      fail = true;
+      sprintf(fail_reason, "Case %d: the fluxes differ from flux_calc\n", c);
+    }
+    memset(flux_x, 0, size * sizeof(double));
+    memset(flux_y, 0, size * sizeof(double));
+  }
+  LOG_PRINT("Compared the fluxes of a %dx%d tile and of a band\n", x_max, y_max);
+
+  for (int i = 0; i < num_arrays; i++)
+    free(a[i]);
+  free(flux_x);
+  free(flux_y);
+}
+
+/**
+ * @brief The JIT kernels reproduce the built-in ones bitwise, and a second run of the deck loads them from the cache
+ */
+void test_jit() {
+  const clover_field fields[] = {CLOVER_FIELD_ENERGY0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+              " x_cells=20\n y_cells=18\n xmax=10.0\n ymax=10.0\n initial_timestep=0.04\n timestep_rise=1.5\n"
+              " max_timestep=0.04\n end_step=20\n tiles_per_chunk=3\n%s*endclover\n",
+      .steps = 20,
+      .fields = fields,
+      .num_fields = 1,
+      .first_node = 1,
+      .x_cells = 20,
+      .y_cells = 18
+  };
+  const char *expected[] = {NULL, "compiled into", "loaded from"};
+  char path[512], cache[] = "/tmp/clover_jit_test_XXXXXX";
+
+  if (mkdtemp(cache) == NULL) {
+    fail = true;
+    sprintf(fail_reason, "Error creating the cache directory\n");
+    return;
+  }
+  setenv("CLOVER_JIT_CACHE", cache, 1);
+
+  for (int d = 0; d < 3 && !fail; d++) {
+    if (!run_compared(&runs, d == 0 ? "" : " jit\n", d, d == 0))
+      break;
+    end_compared(&runs);
+
+    char *jit_line = strstr(runs.out_text, "JIT kernels");
+    if (jit_line != NULL)
+      LOG_PRINT("%.*s\n", (int)strcspn(jit_line, "\n"), jit_line);
+    if ((expected[d] == NULL) != (jit_line == NULL) || (jit_line != NULL && strstr(jit_line, expected[d]) == NULL)) {
+      fail = true;
+      sprintf(fail_reason, "Run %d: JIT kernels not %s\n", d, expected[d] != NULL ? expected[d] : "off");
+    }
+  }
+
+  free_compared(&runs);
+  unsetenv("CLOVER_JIT_CACHE");
+
+  DIR *dir = opendir(cache);
+  struct dirent *entry;
+  while (dir != NULL && (entry = readdir(dir)) != NULL) {
+    if (entry->d_name[0] != '.') {
+      snprintf(path, sizeof(path), "%s/%s", cache, entry->d_name);
+      unlink(path);
+    }
+  }
+  if (dir != NULL)
+    closedir(dir);
+  rmdir(cache);
+}
+
+/**
+ * @brief A uniform grid without the volume and area planes gives the same results as one with them, in less memory, and
+ * the planes built for clover_leaf_get_field() are the same as the allocated ones
+ */
+void test_uniform_grid() {
+  const clover_field fields[] = {CLOVER_FIELD_ENERGY0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+              " x_cells=20\n y_cells=18\n xmax=10.0\n ymax=10.0\n initial_timestep=0.04\n timestep_rise=1.5\n"
+              " max_timestep=0.04\n end_step=20\n tiles_per_chunk=3\n%s*endclover\n",
+      .steps = 20,
+      .fields = fields,
+      .num_fields = 1,
+      .first_node = 1,
+      .x_cells = 20,
+      .y_cells = 18
+  };
+  const clover_field planes[] = {CLOVER_FIELD_VOLUME, CLOVER_FIELD_XAREA, CLOVER_FIELD_YAREA};
+  double *reference_planes[3][3] = {{NULL}};
+  size_t footprint[2];
+
+  for (int d = 0; d < 2 && !fail; d++) {
+    if (!run_compared(&runs, d == 0 ? " full_geometry\n" : "", d, d == 0))
+      break;
+
+    field_footprint_type total;
+    field_footprint(&total);
+    footprint[d] = total.total;
+
+    // The planes built on a uniform grid match the allocated ones, over the two cells of halo kernel_initialise_chunk()
+    // fills them on
+    clover_field_view view;
+    for (int tile = 0; tile < clover_leaf_get_num_tiles() && !fail; tile++) {
+      for (int p = 0; p < 3 && !fail; p++) {
+        if (clover_leaf_get_field(tile, planes[p], &view) != 0) {
+          fail = true;
+          sprintf(fail_reason, "Run %d: no plane %d on tile %d\n", d, p, tile);
+          break;
+        }
+
+        size_t size = view.x_size * (view.y_hi - view.y_lo + 1) * sizeof(double);
+        if (d == 0) {
+          reference_planes[tile][p] = malloc(size);
+          memcpy(reference_planes[tile][p], view.data, size);
+          continue;
+        }
+
+        for (int k = view.y_min - 2; k <= view.y_max + 2 && !fail; k++) {
+          for (int j = view.x_min - 2; j <= view.x_max + 2; j++) {
+            ptrdiff_t i = (k - view.y_lo) * view.x_size + (j - view.x_lo);
+            if (view.data[i] != reference_planes[tile][p][i]) {
+              fail = true;
+              sprintf(fail_reason, "Plane %d of tile %d differs at (%d, %d)\n", p, tile, j, k);
+              break;
+            }
+          }
+        }
+      }
+    }
+
+    end_compared(&runs);
+  }
+
+  free_compared(&runs);
+  for (int tile = 0; tile < 3; tile++)
+    for (int p = 0; p < 3; p++)
+      free(reference_planes[tile][p]);
+
+  LOG_PRINT("Footprint %zu bytes with the planes, %zu without\n", footprint[0], footprint[1]);
+  if (!fail && footprint[1] >= footprint[0]) {
+    fail = true;
+    sprintf(fail_reason, "The uniform grid doesn't take less memory\n");
+  }
+}
+
+/**
+ * @brief The equation of state skipped when density0 and energy0 haven't changed leaves the results as they were, and
+ * the pressure after a field summary is that of the time level 0 state
+ */
+void test_lazy_eos() {
+  const clover_field fields[] = {CLOVER_FIELD_DENSITY0, CLOVER_FIELD_ENERGY0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+              " x_cells=96\n y_cells=96\n xmax=10.0\n ymax=10.0\n end_step=30\n tiles_per_chunk=36\n%s*endclover\n",
+      .steps = 30,
+      .fields = fields,
+      .num_fields = 2,
+      .first_node = 2,
+      .x_cells = 96,
+      .y_cells = 96
+  };
+  const char *options[] = {" summary_frequency=0\n", " summary_frequency=1\n",
+                           " summary_frequency=1\n temporal_blocking\n band_rows=5\n"};
+
+  for (int d = 0; d < 3 && !fail; d++) {
+    if (!run_compared(&runs, options[d], d, d == 0))
+      break;
+
+    // The last step ended with a summary, the pressure must be that of density0 and energy0 and known as such
+    for (int tile = 0; tile < clover_leaf_get_num_tiles() && d > 0 && !fail; tile++) {
+      tile_type *t = &chunk.tiles[tile];
+
+      size_t cells = (size_t)(t->t_xmax + 4) * (t->t_ymax + 4);
+      double *pressure = calloc(cells, sizeof(double)), *soundspeed = calloc(cells, sizeof(double));
+      kernel_ideal_gas(
+          t->t_xmin, t->t_xmax, t->t_ymin, t->t_ymax, t->field.density0, t->field.energy0, pressure, soundspeed
+      );
+
+      for (int k = t->t_ymin; k <= t->t_ymax && !fail; k++) {
+        for (int j = t->t_xmin; j <= t->t_xmax; j++) {
+          size_t index = FTNREF2D(j, k, t->t_xmax + 4, t->t_xmin - 2, t->t_ymin - 2);
+          if (pressure[index] != t->field.pressure[index] || soundspeed[index] != t->field.soundspeed[index]) {
+            fail = true;
+            sprintf(fail_reason, "Run %d, stale pressure in tile %d at (%d, %d)\n", d, tile, j, k);
+            break;
+          }
+        }
+      }
+      if (!fail && (t->eos_version == 0 || t->eos_version != t->state_version)) {
+        fail = true;
+        sprintf(fail_reason, "Run %d, tile %d: state version %lu, pressure version %lu\n", d, tile, t->state_version,
+                t->eos_version);
+      }
+
+      free(pressure);
+      free(soundspeed);
+    }
+
+    LOG_PRINT("Run %d: %ld tile steps skipped\n", d, activity_skipped());
+    end_compared(&runs);
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief Eliding the exchanges of the halos still up to date reproduces the run exchanging every halo bitwise, on a
+ * tiled mesh with tiles at rest, with and without temporal blocking
+ */
+void test_halo_validity() {
+  const clover_field fields[] = {CLOVER_FIELD_DENSITY0, CLOVER_FIELD_ENERGY0, CLOVER_FIELD_XVEL0, CLOVER_FIELD_YVEL0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+              " x_cells=96\n y_cells=96\n xmax=10.0\n ymax=10.0\n end_step=30\n tiles_per_chunk=36\n%s*endclover\n",
+      .steps = 30,
+      .fields = fields,
+      .num_fields = 4,
+      .first_node = 2,
+      .x_cells = 96,
+      .y_cells = 96
+  };
+  const char *options[] = {" full_halo\n", "", " temporal_blocking\n"};
+
+  for (int d = 0; d < 3 && !fail; d++) {
+    if (!run_compared(&runs, options[d], d, d == 0))
+      break;
+
+    long elided = halo_elided();
+    LOG_PRINT("Run %d: %ld of %ld tile field exchanges elided\n", d, elided, halo_requested());
+    if ((d == 0) != (elided == 0)) {
+      fail = true;
+      sprintf(fail_reason, "%ld exchanges elided in run %d\n", elided, d);
+    }
+
+    end_compared(&runs);
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief A team of threads sharing the tiles reproduces a single thread bitwise, timestep by timestep, with uneven tile
+ * ranges, temporal blocking and a field summary on every step
+ */
+void test_team() {
+  const clover_field fields[] = {CLOVER_FIELD_DENSITY0, CLOVER_FIELD_ENERGY0, CLOVER_FIELD_PRESSURE, CLOVER_FIELD_XVEL0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+              " x_cells=90\n y_cells=90\n xmax=10.0\n ymax=10.0\n end_step=20\n tiles_per_chunk=25\n%s*endclover\n",
+      .steps = 20,
+      .every_dt = true,
+      .fields = fields,
+      .num_fields = 4,
+      .first_node = 3,
+      .x_cells = 90,
+      .y_cells = 90
+  };
+  const char *options[] = {"", " threads=4\n", " threads=3\n temporal_blocking\n summary_frequency=1\n"};
+  const int sizes[] = {1, 4, 3};
+
+  for (int d = 0; d < 3 && !fail; d++) {
+    if (!run_compared(&runs, options[d], d, d == 0))
+      break;
+
+    if (team_size() != sizes[d]) {
+      fail = true;
+      sprintf(fail_reason, "Team of %d threads in run %d, expected %d\n", team_size(), d, sizes[d]);
+    }
+
+    LOG_PRINT("Run %d: %d threads, step %d\n", d, team_size(), clover_leaf_get_step());
+    end_compared(&runs);
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief A team is pinned to CPUs the process may run on, the main thread gets its affinity back when the run ends,
+ * and the unpinned keyword leaves the team alone
+ */
+void test_team_placement() {
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+              " x_cells=40\n y_cells=40\n xmax=10.0\n ymax=10.0\n end_step=2\n tiles_per_chunk=6\n threads=3\n"
+              "%s*endclover\n",
+      .steps = 2,
+      .x_cells = 40,
+      .y_cells = 40
+  };
+  cpu_set_t before, after;
+
+  sched_getaffinity(0, sizeof(before), &before);
+
+  for (int d = 0; d < 2 && !fail; d++) {
+    if (!run_compared(&runs, d == 0 ? "" : " unpinned\n", d, d == 0))
+      break;
+
+    for (int m = 0; m < team_size(); m++) {
+      int cpu = team_cpu(m);
+      LOG_PRINT("Run %d: thread %d on CPU %d\n", d, m, cpu);
+
+      if (d == 0 ? cpu < 0 || !CPU_ISSET(cpu, &before) : cpu != -1) {
+        fail = true;
+        sprintf(fail_reason, "Run %d, thread %d on CPU %d\n", d, m, cpu);
+      }
+    }
+
+    end_compared(&runs);
+
+    sched_getaffinity(0, sizeof(after), &after);
+    if (!CPU_EQUAL(&before, &after)) {
+      fail = true;
+      sprintf(fail_reason, "Run %d left the main thread's affinity changed\n", d);
+    }
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief Counts the threads of the process
+ */
+static int process_threads() {
+  int threads = 0;
+
+  DIR *dir = opendir("/proc/self/task");
+  struct dirent *entry;
+  while (dir != NULL && (entry = readdir(dir)) != NULL)
+    threads += entry->d_name[0] != '.';
+  if (dir != NULL)
+    closedir(dir);
+
+  return threads;
+}
+
+/**
+ * @brief A threaded run aborted by an error leaves the calling thread with the affinity it had before the run, and its
+ * workers joined
+ */
+void test_team_abort() {
+  const char *deck =
+      "*clover\n state 1 density=0.2 energy=1.0\n"
+      " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+      " x_cells=40\n y_cells=40\n xmax=10.0\n ymax=10.0\n initial_timestep=1.0e-9\n max_timestep=1.0e-9\n"
+      " end_step=2\n tiles_per_chunk=6\n threads=3\n*endclover\n";
+  cpu_set_t before, after;
+  int threads_before = process_threads();
+
+  pthread_getaffinity_np(pthread_self(), sizeof(before), &before);
+
+  // The timestep below dtmin is reported once the team has been pinned
+  abort_on_error = true;
+  if (clover_leaf_init(deck, NULL, NULL) != 0) {
+    fail = true;
+    sprintf(fail_reason, "Run failed to start\n");
+  } else if (clover_leaf_step(1) != -1) {
+    fail = true;
+    sprintf(fail_reason, "Run not aborted\n");
+  }
+  LOG_PRINT("Thread 0 on CPU %d when the run aborted\n", team_cpu(0));
+  clover_leaf_finalize();
+  abort_on_error = false;
+
+  pthread_getaffinity_np(pthread_self(), sizeof(after), &after);
+  if (!CPU_EQUAL(&before, &after)) {
+    fail = true;
+    sprintf(fail_reason, "The aborted run left the calling thread's affinity changed\n");
+  }
+
+  int threads_after = process_threads();
+  if (threads_after != threads_before) {
+    fail = true;
+    sprintf(fail_reason, "%d threads after the aborted run, %d before\n", threads_after, threads_before);
+  }
+}
+
+/**
+ * @brief Running a step as a dataflow reproduces the bulk-synchronous team bitwise, timestep by timestep and exchange by
+ * exchange, on tiles narrower than the halo margin, with temporal blocking and a field summary on every step
+ */
+void test_flow() {
+  const clover_field fields[] = {CLOVER_FIELD_DENSITY0, CLOVER_FIELD_ENERGY0, CLOVER_FIELD_PRESSURE, CLOVER_FIELD_YVEL0};
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=1.0 ymin=0.0 ymax=1.0\n"
+              " x_cells=90\n y_cells=90\n xmax=10.0\n ymax=10.0\n end_step=20\n tiles_per_chunk=36\n threads=5\n"
+              "%s*endclover\n",
+      .steps = 20,
+      .every_dt = true,
+      .fields = fields,
+      .num_fields = 4,
+      .first_node = 3,
+      .x_cells = 90,
+      .y_cells = 90
+  };
+  const char *options[] = {
+      " bulk_synchronous\n",
+      "",
+      " bulk_synchronous\n temporal_blocking\n summary_frequency=1\n",
+      " temporal_blocking\n summary_frequency=1\n"
+  };
+  long elided = 0;
+
+  // Each dataflow run is compared with the bulk-synchronous run before it
+  for (int d = 0; d < 4 && !fail; d++) {
+    bool reference = d % 2 == 0;
+    if (!run_compared(&runs, options[d], d, reference))
+      break;
+
+    if (flow_on() == reference) {
+      fail = true;
+      sprintf(fail_reason, "Run %d %s as a dataflow\n", d, reference ? "runs" : "doesn't run");
+    }
+
+    // Each tile chooses its own exchanges, the same ones the master chooses for every tile between barriers
+    if (reference) {
+      elided = halo_elided();
+    } else if (halo_elided() != elided) {
+      fail = true;
+      sprintf(fail_reason, "Run %d elided %ld exchanges, %ld with barriers\n", d, halo_elided(), elided);
+    }
+
+    LOG_PRINT("Run %d: %d threads, %ld exchanges elided\n", d, team_size(), halo_elided());
+    end_compared(&runs);
+  }
+
+  free_compared(&runs);
+}
+
+/**
+ * @brief The tiles of a chunk are split closest to square, as wide as they are tall or wider, strips for a prime number
+ */
+void test_tile_grid() {
+  const int cases[][5] = {
+      {64, 200, 200, 8, 8},
+      {12, 300, 100, 6, 2},
+      {12, 100, 300, 2, 6},
+      {7, 200, 200, 7, 1},
+      {7, 100, 300, 1, 7},
+      {49, 40, 40, 7, 7},
+      {1, 10, 10, 1, 1}
+  };
+
+  for (int c = 0; c < (int)(sizeof(cases) / sizeof(cases[0])); c++) {
+    int tile_x, tile_y;
+    clover_tile_grid(cases[c][0], cases[c][1], cases[c][2], &tile_x, &tile_y);
+    LOG_PRINT("%d tiles on %dx%d: %d by %d\n", cases[c][0], cases[c][1], cases[c][2], tile_x, tile_y);
+
+    if (tile_x != cases[c][3] || tile_y != cases[c][4]) {
+      fail = true;
+      sprintf(
+          fail_reason,
+          "%d tiles on %dx%d split %d by %d, not %d by %d\n",
+          cases[c][0],
+          cases[c][1],
+          cases[c][2],
+          tile_x,
+          tile_y,
+          cases[c][3],
+          cases[c][4]
+      );
+    }
+  }
+}
+
+/**
+ * @brief Tuned tiles give the timesteps of a single tile, and a second run of the deck takes them from the cache
+ */
+void test_tune() {
+  compared_runs runs = {
+      .deck = "*clover\n state 1 density=0.2 energy=1.0\n"
+              " state 2 density=1.0 energy=2.5 geometry=rectangle xmin=0.0 xmax=5.0 ymin=0.0 ymax=2.0\n"
+              " x_cells=120\n y_cells=120\n xmax=10.0\n ymax=10.0\n end_step=10\n tiles_per_chunk=%s\n*endclover\n",
+      .steps = 10,
+      .every_dt = true,
+      .x_cells = 120,
+      .y_cells = 120
+  };
+  const char *expected[] = {NULL, "Tuning the tiles", "Tiles from the tuning cache"};
+  char path[512], cache[] = "/tmp/clover_tune_test_XXXXXX";
+
+  if (mkdtemp(cache) == NULL) {
+    fail = true;
+    sprintf(fail_reason, "Error creating the cache directory\n");
+    return;
+  }
+  setenv("CLOVER_JIT_CACHE", cache, 1);
+
+  for (int d = 0; d < 3 && !fail; d++) {
+    if (!run_compared(&runs, d == 0 ? "1" : "auto", d, d == 0))
+      break;
+
+    LOG_PRINT("Run %d: %d tiles\n", d, clover_leaf_get_num_tiles());
+    end_compared(&runs);
+
+    if (expected[d] != NULL && strstr(runs.out_text, expected[d]) == NULL) {
+      fail = true;
+      sprintf(fail_reason, "Run %d: no \"%s\" in clover.out\n", d, expected[d]);
+    }
+  }
+
+  free_compared(&runs);
+  unsetenv("CLOVER_JIT_CACHE");
+
+  // The second run added nothing to the choice of the first
+  int lines = 0;
+  snprintf(path, sizeof(path), "%s/tiles", cache);
+  FILE *file = fopen(path, "r");
+  for (int c; file != NULL && (c = fgetc(file)) != EOF;)
+    lines += c == '\n';
+  if (file != NULL)
+    fclose(file);
+  if (lines != 1 && !fail) {
+    fail = true;
+    sprintf(fail_reason, "%d choices cached, not 1\n", lines);
+  }
+
+  unlink(path);
+  rmdir(cache);
+}
+
+/**
+ * @brief The kernels index arrays of more than 2^31 elements: the external halos of a tile of 2^20 x 2100 cells, in
+ * address space reserved without memory, of which only the rows and columns along the edges are touched
+ */
+void test_large_index() {
+  const int x_min = 1, x_max = 1 << 20, y_min = 1, y_max = 2100, depth = 2;
+  int chunk_neighbours[4] = {EXTERNAL_FACE, EXTERNAL_FACE, EXTERNAL_FACE, EXTERNAL_FACE};
+  int tile_neighbours[4] = {EXTERNAL_TILE, EXTERNAL_TILE, EXTERNAL_TILE, EXTERNAL_TILE};
+  int fields[NUM_FIELDS] = {0};
+  size_t bytes = (size_t)(x_max + 4) * (y_max + 4) * sizeof(double);
+
+  double *density0 = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (density0 == MAP_FAILED) {
+    LOG_PRINT("Skipped, %.1f GB of address space can't be reserved\n", bytes / 1.0e9);
+    return;
+  }
+
+#define DENSITY0(j, k) density0[FTNREF2D(j, k, x_max + 4, x_min - 2, y_min - 2)]
+
+  LOG_PRINT("%zu elements, the last at %td\n", bytes / sizeof(double), &DENSITY0(x_max + 2, y_max + 2) - density0);
+
+  // The halo rows mirror the top two rows of cells, holding the row above 2^31 / (x_max + 4) in their values
+  for (int k = y_max - 1; k <= y_max; k++)
+    for (int j = x_min; j <= x_max; j++)
+      DENSITY0(j, k) = k * 1.0e7 + j;
+
+  fields[FIELD_DENSITY0] = 1;
+  kernel_update_halo(
+      x_min,
+      x_max,
+      y_min,
+      y_max,
+      chunk_neighbours,
+      tile_neighbours,
+      density0,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      NULL,
+      fields,
+      depth
+  );
+
+  for (int j = x_min; j <= x_max && !fail; j++) {
+    if (DENSITY0(j, y_max + 1) != DENSITY0(j, y_max) || DENSITY0(j, y_max + 2) != DENSITY0(j, y_max - 1)) {
+      fail = true;
+      sprintf(fail_reason, "Top halo of column %d: %f, %f\n", j, DENSITY0(j, y_max + 1), DENSITY0(j, y_max + 2));
+    }
+  }
+  if (DENSITY0(x_min - 1, y_max) != DENSITY0(x_min, y_max) ||
+      DENSITY0(x_max + 2, y_max) != DENSITY0(x_max - 1, y_max)) {
+    fail = true;
+    sprintf(fail_reason, "Side halos of the top row: %f, %f\n", DENSITY0(x_min - 1, y_max), DENSITY0(x_max + 2, y_max));
+  }
+
+#undef DENSITY0
+
+  munmap(density0, bytes);
+}
+
 int main(int argc, char **argv) {
   puts("*** CLoverLeaf unit test runner ***");
   file_in = fopen("clover.in", "r");
@@ -274,7 +1782,32 @@ int main(int argc, char **argv) {
   RUN_TEST(test_relative_array_indexing_1D);
   RUN_TEST(test_relative_array_indexing_2D);
   RUN_TEST(test_build_field);
+  RUN_TEST(test_build_field_reuse);
   RUN_TEST(test_build_field_stress);
+  RUN_TEST(test_generate_chunk);
+  RUN_TEST(test_ensemble_update_halo);
+  RUN_TEST(test_embedding_api);
+  RUN_TEST(test_tile_halo);
+  RUN_TEST(test_shm_export);
+  RUN_TEST(test_profiler);
+  RUN_TEST(test_trace);
+  RUN_TEST(test_roofline);
+  RUN_TEST(test_footprint);
+  RUN_TEST(test_activity);
+  RUN_TEST(test_temporal_blocking);
+  RUN_TEST(test_kernel_variants);
+  RUN_TEST(test_pdv_fluxes);
+  RUN_TEST(test_jit);
+  RUN_TEST(test_uniform_grid);
+  RUN_TEST(test_lazy_eos);
+  RUN_TEST(test_halo_validity);
+  RUN_TEST(test_team);
+  RUN_TEST(test_team_placement);
+  RUN_TEST(test_team_abort);
+  RUN_TEST(test_flow);
+  RUN_TEST(test_tile_grid);
+  RUN_TEST(test_tune);
+  RUN_TEST(test_large_index);
 
   puts("\nAll tests passed!");
   return 0;
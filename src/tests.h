@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "clover.h"
+
 // Log enable
 static bool log_enabled = true;
 
@@ -12,10 +14,16 @@ static FILE *file_in;
 static bool fail = false;
 static char fail_reason[128];
 
+// Set by a test expecting an error, which aborts the run instead of failing the test
+static bool abort_on_error = false;
+
 // Override report functions, clover_leaf uses these to report errors
 void __attribute__((weak))
 // NOLINTNEXTLINE(misc-definitions-in-headers)
 report_error_arg(const char *location, const char *error, const char *arg) {
+  if (abort_on_error)
+    clover_abort();
+
   fail = true;
   sprintf(fail_reason, "Error in %s: %s%s\n", location, error, arg);
 }
@@ -32,6 +40,7 @@ static void cleanup() {
     rewind(file_in);
   fail = false;
   fail_reason[0] = '\0';
+  abort_on_error = false;
 }
 
 #define RUN_TEST(x)         \
@@ -0,0 +1,265 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "trace.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "definitions.h"
+#include "report.h"
+#include "team.h"
+#include "utils/math.h"
+#include "utils/timer.h"
+
+/**
+ * @file initialise.c
+ */
+extern FILE *open_run_file(const char *name, const char *mode);
+
+// Events a buffer starts with, doubled when a step needs more
+#define TRACE_BUFFER_EVENTS 4096
+
+typedef enum trace_category_t { TRACE_STEP, TRACE_REGION, TRACE_TILE } trace_category;
+
+static const char *const category_names[] = {"step", "region", "tile"};
+
+typedef struct trace_event_t {
+  const char *name;
+  trace_category category;
+  int arg;  // Step or tile number, by category
+  double start;
+  double end;
+} trace_event;  // 32 bytes
+
+// The events of one member of the team, written to the JSON file at the end of each step, when the team is idle
+typedef struct trace_buffer_t {
+  _Alignas(64) trace_event *events;
+  int num_events;
+  int capacity;
+} trace_buffer;
+
+static const double percentiles[] = {50.0, 95.0, 99.0};
+
+#define NUM_PERCENTILES (int)(sizeof(percentiles) / sizeof(percentiles[0]))
+
+static BATCH_LOCAL bool tracing = false;
+static BATCH_LOCAL FILE *json = NULL, *csv = NULL;
+static BATCH_LOCAL double origin;
+
+static BATCH_LOCAL trace_buffer *buffers = NULL;
+static BATCH_LOCAL int num_buffers;
+static BATCH_LOCAL long events_written;
+
+// Per step rows of the CSV file: the step time followed by the time of each region
+static BATCH_LOCAL int num_columns;
+static BATCH_LOCAL double *current_row = NULL;
+static BATCH_LOCAL double *rows = NULL;
+static BATCH_LOCAL int num_rows, rows_capacity;
+
+/**
+ * @brief Writes the events of every member, each on the thread of its member
+ */
+static void flush_events() {
+  for (int m = 0; m < num_buffers; m++) {
+    trace_buffer *buffer = &buffers[m];
+
+    for (int e = 0; e < buffer->num_events; e++) {
+      const trace_event *event = &buffer->events[e];
+
+      fprintf(
+          json,
+          "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+          "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"%s\":%d}}",
+          events_written++ > 0 ? "," : "",
+          event->name,
+          category_names[event->category],
+          m,
+          (event->start - origin) * 1.0e6,
+          (event->end - event->start) * 1.0e6,
+          event->category == TRACE_TILE ? "tile" : "step",
+          event->arg
+      );
+    }
+    buffer->num_events = 0;
+  }
+}
+
+/**
+ * @brief Adds an event to the buffer of the calling member, which only it writes to within a team region
+ */
+static void record(const char *name, trace_category category, int arg, double start, double end) {
+  trace_buffer *buffer = &buffers[team_member()];
+
+  if (buffer->num_events == buffer->capacity) {
+    trace_event *events = realloc(buffer->events, 2 * (size_t)buffer->capacity * sizeof(trace_event));
+    if (events == NULL)
+      report_error("trace", "Error allocating the trace events.");
+    buffer->events = events;
+    buffer->capacity *= 2;
+  }
+
+  buffer->events[buffer->num_events++] = (trace_event){name, category, arg, start, end};
+}
+
+/**
+ * @brief Closes the files as they are and frees the buffers
+ */
+static void release() {
+  if (json != NULL)
+    fclose(json);
+  if (csv != NULL)
+    fclose(csv);
+  for (int m = 0; m < num_buffers; m++)
+    free(buffers[m].events);
+  free(buffers);
+  free(current_row);
+  free(rows);
+
+  json = NULL;
+  csv = NULL;
+  buffers = NULL;
+  num_buffers = 0;
+  current_row = NULL;
+  rows = NULL;
+  tracing = false;
+}
+
+void trace_open(int num_regions, const char *const region_names[]) {
+  trace_close();
+
+  events_written = 0;
+  num_columns = num_regions + 1;
+  num_rows = 0;
+  rows_capacity = 0;
+
+  json = open_run_file("clover_trace.json", "w");
+  csv = open_run_file("clover_trace.csv", "w");
+  buffers = aligned_alloc(64, team_size() * sizeof(trace_buffer));
+  current_row = calloc(num_columns, sizeof(double));
+
+  bool allocated = buffers != NULL && current_row != NULL;
+  num_buffers = buffers != NULL ? team_size() : 0;
+  for (int m = 0; m < num_buffers; m++) {
+    buffers[m] = (trace_buffer){malloc(TRACE_BUFFER_EVENTS * sizeof(trace_event)), 0, TRACE_BUFFER_EVENTS};
+    allocated = allocated && buffers[m].events != NULL;
+  }
+
+  if (json == NULL || csv == NULL || !allocated) {
+    release();
+    report_error("trace_open", "Error opening the trace files.");
+  }
+
+  fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", json);
+  fputs("step,step_time", csv);
+  for (int r = 0; r < num_regions; r++)
+    fprintf(csv, ",%s", region_names[r]);
+  fputc('\n', csv);
+
+  origin = timer();
+  tracing = true;
+}
+
+void trace_tile(const char *name, int tile, double start, double end) {
+  if (tracing)
+    record(name, TRACE_TILE, tile, start, end);
+}
+
+void trace_region(int region, const char *name, double start, double end) {
+  if (!tracing)
+    return;
+
+  record(name, TRACE_REGION, step, start, end);
+  // The tasks of a dataflow trace their regions from every member at once
+  atomic_add(&current_row[region + 1], end - start);
+}
+
+void trace_step(int step_number, double start) {
+  if (!tracing)
+    return;
+
+  double end = timer();
+  record("step", TRACE_STEP, step_number, start, end);
+  current_row[0] = end - start;
+  flush_events();
+
+  fprintf(csv, "%d", step_number);
+  for (int c = 0; c < num_columns; c++)
+    fprintf(csv, ",%.9f", current_row[c]);
+  fputc('\n', csv);
+
+  if (num_rows == rows_capacity) {
+    rows_capacity = rows_capacity > 0 ? 2 * rows_capacity : 1024;
+    rows = realloc(rows, (size_t)rows_capacity * num_columns * sizeof(double));
+    if (rows == NULL)
+      report_error("trace_step", "Error allocating the trace rows.");
+  }
+  memcpy(&rows[(size_t)num_rows * num_columns], current_row, num_columns * sizeof(double));
+  num_rows++;
+
+  memset(current_row, 0, num_columns * sizeof(double));
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest rank percentiles of one column of the rows
+ */
+static void column_percentiles(int column, double result[static NUM_PERCENTILES]) {
+  double *values = malloc(num_rows * sizeof(double));
+  if (values == NULL)
+    report_error("trace", "Error allocating the percentiles.");
+
+  for (int r = 0; r < num_rows; r++)
+    values[r] = rows[(size_t)r * num_columns + column];
+  qsort(values, num_rows, sizeof(double), compare_doubles);
+
+  for (int p = 0; p < NUM_PERCENTILES; p++) {
+    int rank = (int)ceil(percentiles[p] / 100.0 * num_rows);
+    result[p] = values[rank > 0 ? rank - 1 : 0];
+  }
+  free(values);
+}
+
+void trace_print(FILE *out) {
+  if (!tracing || num_rows == 0)
+    return;
+
+  double latency[NUM_PERCENTILES];
+  column_percentiles(0, latency);
+
+  fprintf(out, "\n%-22s%16s%16s%16s\n", "Step latency", "p50", "p95", "p99");
+  fprintf(out, "\n%-22s:%16.6f%16.6f%16.6f\n", "Step time", latency[0], latency[1], latency[2]);
+}
+
+void trace_close() {
+  if (!tracing)
+    return;
+
+  flush_events();
+  fputs("\n]}\n", json);
+
+  if (num_rows > 0) {
+    double *table = malloc((size_t)num_columns * NUM_PERCENTILES * sizeof(double));
+    if (table == NULL)
+      report_error("trace_close", "Error allocating the percentiles.");
+
+    for (int c = 0; c < num_columns; c++)
+      column_percentiles(c, &table[c * NUM_PERCENTILES]);
+
+    for (int p = 0; p < NUM_PERCENTILES; p++) {
+      fprintf(csv, "p%.0f", percentiles[p]);
+      for (int c = 0; c < num_columns; c++)
+        fprintf(csv, ",%.9f", table[c * NUM_PERCENTILES + p]);
+      fputc('\n', csv);
+    }
+    free(table);
+  }
+
+  release();
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Event trace of the calculation, enabled by the trace_on deck keyword
+ * @details Every step, profiled region and per tile kernel call is recorded as a begin/end pair in a buffer of the
+ * member of the team running it, and written to clover_trace.json at the end of each step in the Chrome trace event
+ * format (chrome://tracing, Perfetto), with the member as the thread of the event. The events of a thread nest as
+ * step > region > tile. The regions are the profiler's, trace_on turns the profiler on too: the master traces the
+ * regions of the bulk-synchronous drivers, and every member the tasks of a dataflow (see flow.h).
+ *
+ * clover_trace.csv gets one row per step with the time of the step and of each profiler region within it, followed by
+ * the p50, p95 and p99 of every column over the steps.
+ */
+
+#pragma once
+
+#include <stdio.h>
+
+/**
+ * @brief Opens the trace files, called by profiler_open() when tracing
+ * @param num_regions Number of profiler regions, the columns of the CSV file after the step time
+ * @param region_names Their names, as CSV column headers
+ */
+extern void trace_open(int num_regions, const char *const region_names[]);
+
+/**
+ * @brief Records a kernel call on one tile, called by profiler_tile_stop()
+ * @param name Kernel name, a string literal
+ */
+extern void trace_tile(const char *name, int tile, double start, double end);
+
+/**
+ * @brief Records a profiler region, adding its time to the region's column of the current step
+ */
+extern void trace_region(int region, const char *name, double start, double end);
+
+/**
+ * @brief Records a step, and writes its row of the CSV file
+ */
+extern void trace_step(int step, double start);
+
+/**
+ * @brief Prints the step latency percentiles
+ */
+extern void trace_print(FILE *out);
+
+/**
+ * @brief Writes the percentiles to the CSV file and closes the trace files, safe to call when they aren't open
+ */
+extern void trace_close();
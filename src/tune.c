@@ -0,0 +1,288 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "tune.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "data.h"
+#include "definitions.h"
+#include "utils/cache_dir.h"
+#include "utils/math.h"
+#include "utils/topology.h"
+
+// Steps of a calibration run, the first of which isn't timed
+#define TUNE_STEPS 4
+
+// Cells of the shortest side of a candidate tile
+#define TUNE_MIN_SIDE 8
+
+#define TUNE_MAX_CANDIDATES 32
+
+extern void start();
+
+extern void destroy_tiles();
+
+extern double hydro_calibrate(int steps);
+
+// A candidate decomposition of the chunk
+typedef struct tile_choice_t {
+  int tiles;
+  int x, y;       // Tiles across and up
+  int band_rows;  // Rows of the bands of temporal blocking, 0 without it
+  double time;    // Of its calibration run
+} tile_choice;
+
+/**
+ * @brief Members of the team the tiles will be shared by, see team_open()
+ */
+static int members() {
+#ifdef BATCH_ENABLED
+  return 1;
+#else
+  return max(threads, 1);
+#endif
+}
+
+/**
+ * @brief Adds the grid of a number of tiles whose tiles are closest to an aspect ratio, unless it is there already or
+ * has tiles narrower than TUNE_MIN_SIDE cells
+ * @param aspect Width over height of the tiles, in cells
+ * @return The number of candidates
+ */
+static int add_grid(tile_choice *list, int num, int tiles, double aspect) {
+  int best_x = 0;
+  double best = 0.0;
+
+  for (int x = 1; x <= tiles; x++) {
+    int y = tiles / x;
+    if (tiles % x != 0 || grid.x_cells / x < TUNE_MIN_SIDE || grid.y_cells / y < TUNE_MIN_SIDE)
+      continue;
+
+    double off = fabs(log((double)grid.x_cells / x / ((double)grid.y_cells / y) / aspect));
+    if (best_x == 0 || off < best) {
+      best_x = x;
+      best = off;
+    }
+  }
+
+  if (best_x == 0 || num == TUNE_MAX_CANDIDATES)
+    return num;
+  for (int c = 0; c < num; c++)
+    if (list[c].x == best_x && list[c].y == tiles / best_x)
+      return num;
+
+  list[num] = (tile_choice){tiles, best_x, tiles / best_x, 0, 0.0};
+  return num + 1;
+}
+
+/**
+ * @brief Lists the grids to calibrate, see tune.h
+ * @return The number of candidates
+ */
+static int candidates(tile_choice *list, long l2, long llc) {
+  int team = members();
+  double mesh = (double)grid.x_cells * grid.y_cells * NUM_FIELD_ARRAYS * sizeof(double);
+  double targets[] = {0.5 * l2, l2, 2.0 * l2, 0.5 * llc / team, 0.0};
+  int num = 0;
+
+  for (int t = 0; t < (int)(sizeof(targets) / sizeof(targets[0])); t++) {
+    // The fewest tiles the team can share last, then rounded up to a tile count the members share evenly
+    int tiles = targets[t] > 0.0 ? (int)fmin(ceil(mesh / targets[t]), grid.x_cells * (double)grid.y_cells) : 1;
+    tiles = (tiles + team - 1) / team * team;
+
+    num = add_grid(list, num, tiles, 1.0);
+    num = add_grid(list, num, tiles, 4.0);
+    num = add_grid(list, num, tiles, 1.0e9);
+  }
+
+  // A mesh too small for any split runs as a single tile
+  if (num == 0)
+    list[num++] = (tile_choice){1, 1, 1, 0, 0.0};
+  return num;
+}
+
+/**
+ * @brief Times the steps of a calibration run of a candidate
+ */
+static double calibrate(tile_choice *choice) {
+  tiles_per_chunk = choice->tiles;
+  tile_grid_x = choice->x;
+  tile_grid_y = choice->y;
+  band_rows = choice->band_rows;
+  step = 0;
+
+  start();
+  // Chosen by start() when the candidate leaves it to the L2 cache size
+  if (temporal_blocking)
+    choice->band_rows = band_rows;
+  double time = hydro_calibrate(TUNE_STEPS);
+  destroy_tiles();
+
+  return time;
+}
+
+/**
+ * @brief Identifies the machine and the deck the tiles are tuned for, without spaces
+ */
+static void tuning_key(char *key, size_t size, long l2, long llc) {
+  char model[128] = "unknown";
+
+  topology_cpu_info("model name", model, sizeof(model));
+  for (char *c = model; *c != '\0'; c++) {
+    if (*c == ' ' || *c == '\t')
+      *c = '_';
+  }
+
+  snprintf(
+      key,
+      size,
+      "%s/cpus=%ld/l2=%ld/llc=%ld/mesh=%dx%d/threads=%d/blocking=%d",
+      model,
+      sysconf(_SC_NPROCESSORS_ONLN),
+      l2,
+      llc,
+      grid.x_cells,
+      grid.y_cells,
+      members(),
+      temporal_blocking ? band_rows : -1
+  );
+}
+
+/**
+ * @brief Reads the choice of a key from the cache file, the last one written
+ * @return Whether there is one
+ */
+static bool cached(const char *path, const char *key, tile_choice *choice) {
+  char entry[512];
+  tile_choice read;
+  bool found = false;
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return false;
+
+  while (fscanf(file, "%511s %d %d %d %d", entry, &read.tiles, &read.x, &read.y, &read.band_rows) == 5) {
+    if (strcmp(entry, key) == 0 && read.tiles == read.x * read.y && read.tiles > 0) {
+      *choice = read;
+      found = true;
+    }
+  }
+
+  fclose(file);
+  return found;
+}
+
+void tune_tiles() {
+  char dir[G_NAME_LEN_MAX], path[G_NAME_LEN_MAX + 8], key[512];
+  tile_choice list[TUNE_MAX_CANDIDATES + 2];
+  tile_choice best;
+
+  long l2 = topology_cache(2);
+  long llc = topology_cache(3);
+  if (l2 == 0)
+    l2 = 1024 * 1024;
+  if (llc == 0)
+    llc = l2;
+
+  cache_dir(dir, sizeof(dir));
+  snprintf(path, sizeof(path), "%s/tiles", dir);
+  tuning_key(key, sizeof(key), l2, llc);
+
+  if (cached(path, key, &best)) {
+    if (parallel.boss)
+      fprintf(g_out, "\nTiles from the tuning cache %s\n", path);
+  } else if (dry_run) {
+    if (parallel.boss)
+      fputs("\nTiles not tuned in a dry run, the chunk is a single tile\n", g_out);
+    return;
+  } else {
+    int num = candidates(list, l2, llc);
+    bool tune_bands = temporal_blocking && band_rows == 0;
+    for (int c = 0; c < num; c++)
+      list[c].band_rows = band_rows;
+
+    // The calibration runs are silent, and don't touch what outlives them
+    bool boss = parallel.boss, profiling = profiler_on, tracing = trace_on, compiling = jit, sweeping = full_sweep;
+    int visits = visit_frequency;
+    char export_name[G_NAME_LEN_MAX];
+    strcpy(export_name, shm_export_name);
+
+    parallel.boss = false;
+    profiler_on = false;
+    trace_on = false;
+    jit = false;
+    full_sweep = true;
+    visit_frequency = 0;
+    shm_export_name[0] = '\0';
+
+    best = list[0];
+    for (int c = 0; c < num; c++) {
+      list[c].time = calibrate(&list[c]);
+      if (list[c].time < best.time || c == 0)
+        best = list[c];
+    }
+
+    // The band height of the fastest grid, halved and doubled from the one chosen by the L2 cache size
+    if (tune_bands) {
+      int rows = best.band_rows;
+      int heights[] = {max(rows / 2, 2), rows * 2};
+
+      for (int h = 0; h < 2; h++) {
+        if (heights[h] == rows)
+          continue;
+        list[num] = best;
+        list[num].band_rows = heights[h];
+        list[num].time = calibrate(&list[num]);
+        num++;
+      }
+      for (int c = 0; c < num; c++)
+        if (list[c].time < best.time)
+          best = list[c];
+    }
+
+    parallel.boss = boss;
+    profiler_on = profiling;
+    trace_on = tracing;
+    jit = compiling;
+    full_sweep = sweeping;
+    visit_frequency = visits;
+    strcpy(shm_export_name, export_name);
+
+    if (parallel.boss) {
+      fprintf(g_out, "\nTuning the tiles on %d calibration runs of %d steps\n", num, TUNE_STEPS);
+      fprintf(g_out, "%8s%12s%12s%14s\n", "Tiles", "Grid", "Band rows", "Time");
+      for (int c = 0; c < num; c++) {
+        tile_choice *choice = &list[c];
+        char rows[16] = "-";
+        if (choice->band_rows > 0)
+          snprintf(rows, sizeof(rows), "%d", choice->band_rows);
+        fprintf(g_out, "%8d%6d x %-4d%12s%14.6f\n", choice->tiles, choice->x, choice->y, rows, choice->time);
+      }
+    }
+
+    FILE *file = make_dirs(dir) ? fopen(path, "a") : NULL;
+    if (file != NULL) {
+      fprintf(file, "%s %d %d %d %d\n", key, best.tiles, best.x, best.y, best.band_rows);
+      fclose(file);
+    }
+    if (parallel.boss)
+      fprintf(g_out, "Tuned tiles %s %s\n", file != NULL ? "cached in" : "not cached, can't write", path);
+  }
+
+  tiles_per_chunk = best.tiles;
+  tile_grid_x = best.x;
+  tile_grid_y = best.y;
+  band_rows = best.band_rows;
+
+  if (parallel.boss) {
+    fprintf(g_out, "Tuned to %d tiles", tiles_per_chunk);
+    if (band_rows > 0)
+      fprintf(g_out, ", bands of %d rows", band_rows);
+    fputc('\n', g_out);
+  }
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+/**
+ * @brief Tuning of the tiles, enabled by tiles_per_chunk auto in the deck
+ * @details The candidates are tile counts whose tiles' fields fill half of the L2 cache, all of it or twice it, or a
+ * share of the last level cache per member of the team, read from sysfs (see utils/topology.h), and the fewest tiles
+ * the team can share. Each count is tried as a grid of square tiles, of tiles four times as wide as tall, and of strips
+ * as wide as the mesh, the kernels sweeping rows, none narrower than TUNE_MIN_SIDE cells. With temporal_blocking the
+ * band height of the fastest grid is tuned too, unless the deck sets band_rows.
+ *
+ * Every candidate is timed by a calibration run: the chunk is decomposed and generated as the deck asks, a few steps
+ * run without output and sweeping every tile, as the steps do once a disturbance has spread, and the chunk is
+ * destroyed. The fastest candidate is kept in a file of the cache directory (see utils/cache_dir.h), keyed by the CPU
+ * model, CPUs, cache sizes, mesh, threads and temporal blocking, and later runs of a deck of that key reuse it without
+ * calibrating. The candidates' times and the choice are printed in clover.out.
+ */
+
+#pragma once
+
+/**
+ * @brief Chooses tiles_per_chunk, tile_grid_x and tile_grid_y, and band_rows with temporal blocking, called once the
+ * deck is read and before start()
+ */
+extern void tune_tiles();
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <stdbool.h>
+#include <stddef.h>
 
 typedef struct state_type_t {
   bool defined;
@@ -36,12 +37,11 @@ typedef struct profiler_type_t {
   double visit;
   double summary;
   double reset;
-  double revert;
-  double flux;
+  double lagrangian;  // The fused Lagrangian phase of temporal blocking, see lagrangian_blocked()
   double tile_halo_exchange;
   double self_halo_exchange;
   double mpi_halo_exchange;
-} profiler_type; // 120 bytes
+} profiler_type; // 112 bytes
 
 typedef struct field_type_t {
   double *density0;     // 2D array
@@ -60,8 +60,8 @@ typedef struct field_type_t {
   double *vol_flux_y;   // 2D array
   double *mass_flux_y;  // 2D array
   double *work_array1;  // 2D array | node_flux, stepbymass, volume_change, pre_vol
-  double *work_array2;  // 2D array | node_mass_post, post_vol
-  double *work_array3;  // 2D array | node_mass_pre, pre_mass
+  double *work_array2;  // 2D array | node_mass_post, post_vol, predicted density
+  double *work_array3;  // 2D array | node_mass_pre, pre_mass, predicted energy
   double *work_array4;  // 2D array | advec_vel, post_mass
   double *work_array5;  // 2D array | mom_flux, advec_vol
   double *work_array6;  // 2D array | pre_vol, post_ener
@@ -76,10 +76,36 @@ typedef struct field_type_t {
   double *vertexdx;  // 1D array
   double *vertexdy;  // 1D array
 
-  double *volume;  // 2D array
-  double *xarea;   // 2D array
-  double *yarea;   // 2D array
-} field_type; // 264 bytes
+  double *volume;  // 2D array, NULL on a uniform grid
+  double *xarea;   // 2D array, NULL on a uniform grid
+  double *yarea;   // 2D array, NULL on a uniform grid
+
+  // The single values of volume, xarea and yarea on a uniform grid, see kernels/geometry.h
+  double uniform_volume;
+  double uniform_xarea;
+  double uniform_yarea;
+} field_type;  // 288 bytes
+
+// Number of arrays in field_type
+#define NUM_FIELD_ARRAYS 33
+
+// Layout of one of the field_type arrays, as the number of elements past the tile's x_max and y_max in each direction.
+// A zero marks a direction the array doesn't extend in.
+typedef struct field_array_type_t {
+  const char *name;
+  size_t offset;  // Offset of the array pointer in field_type
+  int x_extra;
+  int y_extra;
+} field_array_type;
+
+// Memory taken by the field arrays of every tile, see field_footprint()
+typedef struct field_footprint_type_t {
+  size_t array[NUM_FIELD_ARRAYS];  // Bytes of each of field_arrays, summed over the tiles
+  size_t total;
+  size_t interior;  // Bytes covering the tiles' own cells and faces, the rest is halo
+  size_t tile_min;  // Bytes of the smallest tile
+  size_t tile_max;  // Bytes of the largest tile
+} field_footprint_type;
 
 typedef struct tile_type_t {
   field_type field;
@@ -95,7 +121,12 @@ typedef struct tile_type_t {
   int t_right;
   int t_bottom;
   int t_top;
-} tile_type; // 328 bytes
+
+  // Version of density0 and energy0, bumped when they change, and the version pressure and soundspeed were evaluated
+  // from, 0 when from none or from the predicted state, see ideal_gas()
+  unsigned long state_version;
+  unsigned long eos_version;
+} tile_type; // 368 bytes
 
 typedef struct chunk_type_t {
   int task;
@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: MIT
 // Copyright (C) 2022 Niccolò Betto
 
+#include <stddef.h>
+
 /**
  * @brief Flattens the given matrix index (2D) to the corresponding 1D index
  */
-#define INDEX2D(row, column, row_size) ((row) * (row_size) + (column))
+#define INDEX2D(row, column, row_size) ((ptrdiff_t)(row) * (row_size) + (column))
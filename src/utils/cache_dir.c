@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "cache_dir.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void cache_dir(char *dir, size_t size) {
+  const char *env;
+
+  if ((env = getenv("CLOVER_JIT_CACHE")) != NULL && *env != '\0')
+    snprintf(dir, size, "%s", env);
+  else if ((env = getenv("XDG_CACHE_HOME")) != NULL && *env != '\0')
+    snprintf(dir, size, "%s/cloverleaf", env);
+  else if ((env = getenv("HOME")) != NULL && *env != '\0')
+    snprintf(dir, size, "%s/.cache/cloverleaf", env);
+  else
+    snprintf(dir, size, "/tmp/cloverleaf-%u", (unsigned)getuid());
+}
+
+bool make_dirs(char *path) {
+  struct stat info;
+
+  for (char *c = path + 1; *c != '\0'; c++) {
+    if (*c == '/') {
+      *c = '\0';
+      mkdir(path, 0700);
+      *c = '/';
+    }
+  }
+  mkdir(path, 0700);
+
+  // Not a link, as another user could have planted it in /tmp
+  return lstat(path, &info) == 0 && S_ISDIR(info.st_mode) && info.st_uid == getuid() &&
+         (info.st_mode & (S_IWGRP | S_IWOTH)) == 0;
+}
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The directory of what is kept across runs, the JIT kernels and the tuned tiles: $CLOVER_JIT_CACHE, else
+ * cloverleaf under $XDG_CACHE_HOME or ~/.cache, else /tmp/cloverleaf-<uid>
+ */
+extern void cache_dir(char *dir, size_t size);
+
+/**
+ * @brief Creates a directory and its missing parents, readable by the user only
+ * @return Whether the directory exists, is the user's own and can't be written by anyone else, so that the code of the
+ * JIT kernels can be loaded from it
+ */
+extern bool make_dirs(char *path);
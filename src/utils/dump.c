@@ -36,7 +36,7 @@ void dump_step_header(int step) {
         (cur_tile->t_ymax + ymax) - (cur_tile->t_ymin + ymin)                            \
     );                                                                                   \
                                                                                          \
-    int stride = (cur_tile->t_xmax + xmax) - (cur_tile->t_xmin + xmin) + 1;              \
+    size_t stride = (cur_tile->t_xmax + xmax) - (cur_tile->t_xmin + xmin) + 1;           \
     for (int k = 0; k <= (cur_tile->t_ymax + ymax) - (cur_tile->t_ymin + ymin); k++) {   \
       for (int j = 0; j <= (cur_tile->t_xmax + xmax) - (cur_tile->t_xmin + xmin); j++) { \
         fprintf(dump_file, "%.2f ", cur_tile->field.array[k * stride + j]);              \
@@ -16,3 +16,15 @@
     __typeof__ (b) _b = (b); \
     _a < _b ? _a : _b;       \
 })
+
+/**
+ * @brief Adds to a double that other threads may be adding to at the same time, without a lock
+ */
+static inline void atomic_add(double *target, double value) {
+  double old, sum;
+
+  __atomic_load(target, &old, __ATOMIC_RELAXED);
+  do {
+    sum = old + value;
+  } while (!__atomic_compare_exchange(target, &old, &sum, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
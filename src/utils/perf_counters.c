@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "perf_counters.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include "thread_local.h"
+
+typedef struct perf_event_t {
+  perf_counter counter;
+  uint32_t type;
+  uint64_t config;
+} perf_event;
+
+// The first event of a group is its leader
+static const perf_event core_group[] = {
+    {PERF_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_LLC_REFERENCES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES},
+    {PERF_LLC_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+// FP_ARITH_INST_RETIRED (event 0xc7), umask 0x01 scalar double, 0x04 | 0x10 | 0x40 packed double of 128, 256, 512 bits
+static const perf_event fp_group[] = {
+    {PERF_FP_SCALAR, PERF_TYPE_RAW, 0x01c7},
+    {PERF_FP_PACKED, PERF_TYPE_RAW, 0x54c7},
+};
+
+#define CORE_GROUP_SIZE (int)(sizeof(core_group) / sizeof(core_group[0]))
+#define FP_GROUP_SIZE   (int)(sizeof(fp_group) / sizeof(fp_group[0]))
+
+typedef struct perf_group_t {
+  const perf_event *events;
+  int size;
+  int fd[PERF_NUM_COUNTERS];  // -1 if the group isn't open
+} perf_group;
+
+// The groups of one thread, alone on its cache lines as every thread opens its own at once
+typedef struct perf_thread_t {
+  _Alignas(64) perf_group groups[2];
+  int errnum;  // Why the core group couldn't be opened, 0 if it was
+} perf_thread;
+
+static BATCH_LOCAL perf_thread *threads = NULL;
+static BATCH_LOCAL int num_threads = 0;
+
+static BATCH_LOCAL char error[128] = "";
+
+static int open_event(const perf_event *event, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = event->type;
+  attr.config = event->config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  // The leader starts disabled, so that the whole group starts counting at once
+  attr.disabled = group_fd == -1;
+
+  // The calling thread on any CPU
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+static void close_group(perf_group *group) {
+  if (group->fd[0] < 0)
+    return;
+
+  for (int e = group->size - 1; e >= 0; e--) {
+    if (group->fd[e] >= 0)
+      close(group->fd[e]);
+    group->fd[e] = -1;
+  }
+}
+
+static bool open_group(perf_group *group) {
+  for (int e = 0; e < group->size; e++)
+    group->fd[e] = -1;
+
+  for (int e = 0; e < group->size; e++) {
+    group->fd[e] = open_event(&group->events[e], e == 0 ? -1 : group->fd[0]);
+    if (group->fd[e] < 0) {
+      close_group(group);
+      return false;
+    }
+  }
+
+  ioctl(group->fd[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(group->fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return true;
+}
+
+/**
+ * @brief The groups of a thread, NULL unless perf_counters_init() counted it
+ */
+static perf_thread *thread_groups(int thread) {
+  return thread >= 0 && thread < num_threads ? &threads[thread] : NULL;
+}
+
+/**
+ * @brief Whether the raw floating point events can be used, only on Intel cores
+ */
+static bool intel_cpu() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int max_leaf, ebx, ecx, edx;
+  if (__get_cpuid(0, &max_leaf, &ebx, &ecx, &edx) == 0)
+    return false;
+  return ebx == 0x756e6547 && edx == 0x49656e69 && ecx == 0x6c65746e;  // "GenuineIntel"
+#else
+  return false;
+#endif
+}
+
+void perf_counters_init(int num) {
+  perf_counters_close();
+
+  threads = aligned_alloc(64, num * sizeof(perf_thread));
+  num_threads = threads != NULL ? num : 0;
+
+  for (int t = 0; t < num_threads; t++) {
+    threads[t] = (perf_thread){{{core_group, CORE_GROUP_SIZE, {0}}, {fp_group, FP_GROUP_SIZE, {0}}}, ENOMEM};
+    for (int g = 0; g < 2; g++)
+      for (int e = 0; e < PERF_NUM_COUNTERS; e++)
+        threads[t].groups[g].fd[e] = -1;
+  }
+}
+
+bool perf_counters_open(int thread) {
+  perf_thread *t = thread_groups(thread);
+  if (t == NULL)
+    return false;
+
+  if (!open_group(&t->groups[0])) {
+    t->errnum = errno;
+    return false;
+  }
+
+  t->errnum = 0;
+  if (intel_cpu())
+    open_group(&t->groups[1]);
+
+  return true;
+}
+
+bool perf_counters_available(perf_counter counter) {
+  if (num_threads == 0)
+    return false;
+
+  for (int t = 0; t < num_threads; t++) {
+    for (int g = 0; g < 2; g++) {
+      for (int e = 0; e < threads[t].groups[g].size; e++) {
+        if (threads[t].groups[g].events[e].counter == counter && threads[t].groups[g].fd[e] < 0)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+const char *perf_counters_error() {
+  int errnum = num_threads > 0 ? 0 : ENOMEM;
+  for (int t = 0; t < num_threads && errnum == 0; t++)
+    errnum = threads[t].errnum;
+
+  if (errnum == 0)
+    error[0] = '\0';
+  else if (errnum == EACCES || errnum == EPERM)
+    snprintf(error, sizeof(error), "%s, see /proc/sys/kernel/perf_event_paranoid", strerror(errnum));
+  else if (errnum == ENOENT || errnum == EOPNOTSUPP)
+    snprintf(error, sizeof(error), "no hardware PMU available");
+  else
+    snprintf(error, sizeof(error), "%s", strerror(errnum));
+  return error;
+}
+
+void perf_counters_read(int thread, perf_counts *counts) {
+  memset(counts, 0, sizeof(*counts));
+
+  perf_thread *t = thread_groups(thread);
+  if (t == NULL)
+    return;
+
+  for (int g = 0; g < 2; g++) {
+    const perf_group *group = &t->groups[g];
+    if (group->fd[0] < 0)
+      continue;
+
+    struct {
+      uint64_t nr;
+      uint64_t time_enabled;
+      uint64_t time_running;
+      uint64_t values[PERF_NUM_COUNTERS];
+    } data;
+
+    if (read(group->fd[0], &data, sizeof(data)) < (ssize_t)(3 + group->size) * (ssize_t)sizeof(uint64_t))
+      continue;
+
+    // Estimate of the full count when the group shared the PMU with others
+    double scale = data.time_running > 0 ? (double)data.time_enabled / data.time_running : 0.0;
+    for (int e = 0; e < group->size; e++)
+      counts->value[group->events[e].counter] = data.values[e] * scale;
+  }
+}
+
+/**
+ * @brief Stops or restarts the groups of a thread
+ */
+static void enable(int thread, unsigned long request) {
+  perf_thread *t = thread_groups(thread);
+  if (t == NULL)
+    return;
+
+  for (int g = 0; g < 2; g++) {
+    if (t->groups[g].fd[0] >= 0)
+      ioctl(t->groups[g].fd[0], request, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void perf_counters_pause(int thread) {
+  enable(thread, PERF_EVENT_IOC_DISABLE);
+}
+
+void perf_counters_resume(int thread) {
+  enable(thread, PERF_EVENT_IOC_ENABLE);
+}
+
+void perf_counters_close() {
+  for (int t = 0; t < num_threads; t++)
+    for (int g = 0; g < 2; g++)
+      close_group(&threads[t].groups[g]);
+
+  free(threads);
+  threads = NULL;
+  num_threads = 0;
+}
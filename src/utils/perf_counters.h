@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+#include <stdbool.h>
+
+/**
+ * @brief Hardware performance counters of a team of threads, read through perf_event_open(2)
+ * @details Every thread opens its own counters, numbered from 0 as the members of a team, and reads or pauses them by
+ * its number. The counters of each thread are opened as two groups, each scheduled on the PMU as a whole: the core group (cycles,
+ * instructions and last level cache references and misses), and the floating point group (scalar and packed double
+ * precision arithmetic instructions), which uses raw events only available on Intel cores since Broadwell. Either group
+ * may be missing, e.g. in virtual machines without a virtual PMU or when perf_event_paranoid forbids it, and the
+ * counters of a missing group read as zero. When the groups don't fit the PMU together the kernel multiplexes them, and
+ * the values are scaled up to the time the group was enabled.
+ */
+
+typedef enum perf_counter_t {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_LLC_REFERENCES,
+  PERF_LLC_MISSES,
+  PERF_FP_SCALAR,  // Scalar double precision arithmetic instructions
+  PERF_FP_PACKED,  // Packed double precision arithmetic instructions, of any vector width
+  PERF_NUM_COUNTERS
+} perf_counter;
+
+typedef struct perf_counts_t {
+  double value[PERF_NUM_COUNTERS];
+} perf_counts;
+
+/**
+ * @brief Makes room for the counters of a number of threads, closing the previous ones, before the threads open theirs
+ */
+extern void perf_counters_init(int threads);
+
+/**
+ * @brief Opens the counters of the calling thread as thread number thread, counting user space only
+ * @return Whether the core group is available
+ */
+extern bool perf_counters_open(int thread);
+
+/**
+ * @brief Whether a counter was opened successfully by every thread
+ */
+extern bool perf_counters_available(perf_counter counter);
+
+/**
+ * @brief Why the core group couldn't be opened by a thread, an empty string if every thread opened it
+ */
+extern const char *perf_counters_error();
+
+/**
+ * @brief Reads the running totals of every counter of a thread, zero for the unavailable ones
+ */
+extern void perf_counters_read(int thread, perf_counts *counts);
+
+/**
+ * @brief Stops the counters of a thread until perf_counters_resume(), called by the thread itself, e.g. while it waits
+ * at a barrier. Does nothing for a thread without counters.
+ */
+extern void perf_counters_pause(int thread);
+
+extern void perf_counters_resume(int thread);
+
+/**
+ * @brief Closes the counters of every thread, from any thread, safe to call when they aren't open
+ */
+extern void perf_counters_close();
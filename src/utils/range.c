@@ -26,7 +26,7 @@
     for (int tile = 0; tile < tiles_per_chunk; tile++) {                                   \
       tile_type *cur_tile = &chunk.tiles[tile];                                            \
                                                                                            \
-      int stride = (cur_tile->t_xmax + xmax) - (cur_tile->t_xmin + xmin) + 1;              \
+      size_t stride = (cur_tile->t_xmax + xmax) - (cur_tile->t_xmin + xmin) + 1;           \
       for (int k = 0; k <= (cur_tile->t_ymax + ymax) - (cur_tile->t_ymin + ymin); k++) {   \
         for (int j = 0; j <= (cur_tile->t_xmax + xmax) - (cur_tile->t_xmin + xmin); j++) { \
           if (cur_tile->field.array[k * stride + j] < cur_min)                             \
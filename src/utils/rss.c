@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "rss.h"
+
+#include <sys/resource.h>
+
+double peak_rss() {
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0.0;
+
+  // Linux reports it in kilobytes
+  return usage.ru_maxrss * 1024.0;
+}
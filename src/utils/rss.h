@@ -0,0 +1,11 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+/**
+ * @brief Peak resident set size of the process so far, from getrusage(2)
+ * @details This is the high water mark of the whole process: in batch runs it covers every deck run so far.
+ * @return The peak in bytes, 0 if it can't be read
+ */
+extern double peak_rss();
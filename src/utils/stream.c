@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#include "stream.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "timer.h"
+
+#define STREAM_MIN_BYTES (32L << 20)
+#define STREAM_MAX_BYTES (256L << 20)
+#define STREAM_RUNS      5
+
+static pthread_once_t probe_once = PTHREAD_ONCE_INIT;
+static double bandwidth = 0.0;
+
+// Keeps the compiler from dropping the triads, whose results are otherwise never read
+static volatile double sink;
+
+static void probe() {
+  long cache = sysconf(_SC_LEVEL3_CACHE_SIZE);
+  if (cache <= 0)
+    cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+
+  // Virtual machines may report the cache of the whole host, keep the arrays within a fraction of the memory
+  long memory = sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+  long limit = memory > 0 && memory / 16 < STREAM_MAX_BYTES ? memory / 16 : STREAM_MAX_BYTES;
+
+  long bytes = 4 * cache > STREAM_MIN_BYTES ? 4 * cache : STREAM_MIN_BYTES;
+  if (bytes > limit)
+    bytes = limit > STREAM_MIN_BYTES ? limit : STREAM_MIN_BYTES;
+  long n = bytes / sizeof(double);
+
+  double *a = malloc(n * sizeof(double));
+  double *b = malloc(n * sizeof(double));
+  double *c = malloc(n * sizeof(double));
+  if (a == NULL || b == NULL || c == NULL) {
+    free(a);
+    free(b);
+    free(c);
+    return;
+  }
+
+  // Touch every page before timing
+  for (long i = 0; i < n; i++) {
+    a[i] = 0.0;
+    b[i] = 1.0;
+    c[i] = 2.0;
+  }
+
+  double best = 0.0;
+  for (int run = 0; run < STREAM_RUNS; run++) {
+    double start = timer();
+    for (long i = 0; i < n; i++)
+      a[i] = b[i] + 3.0 * c[i];
+    double elapsed = timer() - start;
+
+    sink += a[run];
+    if (best == 0.0 || elapsed < best)
+      best = elapsed;
+  }
+
+  if (best > 0.0)
+    bandwidth = 3.0 * n * sizeof(double) / best;
+
+  free(a);
+  free(b);
+  free(c);
+}
+
+double stream_bandwidth() {
+  pthread_once(&probe_once, probe);
+  return bandwidth;
+}
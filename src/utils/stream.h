@@ -0,0 +1,14 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+/**
+ * @brief Sustainable memory bandwidth of the machine, the ceiling of the roofline model
+ * @details Measured with the triad of the STREAM benchmark, a[i] = b[i] + s * c[i], on arrays four times the size of
+ * the last level cache, between 32 and 256 MB each and within 1/16 of the memory, taking the best of a few runs and
+ * counting 24 bytes per element as STREAM does. The arrays count towards the peak RSS of the process. The probe runs on the first call only, once per process: in batch runs it shares the memory bus with
+ * the decks already running, and reports the share it got.
+ * @return The bandwidth in bytes per second, 0 if the arrays couldn't be allocated
+ */
+extern double stream_bandwidth();
@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+/**
+ * @brief Storage qualifier for the program's global state.
+ * In batch builds (see batch.c) every worker thread runs its own independent simulation, so each thread needs its own
+ * copy of the globals. In all other builds it expands to nothing and the globals are plain process-wide variables.
+ */
+#ifdef BATCH_ENABLED
+#define BATCH_LOCAL __thread
+#else
+#define BATCH_LOCAL
+#endif
@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Niccolò Betto
+
+#include "thread_pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct pool_job_t {
+  thread_pool_task task;
+  void *arg;
+  struct pool_job_t *next;
+} pool_job;
+
+struct thread_pool_t {
+  pthread_mutex_t lock;
+  pthread_cond_t job_available;
+  pthread_cond_t all_done;
+
+  pool_job *head;
+  pool_job *tail;
+  int pending;  // Jobs queued or running
+  bool stopping;
+
+  int num_threads;
+  pthread_t *threads;
+};
+
+static void *pool_worker(void *arg) {
+  thread_pool *pool = arg;
+
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (pool->head == NULL && !pool->stopping)
+      pthread_cond_wait(&pool->job_available, &pool->lock);
+
+    if (pool->head == NULL)
+      break;  // Stopping and nothing left to run
+
+    pool_job *job = pool->head;
+    pool->head = job->next;
+    if (pool->head == NULL)
+      pool->tail = NULL;
+
+    pthread_mutex_unlock(&pool->lock);
+    job->task(job->arg);
+    free(job);
+    pthread_mutex_lock(&pool->lock);
+
+    if (--pool->pending == 0)
+      pthread_cond_broadcast(&pool->all_done);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+thread_pool *thread_pool_create(int num_threads) {
+  thread_pool *pool = calloc(1, sizeof(thread_pool));
+  if (pool == NULL)
+    return NULL;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->job_available, NULL);
+  pthread_cond_init(&pool->all_done, NULL);
+
+  pool->threads = malloc(num_threads * sizeof(pthread_t));
+  if (pool->threads == NULL) {
+    free(pool);
+    return NULL;
+  }
+
+  for (int i = 0; i < num_threads; i++) {
+    if (pthread_create(&pool->threads[i], NULL, pool_worker, pool) != 0) {
+      pool->num_threads = i;
+      thread_pool_destroy(pool);
+      return NULL;
+    }
+  }
+  pool->num_threads = num_threads;
+
+  return pool;
+}
+
+void thread_pool_submit(thread_pool *pool, thread_pool_task task, void *arg) {
+  pool_job *job = malloc(sizeof(pool_job));
+  job->task = task;
+  job->arg = arg;
+  job->next = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->tail != NULL)
+    pool->tail->next = job;
+  else
+    pool->head = job;
+  pool->tail = job;
+  pool->pending++;
+  pthread_cond_signal(&pool->job_available);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_wait(thread_pool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  while (pool->pending > 0)
+    pthread_cond_wait(&pool->all_done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_destroy(thread_pool *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->job_available);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (int i = 0; i < pool->num_threads; i++)
+    pthread_join(pool->threads[i], NULL);
+
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->job_available);
+  pthread_cond_destroy(&pool->all_done);
+  free(pool->threads);
+  free(pool);
+}
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: MIT
+// Copyright (C) 2022 Niccolò Betto
+
+/*
+ * Minimal fixed-size thread pool, executing submitted tasks in FIFO order
+ */
+
+#pragma once
+
+typedef struct thread_pool_t thread_pool;
+
+typedef void (*thread_pool_task)(void *arg);
+
+/**
+ * @brief Creates a pool of worker threads
+ * @param num_threads The number of worker threads, at least 1
+ * @return The new pool, or NULL if the threads could not be created
+ */
+extern thread_pool *thread_pool_create(int num_threads);
+
+/**
+ * @brief Queues a task for execution on one of the pool's workers
+ */
+extern void thread_pool_submit(thread_pool *pool, thread_pool_task task, void *arg);
+
+/**
+ * @brief Blocks until all the submitted tasks have completed
+ */
+extern void thread_pool_wait(thread_pool *pool);
+
+/**
+ * @brief Waits for the submitted tasks to complete, then stops the workers and frees the pool
+ */
+extern void thread_pool_destroy(thread_pool *pool);
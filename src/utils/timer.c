@@ -2,11 +2,10 @@
 // Copyright (C) 2022 Niccolò Betto
 // Crown Copyright (C) 2012 AWE
 
-#include <stddef.h>
-#include <sys/time.h>
+#include <time.h>
 
 double timer() {
-  struct timeval t;
-  gettimeofday(&t, (struct timezone *)NULL);
-  return t.tv_sec + t.tv_usec * 1.0e-6;
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1.0e-9;
 }
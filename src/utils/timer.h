@@ -4,7 +4,7 @@
 #pragma once
 
 /**
- * @brief C timer function
- * @return The time elapsed in 'seconds.microseconds'
+ * @brief C timer function, reading the monotonic clock with nanosecond resolution
+ * @return The time elapsed since an arbitrary point in the past, in seconds
  */
 extern double timer();
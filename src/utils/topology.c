@@ -0,0 +1,196 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#define _GNU_SOURCE
+
+#include "topology.h"
+
+#include <dirent.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Reads the first number of a CPU list file of sysfs, such as "0-3,8-11"
+ * @return The number, -1 if the file can't be read
+ */
+static int first_in_list(const char *path) {
+  int first = -1;
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return -1;
+  if (fscanf(file, "%d", &first) != 1)
+    first = -1;
+  fclose(file);
+  return first;
+}
+
+/**
+ * @brief Marks the CPUs of a CPU list file of sysfs as on a node
+ */
+static void read_node(const char *path, int node, int *node_of, int num) {
+  int lo, hi;
+  char separator;
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return;
+
+  while (fscanf(file, "%d", &lo) == 1) {
+    hi = lo;
+    if (fscanf(file, "%c", &separator) == 1 && separator == '-') {
+      if (fscanf(file, "%d", &hi) != 1)
+        break;
+      if (fscanf(file, "%c", &separator) != 1)
+        separator = '\n';
+    }
+    for (int cpu = lo; cpu <= hi && cpu < num; cpu++)
+      node_of[cpu] = node;
+    if (separator != ',')
+      break;
+  }
+  fclose(file);
+}
+
+/**
+ * @brief Ranks a CPU for the ordering: its node first, then whether it is the first hardware thread of its core
+ */
+static long rank(int cpu, const int *node_of) {
+  char path[96];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+  int first = first_in_list(path);
+  bool sibling = first >= 0 && first != cpu;
+
+  return ((long)node_of[cpu] * 2 + sibling) * CPU_SETSIZE + cpu;
+}
+
+int topology_cpus(int *cpus, int *nodes, int max) {
+  cpu_set_t allowed;
+  int node_of[CPU_SETSIZE] = {0};
+  long ranks[CPU_SETSIZE];
+  int num = 0;
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return 0;
+
+  DIR *dir = opendir("/sys/devices/system/node");
+  if (dir != NULL) {
+    struct dirent *entry;
+    int node;
+    char path[300];
+
+    while ((entry = readdir(dir)) != NULL) {
+      if (sscanf(entry->d_name, "node%d", &node) != 1)
+        continue;
+      snprintf(path, sizeof(path), "/sys/devices/system/node/%s/cpulist", entry->d_name);
+      read_node(path, node, node_of, CPU_SETSIZE);
+    }
+    closedir(dir);
+  }
+
+  // Insertion sort by rank, there are at most a few hundred CPUs
+  for (int cpu = 0; cpu < CPU_SETSIZE && num < max; cpu++) {
+    if (!CPU_ISSET(cpu, &allowed))
+      continue;
+
+    long r = rank(cpu, node_of);
+    int i = num++;
+    for (; i > 0 && ranks[i - 1] > r; i--) {
+      ranks[i] = ranks[i - 1];
+      cpus[i] = cpus[i - 1];
+    }
+    ranks[i] = r;
+    cpus[i] = cpu;
+  }
+
+  for (int i = 0; i < num; i++)
+    nodes[i] = node_of[cpus[i]];
+
+  return num;
+}
+
+/**
+ * @brief Reads a cache size file of sysfs, such as "2048K"
+ * @return The size in bytes, 0 if the file can't be read
+ */
+static long read_size(const char *path) {
+  long size = 0;
+  char unit = '\0';
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL)
+    return 0;
+  if (fscanf(file, "%ld%c", &size, &unit) < 1)
+    size = 0;
+  fclose(file);
+
+  if (unit == 'K')
+    size *= 1024;
+  else if (unit == 'M')
+    size *= 1024 * 1024;
+  return size;
+}
+
+long topology_cache(int level) {
+  cpu_set_t allowed;
+  int cpu = 0;
+  char path[128], type[16];
+
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    while (cpu < CPU_SETSIZE - 1 && !CPU_ISSET(cpu, &allowed))
+      cpu++;
+  }
+
+  for (int index = 0;; index++) {
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+    int cache_level = first_in_list(path);
+    if (cache_level < 0)
+      break;
+    if (cache_level != level)
+      continue;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu, index);
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+      continue;
+    bool data = fscanf(file, "%15s", type) == 1 && type[0] != 'I';
+    fclose(file);
+    if (!data)
+      continue;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/size", cpu, index);
+    return read_size(path);
+  }
+
+  long size = sysconf(level == 2 ? _SC_LEVEL2_CACHE_SIZE : level == 3 ? _SC_LEVEL3_CACHE_SIZE : _SC_LEVEL1_DCACHE_SIZE);
+  return size > 0 ? size : 0;
+}
+
+bool topology_cpu_info(const char *field, char *value, size_t size) {
+  char *line = NULL;
+  size_t capacity = 0, length = strlen(field);
+  bool found = false;
+
+  FILE *info = fopen("/proc/cpuinfo", "r");
+  if (info == NULL)
+    return false;
+
+  // The flags run to thousands of characters, the names are padded up to the colon with tabs
+  while (!found && getline(&line, &capacity, info) > 0) {
+    char *colon = strchr(line, ':');
+    if (colon == NULL || strncmp(line, field, length) != 0 || line + length + strspn(line + length, " \t") != colon)
+      continue;
+
+    snprintf(value, size, "%s", colon + strspn(colon + 1, " ") + 1);
+    value[strcspn(value, "\n")] = '\0';
+    found = true;
+  }
+
+  free(line);
+  fclose(info);
+  return found;
+}
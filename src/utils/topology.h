@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+// Copyright (C) 2022 Niccolò Betto
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The CPUs the process may run on, grouped by NUMA node, from sched_getaffinity(2) and sysfs
+ * @details Within a node the first CPU of every core comes first, then its other hardware threads, so that the first
+ * CPUs of a node each have a core of their own. Without NUMA information in sysfs every CPU is on node 0.
+ * @param cpus Filled with the CPU numbers, in that order
+ * @param nodes Filled with the node of each CPU
+ * @param max Capacity of both arrays
+ * @return The number of CPUs, 0 if the affinity can't be read
+ */
+extern int topology_cpus(int *cpus, int *nodes, int max);
+
+/**
+ * @brief Size of the data or unified cache of a level, as seen by the first CPU the process may run on, from sysfs
+ * @details Falls back on sysconf(3) when sysfs doesn't list the caches.
+ * @return The size in bytes, 0 if unknown
+ */
+extern long topology_cache(int level);
+
+/**
+ * @brief A field of the first processor listed in /proc/cpuinfo, such as "model name" or "flags"
+ * @param value Filled with the value of the field, cut to size, left as it is when the field isn't listed
+ * @return Whether the field is listed
+ */
+extern bool topology_cpu_info(const char *field, char *value, size_t size);